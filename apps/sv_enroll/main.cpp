@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <iostream>
+#include <optional>
 
 #include <libvoicefeat/libvoicefeat.h>
 #include <filesystem>
@@ -8,6 +9,10 @@
 #include "sv/gmm/gmm_model.h"
 #include "sv/gmm/gmm_model_serdes.h"
 #include "sv/gmm/map_adaptor.h"
+#include "sv/gmm/speaker_stats.h"
+#include "sv/gmm/speaker_stats_serdes.h"
+#include "sv/gmm/ubm_posterior_cache.h"
+#include "sv/io/feature_projection_serdes.h"
 #include "sv/io/feature_serdes.h"
 
 using namespace libvoicefeat;
@@ -37,26 +42,84 @@ ListOfPaths getAllLvfFilesFromDir(const fs::path& rootDir) // TODO: DRY
     return paths;
 }
 
-int main()
+// sv_enroll [--posterior-cache=DIR] [--top-c=20]
+// By default every utterance is accumulated with exact UBM posteriors.
+// --posterior-cache accumulates from top-C renormalized posteriors kept in
+// DIR (see UbmPosteriorCache) instead; stored stats of the other mode are
+// not mixed in but accumulated again.
+int main(int argc, char** argv)
 {
     auto spkLfvFiles = getAllLvfFilesFromDir("../../../data/features/TEST/DR1/FAKS0");
+    const fs::path statsPath = "../../../data/models/spk_FAKS0.stats";
+
+    fs::path cacheDir;
+    std::optional<std::size_t> topC;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--posterior-cache") cacheDir = val;
+        else if (key == "--top-c") topC = std::stoul(val);
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    if (topC && cacheDir.empty())
+        throw std::runtime_error("--top-c needs --posterior-cache=DIR");
+
+    const fs::path ubmPath = "../../../data/models/ubm.bin";
     GmmModelSerdes ubmSerdes;
-    sv::io::FeatureSerdes featureSerdes;
-    GmmModel ubm = ubmSerdes.load("../../../data/models/ubm.bin");
+    SpeakerStatsSerdes statsSerdes;
+    GmmModel ubm = ubmSerdes.load(ubmPath);
+    const uint64_t ubmFingerprint = GmmModelSerdes::fingerprint(ubm);
+    sv::io::FeatureSerdes featureSerdes(
+        sv::io::FeatureProjectionSerdes().featureOptionsFor(ubmPath, ubmFingerprint));
     GmmBwStatsAccumulator acc;
-    BwStats stats(ubm.numGaussians, ubm.dim);
+    auto& ws = sv::util::Workspace::local();
+
+    std::optional<UbmPosteriorCache> cache;
+    PrecomputedGmm ubmPre;
+    if (cacheDir.empty()) ubmPre = acc.precompute(ubm);
+    else cache.emplace(ubm, UbmPosteriorCache::Options{.topC = topC.value_or(20), .directory = cacheDir});
+    UtterancePosteriors post;
 
+    const SpeakerStatsSerdes::SaveOptions statsOptions{
+        .ubmFingerprint = ubmFingerprint,
+        .posteriorTopC = cache ? static_cast<uint32_t>(cache->topC()) : 0u};
+
+    // previously enrolled utterances are reused from their stored stats,
+    // unless those were accumulated against another UBM or in the other mode
+    SpeakerStats spkStats = statsSerdes.loadMatching(statsPath, statsOptions, ubm.numGaussians, ubm.dim);
+
+    std::size_t added = 0;
     for (auto& lvf : spkLfvFiles) {
+        const std::string uttId = lvf.filename().string();
+        if (spkStats.hasUtterance(uttId)) continue;
+
+        BwStats stats(ubm.numGaussians, ubm.dim);
         auto feat = featureSerdes.load(lvf);
-        acc.accumulate(stats, ubm, feat.getComputedMatrix());
+        const auto& m = feat.getComputedMatrix();
+        if (cache) {
+            cache->fetch(lvf, m, post, ws);
+            acc.accumulate(stats, post, m, ws);
+        } else {
+            acc.accumulate(stats, ubmPre, m, ws);
+        }
+        spkStats.addUtterance(UtteranceStats::fromBwStats(uttId, stats));
+        ++added;
     }
 
+    std::cout << "utterances: " << spkStats.utterances().size()
+              << " (new: " << added << ")\n";
+
     GmmMapAdaptor adaptor({ .relevanceFactor = 16.0 });
-    GmmModel spkModel = adaptor.adaptMeansOnly(ubm, stats);
+    GmmModel spkModel = adaptor.adaptMeansOnly(ubm, spkStats);
 
     GmmModelSerdes spkSerdes;
 
-    spkSerdes.save("../../../data/models/spk_FAKS0.bin", spkModel);
+    spkSerdes.save("../../../data/models/spk_FAKS0.bin", spkModel, { .ubmFingerprint = ubmFingerprint });
+    statsSerdes.save(statsPath, spkStats, statsOptions);
 
     return 0;
 }
\ No newline at end of file
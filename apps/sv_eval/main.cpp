@@ -7,12 +7,16 @@
 #include <unordered_map>
 #include <vector>
 #include <numeric>
+#include <optional>
 
 #include "sv/gmm/gmm_model.h"
 #include "sv/gmm/gmm_model_serdes.h"
 #include "sv/gmm/bw_stats_accumulator.h"
 #include "sv/gmm/map_adaptor.h"
 #include "sv/gmm/scorer.h"
+#include "sv/gmm/ubm_posterior_cache.h"
+#include "sv/io/feature_prefetcher.h"
+#include "sv/io/feature_projection_serdes.h"
 #include "sv/io/feature_serdes.h"
 
 namespace fs = std::filesystem;
@@ -136,20 +140,40 @@ void splitEnrollTest(std::vector<SpeakerData>& speakers, const size_t enrollN, c
     }
 }
 
+// cache == nullptr: exact UBM posteriors
 SpeakerModelsMap buildSpeakerModels(std::vector<SpeakerData>& speakers, GmmBwStatsAccumulator& acc,
-    FeatureSerdes& featureSerdes, GmmModel& ubm, GmmMapAdaptor& adaptor)
+    FeatureSerdes& featureSerdes, GmmModel& ubm, GmmMapAdaptor& adaptor, const UbmPosteriorCache* cache)
 {
     SpeakerModelsMap spkModels;
     spkModels.reserve(speakers.size());
 
+    // every enrollment file in speaker order, read ahead while we accumulate
+    std::vector<fs::path> files;
+    for (const auto& s : speakers) files.insert(files.end(), s.enroll.begin(), s.enroll.end());
+
+    sv::io::FeaturePrefetcher prefetcher(featureSerdes, files);
+    libvoicefeat::features::Feature feat;
+    UtterancePosteriors post;
+
+    const PrecomputedGmm ubmPre = cache ? PrecomputedGmm() : acc.precompute(ubm);
+    auto& ws = sv::util::Workspace::local();
+
     for (const auto& s : speakers)
     {
         BwStats stats(ubm.numGaussians, ubm.dim);
 
-        for (const auto& f : s.enroll)
+        for (std::size_t i = 0; i < s.enroll.size() && prefetcher.next(feat); ++i)
         {
-            auto feat = featureSerdes.load(f);
-            acc.accumulate(stats, ubm, feat.getComputedMatrix());
+            const auto& m = feat.getComputedMatrix();
+            if (cache)
+            {
+                cache->fetch(files[prefetcher.index()], m, post, ws);
+                acc.accumulate(stats, post, m, ws);
+            }
+            else
+            {
+                acc.accumulate(stats, ubmPre, m, ws);
+            }
         }
 
         auto spkModel = adaptor.adaptMeansOnly(ubm, stats);
@@ -159,10 +183,29 @@ SpeakerModelsMap buildSpeakerModels(std::vector<SpeakerData>& speakers, GmmBwSta
     return spkModels;
 }
 
-int main()
+// sv_eval [--posterior-cache=DIR] [--top-c=20]
+// By default enrollment and trials use exact UBM posteriors.
+// --posterior-cache takes the UBM side from top-C renormalized posteriors
+// kept in DIR (see UbmPosteriorCache), computed once per utterance.
+int main(int argc, char** argv)
 {
     try
     {
+        fs::path cacheDir;
+        std::optional<std::size_t> topC;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto eq = arg.find('=');
+            const std::string key = arg.substr(0, eq);
+            const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+            if (key == "--posterior-cache") cacheDir = val;
+            else if (key == "--top-c") topC = std::stoul(val);
+            else throw std::runtime_error("Unknown argument: " + arg);
+        }
+        if (topC && cacheDir.empty()) throw std::runtime_error("--top-c needs --posterior-cache=DIR");
+
         const fs::path root = "../../../data/features/TEST";
         constexpr size_t targetSpeakers = 30;
         constexpr size_t enrollN = 5;
@@ -172,13 +215,34 @@ int main()
         const uint32_t seed = 777;
 
         GmmModelSerdes modelSerdes;
-        GmmModel ubm = modelSerdes.load("../../../data/models/ubm.bin");
+        const fs::path ubmPath = "../../../data/models/ubm.bin";
+        GmmModel ubm = modelSerdes.load(ubmPath);
 
-        FeatureSerdes featureSerdes;
+        // features are projected on load when the UBM was trained on projected ones
+        FeatureSerdes featureSerdes(FeatureProjectionSerdes().featureOptionsFor(ubmPath, GmmModelSerdes::fingerprint(ubm)));
         GmmBwStatsAccumulator acc;
         GmmMapAdaptor adaptor({.relevanceFactor = 16.0, .minOcc = 1e-3});
         GmmLlrScorer scorer;
 
+        // UBM posteriors per utterance, reused by enrollment and every trial;
+        // entries of another UBM or changed features are recomputed
+        std::optional<UbmPosteriorCache> cache;
+        if (!cacheDir.empty())
+            cache.emplace(ubm, UbmPosteriorCache::Options{.topC = topC.value_or(20), .directory = cacheDir});
+        const PrecomputedGmm ubmPre = scorer.precompute(ubm);
+        UtterancePosteriors post;
+        auto& ws = sv::util::Workspace::local();
+
+        auto scoreTrial = [&](const PrecomputedGmm& model, const fs::path& testFile)
+        {
+            auto feat = featureSerdes.load(testFile);
+            const auto& m = feat.getComputedMatrix();
+            if (!cache) return scorer.score(model, ubmPre, m, ws);
+
+            cache->fetch(testFile, m, post, ws);
+            return scorer.score(model, post, m, ws);
+        };
+
         auto speakers = collectSpeakers(root);
 
         removeSpeakersWithBadAmountOfFiles(speakers, enrollN + testM);
@@ -195,17 +259,29 @@ int main()
 
         splitEnrollTest(speakers, enrollN, testM);
 
-        SpeakerModelsMap spkModels = buildSpeakerModels(speakers, acc, featureSerdes, ubm, adaptor);
+        if (cache)
+        {
+            Paths files;
+            for (const auto& s : speakers)
+            {
+                files.insert(files.end(), s.enroll.begin(), s.enroll.end());
+                files.insert(files.end(), s.test.begin(), s.test.end());
+            }
+            const std::size_t computed = cache->precompute(files, featureSerdes);
+            std::cout << "posterior cache: " << computed << " of " << files.size() << " utterances computed\n";
+        }
+
+        SpeakerModelsMap spkModels = buildSpeakerModels(speakers, acc, featureSerdes, ubm, adaptor,
+                                                         cache ? &*cache : nullptr);
 
         // Genuine
         for (const auto& s : speakers)
         {
-            const auto& model = spkModels.at(s.id);
+            const PrecomputedGmm model = scorer.precompute(spkModels.at(s.id), ubmPre);
 
             for (const auto& testFile : s.test)
             {
-                auto feat = featureSerdes.load(testFile);
-                const double sc = scorer.score(model, ubm, feat.getComputedMatrix());
+                const double sc = scoreTrial(model, testFile);
 
                 scores.genuineScores.push_back(sc);
 
@@ -220,7 +296,7 @@ int main()
 
         for (const auto& s : speakers)
         {
-            const auto& model = spkModels.at(s.id);
+            const PrecomputedGmm model = scorer.precompute(spkModels.at(s.id), ubmPre);
 
             size_t added = 0;
             while (added < impostorPerSpeaker)
@@ -232,8 +308,7 @@ int main()
                 std::uniform_int_distribution<size_t> tfDist(0, other.test.size() - 1);
                 const auto& testFile = other.test[tfDist(rng)];
 
-                auto feat = featureSerdes.load(testFile);
-                const double sc = scorer.score(model, ubm, feat.getComputedMatrix());
+                const double sc = scoreTrial(model, testFile);
 
                 scores.impostorScores.push_back(sc);
 
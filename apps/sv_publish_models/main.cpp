@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/shared_model_store.h"
+#include "sv/io/feature_projection_serdes.h"
+
+namespace fs = std::filesystem;
+
+// Publishes the UBM and every speaker model into a shared segment that
+// sv_server --shared=<name> (and any other attached process) maps read-only.
+// Running it again publishes the next generation; attached servers pick it
+// up on their own. The UBM's projection (<ubm>.proj), if it has one, is
+// published with it, so servers project features for the UBM they attach.
+//
+// sv_publish_models [--name=sv] [--ubm=...] [--models=...] [--shm-dir=/dev/shm]
+int main(int argc, char** argv)
+{
+    std::string name = "sv";
+    fs::path ubmPath = "../../../data/models/ubm.bin";
+    fs::path modelDir = "../../../data/models";
+    const std::string prefix = "spk_";
+    const std::string extension = ".bin";
+    sv::gmm::SharedModelStore::Options opt;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const auto eq = arg.find('=');
+            const std::string key = arg.substr(0, eq);
+            const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+            if (key == "--name") name = val;
+            else if (key == "--ubm") ubmPath = val;
+            else if (key == "--models") modelDir = val;
+            else if (key == "--shm-dir") opt.root = val;
+            else throw std::runtime_error("Unknown argument: " + arg);
+        }
+
+        const auto ubm = sv::gmm::GmmModelSerdes().load(ubmPath);
+        // throws if the .proj next to the UBM was saved for another one
+        const auto projection = sv::io::FeatureProjectionSerdes()
+                                    .featureOptionsFor(ubmPath, sv::gmm::GmmModelSerdes::fingerprint(ubm))
+                                    .projection;
+
+        std::vector<std::pair<std::string, fs::path>> speakers;
+        for (const auto& entry : fs::directory_iterator(modelDir))
+        {
+            if (!entry.is_regular_file()) continue;
+
+            const std::string file = entry.path().filename().string();
+            if (file.size() <= prefix.size() + extension.size()) continue;
+            if (file.compare(0, prefix.size(), prefix) != 0) continue;
+            if (file.compare(file.size() - extension.size(), extension.size(), extension) != 0) continue;
+
+            speakers.emplace_back(file.substr(prefix.size(), file.size() - prefix.size() - extension.size()),
+                                  entry.path());
+        }
+        std::sort(speakers.begin(), speakers.end());
+
+        const sv::gmm::SharedModelStore store(opt);
+        const uint64_t generation = store.publishFiles(name, ubm, speakers, projection.get());
+        const auto segment = store.attach(name);
+
+        std::cout << "[publish] " << store.linkPath(name).string() << " generation=" << generation
+                  << " speakers=" << segment->size() << " bytes=" << segment->bytes()
+                  << " projected=" << (segment->ubm()->projection ? 1 : 0) << "\n";
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,389 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sv/gmm/bw_stats_accumulator.h"
+#include "sv/gmm/map_adaptor.h"
+#include "sv/gmm/model_registry.h"
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/shared_model_store.h"
+#include "sv/gmm/speaker_stats.h"
+#include "sv/gmm/speaker_stats_serdes.h"
+#include "sv/io/feature_serdes.h"
+#include "sv/service/latency_recorder.h"
+#include "sv/service/verify_batcher.h"
+
+namespace fs = std::filesystem;
+
+using namespace sv::gmm;
+using namespace sv::service;
+
+// Line protocol, one request per line, one response line per request:
+//   VERIFY <speakerId> <file.lvf>           -> OK <score>
+//   ENROLL <speakerId> <file.lvf> [...]     -> OK <numUtterances>
+//   STATS                                   -> OK key=value ...
+//   SHUTDOWN                                -> OK
+// Speaker IDs are [A-Za-z0-9_-] only (they name files under the model dir).
+// Errors are answered with "ERR <message>".
+
+struct ServerConfig
+{
+    fs::path socketPath = "/tmp/sv_server.sock";
+    fs::path ubmPath = "../../../data/models/ubm.bin";
+    fs::path modelDir = "../../../data/models";
+    std::size_t cacheMb = 256;
+    VerifyBatcher::Options batch{};
+
+    // attach the UBM and models published by sv_publish_models instead of
+    // loading private copies; newer generations are picked up while running
+    std::string sharedName;
+    fs::path shmDir = "/dev/shm";
+};
+
+static std::atomic<bool> g_stop{false};
+
+static void onSignal(int)
+{
+    g_stop.store(true);
+}
+
+static ServerConfig parseArgs(int argc, char** argv)
+{
+    ServerConfig cfg;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto eq = arg.find('=');
+        const std::string key = arg.substr(0, eq);
+        const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--socket") cfg.socketPath = val;
+        else if (key == "--ubm") cfg.ubmPath = val;
+        else if (key == "--models") cfg.modelDir = val;
+        else if (key == "--cache-mb") cfg.cacheMb = std::stoul(val);
+        else if (key == "--batch") cfg.batch.maxBatch = std::stoul(val);
+        else if (key == "--wait-us") cfg.batch.maxWait = std::chrono::microseconds(std::stol(val));
+        else if (key == "--threads") cfg.batch.numThreads = std::stoul(val);
+        else if (key == "--shared") cfg.sharedName = val;
+        else if (key == "--shm-dir") cfg.shmDir = val;
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    return cfg;
+}
+
+// Runs fn and records how long it took, whether it returns or throws.
+template <class Fn>
+static auto timed(LatencyRecorder& recorder, Fn&& fn)
+{
+    struct Record
+    {
+        LatencyRecorder& recorder;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        ~Record() { recorder.record(std::chrono::steady_clock::now() - t0); }
+    } record{recorder};
+
+    return fn();
+}
+
+class Server
+{
+public:
+    explicit Server(const ServerConfig& cfg)
+        : _cfg(cfg),
+          _store({.root = cfg.shmDir}),
+          _segment(cfg.sharedName.empty() ? nullptr : _store.attach(cfg.sharedName)),
+          _registry(_segment ? _segment->ubm() : ModelRegistry::loadUbm(cfg.ubmPath),
+                    {.modelDir = cfg.modelDir, .maxBytes = cfg.cacheMb << 20}),
+          _batcher(_registry, cfg.batch)
+    {
+        if (_segment) _registry.attach(std::move(_segment));
+    }
+
+    // Attaches a newer published generation, if there is one.
+    void refreshShared()
+    {
+        if (_cfg.sharedName.empty()) return;
+
+        const uint64_t generation = _store.currentGeneration(_cfg.sharedName);
+        if (generation == 0 || generation == _registry.attachedGeneration()) return;
+
+        _registry.attach(_store.attach(_cfg.sharedName));
+        std::cout << "[server] attached " << _cfg.sharedName << " generation " << generation << "\n" << std::flush;
+    }
+
+    std::string handle(const std::string& line)
+    {
+        std::istringstream in(line);
+        std::string cmd;
+        in >> cmd;
+
+        if (cmd == "VERIFY")
+        {
+            std::string spk, file;
+            if (!(in >> spk >> file)) return "ERR usage: VERIFY <speakerId> <file.lvf>";
+            if (!ModelRegistry::isValidSpeakerId(spk)) return "ERR invalid speaker id";
+
+            const double score = timed(_verifyLatency, [&] { return _batcher.submit(spk, file).get(); });
+
+            std::ostringstream out;
+            out << "OK " << score;
+            return out.str();
+        }
+
+        if (cmd == "ENROLL")
+        {
+            std::string spk, file;
+            std::vector<fs::path> files;
+            if (!(in >> spk)) return "ERR usage: ENROLL <speakerId> <file.lvf> [...]";
+            if (!ModelRegistry::isValidSpeakerId(spk)) return "ERR invalid speaker id";
+            while (in >> file) files.emplace_back(file);
+            if (files.empty()) return "ERR usage: ENROLL <speakerId> <file.lvf> [...]";
+
+            const std::size_t n = timed(_enrollLatency, [&] { return enroll(spk, files); });
+
+            return "OK " + std::to_string(n);
+        }
+
+        if (cmd == "STATS") return "OK " + stats();
+
+        if (cmd == "SHUTDOWN")
+        {
+            g_stop.store(true);
+            return "OK";
+        }
+
+        return "ERR unknown command: " + cmd;
+    }
+
+    std::string stats() const
+    {
+        const auto v = _verifyLatency.summary();
+        const auto e = _enrollLatency.summary();
+        const auto b = _batcher.counters();
+        const auto r = _registry.counters();
+
+        std::ostringstream out;
+        out << "verify_n=" << v.count << " verify_p50_us=" << v.p50Us << " verify_p99_us=" << v.p99Us
+            << " enroll_n=" << e.count << " enroll_p50_us=" << e.p50Us << " enroll_p99_us=" << e.p99Us
+            << " batches=" << b.batches
+            << " avg_batch=" << (b.batches ? static_cast<double>(b.requests) / static_cast<double>(b.batches) : 0.0)
+            << " feature_loads=" << b.featureLoads
+            << " cache_hits=" << r.hits << " cache_misses=" << r.misses << " cache_evictions=" << r.evictions
+            << " cache_models=" << r.residentModels << " cache_bytes=" << r.residentBytes
+            << " shared_generation=" << _registry.attachedGeneration();
+        return out.str();
+    }
+
+private:
+    ServerConfig _cfg;
+    SharedModelStore _store;
+    SharedModelSegmentPtr _segment; // only until the registry has attached it
+    ModelRegistry _registry;
+    VerifyBatcher _batcher;
+
+    GmmBwStatsAccumulator _acc;
+    GmmMapAdaptor _adaptor{{.relevanceFactor = 16.0, .minOcc = 1e-3}};
+    std::mutex _enrollMutex;
+
+    LatencyRecorder _verifyLatency;
+    LatencyRecorder _enrollLatency;
+
+    // incremental: previously enrolled utterances come from the stored stats
+    std::size_t enroll(const std::string& spk, const std::vector<fs::path>& files)
+    {
+        const auto shared = _registry.ubm();
+        const GmmModel& ubm = shared->model;
+        const sv::io::FeatureSerdes featureSerdes({.projection = shared->projection});
+        const fs::path statsPath = _registry.statsPath(spk);
+
+        std::lock_guard lock(_enrollMutex);
+
+        // stats accumulated against another UBM (e.g. before a new shared
+        // generation was attached) or from cached top-C posteriors are
+        // dropped and rebuilt from the files given with exact posteriors
+        SpeakerStatsSerdes statsSerdes;
+        const SpeakerStatsSerdes::SaveOptions statsOptions{.ubmFingerprint = shared->fingerprint};
+        SpeakerStats spkStats = statsSerdes.loadMatching(statsPath, statsOptions, ubm.numGaussians, ubm.dim);
+
+        for (const auto& f : files)
+        {
+            const std::string uttId = f.filename().string();
+            if (spkStats.hasUtterance(uttId)) continue;
+
+            BwStats stats(ubm.numGaussians, ubm.dim);
+            auto feat = featureSerdes.load(f);
+            _acc.accumulate(stats, shared->precomputed, feat.getComputedMatrix(), sv::util::Workspace::local());
+            spkStats.addUtterance(UtteranceStats::fromBwStats(uttId, stats));
+        }
+
+        GmmModel model = _adaptor.adaptMeansOnly(ubm, spkStats);
+        GmmModelSerdes().save(_registry.modelPath(spk), model,
+                              {.ubmFingerprint = shared->fingerprint});
+        statsSerdes.save(statsPath, spkStats, statsOptions);
+        _registry.put(spk, model);
+
+        return spkStats.utterances().size();
+    }
+};
+
+// One per client. The thread sets done when the client goes away and the
+// accept loop joins it, so finished connections do not pile up.
+struct Connection
+{
+    std::atomic<bool> done{false};
+    std::thread thread;
+};
+
+static void reapFinished(std::list<Connection>& connections)
+{
+    for (auto it = connections.begin(); it != connections.end();)
+    {
+        if (!it->done.load())
+        {
+            ++it;
+            continue;
+        }
+        it->thread.join();
+        it = connections.erase(it);
+    }
+}
+
+static void serveConnection(Server& server, int fd)
+{
+    std::string buf;
+    char chunk[4096];
+
+    while (!g_stop.load())
+    {
+        pollfd pfd{fd, POLLIN, 0};
+        const int pr = ::poll(&pfd, 1, 200);
+        if (pr < 0) break;
+        if (pr == 0) continue;
+
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        buf.append(chunk, static_cast<std::size_t>(n));
+
+        std::size_t pos;
+        while ((pos = buf.find('\n')) != std::string::npos)
+        {
+            std::string line = buf.substr(0, pos);
+            buf.erase(0, pos + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            std::string reply;
+            try
+            {
+                reply = server.handle(line);
+            }
+            catch (const std::exception& e)
+            {
+                reply = std::string("ERR ") + e.what();
+            }
+            reply += '\n';
+
+            const char* p = reply.data();
+            std::size_t left = reply.size();
+            while (left > 0)
+            {
+                const ssize_t w = ::send(fd, p, left, MSG_NOSIGNAL);
+                if (w <= 0) { ::close(fd); return; }
+                p += w;
+                left -= static_cast<std::size_t>(w);
+            }
+        }
+    }
+
+    ::close(fd);
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        const ServerConfig cfg = parseArgs(argc, argv);
+
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+
+        Server server(cfg);
+
+        const int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        const std::string sock = cfg.socketPath.string();
+        if (sock.size() >= sizeof(addr.sun_path)) throw std::runtime_error("Socket path too long: " + sock);
+        std::strncpy(addr.sun_path, sock.c_str(), sizeof(addr.sun_path) - 1);
+
+        ::unlink(sock.c_str());
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw std::runtime_error(std::string("bind: ") + std::strerror(errno));
+        if (::listen(listenFd, 128) < 0)
+            throw std::runtime_error(std::string("listen: ") + std::strerror(errno));
+
+        std::cout << "[server] listening on " << sock << "\n" << std::flush;
+
+        std::list<Connection> connections;
+        auto nextRefresh = std::chrono::steady_clock::now();
+        while (!g_stop.load())
+        {
+            if (const auto now = std::chrono::steady_clock::now(); now >= nextRefresh)
+            {
+                try
+                {
+                    server.refreshShared();
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "[server] shared refresh failed: " << e.what() << "\n";
+                }
+                nextRefresh = now + std::chrono::seconds(1);
+            }
+
+            reapFinished(connections);
+
+            pollfd pfd{listenFd, POLLIN, 0};
+            const int pr = ::poll(&pfd, 1, 200);
+            if (pr <= 0) continue;
+
+            const int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0) continue;
+
+            Connection& c = connections.emplace_back();
+            c.thread = std::thread([&server, &c, fd]
+            {
+                serveConnection(server, fd);
+                c.done.store(true);
+            });
+        }
+
+        ::close(listenFd);
+        ::unlink(sock.c_str());
+        for (auto& c : connections) c.thread.join();
+
+        std::cout << "[server] " << server.stats() << "\n";
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -3,9 +3,14 @@
 
 #include "sv/gmm/gmm_ubm_trainer.h"
 #include "sv/gmm/gmm_model_serdes.h"
+#include "sv/io/feature_projection_serdes.h"
+#include "sv/io/projection_trainer.h"
+#include "sv/util/instrument.h"
 
 #include <cmath>
 #include <limits>
+#include <memory>
+#include <string>
 
 using ListOfPaths = std::vector<fs::path>;
 
@@ -31,25 +36,95 @@ ListOfPaths getAllLvfFilesFromDir(const fs::path& rootDir) // TODO: DRY
     return paths;
 }
 
-int main()
+// sv_train_ubm            -> data/models/ubm.bin (128 Gaussians)
+// sv_train_ubm 64 128 256 -> data/models/ubm_k64.bin, ubm_k128.bin, ... trained as one sweep
+// --pca=N / --lda=N       -> train on features projected to N dims; the projection
+//                            is saved next to each UBM (ubm.proj) and applied on load
+int main(int argc, char** argv)
 {
      fs::path featuresRoot    = "../../../data/features";
      fs::path trainRoot    = featuresRoot / "TRAIN";
      const auto lvfFiles = getAllLvfFilesFromDir(trainRoot);
 
+     std::vector<std::size_t> sizes;
+     std::shared_ptr<const sv::io::FeatureProjection> projection;
+     sv::io::ProjectionTrainer::Options projOptions;
+     projOptions.verbose = true;
+     bool project = false;
+     for (int i = 1; i < argc; ++i)
+     {
+         const std::string arg = argv[i];
+         if (arg.rfind("--pca=", 0) == 0 || arg.rfind("--lda=", 0) == 0)
+         {
+             projOptions.kind = arg[2] == 'l' ? sv::io::FeatureProjection::Kind::Lda : sv::io::FeatureProjection::Kind::Pca;
+             projOptions.outDim = std::stoul(arg.substr(6));
+             project = true;
+         }
+         else
+         {
+             sizes.push_back(std::stoul(arg));
+         }
+     }
+
      sv::io::FeatureSerdes featSerdes;
+     if (project)
+     {
+         // LDA labels come from the speaker directories under TRAIN
+         projection = std::make_shared<const sv::io::FeatureProjection>(
+             sv::io::ProjectionTrainer(projOptions).train(lvfFiles, featSerdes));
+         featSerdes = sv::io::FeatureSerdes({.projection = projection});
+     }
 
      sv::gmm::GmmUbmTrainer::Options options;
      options.numGaussians = 128;
      options.maxIterations = 15;
      options.verbose = true;
+     // hold out ~10% of the speakers; stop on (and keep) the best held-out iteration
+     options.validationFraction = 0.1;
 
      sv::gmm::GmmUbmTrainer trainer(options);
 
-     auto ubm = trainer.trainFromLfv(lvfFiles, featSerdes);
+     if constexpr (sv::util::kInstrumentationEnabled) sv::util::Instrumentation::enableTrace(true);
 
      sv::gmm::GmmModelSerdes modelSerdes;
-     modelSerdes.save("../../../data/models/ubm.bin", ubm);
+
+     // a stale projection next to a UBM trained without one would fail to load
+     auto saveUbm = [&](const fs::path& path, const sv::gmm::GmmModel& ubm)
+     {
+         modelSerdes.save(path, ubm);
+
+         const auto projPath = sv::io::FeatureProjectionSerdes::pathFor(path);
+         if (projection)
+         {
+             sv::io::FeatureProjectionSerdes().save(projPath, *projection,
+                                                    {.ubmFingerprint = sv::gmm::GmmModelSerdes::fingerprint(ubm)});
+         }
+         else
+         {
+             fs::remove(projPath);
+         }
+     };
+
+     if (!sizes.empty())
+     {
+         const auto ubms = trainer.trainSweepFromLfv(sizes, lvfFiles, featSerdes);
+         for (std::size_t i = 0; i < sizes.size(); ++i)
+         {
+             saveUbm("../../../data/models/ubm_k" + std::to_string(sizes[i]) + ".bin", ubms[i]);
+         }
+     }
+     else
+     {
+         auto ubm = trainer.trainFromLfv(lvfFiles, featSerdes);
+         saveUbm("../../../data/models/ubm.bin", ubm);
+     }
+
+     if constexpr (sv::util::kInstrumentationEnabled)
+     {
+         sv::util::Instrumentation::writeJson("../../../data/profile/train_ubm.json");
+         sv::util::Instrumentation::writeChromeTrace("../../../data/profile/train_ubm.trace.json");
+         std::cout << sv::util::Instrumentation::toJson();
+     }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,827 @@
+#include <benchmark/benchmark.h>
+
+#include "synthetic.h"
+
+#include "sv/gmm/bw_stats_accumulator.h"
+#include "sv/gmm/gaussian_shortlist.h"
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/gmm_ubm_trainer.h"
+#include "sv/gmm/ivector_extractor.h"
+#include "sv/gmm/map_adaptor.h"
+#include "sv/gmm/model_registry.h"
+#include "sv/gmm/parallel_estep.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/gmm/scorer.h"
+#include "sv/gmm/ubm_posterior_cache.h"
+#include "sv/io/feature_serdes.h"
+#include "sv/io/projection_trainer.h"
+#include "sv/service/verify_batcher.h"
+#include "sv/util/ivf_index.h"
+#include "sv/util/numa.h"
+#include "sv/util/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <set>
+#include <string>
+
+namespace sv::bench
+{
+    namespace
+    {
+        void setFrameCounters(benchmark::State& state, std::size_t framesPerIter, std::size_t D)
+        {
+            const auto frames = static_cast<double>(framesPerIter) * static_cast<double>(state.iterations());
+            state.counters["frames/s"] = benchmark::Counter(frames, benchmark::Counter::kIsRate);
+            state.SetBytesProcessed(static_cast<int64_t>(frames) * static_cast<int64_t>(D * sizeof(float)));
+        }
+
+        // The per-frame diagonal-Gaussian kernel (all K components).
+        void BM_ComponentLogLikelihoods(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            const auto model = sv::gmm::PrecomputedGmm::from(makeModel(K, D, config().seed));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            std::vector<double> out(K);
+
+            for (auto _ : state)
+            {
+                for (const auto& x : frames)
+                {
+                    model.componentLogLikelihoods(x.data(), out.data());
+                    benchmark::DoNotOptimize(out.data());
+                }
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        void BM_Accumulate(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            const auto ubm = makeModel(K, D, config().seed);
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::gmm::GmmBwStatsAccumulator acc;
+            sv::gmm::BwStats stats(K, D);
+            const auto pre = acc.precompute(ubm);
+            sv::util::Workspace ws;
+
+            for (auto _ : state)
+            {
+                stats.clearAccumulators();
+                acc.accumulate(stats, pre, frames, ws);
+                benchmark::DoNotOptimize(stats.N.data());
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        // Chunked multi-threaded E-step; range(4) = 1 for the fixed-order
+        // pairwise reduction, 0 for per-worker sums. Compare against
+        // Accumulate (sequential) for the cost of chunking and of determinism.
+        void BM_EStep(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            const auto pre = sv::gmm::PrecomputedGmm::from(makeModel(K, D, config().seed));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+
+            std::vector<float> X;
+            X.reserve(T * D);
+            for (const auto& x : frames) X.insert(X.end(), x.begin(), x.end());
+
+            sv::gmm::ParallelEStep::Options eo;
+            eo.numThreads = static_cast<std::size_t>(state.range(3));
+            eo.chunkFrames = 256; // several chunks even at the default T
+            eo.deterministic = state.range(4) != 0;
+            sv::gmm::ParallelEStep estep(pre, eo);
+
+            for (auto _ : state)
+            {
+                estep.add(X.data(), T);
+                auto stats = estep.finish();
+                benchmark::DoNotOptimize(stats.N.data());
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        bool sameStats(const sv::gmm::BwStats& a, const sv::gmm::BwStats& b)
+        {
+            return a.N == b.N && a.F == b.F && a.S == b.S && a.totalFrames == b.totalFrames
+                && a.totalLogLikelihood == b.totalLogLikelihood;
+        }
+
+        // Deterministic E-step over range(4) emulated NUMA nodes
+        // (NumaTopology::emulated) on range(3) threads. Before timing, the
+        // stats must be bit-identical to one thread on a single node; the
+        // run is skipped with an error otherwise. nodes = 1 is the plain path.
+        void BM_EStepNuma(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+            const auto topo = sv::util::NumaTopology::emulated(static_cast<std::size_t>(state.range(4)));
+            const auto single = sv::util::NumaTopology::singleNode();
+
+            const auto pre = sv::gmm::PrecomputedGmm::from(makeModel(K, D, config().seed));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+
+            std::vector<float> X;
+            X.reserve(T * D);
+            for (const auto& x : frames) X.insert(X.end(), x.begin(), x.end());
+
+            sv::gmm::ParallelEStep::Options eo;
+            eo.chunkFrames = 256;
+            eo.deterministic = true;
+            eo.numThreads = 1;
+            eo.topology = &single;
+            sv::gmm::ParallelEStep reference(pre, eo);
+            reference.add(X.data(), T);
+            const auto expected = reference.finish();
+
+            eo.numThreads = static_cast<std::size_t>(state.range(3));
+            eo.topology = &topo;
+            sv::gmm::ParallelEStep estep(pre, eo);
+            estep.add(X.data(), T);
+            if (!sameStats(estep.finish(), expected))
+            {
+                state.SkipWithError("E-step stats differ from the single-node run");
+                return;
+            }
+
+            for (auto _ : state)
+            {
+                estep.add(X.data(), T);
+                auto stats = estep.finish();
+                benchmark::DoNotOptimize(stats.N.data());
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        // VerifyBatcher over range(3) emulated NUMA nodes: 8 speakers against
+        // 8 files per batch, on max(nodes, hardware) threads. Before timing,
+        // the scores must equal those of a single-node batcher; the run is
+        // skipped with an error otherwise. Models and features are written
+        // under --sv_workdir.
+        void BM_VerifyNuma(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+            const auto nodes = static_cast<std::size_t>(state.range(3));
+            constexpr std::size_t kSpeakers = 8;
+            constexpr std::size_t kFiles = 8;
+
+            const fs::path dir = benchFile("numa");
+            fs::create_directories(dir);
+            const auto ubmModel = makeModel(K, D, config().seed);
+            const sv::gmm::GmmModelSerdes modelSerdes;
+            for (std::size_t i = 0; i < kSpeakers; ++i)
+            {
+                auto spk = ubmModel;
+                spk.means = makeModel(K, D, config().seed + 20 + static_cast<std::uint32_t>(i)).means;
+                modelSerdes.save(dir / ("spk_" + std::to_string(i) + ".bin"), spk);
+            }
+            std::vector<fs::path> files;
+            for (std::size_t f = 0; f < kFiles; ++f)
+            {
+                files.push_back(dir / ("utt" + std::to_string(f) + ".lvf"));
+                sv::io::FeatureSerdes().save(files.back(), makeFeature(T, D, config().seed + 40 + static_cast<std::uint32_t>(f)));
+            }
+
+            auto ubm = std::make_shared<sv::gmm::SharedUbm>();
+            ubm->model = ubmModel;
+            ubm->precomputed = sv::gmm::PrecomputedGmm::from(ubmModel);
+            ubm->fingerprint = sv::gmm::GmmModelSerdes::fingerprint(ubmModel);
+            sv::gmm::ModelRegistry registry(ubm, {.modelDir = dir});
+
+            auto scoreAll = [&](sv::service::VerifyBatcher& batcher)
+            {
+                std::vector<std::future<double>> pending;
+                for (const auto& file : files)
+                    for (std::size_t i = 0; i < kSpeakers; ++i) pending.push_back(batcher.submit(std::to_string(i), file));
+
+                std::vector<double> scores;
+                for (auto& p : pending) scores.push_back(p.get());
+                return scores;
+            };
+
+            const auto single = sv::util::NumaTopology::singleNode();
+            const auto topo = sv::util::NumaTopology::emulated(nodes);
+            sv::service::VerifyBatcher::Options bo;
+            bo.maxBatch = kSpeakers * kFiles;
+            bo.numThreads = std::max(nodes, sv::util::resolveNumThreads(0));
+
+            bo.topology = &single;
+            std::vector<double> expected;
+            {
+                sv::service::VerifyBatcher reference(registry, bo);
+                expected = scoreAll(reference);
+            }
+
+            bo.topology = &topo;
+            sv::service::VerifyBatcher batcher(registry, bo);
+            if (scoreAll(batcher) != expected)
+            {
+                state.SkipWithError("VerifyBatcher scores differ from the single-node run");
+                return;
+            }
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scoreAll(batcher).data());
+            }
+            state.counters["trials/s"] = benchmark::Counter(
+                static_cast<double>(state.iterations() * kSpeakers * kFiles), benchmark::Counter::kIsRate);
+        }
+
+        void BM_Score(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            const auto ubm = makeModel(K, D, config().seed);
+            const auto spk = makeModel(K, D, config().seed + 2);
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::gmm::GmmLlrScorer scorer;
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, ubm, frames));
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        void BM_ScorePrecomputed(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            sv::gmm::GmmLlrScorer scorer;
+            const auto ubm = scorer.precompute(makeModel(K, D, config().seed));
+            const auto spk = scorer.precompute(makeModel(K, D, config().seed + 2));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, ubm, frames));
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        // Means-only adapted speaker: weights and variances are the UBM's, so
+        // fused = 1 scores both in one pass (Options::fuseSharedVariances).
+        void BM_ScoreMeansOnly(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            sv::gmm::GmmLlrScorer::Options so;
+            so.fuseSharedVariances = state.range(3) != 0;
+            sv::gmm::GmmLlrScorer scorer(so);
+
+            const auto ubmModel = makeModel(K, D, config().seed);
+            auto spkModel = ubmModel;
+            spkModel.means = makeModel(K, D, config().seed + 2).means;
+
+            const auto ubm = scorer.precompute(ubmModel);
+            const auto spk = scorer.precompute(spkModel, ubm);
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::util::Workspace ws;
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, ubm, frames, ws));
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        constexpr std::size_t kTopC = 5;
+
+        // Exact top-C: every UBM component, the speaker on the best C.
+        void BM_ScoreTopC(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            sv::gmm::GmmLlrScorer::Options so;
+            so.topC = kTopC;
+            sv::gmm::GmmLlrScorer scorer(so);
+            const auto ubm = scorer.precompute(makeModel(K, D, config().seed));
+            const auto spk = scorer.precompute(makeModel(K, D, config().seed + 2));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::util::Workspace ws;
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, ubm, frames, ws));
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        // Top-C with the UBM side read from an UbmPosteriorCache entry (the
+        // per-trial cost once an utterance's posteriors are cached).
+        void BM_ScoreCached(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            const auto ubmModel = makeModel(K, D, config().seed);
+            sv::gmm::GmmLlrScorer scorer;
+            const auto spk = scorer.precompute(makeModel(K, D, config().seed + 2));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::util::Workspace ws;
+
+            sv::gmm::UbmPosteriorCache::Options co;
+            co.topC = kTopC;
+            const sv::gmm::UbmPosteriorCache cache(ubmModel, co);
+            sv::gmm::UtterancePosteriors post;
+            cache.compute(frames, 0, post, ws);
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, post, frames, ws));
+            }
+            setFrameCounters(state, T, D);
+        }
+
+        // Top-C through a GaussianShortlist with range(3) clusters and a beam
+        // of range(4); the recall / candidates / llError counters against
+        // exact top-C make this the recall-vs-speed report for tuning.
+        void BM_ScoreShortlist(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto T = static_cast<std::size_t>(state.range(2));
+
+            sv::gmm::GmmLlrScorer::Options so;
+            so.topC = kTopC;
+            sv::gmm::GmmLlrScorer scorer(so);
+            const auto ubmModel = makeModel(K, D, config().seed);
+            const auto ubm = scorer.precompute(ubmModel);
+            const auto spk = scorer.precompute(makeModel(K, D, config().seed + 2));
+            const auto frames = makeFrames(T, D, config().seed + 1);
+            sv::util::Workspace ws;
+
+            sv::gmm::GaussianShortlist::Options lo;
+            lo.numClusters = static_cast<std::size_t>(state.range(3));
+            lo.clustersPerFrame = static_cast<std::size_t>(state.range(4));
+            const sv::gmm::GaussianShortlist shortlist(ubmModel, lo);
+
+            for (auto _ : state)
+            {
+                benchmark::DoNotOptimize(scorer.score(spk, ubm, shortlist, frames, ws));
+            }
+            setFrameCounters(state, T, D);
+
+            const auto recall = shortlist.evaluate(ubm, frames, kTopC, ws);
+            state.counters["recall"] = recall.topCRecall;
+            state.counters["candidates"] = recall.avgCandidates;
+            state.counters["llError"] = recall.avgLogLikError;
+        }
+
+        void BM_AdaptMeansOnly(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+
+            const auto ubm = makeModel(K, D, config().seed);
+            const auto stats = makeStats(K, D, 3000, config().seed + 3);
+            sv::gmm::GmmMapAdaptor adaptor;
+
+            for (auto _ : state)
+            {
+                auto m = adaptor.adaptMeansOnly(ubm, stats);
+                benchmark::DoNotOptimize(m.means.data());
+            }
+            state.counters["speakers/s"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                              benchmark::Counter::kIsRate);
+        }
+
+        void BM_AdaptBatch(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto S = static_cast<std::size_t>(state.range(2));
+
+            const auto ubm = makeModel(K, D, config().seed);
+            std::vector<sv::gmm::BwStats> stats;
+            for (std::size_t s = 0; s < S; ++s) stats.push_back(makeStats(K, D, 3000, config().seed + 10 + s));
+            sv::gmm::GmmMapAdaptor adaptor;
+
+            for (auto _ : state)
+            {
+                auto models = adaptor.adaptBatch(ubm, stats);
+                benchmark::DoNotOptimize(models.data());
+            }
+            state.counters["speakers/s"] = benchmark::Counter(static_cast<double>(state.iterations() * S),
+                                                              benchmark::Counter::kIsRate);
+        }
+
+        // i-vector extraction of range(2) utterances of rank range(3) in
+        // batches of range(4) on range(5) threads; the matrix is random, the
+        // cost does not depend on its values.
+        void BM_IvectorExtract(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto U = static_cast<std::size_t>(state.range(2));
+            const auto R = static_cast<std::size_t>(state.range(3));
+
+            const auto ubm = makeModel(K, D, config().seed);
+            std::mt19937 rng(config().seed + 3);
+            std::normal_distribution<double> nd(0.0, 0.1);
+            std::vector<double> T(K * D * R);
+            for (double& t : T) t = nd(rng);
+
+            sv::gmm::IvectorExtractor::Options eo;
+            eo.batchSize = static_cast<std::size_t>(state.range(4));
+            eo.numThreads = static_cast<std::size_t>(state.range(5));
+            const sv::gmm::IvectorExtractor extractor(ubm, R, std::move(T), eo);
+
+            std::vector<sv::gmm::UtteranceStats> utts;
+            for (std::size_t u = 0; u < U; ++u)
+                utts.push_back(sv::gmm::UtteranceStats::fromBwStats("", makeStats(K, D, 300, config().seed + 10 + u)));
+            std::vector<const sv::gmm::UtteranceStats*> ptrs;
+            for (const auto& u : utts) ptrs.push_back(&u);
+
+            std::vector<std::vector<double>> out;
+            for (auto _ : state)
+            {
+                extractor.extractBatch(ptrs, out);
+                benchmark::DoNotOptimize(out.data());
+            }
+            state.counters["utts/s"] = benchmark::Counter(static_cast<double>(state.iterations() * U),
+                                                          benchmark::Counter::kIsRate);
+        }
+        // Speaker shortlist search: nq queries against N unit vectors (the
+        // supervector layout SpeakerIdentifier indexes), drawn around
+        // 4 * nlist random centres, since real galleries cluster by gender,
+        // channel and language. Recall is against a brute-force scan.
+        void BM_IvfSearch(benchmark::State& state)
+        {
+            const auto N = static_cast<std::size_t>(state.range(0));
+            const auto dim = static_cast<std::size_t>(state.range(1));
+            const auto nlist = static_cast<std::size_t>(state.range(2));
+            constexpr std::size_t nq = 64;
+            constexpr std::size_t k = 10;
+
+            std::mt19937 rng(config().seed + 5);
+            std::normal_distribution<float> nd;
+            std::vector<float> centres(4 * nlist * dim);
+            for (float& c : centres) c = nd(rng);
+            std::uniform_int_distribution<std::size_t> pickCentre(0, 4 * nlist - 1);
+
+            auto unitRows = [&](std::size_t n)
+            {
+                std::vector<float> X(n * dim);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const float* c = centres.data() + pickCentre(rng) * dim;
+                    float* row = X.data() + i * dim;
+                    double norm = 0.0;
+                    for (std::size_t d = 0; d < dim; ++d)
+                    {
+                        row[d] = c[d] + 0.7f * nd(rng);
+                        norm += static_cast<double>(row[d]) * row[d];
+                    }
+                    const auto inv = static_cast<float>(1.0 / std::sqrt(norm));
+                    for (std::size_t d = 0; d < dim; ++d) row[d] *= inv;
+                }
+                return X;
+            };
+            const auto X = unitRows(N);
+            const auto Q = unitRows(nq);
+
+            sv::util::IvfIndex::Options io;
+            io.nlist = nlist;
+            io.nprobe = static_cast<std::size_t>(state.range(3));
+            sv::util::IvfIndex index(dim, io);
+            index.train(X.data(), N);
+            index.addBatch(X.data(), N);
+
+            std::vector<sv::util::IvfIndex::Hit> hits, exact;
+            for (auto _ : state)
+            {
+                for (std::size_t q = 0; q < nq; ++q)
+                {
+                    index.search(Q.data() + q * dim, k, hits);
+                    benchmark::DoNotOptimize(hits.data());
+                }
+            }
+
+            std::size_t found = 0;
+            for (std::size_t q = 0; q < nq; ++q)
+            {
+                index.search(Q.data() + q * dim, k, hits);
+                index.searchExact(Q.data() + q * dim, k, exact);
+                std::set<uint32_t> truth;
+                for (const auto& h : exact) truth.insert(h.id);
+                for (const auto& h : hits) found += truth.count(h.id);
+            }
+
+            state.counters["queries/s"] = benchmark::Counter(static_cast<double>(state.iterations() * nq),
+                                                             benchmark::Counter::kIsRate);
+            state.counters["recall@10"] = static_cast<double>(found) / static_cast<double>(nq * k);
+        }
+
+        // UBM training from clustered frames (drawn from a random GMM with
+        // 2K components), range(3) = 1 for the k-means initialization and 0
+        // for random frames. Times initialization plus range(2) EM
+        // iterations and reports the training data's avgLL under the result,
+        // so the two inits compare at equal iteration counts.
+        void BM_UbmTrain(benchmark::State& state)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+            const auto iterations = static_cast<std::size_t>(state.range(2));
+            constexpr std::size_t kUttFrames = 1000;
+            const std::size_t utts = std::max<std::size_t>(8, 64 * K / kUttFrames);
+
+            const auto source = makeModel(2 * K, D, config().seed);
+            std::mt19937 rng(config().seed + 12);
+            std::normal_distribution<double> nd;
+            std::uniform_int_distribution<std::size_t> pick(0, 2 * K - 1);
+
+            std::vector<libvoicefeat::features::Feature> feats(utts);
+            for (auto& f : feats)
+            {
+                auto& m = f.getComputedMatrix();
+                m.assign(kUttFrames, std::vector<float>(D));
+                for (auto& x : m)
+                {
+                    const std::size_t k = pick(rng);
+                    for (std::size_t d = 0; d < D; ++d)
+                        x[d] = static_cast<float>(3.0 * source.means[k][d] + std::sqrt(source.vars[k][d]) * nd(rng));
+                }
+                f.setVADFlags(libvoicefeat::VADFlags(kUttFrames, static_cast<libvoicefeat::VADState>(1)));
+            }
+
+            sv::gmm::GmmUbmTrainer::Options to;
+            to.numGaussians = K;
+            to.maxIterations = iterations;
+            to.llTolerance = 0.0;
+            to.kmeansInit = state.range(3) != 0;
+            to.verbose = false;
+
+            sv::gmm::GmmModel ubm;
+            for (auto _ : state)
+            {
+                ubm = sv::gmm::GmmUbmTrainer(to).train(feats);
+                benchmark::DoNotOptimize(ubm.means.data());
+            }
+
+            sv::gmm::GmmBwStatsAccumulator acc;
+            sv::gmm::BwStats stats(K, D);
+            const auto pre = acc.precompute(ubm);
+            sv::util::Workspace ws;
+            for (auto& f : feats) acc.accumulate(stats, pre, f.getComputedMatrix(), ws);
+
+            state.counters["avgLL"] = stats.totalLogLikelihood / static_cast<double>(stats.totalFrames);
+            setFrameCounters(state, utts * kUttFrames * (iterations + 1), D);
+        }
+
+        // Equal error rate of genuine vs impostor scores, in percent.
+        double equalErrorRate(std::vector<double> genuine, std::vector<double> impostor)
+        {
+            std::sort(genuine.begin(), genuine.end());
+            std::sort(impostor.begin(), impostor.end());
+
+            // sweep the threshold over the genuine scores until the false
+            // reject rate overtakes the false accept rate
+            double eer = 100.0;
+            for (std::size_t i = 0; i < genuine.size(); ++i)
+            {
+                const double th = genuine[i];
+                const double frr = static_cast<double>(i) / static_cast<double>(genuine.size());
+                const auto accepted = impostor.end() - std::lower_bound(impostor.begin(), impostor.end(), th);
+                const double far = static_cast<double>(accepted) / static_cast<double>(impostor.size());
+                if (frr >= far)
+                {
+                    eer = 50.0 * (frr + far);
+                    break;
+                }
+            }
+            return eer;
+        }
+
+        // End-to-end verification on projected features: train the
+        // projection and a 32-component UBM on background speakers, enrol
+        // means-only models of 24 others at outDim, then score every test
+        // utterance against every enrolled speaker. Frames are
+        // 39-dim mixes of a speaker latent (6 dims), a session latent
+        // (3 dims, redrawn per utterance), one of 16 phonetic clusters
+        // (10 dims) and noise, so PCA keeps the phonetic and session
+        // directions and LDA the speaker ones. Speakers enrol from three
+        // sessions; with one, LDA would take session offsets for speaker ones. range(0): -1 unprojected,
+        // 0 PCA, 1 LDA; range(1): outDim. The timed loop is trial scoring.
+        void BM_ProjectedVerify(benchmark::State& state)
+        {
+            const auto kind = state.range(0);
+            constexpr std::size_t D = 39;
+            constexpr std::size_t S = 24;
+            constexpr std::size_t kEnrol = 3;
+            constexpr std::size_t kTest = 4;
+            constexpr std::size_t enrolFrames = 400;
+            constexpr std::size_t testFrames = 300;
+            const std::size_t outD = kind < 0 ? D : static_cast<std::size_t>(state.range(1));
+
+            std::mt19937 rng(config().seed + 11);
+            std::normal_distribution<float> nd;
+            auto randomMatrix = [&](std::size_t cols, float scale)
+            {
+                std::vector<float> M(D * cols);
+                for (float& v : M) v = scale * nd(rng);
+                return M;
+            };
+            const auto A = randomMatrix(6, 0.8f);  // speaker
+            const auto B = randomMatrix(3, 0.6f);  // session
+            const auto C = randomMatrix(10, 1.0f); // phonetic
+            std::vector<float> phones(16 * 10);
+            for (float& v : phones) v = nd(rng);
+
+            std::uniform_int_distribution<std::size_t> pickPhone(0, 15);
+            auto utterance = [&](const float* spk, std::size_t T)
+            {
+                float session[3];
+                for (float& v : session) v = nd(rng);
+
+                libvoicefeat::features::Feature f;
+                auto& m = f.getComputedMatrix();
+                m.assign(T, std::vector<float>(D));
+                for (auto& x : m)
+                {
+                    const float* p = phones.data() + pickPhone(rng) * 10;
+                    for (std::size_t d = 0; d < D; ++d)
+                    {
+                        float v = 0.4f * nd(rng);
+                        for (std::size_t j = 0; j < 6; ++j) v += A[d * 6 + j] * spk[j];
+                        for (std::size_t j = 0; j < 3; ++j) v += B[d * 3 + j] * session[j];
+                        for (std::size_t j = 0; j < 10; ++j) v += C[d * 10 + j] * (p[j] + 0.3f * nd(rng));
+                        x[d] = v;
+                    }
+                }
+                f.setVADFlags(libvoicefeat::VADFlags(T, static_cast<libvoicefeat::VADState>(1)));
+                return f;
+            };
+
+            // background speakers train the projection and the UBM; the
+            // evaluation speakers are disjoint from them
+            std::vector<libvoicefeat::features::Feature> background, enrol, test;
+            std::vector<std::size_t> backgroundLabels, testLabels;
+            for (std::size_t s = 0; s < 2 * S; ++s)
+            {
+                float spk[6];
+                for (float& v : spk) v = nd(rng);
+                if (s >= S)
+                {
+                    for (std::size_t u = 0; u < kEnrol; ++u)
+                    {
+                        background.push_back(utterance(spk, enrolFrames));
+                        backgroundLabels.push_back(s - S);
+                    }
+                    continue;
+                }
+                for (std::size_t u = 0; u < kEnrol; ++u) enrol.push_back(utterance(spk, enrolFrames));
+                for (std::size_t u = 0; u < kTest; ++u)
+                {
+                    test.push_back(utterance(spk, testFrames));
+                    testLabels.push_back(s);
+                }
+            }
+
+            double retained = 1.0;
+            if (kind >= 0)
+            {
+                sv::io::ProjectionTrainer::Options po;
+                po.kind = kind == 0 ? sv::io::FeatureProjection::Kind::Pca : sv::io::FeatureProjection::Kind::Lda;
+                po.outDim = outD;
+                sv::io::ProjectionTrainer trainer(po);
+                const auto projection = trainer.train(background, backgroundLabels);
+                retained = trainer.retained();
+
+                std::vector<float> in, out;
+                for (auto* set : {&background, &enrol, &test})
+                {
+                    for (auto& f : *set)
+                    {
+                        auto& m = f.getComputedMatrix();
+                        in.clear();
+                        for (const auto& x : m) in.insert(in.end(), x.begin(), x.end());
+                        out.resize(m.size() * outD);
+                        projection.apply(in.data(), m.size(), out.data());
+                        for (std::size_t t = 0; t < m.size(); ++t)
+                            m[t].assign(out.begin() + static_cast<std::ptrdiff_t>(t * outD),
+                                        out.begin() + static_cast<std::ptrdiff_t>((t + 1) * outD));
+                    }
+                }
+            }
+
+            sv::gmm::GmmUbmTrainer::Options to;
+            to.numGaussians = 32;
+            to.verbose = false;
+            const auto ubm = sv::gmm::GmmUbmTrainer(to).train(background);
+
+            sv::gmm::GmmBwStatsAccumulator acc;
+            sv::gmm::GmmMapAdaptor adaptor;
+            sv::gmm::GmmLlrScorer scorer;
+            const auto ubmPre = scorer.precompute(ubm);
+            std::vector<sv::gmm::PrecomputedGmm> speakers;
+            for (std::size_t s = 0; s < S; ++s)
+            {
+                sv::gmm::BwStats stats(ubm.numGaussians, ubm.dim);
+                for (std::size_t u = 0; u < kEnrol; ++u)
+                    acc.accumulate(stats, ubm, enrol[s * kEnrol + u].getComputedMatrix());
+                speakers.push_back(scorer.precompute(adaptor.adaptMeansOnly(ubm, stats)));
+            }
+
+            std::vector<double> genuine, impostor;
+            for (auto _ : state)
+            {
+                genuine.clear();
+                impostor.clear();
+                for (std::size_t u = 0; u < test.size(); ++u)
+                    for (std::size_t s = 0; s < S; ++s)
+                    {
+                        const double llr = scorer.score(speakers[s], ubmPre, test[u].getComputedMatrix());
+                        (s == testLabels[u] ? genuine : impostor).push_back(llr);
+                    }
+            }
+
+            setFrameCounters(state, test.size() * S * testFrames, outD);
+            state.counters["eer%"] = equalErrorRate(genuine, impostor);
+            state.counters["retained"] = retained;
+        }
+    }
+
+    void registerGmmBenchmarks()
+    {
+        const auto& cfg = config();
+        std::vector<std::int64_t> threadCounts{1};
+        if (const auto hw = sv::util::resolveNumThreads(0); hw > 1) threadCounts.push_back(static_cast<std::int64_t>(hw));
+
+        for (auto K : cfg.numGaussians)
+            for (auto D : cfg.dims)
+            {
+                for (auto T : cfg.frames)
+                {
+                    benchmark::RegisterBenchmark("ComponentLogLikelihoods", BM_ComponentLogLikelihoods)->Args({K, D, T});
+                    benchmark::RegisterBenchmark("Accumulate", BM_Accumulate)->Args({K, D, T});
+                    for (auto threads : threadCounts)
+                        for (std::int64_t det : {0, 1})
+                            benchmark::RegisterBenchmark("EStep", BM_EStep)
+                                ->Args({K, D, T, threads, det})->UseRealTime();
+                    for (std::int64_t nodes : {1, 2})
+                    {
+                        const auto threads = std::max<std::int64_t>(nodes, threadCounts.back());
+                        benchmark::RegisterBenchmark("EStepNuma", BM_EStepNuma)
+                            ->Args({K, D, T, threads, nodes})->UseRealTime();
+                        benchmark::RegisterBenchmark("VerifyNuma", BM_VerifyNuma)->Args({K, D, T, nodes})->UseRealTime();
+                    }
+                    benchmark::RegisterBenchmark("Score", BM_Score)->Args({K, D, T});
+                    benchmark::RegisterBenchmark("ScorePrecomputed", BM_ScorePrecomputed)->Args({K, D, T});
+                    for (std::int64_t fused : {0, 1})
+                        benchmark::RegisterBenchmark("ScoreMeansOnly", BM_ScoreMeansOnly)->Args({K, D, T, fused});
+                    benchmark::RegisterBenchmark("ScoreTopC", BM_ScoreTopC)->Args({K, D, T});
+                    benchmark::RegisterBenchmark("ScoreCached", BM_ScoreCached)->Args({K, D, T});
+                    for (std::int64_t beam : {1, 2, 4, 8})
+                        benchmark::RegisterBenchmark("ScoreShortlist", BM_ScoreShortlist)->Args({K, D, T, 64, beam});
+                }
+
+                benchmark::RegisterBenchmark("AdaptMeansOnly", BM_AdaptMeansOnly)->Args({K, D});
+                for (auto S : cfg.speakers)
+                    benchmark::RegisterBenchmark("AdaptBatch", BM_AdaptBatch)->Args({K, D, S})->UseRealTime();
+
+                for (std::int64_t iterations : {1, 4})
+                    for (std::int64_t kmeans : {0, 1})
+                        benchmark::RegisterBenchmark("UbmTrain", BM_UbmTrain)
+                            ->Args({K, D, iterations, kmeans})->UseRealTime();
+
+                for (auto threads : threadCounts)
+                    for (std::int64_t batch : {1, 64})
+                        benchmark::RegisterBenchmark("IvectorExtract", BM_IvectorExtract)
+                            ->Args({K, D, 256, 200, batch, threads})->UseRealTime();
+            }
+
+        benchmark::RegisterBenchmark("ProjectedVerify", BM_ProjectedVerify)->Args({-1, 39});
+        for (std::int64_t outDim : {24, 16, 12})
+            benchmark::RegisterBenchmark("ProjectedVerify", BM_ProjectedVerify)->Args({0, outDim});
+        for (std::int64_t outDim : {16, 8})
+            benchmark::RegisterBenchmark("ProjectedVerify", BM_ProjectedVerify)->Args({1, outDim});
+
+        for (std::int64_t nprobe : {1, 4, 16})
+            benchmark::RegisterBenchmark("IvfSearch", BM_IvfSearch)->Args({100000, 256, 256, nprobe});
+    }
+}
@@ -0,0 +1,143 @@
+#include <benchmark/benchmark.h>
+
+#include "synthetic.h"
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/mapped_gmm_model.h"
+#include "sv/gmm/scorer.h"
+#include "sv/io/feature_serdes.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sv::bench
+{
+    namespace
+    {
+        using Encoding = sv::io::FeatureSerdes::Encoding;
+
+        const char* encodingName(Encoding e)
+        {
+            switch (e)
+            {
+            case Encoding::Float16: return "f16";
+            case Encoding::Int16: return "i16";
+            default: return "f32";
+            }
+        }
+
+        // Load modes: a fresh Feature, a reused Feature + Workspace, or frames
+        // only (loadFrames). Besides throughput, reports the file size per
+        // frame and what quantization costs: the largest value error and the
+        // mean absolute change of a speaker-vs-UBM LLR (K = 64) over the
+        // utterance, the score-level proxy for EER impact.
+        void BM_FeatureLoad(benchmark::State& state, Encoding encoding, int mode)
+        {
+            const auto D = static_cast<std::size_t>(state.range(0));
+            const auto T = static_cast<std::size_t>(state.range(1));
+
+            sv::io::FeatureSerdes serdes;
+            const auto file = benchFile("feat_" + std::to_string(D) + "_" + std::to_string(T) + "_"
+                                        + encodingName(encoding) + ".lvf");
+            const auto original = makeFeature(T, D, config().seed);
+            serdes.save(file, original, {.encoding = encoding});
+            const auto bytes = static_cast<int64_t>(fs::file_size(file));
+
+            sv::util::Workspace ws;
+            libvoicefeat::features::Feature reused;
+
+            for (auto _ : state)
+            {
+                if (mode == 1)
+                {
+                    serdes.load(file, reused, ws);
+                    benchmark::DoNotOptimize(reused.getComputedMatrix().data());
+                }
+                else if (mode == 2)
+                {
+                    std::size_t rows = 0, cols = 0;
+                    benchmark::DoNotOptimize(serdes.loadFrames(file, ws, rows, cols));
+                }
+                else
+                {
+                    auto f = serdes.load(file);
+                    benchmark::DoNotOptimize(f.getComputedMatrix().data());
+                }
+            }
+            state.SetBytesProcessed(state.iterations() * bytes);
+            state.counters["frames/s"] = benchmark::Counter(static_cast<double>(state.iterations() * T),
+                                                            benchmark::Counter::kIsRate);
+            state.counters["fileBytes/frame"] = static_cast<double>(bytes) / static_cast<double>(T);
+
+            const auto decoded = serdes.load(file);
+            const auto& x = const_cast<libvoicefeat::features::Feature&>(original).getComputedMatrix();
+            const auto& y = const_cast<libvoicefeat::features::Feature&>(decoded).getComputedMatrix();
+            double maxError = 0.0;
+            for (std::size_t t = 0; t < T; ++t)
+                for (std::size_t d = 0; d < D; ++d) maxError = std::max(maxError, double(std::fabs(x[t][d] - y[t][d])));
+
+            const sv::gmm::GmmLlrScorer scorer;
+            const auto ubm = scorer.precompute(makeModel(64, D, config().seed));
+            const auto spk = scorer.precompute(makeModel(64, D, config().seed + 2));
+            state.counters["maxError"] = maxError;
+            state.counters["llrError"] = std::fabs(scorer.score(spk, ubm, x) - scorer.score(spk, ubm, y));
+        }
+
+        void BM_ModelLoad(benchmark::State& state, bool float32, bool mapped)
+        {
+            const auto K = static_cast<std::size_t>(state.range(0));
+            const auto D = static_cast<std::size_t>(state.range(1));
+
+            sv::gmm::GmmModelSerdes serdes;
+            const auto file = benchFile("model_" + std::to_string(K) + "_" + std::to_string(D)
+                                        + (float32 ? "_f32" : "_f64") + ".bin");
+            serdes.save(file, makeModel(K, D, config().seed), {.float32 = float32});
+            const auto bytes = static_cast<int64_t>(fs::file_size(file));
+
+            for (auto _ : state)
+            {
+                if (mapped)
+                {
+                    sv::gmm::MappedGmmModel m(file);
+                    auto pre = m.precompute();
+                    benchmark::DoNotOptimize(pre.logConst.data());
+                }
+                else
+                {
+                    auto m = serdes.load(file);
+                    benchmark::DoNotOptimize(m.means.data());
+                }
+            }
+            state.SetBytesProcessed(state.iterations() * bytes);
+            state.counters["models/s"] = benchmark::Counter(static_cast<double>(state.iterations()),
+                                                            benchmark::Counter::kIsRate);
+        }
+    }
+
+    void registerIoBenchmarks()
+    {
+        const auto& cfg = config();
+
+        for (auto D : cfg.dims)
+        {
+            for (auto T : cfg.frames)
+            {
+                for (auto e : {Encoding::Float32, Encoding::Float16, Encoding::Int16})
+                {
+                    // float32 keeps the unsuffixed names the baseline was recorded under
+                    const std::string suffix = e == Encoding::Float32 ? "" : std::string("/") + encodingName(e);
+                    benchmark::RegisterBenchmark(("FeatureLoad" + suffix).c_str(), BM_FeatureLoad, e, 0)->Args({D, T});
+                    benchmark::RegisterBenchmark(("FeatureLoad/reuse" + suffix).c_str(), BM_FeatureLoad, e, 1)->Args({D, T});
+                    benchmark::RegisterBenchmark(("FeatureLoadFrames" + suffix).c_str(), BM_FeatureLoad, e, 2)->Args({D, T});
+                }
+            }
+
+            for (auto K : cfg.numGaussians)
+            {
+                benchmark::RegisterBenchmark("ModelLoad/f64", BM_ModelLoad, false, false)->Args({K, D});
+                benchmark::RegisterBenchmark("ModelLoad/f32", BM_ModelLoad, true, false)->Args({K, D});
+                benchmark::RegisterBenchmark("ModelMapPrecompute/f64", BM_ModelLoad, false, true)->Args({K, D});
+            }
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+
+#include "synthetic.h"
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// libsv_bench [--sv_k=64,512] [--sv_d=39] [--sv_frames=1000] [--sv_speakers=64]
+//             [--sv_seed=777] [--sv_workdir=/tmp/libsv_bench] [benchmark flags...]
+// Everything runs on synthetic data, no corpus required.
+
+namespace sv::bench
+{
+    void registerGmmBenchmarks();
+    void registerIoBenchmarks();
+
+    namespace
+    {
+        BenchConfig g_config;
+
+        std::vector<std::int64_t> parseList(const std::string& s)
+        {
+            std::vector<std::int64_t> out;
+            std::stringstream ss(s);
+            std::string item;
+            while (std::getline(ss, item, ',')) out.push_back(std::stoll(item));
+            return out;
+        }
+
+        // consumes the --sv_* flags, leaves the rest for Google Benchmark
+        void parseArgs(int& argc, char** argv)
+        {
+            int w = 1;
+            for (int i = 1; i < argc; ++i)
+            {
+                const std::string arg = argv[i];
+                const auto eq = arg.find('=');
+                const std::string key = arg.substr(0, eq);
+                const std::string val = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+                if (key == "--sv_k") g_config.numGaussians = parseList(val);
+                else if (key == "--sv_d") g_config.dims = parseList(val);
+                else if (key == "--sv_frames") g_config.frames = parseList(val);
+                else if (key == "--sv_speakers") g_config.speakers = parseList(val);
+                else if (key == "--sv_seed") g_config.seed = static_cast<std::uint32_t>(std::stoul(val));
+                else if (key == "--sv_workdir") g_config.workDir = val;
+                else argv[w++] = argv[i];
+            }
+            argc = w;
+        }
+    }
+
+    const BenchConfig& config() { return g_config; }
+}
+
+int main(int argc, char** argv)
+{
+    sv::bench::parseArgs(argc, argv);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    sv::bench::registerGmmBenchmarks();
+    sv::bench::registerIoBenchmarks();
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libvoicefeat/libvoicefeat.h>
+#include <libvoicefeat/features/feature.h>
+
+#include "sv/gmm/bw_stats.h"
+#include "sv/gmm/gmm_model.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::bench
+{
+    // Sizes the benchmarks are registered for; each list can be overridden
+    // on the command line (see main.cpp).
+    struct BenchConfig
+    {
+        std::vector<std::int64_t> numGaussians{64, 512};
+        std::vector<std::int64_t> dims{39};
+        std::vector<std::int64_t> frames{1000};
+        std::vector<std::int64_t> speakers{64};
+        std::uint32_t seed = 777;
+        fs::path workDir = fs::temp_directory_path() / "libsv_bench";
+    };
+
+    const BenchConfig& config();
+
+    // Well-conditioned random UBM: unit-ish variances, means spread around 0.
+    inline sv::gmm::GmmModel makeModel(std::size_t K, std::size_t D, std::uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> nd(0.0, 1.0);
+        std::uniform_real_distribution<double> ud(0.5, 1.5);
+
+        sv::gmm::GmmModel m;
+        m.numGaussians = K;
+        m.dim = D;
+        m.weights.assign(K, 1.0 / static_cast<double>(K));
+        m.means.assign(K, std::vector<double>(D));
+        m.vars.assign(K, std::vector<double>(D));
+        for (auto& row : m.means) for (auto& v : row) v = nd(rng);
+        for (auto& row : m.vars) for (auto& v : row) v = ud(rng);
+        return m;
+    }
+
+    inline libvoicefeat::FeatureMatrix makeFrames(std::size_t T, std::size_t D, std::uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> nd(0.0f, 1.0f);
+
+        libvoicefeat::FeatureMatrix m(T, std::vector<float>(D));
+        for (auto& row : m) for (auto& v : row) v = nd(rng);
+        return m;
+    }
+
+    inline libvoicefeat::features::Feature makeFeature(std::size_t T, std::size_t D, std::uint32_t seed)
+    {
+        libvoicefeat::features::Feature f;
+        f.getComputedMatrix() = makeFrames(T, D, seed);
+        f.setVADFlags(libvoicefeat::VADFlags(T, static_cast<libvoicefeat::VADState>(1))); // all speech
+        return f;
+    }
+
+    // Stats of roughly `frames` frames spread over the components.
+    inline sv::gmm::BwStats makeStats(std::size_t K, std::size_t D, std::size_t frames, std::uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<double> nd(0.0, 1.0);
+        std::gamma_distribution<double> gd(1.0, static_cast<double>(frames) / static_cast<double>(K));
+
+        sv::gmm::BwStats s(K, D);
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            const double n = gd(rng);
+            s.N[k] = n;
+            for (std::size_t d = 0; d < D; ++d)
+            {
+                const double mu = nd(rng);
+                s.Frow(k)[d] = n * mu;
+                s.Srow(k)[d] = n * (mu * mu + 1.0);
+            }
+        }
+        s.totalFrames = frames;
+        return s;
+    }
+
+    inline fs::path benchFile(const std::string& name)
+    {
+        fs::create_directories(config().workDir);
+        return config().workDir / name;
+    }
+}
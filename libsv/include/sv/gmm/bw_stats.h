@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <cstddef>
+#include <algorithm>
 
 namespace sv::gmm
 {
@@ -10,8 +11,8 @@ namespace sv::gmm
         std::size_t D = 0;
 
         std::vector<double> N; // K
-        std::vector<std::vector<double>> F; // K x D
-        std::vector<std::vector<double>> S; // K x D
+        std::vector<double> F; // K x D, row-major
+        std::vector<double> S; // K x D, row-major
 
         double totalLogLikelihood = 0.0;
         std::size_t totalFrames = 0;
@@ -24,8 +25,8 @@ namespace sv::gmm
             K = k;
             D = d;
             N.assign(K, 0.0);
-            F.assign(K, std::vector<double>(D, 0.0));
-            S.assign(K, std::vector<double>(D, 0.0));
+            F.assign(K * D, 0.0);
+            S.assign(K * D, 0.0);
             totalLogLikelihood = 0.0;
             totalFrames = 0;
         }
@@ -33,10 +34,26 @@ namespace sv::gmm
         void clearAccumulators()
         {
             std::fill(N.begin(), N.end(), 0.0);
-            for (auto& v : F) std::fill(v.begin(), v.end(), 0.0);
-            for (auto& v : S) std::fill(v.begin(), v.end(), 0.0);
+            std::fill(F.begin(), F.end(), 0.0);
+            std::fill(S.begin(), S.end(), 0.0);
             totalLogLikelihood = 0.0;
             totalFrames = 0;
         }
+
+        // this += other, element by element (same K and D).
+        void merge(const BwStats& other)
+        {
+            for (std::size_t i = 0; i < N.size(); ++i) N[i] += other.N[i];
+            for (std::size_t i = 0; i < F.size(); ++i) F[i] += other.F[i];
+            for (std::size_t i = 0; i < S.size(); ++i) S[i] += other.S[i];
+            totalLogLikelihood += other.totalLogLikelihood;
+            totalFrames += other.totalFrames;
+        }
+
+        [[nodiscard]] double* Frow(std::size_t k) { return F.data() + k * D; }
+        [[nodiscard]] const double* Frow(std::size_t k) const { return F.data() + k * D; }
+
+        [[nodiscard]] double* Srow(std::size_t k) { return S.data() + k * D; }
+        [[nodiscard]] const double* Srow(std::size_t k) const { return S.data() + k * D; }
     };
 }
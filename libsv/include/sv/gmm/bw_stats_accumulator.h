@@ -1,7 +1,11 @@
 #pragma once
 
+#include "sv/gmm/gaussian_shortlist.h"
 #include "sv/gmm/gmm_model.h"
 #include "sv/gmm/bw_stats.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/gmm/ubm_posterior_cache.h"
+#include "sv/util/workspace.h"
 
 #include <vector>
 
@@ -15,20 +19,45 @@ namespace sv::gmm
         struct Options
         {
             double minWeight = 1e-12;
+
+            // numThreads != 1 or deterministic = true route long inputs
+            // through ParallelEStep: fixed frame chunks summed on up to
+            // numThreads threads (0 = all hardware threads). With
+            // deterministic the chunk sums are combined in a fixed pairwise
+            // order, so the stats do not depend on numThreads. The default
+            // single-threaded sequential sum is the allocation-free path.
+            std::size_t numThreads = 1;
+            std::size_t chunkFrames = 4096;
+            bool deterministic = false;
         };
 
         GmmBwStatsAccumulator() : GmmBwStatsAccumulator(Options()) {}
         explicit GmmBwStatsAccumulator(Options opt);
 
+        // Scratch comes from the calling thread's Workspace::local().
         void accumulate(BwStats& stats, const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const;
+        void accumulate(BwStats& stats, const GmmModel& model, const libvoicefeat::FeatureMatrix& m,
+                        sv::util::Workspace& ws) const;
 
-    private:
-        Options _opt;
+        // Reuses the model's constants across calls (e.g. a shared UBM); this
+        // path does not allocate once ws is warm.
+        void accumulate(BwStats& stats, const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                        sv::util::Workspace& ws) const;
+
+        // Evaluates only the components shortlisted per frame (shortlist
+        // built from this model); posteriors are normalized over the
+        // shortlist and the other components get no occupancy.
+        void accumulate(BwStats& stats, const PrecomputedGmm& model, const GaussianShortlist& shortlist,
+                        const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const;
 
-        static double logSumExp(const std::vector<double>& v);
+        // From cached UBM posteriors of m (see UbmPosteriorCache): no model
+        // evaluation, only the top-C components of each frame are updated.
+        void accumulate(BwStats& stats, const UtterancePosteriors& post, const libvoicefeat::FeatureMatrix& m,
+                        sv::util::Workspace& ws) const;
 
-        [[nodiscard]] double logGaussianDiag(const std::vector<float>& x,
-                               const std::vector<double>& mean,
-                               const std::vector<double>& var) const;
+        [[nodiscard]] PrecomputedGmm precompute(const GmmModel& model) const;
+
+    private:
+        Options _opt;
     };
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/util/workspace.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <libvoicefeat/config.h>
+
+namespace sv::gmm
+{
+    // Coarse-to-fine index over the components of a UBM, so a frame only
+    // evaluates a shortlist of them instead of all K.
+    //
+    // The component means, scaled per dimension by the average standard
+    // deviation, are clustered with k-means++ into numClusters groups. Each
+    // group becomes one coarse Gaussian, moment-matched over its members, and
+    // each component is listed under its clustersPerComponent nearest groups
+    // (overlap keeps components near a boundary reachable). Per frame the
+    // coarse level is evaluated in full and the members of its
+    // clustersPerFrame best groups form the shortlist.
+    class GaussianShortlist
+    {
+    public:
+        struct Options
+        {
+            std::size_t numClusters = 64;
+            std::size_t clustersPerComponent = 2;
+            std::size_t clustersPerFrame = 4;
+            std::size_t kmeansIterations = 20;
+            std::uint32_t seed = 777;
+        };
+
+        // How closely the shortlist follows exact evaluation over some frames.
+        struct Recall
+        {
+            double topCRecall = 0.0;     // share of the exact top-C components that were shortlisted
+            double avgCandidates = 0.0;  // shortlisted components per frame
+            double avgLogLikError = 0.0; // mean |exact - shortlisted| UBM frame log-likelihood
+        };
+
+        GaussianShortlist() = default;
+        explicit GaussianShortlist(const GmmModel& ubm) : GaussianShortlist(ubm, Options()) {}
+        GaussianShortlist(const GmmModel& ubm, Options opt);
+
+        [[nodiscard]] bool empty() const { return _numGaussians == 0; }
+        [[nodiscard]] std::size_t numGaussians() const { return _numGaussians; }
+        [[nodiscard]] std::size_t numClusters() const { return _coarse.numGaussians; }
+
+        // Room candidates() needs in out.
+        [[nodiscard]] std::size_t maxCandidates() const { return _numGaussians; }
+
+        // Writes the shortlisted components of frame x (no duplicates,
+        // ascending within each group) to out, which needs maxCandidates()
+        // entries, and returns their count. Uses ws.logpAux() for the coarse level.
+        std::size_t candidates(const float* x, std::uint32_t* out, sv::util::Workspace& ws) const;
+
+        // Compares against exact evaluation of ubm (the model the index was
+        // built from) on the frames of m; for tuning the options.
+        [[nodiscard]] Recall evaluate(const PrecomputedGmm& ubm, const libvoicefeat::FeatureMatrix& m,
+                                      std::size_t topC, sv::util::Workspace& ws) const;
+
+    private:
+        Options _opt;
+        std::size_t _numGaussians = 0;
+
+        PrecomputedGmm _coarse;
+        std::vector<std::size_t> _offsets;   // group g lists _members[_offsets[g] .. _offsets[g + 1])
+        std::vector<std::uint32_t> _members;
+
+        std::size_t _groupsPerComponent = 1;
+        std::vector<std::uint32_t> _componentGroups; // K x _groupsPerComponent
+    };
+}
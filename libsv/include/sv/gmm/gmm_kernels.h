@@ -0,0 +1,79 @@
+#pragma once
+
+#include "sv/gmm/bw_stats.h"
+#include "sv/gmm/precomputed_gmm.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::gmm::kernels
+{
+    // Per-frame inner loops of the trainer, the accumulator and the scorer.
+    // select(D) picks a kernel compiled for that exact dimension when there is
+    // one (fully unrolled over the padded row) and the generic runtime-D loop
+    // otherwise, so every caller goes through the same dispatch.
+    struct FrameKernels
+    {
+        std::size_t dim; // 0 for the generic kernels
+
+        // out[k] = log(w_k) + log N(x | mean_k, var_k), out has K entries
+        void (*logLikelihoods)(const PrecomputedGmm& g, const float* x, double* out);
+
+        // the same for the n components in idx only (out still indexed by k)
+        void (*logLikelihoodsSubset)(const PrecomputedGmm& g, const float* x, const std::uint32_t* idx,
+                                     std::size_t n, double* out);
+
+        // N[k] += gamma[k]; F[k] += gamma[k] x; S[k] += gamma[k] x^2 (F, S: K x D)
+        void (*accumulate)(const float* x, const double* gamma, std::size_t K, std::size_t D,
+                           double* N, double* F, double* S);
+
+        // F[k] += gamma[k] x; S[k] += gamma[k] x^2 for the n components in idx only
+        void (*accumulateSubset)(const float* x, const double* gamma, const std::uint32_t* idx, std::size_t n,
+                                 std::size_t D, double* F, double* S);
+
+        // Models sharing the inverse variances of `vars` (e.g. means-only MAP
+        // speakers and their UBM) over a block of n <= kFrameBlock frames:
+        // out[(j * n + t) * K + k] for model j and frame t, exactly as
+        // logLikelihoods gives it. Each invVar row is read once for all
+        // models and frames, each mean row once per block, and each frame is
+        // widened once; on large K that keeps the rows in cache instead of
+        // streaming every model once per frame.
+        void (*logLikelihoodsShared)(const PrecomputedGmm& vars, const PrecomputedGmm* const* models,
+                                     std::size_t numModels, const float* const* x, std::size_t n, double* out);
+    };
+
+    // Frames per logLikelihoodsShared() call.
+    constexpr std::size_t kFrameBlock = 8;
+
+    // Dimensions with specialized kernels: 39 (13 MFCC + deltas + delta-deltas) and 60.
+    [[nodiscard]] const FrameKernels& select(std::size_t D);
+
+    // exp(logp - logDen), flushed to 0 below exp(kMinLogPosterior) (~1e-261):
+    // exp() near its underflow, and the denormal F / S products such
+    // posteriors lead to, take slow paths. Sharp, well-separated components
+    // (e.g. after k-means initialization) produce them for most of K on
+    // every frame.
+    constexpr double kMinLogPosterior = -600.0;
+
+    [[nodiscard]] inline double posterior(double logp, double logDen)
+    {
+        const double r = logp - logDen;
+        return r < kMinLogPosterior ? 0.0 : std::exp(r);
+    }
+
+    [[nodiscard]] double logSumExp(const double* v, std::size_t n);
+
+    // log sum_i exp(v[idx[i]]) over n indices
+    [[nodiscard]] double logSumExp(const double* v, const std::uint32_t* idx, std::size_t n);
+
+    // One E-step frame: fills logp (K entries, overwritten with posteriors) and
+    // adds the frame to stats, totalFrames and totalLogLikelihood included.
+    // With components, N is still updated for every component but F and S
+    // only for the listed ones (an empty list leaves just N and the totals).
+    // Returns log p(x).
+    double accumulateFrame(const FrameKernels& kern, const PrecomputedGmm& g, const float* x,
+                           BwStats& stats, double* logp,
+                           const std::vector<std::uint32_t>* components = nullptr);
+}
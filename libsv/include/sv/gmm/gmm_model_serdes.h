@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <array>
 #include <fstream>
+#include <vector>
 
 #include "sv/gmm/gmm_model.h"
 
@@ -12,31 +13,75 @@ namespace fs = std::filesystem;
 namespace sv::gmm
 {
 
+    // On-disk model format.
+    //
+    // v1: header, then every weight/mean/variance as an individual float64.
+    // v2: fixed 64-byte header followed by three contiguous blocks
+    //     (weights K, means K x D, vars K x D), each starting on a 64-byte
+    //     boundary, stored as float64 or float32. The header carries an XXH64
+    //     of the payload and the fingerprint of the UBM a speaker model was
+    //     adapted from (0 for UBMs). v2 files can be mapped with
+    //     MappedGmmModel and used without parsing.
     class GmmModelSerdes
     {
     public:
+        struct SaveOptions
+        {
+            bool float32 = false;
+            uint64_t ubmFingerprint = 0;
+        };
+
+        struct Header
+        {
+            uint32_t version = 0;
+            bool float32 = false;
+            uint64_t numGaussians = 0;
+            uint64_t dim = 0;
+            uint64_t ubmFingerprint = 0;
+            uint64_t payloadChecksum = 0;
+            uint64_t payloadOffset = 0;
+            uint64_t payloadBytes = 0;
+
+            [[nodiscard]] std::size_t scalarSize() const { return float32 ? sizeof(float) : sizeof(double); }
+            [[nodiscard]] uint64_t weightsOffset() const { return 0; }
+            [[nodiscard]] uint64_t meansOffset() const;
+            [[nodiscard]] uint64_t varsOffset() const;
+        };
+
+        static constexpr uint32_t kVersion = 2;
+        static constexpr std::size_t kAlignment = 64;
+
         GmmModelSerdes() = default;
 
         void save(const fs::path& file, const GmmModel& model) const;
+        void save(const fs::path& file, const GmmModel& model, const SaveOptions& opt) const;
+
+        // Reads v1 and v2; v2 payloads are checksum-verified.
         [[nodiscard]] GmmModel load(const fs::path& file) const;
 
+        [[nodiscard]] Header readHeader(const fs::path& file) const;
+
+        // Content hash of the float64 parameters; stored in speaker models to
+        // tie them (and anything derived from the UBM) to one exact UBM.
+        [[nodiscard]] static uint64_t fingerprint(const GmmModel& model);
+
+        static void parseHeader(const char* data, std::size_t size, Header& h, const fs::path& file);
+        static void validateModel(const GmmModel& model);
+
     private:
-        static constexpr uint32_t kVersion = 1;
+        static constexpr uint32_t kVersion1 = 1;
+        static constexpr uint32_t kFlagFloat32 = 1u << 0;
+        static constexpr std::size_t kHeaderBytes = 64;
         static constexpr std::array<char, 8> kMagic = {'S','V','G','M','M','\0','\0','\0'};
 
         static void writeU32(std::ofstream& out, uint32_t v);
-        static void readU32(std::ifstream& in, uint32_t& v);
-
         static void writeU64(std::ofstream& out, uint64_t v);
-        static void readU64(std::ifstream& in, uint64_t& v);
-
-        static void writeF64(std::ofstream& out, double v);
-        static void readF64(std::ifstream& in, double& v);
 
         static void ensureReadable(std::ifstream& in, const fs::path& file);
         static void ensureWritable(std::ofstream& out, const fs::path& file);
 
-        static void validateModel(const GmmModel& model);
+        static std::vector<char> buildPayload(const GmmModel& model, const Header& h);
+        static GmmModel decodePayload(const char* payload, const Header& h);
     };
 
-}
\ No newline at end of file
+}
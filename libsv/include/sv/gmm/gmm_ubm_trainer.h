@@ -2,13 +2,19 @@
 
 #include "sv/gmm/gmm_model.h"
 #include "sv/gmm/bw_stats.h"
+#include "sv/gmm/parallel_estep.h"
+#include "sv/gmm/precomputed_gmm.h"
 
 #include <filesystem>
+#include <functional>
 #include <vector>
 #include <random>
 
 #include <libvoicefeat/features/feature.h>
+#include "sv/io/feature_corpus.h"
+#include "sv/io/feature_prefetcher.h"
 #include "sv/io/feature_serdes.h"
+#include "sv/util/workspace.h"
 
 namespace fs = std::filesystem;
 
@@ -26,8 +32,78 @@ namespace sv::gmm
             double minComponentOcc = 10.0;
             double minWeight = 1e-8;
 
+            // EM stops after the first iteration that meets any enabled
+            // criterion (a tolerance of 0 disables it):
+            //  - llTolerance: |avgLL - previous avgLL|
+            //  - relativeLlTolerance: that change divided by |previous avgLL|
+            //  - paramTolerance: largest component change (see freezeTolerance)
+            //  - held-out LL: see validationFraction below
+            double llTolerance = 1e-4;
+            double relativeLlTolerance = 0.0;
+            double paramTolerance = 0.0;
+
+            // Held-out validation: this fraction of the data is kept out of
+            // training (whole speakers, sampled with seed, in trainFromLfv,
+            // where a speaker is a file's directory; every n-th utterance in
+            // train()). Every validationInterval iterations its avgLL under
+            // the current model is computed alongside the E-step. EM stops
+            // once it has not improved on the best by more than
+            // validationTolerance for validationPatience evaluations, and
+            // with keepBestModel the best-scoring model is returned instead
+            // of the last one.
+            double validationFraction = 0.0;
+            std::size_t validationInterval = 1;
+            double validationTolerance = 0.0;
+            std::size_t validationPatience = 2;
+            bool keepBestModel = true;
+
+            // A component's change in an M-step is the largest |delta mean| / sigma
+            // and |delta log var| over its dimensions. Once it drops below
+            // freezeTolerance the component is frozen: later M-steps keep its
+            // mean and variances and the E-step stops accumulating its F / S.
+            // Weights stay live since they renormalize over all components.
+            // 0 = never freeze.
+            double freezeTolerance = 0.0;
+
             uint32_t seed = 777;
             bool verbose = true;
+
+            // Initialization: k-means++ seeds from a reservoir sample of
+            // initSamplesPerComponent frames per component, refined by
+            // initIterations mini-batch k-means passes over the sample in
+            // batches of initBatchFrames. Distances are in units of the global
+            // standard deviation, and each cluster's frames give its component's
+            // initial mean, variances and weight. With kmeansInit = false the
+            // means are K random frames and every variance the global one.
+            bool kmeansInit = true;
+            std::size_t initSamplesPerComponent = 32;
+            std::size_t initIterations = 2;
+            std::size_t initBatchFrames = 4096;
+
+            // trainFromLfv: background reader threads (0 = load inline) and the
+            // cap on decoded-but-unprocessed features they may hold
+            std::size_t prefetchThreads = 2;
+            std::size_t prefetchBytes = std::size_t(256) << 20;
+
+            // trainFromLfv loads the corpus into memory once when its estimated
+            // size fits this budget (0 = always stream from disk)
+            std::size_t corpusCacheBytes = std::size_t(1) << 30;
+            bool corpusFloat16 = false;
+
+            // train on VAD speech frames only
+            bool speechOnly = false;
+
+            // E-step worker threads (0 = all hardware threads) and the frame
+            // chunk each one sums at a time. deterministic = true combines the
+            // chunks in a fixed pairwise order, so the model does not depend
+            // on numThreads (see ParallelEStep).
+            std::size_t numThreads = 0;
+            std::size_t chunkFrames = 4096;
+            bool deterministic = true;
+
+            // NUMA layout the E-step threads are placed on (nullptr = detect);
+            // NumaTopology::singleNode() turns placement off
+            const sv::util::NumaTopology* topology = nullptr;
         };
 
         GmmUbmTrainer() : GmmUbmTrainer(Options{}) {}
@@ -35,8 +111,23 @@ namespace sv::gmm
 
         [[nodiscard]] GmmModel train(const std::vector<libvoicefeat::features::Feature>& feats);
 
+        [[nodiscard]] GmmModel train(const sv::io::FeatureCorpus& corpus);
+
         [[nodiscard]] GmmModel trainFromLfv(const std::vector<fs::path>& lvfFiles, const sv::io::FeatureSerdes& serdes);
 
+        // Trains one UBM per entry of numGaussians (Options::numGaussians is
+        // ignored) side by side: the global statistics, the initialization
+        // pass and every EM pass are shared, so the corpus is read and
+        // decoded once per iteration for the whole sweep. Each model trains
+        // and converges as it would alone; models come back in input order.
+        [[nodiscard]] std::vector<GmmModel> trainSweep(const std::vector<std::size_t>& numGaussians,
+                                                       const std::vector<libvoicefeat::features::Feature>& feats);
+        [[nodiscard]] std::vector<GmmModel> trainSweep(const std::vector<std::size_t>& numGaussians,
+                                                       const sv::io::FeatureCorpus& corpus);
+        [[nodiscard]] std::vector<GmmModel> trainSweepFromLfv(const std::vector<std::size_t>& numGaussians,
+                                                              const std::vector<fs::path>& lvfFiles,
+                                                              const sv::io::FeatureSerdes& serdes);
+
     private:
         using FeatureMatrix = libvoicefeat::FeatureMatrix;
         using Feature = libvoicefeat::features::Feature;
@@ -49,31 +140,52 @@ namespace sv::gmm
             std::size_t frames = 0;
         };
 
+        struct EmState;
+
         Options _opt;
-        std::mt19937 _rng;
 
-        GlobalStats computeGlobalStats(const std::vector<Feature>& feats);
-        GlobalStats computeGlobalStatsFromLfv(const std::vector<fs::path>& lvfFiles,
-                                              const sv::io::FeatureSerdes& serdes);
+        // One full pass over the training data: visit(X, T, D) once per
+        // utterance, X being T x D row-major frames valid during the call.
+        using UtteranceFn = std::function<void(const float* X, std::size_t T, std::size_t D)>;
+        using CorpusPass = std::function<void(const UtteranceFn& visit)>;
+
+        // validation may be empty (no held-out data)
+        std::vector<GmmModel> sweepImpl(const std::vector<std::size_t>& numGaussians,
+                                        const CorpusPass& pass, const CorpusPass& validation);
+
+        GlobalStats computeGlobalStats(const CorpusPass& pass);
+        void initModels(std::vector<EmState>& states, const GlobalStats& gs, const CorpusPass& pass);
+
+        // k-means initialization of model (K and dim set) from n sampled
+        // frames X, which are shuffled in place.
+        void kmeansInitModel(GmmModel& model, float* X, std::size_t n, const GlobalStats& gs,
+                             std::mt19937& rng) const;
+
+        [[nodiscard]] CorpusPass featurePass(const std::vector<Feature>& feats) const;
+        [[nodiscard]] static CorpusPass corpusPass(const sv::io::FeatureCorpus& corpus);
+        [[nodiscard]] CorpusPass streamPass(const std::vector<fs::path>& files, const sv::io::FeatureSerdes& serdes) const;
 
-        void initModel(GmmModel& model,
-                       const GlobalStats& gs,
-                       const std::vector<Feature>& feats);
+        // the utterances of pass whose index is (heldOut) or is not (!heldOut) n * period - 1
+        [[nodiscard]] static CorpusPass everyNth(CorpusPass pass, std::size_t period, bool heldOut);
+        [[nodiscard]] std::size_t holdoutPeriod() const; // 0 = no validation
 
-        void initModelFromLfv(GmmModel& model,
-                              const GlobalStats& gs,
-                              const std::vector<fs::path>& lvfFiles,
-                              const sv::io::FeatureSerdes& serdes);
+        void splitBySpeaker(const std::vector<fs::path>& files,
+                            std::vector<fs::path>& train, std::vector<fs::path>& validation) const;
 
-        void accumulateBwStats(BwStats& stats, const GmmModel& model, const FeatureMatrix& m);
-        void maximize(GmmModel& model, const BwStats& stats, const GlobalStats& gs);
+        // Occupancies and log-likelihood of the validation data under each
+        // model, in one pass (no F / S).
+        [[nodiscard]] std::vector<BwStats> evaluateHeldOut(const std::vector<const PrecomputedGmm*>& models,
+                                                           const CorpusPass& validation,
+                                                           sv::util::NodeThreadPool& pool) const;
 
-        [[nodiscard]] double logGaussianDiag(const std::vector<float>& x,
-                               const std::vector<double>& mean,
-                               const std::vector<double>& var) const;
+        // Returns the largest change of an updated (not frozen, not
+        // reinitialized) component; freezes the ones below freezeTolerance.
+        double maximize(GmmModel& model, const BwStats& stats, const GlobalStats& gs, std::vector<char>& frozen,
+                        std::mt19937& rng);
 
-        static double logSumExp(const std::vector<double>& v);
+        void reinitComponent(GmmModel& model, std::size_t k, const GlobalStats& gs, std::mt19937& rng);
 
-        void reinitComponent(GmmModel& model, std::size_t k, const GlobalStats& gs);
+        [[nodiscard]] sv::io::FeaturePrefetcher::Options prefetchOptions() const;
+        [[nodiscard]] ParallelEStep::Options estepOptions() const;
     };
 }
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/speaker_stats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::gmm
+{
+    // i-vector extraction with a total-variability matrix T (Dehak et al. 2011).
+    //
+    // An utterance's mean supervector is modelled as m + Sigma^1/2 T w with
+    // w ~ N(0, I), m and Sigma from the UBM. Stats are centered on the UBM
+    // means and whitened by its standard deviations, so for zeroth/first
+    // order stats N_k, F_k the posterior of w has
+    //   precision  L = I + sum_k N_k T_k^T T_k
+    //   mean       w = L^-1 sum_k T_k^T F~_k
+    // with T_k the D x R block of component k. The K terms T_k^T T_k are
+    // built once per matrix, and a batch of utterances assembles all its
+    // precisions as one product of its occupancies with them, so per
+    // utterance only the R x R Cholesky solve remains.
+    //
+    // Batch work is split by output (precision tiles, utterances), so results
+    // do not depend on numThreads.
+    class IvectorExtractor
+    {
+    public:
+        struct Options
+        {
+            std::size_t numThreads = 0; // 0 = all hardware threads
+            std::size_t batchSize = 64; // utterances whose precisions are assembled together
+        };
+
+        IvectorExtractor() = default;
+
+        // T: (K * D) x rank, row-major, in whitened units (see above).
+        IvectorExtractor(const GmmModel& ubm, std::size_t rank, std::vector<double> T)
+            : IvectorExtractor(ubm, rank, std::move(T), Options())
+        {
+        }
+        IvectorExtractor(const GmmModel& ubm, std::size_t rank, std::vector<double> T, Options opt);
+
+        [[nodiscard]] bool empty() const { return _R == 0; }
+        [[nodiscard]] std::size_t rank() const { return _R; }
+        [[nodiscard]] std::size_t numGaussians() const { return _K; }
+        [[nodiscard]] std::size_t dim() const { return _D; }
+        [[nodiscard]] uint64_t ubmFingerprint() const { return _ubmFingerprint; }
+        [[nodiscard]] const std::vector<double>& matrix() const { return _T; }
+
+        [[nodiscard]] std::vector<double> extract(const UtteranceStats& utt) const;
+
+        // From the pooled stats of all of a speaker's utterances.
+        [[nodiscard]] std::vector<double> extract(const SpeakerStats& spk) const;
+
+        // out[i] = extract(*utts[i]).
+        void extractBatch(const std::vector<const UtteranceStats*>& utts,
+                          std::vector<std::vector<double>>& out) const;
+
+        // Scales w to unit length (no-op for a zero vector).
+        static void lengthNormalize(std::vector<double>& w);
+
+        // Cosine similarity, the usual i-vector trial score.
+        [[nodiscard]] static double cosineScore(const std::vector<double>& a, const std::vector<double>& b);
+
+    private:
+        friend class TvTrainer;
+
+        struct StatsRef
+        {
+            const double* N; // K
+            const double* F; // K x D
+        };
+
+        // Per-batch state: centered, whitened stats in, posteriors out.
+        struct Batch
+        {
+            std::size_t size = 0;
+            std::vector<double> N;     // size x K
+            std::vector<double> F;     // size x K*D
+            std::vector<double> L;     // size x packed R x R precision
+            std::vector<double> W;     // size x R posterior means
+            std::vector<double> Cov;   // size x packed R x R, E[w w^T] (trainer only)
+        };
+
+        Options _opt;
+        std::size_t _K = 0;
+        std::size_t _D = 0;
+        std::size_t _R = 0;
+        uint64_t _ubmFingerprint = 0;
+
+        std::vector<double> _means;  // K x D
+        std::vector<double> _invStd; // K x D
+        std::vector<double> _T;      // K*D x R
+        std::vector<double> _TtT;    // packed R x R entries x K: the T_k^T T_k, transposed
+
+        void rebuildTerms();
+
+        void checkShape(std::size_t nSize, std::size_t fSize) const;
+        void prepare(const StatsRef* stats, std::size_t n, Batch& b) const;
+        void assemblePrecisions(Batch& b) const;
+        // Posterior means into b.W; with secondOrder also E[w w^T] into b.Cov.
+        void solve(Batch& b, bool secondOrder) const;
+
+        void extractRefs(const StatsRef* stats, std::size_t n, std::vector<std::vector<double>>& out) const;
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/ivector_extractor.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+    // Total-variability matrix on disk: 64-byte header (K, D, rank, the UBM
+    // fingerprint and an XXH64 of the payload) followed by T as float64,
+    // (K * D) x rank row-major. The UBM is not stored; load() takes it and
+    // refuses a matrix trained against another one.
+    class IvectorExtractorSerdes
+    {
+    public:
+        IvectorExtractorSerdes() = default;
+
+        void save(const fs::path& file, const IvectorExtractor& extractor) const;
+
+        [[nodiscard]] IvectorExtractor load(const fs::path& file, const GmmModel& ubm) const;
+        [[nodiscard]] IvectorExtractor load(const fs::path& file, const GmmModel& ubm,
+                                            IvectorExtractor::Options opt) const;
+
+    private:
+        static constexpr uint32_t kVersion = 1;
+        static constexpr std::size_t kHeaderBytes = 64;
+        static constexpr std::array<char, 8> kMagic = {'S','V','I','V','E','C','\0','\0'};
+    };
+}
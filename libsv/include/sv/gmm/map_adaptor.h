@@ -2,6 +2,9 @@
 
 #include "sv/gmm/gmm_model.h"
 #include "sv/gmm/bw_stats.h"
+#include "sv/gmm/speaker_stats.h"
+
+#include <vector>
 
 namespace sv::gmm
 {
@@ -13,6 +16,16 @@ namespace sv::gmm
         {
             double relevanceFactor = 16.0;
             double minOcc = 1e-3;
+
+            // used by adapt()/adaptBatch() only
+            double weightRelevanceFactor = 16.0;
+            double varianceRelevanceFactor = 16.0;
+            bool adaptWeights = true;
+            bool adaptVariances = true;
+            double varianceFloor = 1e-2; // fraction of the UBM variance
+            double minWeight = 1e-8;
+
+            std::size_t numThreads = 0; // adaptBatch, 0 = hardware concurrency
         };
 
         GmmMapAdaptor() : GmmMapAdaptor(Options()) {}
@@ -21,8 +34,23 @@ namespace sv::gmm
 
         [[nodiscard]] GmmModel adaptMeansOnly(const GmmModel& ubm, const BwStats& spkStats) const;
 
+        // Re-adapts from persisted N/F sums; O(K*D), no features involved.
+        [[nodiscard]] GmmModel adaptMeansOnly(const GmmModel& ubm, const SpeakerStats& spkStats) const;
+
+        // Classical MAP with separate relevance factors for weights, means and
+        // variances (Reynolds et al. 2000). Needs the second-order stats S.
+        [[nodiscard]] GmmModel adapt(const GmmModel& ubm, const BwStats& spkStats) const;
+
+        // adapt() for many speakers against one UBM, spread over numThreads.
+        [[nodiscard]] std::vector<GmmModel> adaptBatch(const GmmModel& ubm,
+                                                       const std::vector<BwStats>& spkStats) const;
+
     private:
         Options _opt;
+
+        static void checkShape(const GmmModel& ubm, std::size_t K, std::size_t D);
+
+        void adaptMeans(GmmModel& out, const GmmModel& ubm, const double* N, const double* F) const;
     };
 
 }
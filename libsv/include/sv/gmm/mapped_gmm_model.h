@@ -0,0 +1,54 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/precomputed_gmm.h"
+
+#include <cstddef>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+    // Read-only mmap of a v2 model file. The parameter blocks are used in
+    // place: nothing is parsed beyond the 64-byte header.
+    class MappedGmmModel
+    {
+    public:
+        explicit MappedGmmModel(const fs::path& file, bool verifyChecksum = true);
+        ~MappedGmmModel();
+
+        MappedGmmModel(MappedGmmModel&& other) noexcept;
+        MappedGmmModel& operator=(MappedGmmModel&& other) noexcept;
+        MappedGmmModel(const MappedGmmModel&) = delete;
+        MappedGmmModel& operator=(const MappedGmmModel&) = delete;
+
+        [[nodiscard]] const GmmModelSerdes::Header& header() const { return _header; }
+        [[nodiscard]] std::size_t numGaussians() const { return static_cast<std::size_t>(_header.numGaussians); }
+        [[nodiscard]] std::size_t dim() const { return static_cast<std::size_t>(_header.dim); }
+        [[nodiscard]] bool float32() const { return _header.float32; }
+
+        // float64 files only
+        [[nodiscard]] const double* weights() const;
+        [[nodiscard]] const double* means() const; // K x D, row-major
+        [[nodiscard]] const double* vars() const; // K x D, row-major
+
+        // float32 files only
+        [[nodiscard]] const float* weightsF32() const;
+        [[nodiscard]] const float* meansF32() const;
+        [[nodiscard]] const float* varsF32() const;
+
+        [[nodiscard]] PrecomputedGmm precompute(double minWeight = 1e-12) const;
+        [[nodiscard]] GmmModel toModel() const;
+
+    private:
+        void* _base = nullptr;
+        std::size_t _size = 0;
+        GmmModelSerdes::Header _header{};
+
+        [[nodiscard]] const char* payload() const;
+        void requireScalar(bool f32) const;
+        void unmap();
+    };
+}
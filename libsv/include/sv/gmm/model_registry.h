@@ -0,0 +1,150 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/io/feature_projection.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+    // Immutable UBM shared by every consumer in the process; loaded once.
+    // A UBM trained on projected features carries its projection, so features
+    // are always loaded for the UBM they are scored against.
+    struct SharedUbm
+    {
+        GmmModel model;
+        PrecomputedGmm precomputed;
+        std::uint64_t fingerprint = 0;
+        std::shared_ptr<const sv::io::FeatureProjection> projection; // null: features as stored
+
+        // feature dims before any projection
+        [[nodiscard]] std::size_t featureDim() const { return projection ? projection->inDim() : model.dim; }
+    };
+
+    using SharedUbmPtr = std::shared_ptr<const SharedUbm>;
+    using SpeakerModelPtr = std::shared_ptr<const PrecomputedGmm>;
+
+    class SharedModelSegment;
+
+    // Size-bounded cache of speaker models for long-running scoring processes.
+    // Models are loaded lazily from <modelDir>/<prefix><id><extension> (v2 files
+    // are mmapped, v1 files parsed) and kept in scoring form only. A v2 model
+    // adapted from a different UBM is rejected by fingerprint. Lookups take a shared lock and bump an atomic
+    // use-tick; a miss loads outside the lock and then inserts under an
+    // exclusive lock, evicting least recently used entries down to
+    // lowWatermark * maxBytes so eviction work is amortised over many misses.
+    //
+    // With a SharedModelSegment attached, the UBM and every speaker it holds
+    // come from the shared mapping (views, next to no private memory); model
+    // files are only read for speakers the segment lacks, or that were put()
+    // in this process (their file is newer than any segment). attach() swaps the
+    // UBM and segment together and drops every cached model; requests
+    // already holding models finish on the generation they started with.
+    class ModelRegistry
+    {
+    public:
+        struct Options
+        {
+            fs::path modelDir;
+            std::string filePrefix = "spk_";
+            std::string fileExtension = ".bin";
+            std::string statsExtension = ".stats"; // enrollment statistics next to the model
+
+            std::size_t maxBytes = std::size_t(256) << 20;
+            double lowWatermark = 0.9;
+            double minWeight = 1e-12;
+        };
+
+        struct Counters
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+            std::uint64_t loadFailures = 0;
+            std::size_t residentModels = 0;
+            std::size_t residentBytes = 0;
+        };
+
+        ModelRegistry(SharedUbmPtr ubm, Options opt);
+
+        // The UBM in file, with the projection saved next to it (if any).
+        [[nodiscard]] static SharedUbmPtr loadUbm(const fs::path& file, double minWeight = 1e-12);
+
+        [[nodiscard]] SharedUbmPtr ubm() const;
+
+        // Switches to the segment's UBM and models (e.g. a newer generation).
+        // Throws, keeping the current ones, if the segment's UBM expects
+        // features of other dims than the current UBM.
+        void attach(std::shared_ptr<const SharedModelSegment> segment);
+        [[nodiscard]] uint64_t attachedGeneration() const;
+
+        // nullptr if the speaker has no model file
+        [[nodiscard]] SpeakerModelPtr find(const std::string& speakerId);
+
+        // throws if the speaker has no model file
+        [[nodiscard]] SpeakerModelPtr get(const std::string& speakerId);
+
+        // insert or replace, e.g. right after (re-)enrollment
+        void put(const std::string& speakerId, const GmmModel& model);
+        void invalidate(const std::string& speakerId);
+
+        [[nodiscard]] Counters counters() const;
+
+        // Speaker IDs become file names, so only [A-Za-z0-9_-]{1,kMaxSpeakerIdLength}
+        // is accepted; the paths below throw for anything else.
+        static constexpr std::size_t kMaxSpeakerIdLength = 128;
+        [[nodiscard]] static bool isValidSpeakerId(const std::string& speakerId);
+
+        [[nodiscard]] fs::path modelPath(const std::string& speakerId) const;
+        [[nodiscard]] fs::path statsPath(const std::string& speakerId) const;
+
+    private:
+        struct Slot
+        {
+            SpeakerModelPtr model;
+            std::size_t bytes = 0;
+            mutable std::atomic<std::uint64_t> lastUse{0};
+        };
+
+        SharedUbmPtr _ubm;
+        Options _opt;
+
+        mutable std::shared_mutex _mutex;
+        std::shared_ptr<const SharedModelSegment> _segment;
+        uint64_t _epoch = 0; // bumped by attach(); loads from an older epoch are not cached
+        std::unordered_set<std::string> _putIds; // bypass the segment
+        std::unordered_map<std::string, std::unique_ptr<Slot>> _slots;
+        std::size_t _residentBytes = 0;
+
+        mutable std::atomic<std::uint64_t> _tick{0};
+        std::atomic<std::uint64_t> _hits{0};
+        std::atomic<std::uint64_t> _misses{0};
+        std::atomic<std::uint64_t> _evictions{0};
+        std::atomic<std::uint64_t> _loadFailures{0};
+
+        struct Snapshot
+        {
+            SharedUbmPtr ubm;
+            std::shared_ptr<const SharedModelSegment> segment; // null: read the file
+            uint64_t epoch = 0;
+        };
+
+        [[nodiscard]] SpeakerModelPtr lookup(const std::string& speakerId, Snapshot* snapshot) const;
+        [[nodiscard]] PrecomputedGmm loadModel(const fs::path& file, const SharedUbm& ubm) const;
+        SpeakerModelPtr insert(const std::string& speakerId, SpeakerModelPtr model, bool replace, uint64_t epoch);
+        void evictLocked(std::size_t incomingBytes);
+
+        static std::size_t footprint(const PrecomputedGmm& model);
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "sv/gmm/bw_stats.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/util/numa.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sv::gmm
+{
+    // Multi-threaded Baum-Welch accumulation over a stream of frames.
+    //
+    // Frames are cut into fixed chunks of chunkFrames by their position in
+    // the stream (utterance boundaries do not matter), each chunk is summed on
+    // one thread into its own BwStats, and the chunk results are combined by
+    // a pairwise tree in chunk order. Both the chunking and the tree depend on
+    // the frames only, so with deterministic = true the result is bit-identical
+    // for any numThreads. deterministic = false lets each worker sum whatever
+    // chunks it picks up into one accumulator, which saves the per-chunk
+    // clear + merge but makes the rounding depend on scheduling.
+    //
+    // When the threads span several NUMA nodes, each node gets a contiguous
+    // share of the chunk slots: the staging rows, chunk stats and worker
+    // accumulators of a share are first touched by that node's pinned
+    // threads, and they score against a node-local copy of the model. The
+    // chunking and the reduction order are the same as on one node.
+    class ParallelEStep
+    {
+    public:
+        struct Options
+        {
+            std::size_t numThreads = 0; // 0 = all hardware threads
+            std::size_t chunkFrames = 4096;
+            bool deterministic = true;
+
+            // nullptr = NumaTopology::system(); must outlive the E-step
+            const sv::util::NumaTopology* topology = nullptr;
+
+            // Workers to run on, e.g. one pool for every E-step of a training
+            // run; its threads and nodes replace numThreads and topology.
+            // nullptr = the E-step starts its own. Must outlive the E-step.
+            sv::util::NodeThreadPool* pool = nullptr;
+        };
+
+        // model (and components, when given) must outlive this object.
+        // components restricts the F / S updates to the listed components (N
+        // and the totals always cover all of them); an empty list computes
+        // occupancies and log-likelihood only.
+        ParallelEStep(const PrecomputedGmm& model, Options opt,
+                      const std::vector<std::uint32_t>* components = nullptr);
+
+        // Appends T x dim row-major frames. They are copied, so X only has to
+        // stay valid during the call; full batches are processed here.
+        void add(const float* X, std::size_t T);
+
+        // Processes what is left and returns the stats of every frame added
+        // since construction or the previous finish().
+        [[nodiscard]] BwStats finish();
+
+    private:
+        const PrecomputedGmm& _model;
+        Options _opt;
+        const std::vector<std::uint32_t>* _components;
+        std::size_t _threads;
+        std::size_t _batchChunks;
+
+        // the workers, the NUMA nodes they span (1 = plain path) and, with
+        // more than one, a model copy per node
+        std::unique_ptr<sv::util::NodeThreadPool> _ownPool;
+        sv::util::NodeThreadPool* _pool;
+        std::size_t _nodes;
+        std::vector<PrecomputedGmm> _replicas;
+
+        std::unique_ptr<float[]> _stage; // _batchChunks * chunkFrames frames
+        std::size_t _staged = 0;         // frames in _stage
+
+        std::vector<std::vector<double>> _logp; // one K buffer per chunk / worker slot
+
+        // deterministic: per-chunk stats of the running batch, the partial
+        // sums of the pairwise tree (level, stats) and recycled accumulators
+        std::vector<BwStats> _batch;
+        std::vector<std::pair<unsigned, BwStats>> _tree;
+        std::vector<BwStats> _free;
+
+        // !deterministic: one accumulator per worker
+        std::vector<BwStats> _workers;
+
+        void runBatch();
+        void accumulateChunk(const PrecomputedGmm& model, std::size_t c, BwStats& stats, double* logp) const;
+
+        // slots [0, _batchChunks) of node g, and how many of the first n
+        [[nodiscard]] std::size_t slotBegin(std::size_t g) const;
+        [[nodiscard]] std::vector<std::size_t> slotsPerNode(std::size_t n) const;
+
+        BwStats acquire();
+        void pushChunk(BwStats&& s);
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/util/aligned_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sv::gmm
+{
+    // Flat, read-only view of a diagonal GMM with every per-component term that
+    // does not depend on the frame folded into one constant:
+    //   logConst[k] = log(w_k) - 0.5 * (D * log(2*pi) + sum_d log(var_kd))
+    // Built per model, so MAP-adapted weights/variances get their own constants.
+    // Rows are padded to `stride` (a multiple of kLane doubles, 64 bytes) and
+    // start 64-byte aligned; padding lanes hold mean 0 and invVar 0, so they
+    // add nothing to the quadratic term.
+    //
+    // The kernels read through meanRow()/invVarRow()/logConstants(), which
+    // point either at the vectors below or, for a view(), at blocks owned by
+    // someone else (e.g. a segment shared between processes, see
+    // SharedModelStore); the view keeps its backing alive.
+    struct PrecomputedGmm
+    {
+        static constexpr std::size_t kLane = 8;
+
+        [[nodiscard]] static constexpr std::size_t paddedDim(std::size_t D)
+        {
+            return (D + kLane - 1) / kLane * kLane;
+        }
+
+        std::size_t numGaussians = 0;
+        std::size_t dim = 0;
+        std::size_t stride = 0;
+
+        // owned storage; empty for a view
+        sv::util::AlignedVector<double> means; // K x stride, row-major
+        sv::util::AlignedVector<double> invVars; // K x stride, row-major
+        std::vector<double> logConst; // K
+
+        PrecomputedGmm() = default;
+        PrecomputedGmm(const PrecomputedGmm& other);
+        PrecomputedGmm(PrecomputedGmm&& other) noexcept;
+        PrecomputedGmm& operator=(const PrecomputedGmm& other);
+        PrecomputedGmm& operator=(PrecomputedGmm&& other) noexcept;
+
+        [[nodiscard]] bool empty() const { return numGaussians == 0 || dim == 0; }
+        [[nodiscard]] bool isView() const { return _backing != nullptr; }
+        [[nodiscard]] const double* meanRow(std::size_t k) const { return _means + k * stride; }
+        [[nodiscard]] const double* invVarRow(std::size_t k) const { return _invVars + k * stride; }
+        [[nodiscard]] const double* logConstants() const { return _logConst; }
+
+        [[nodiscard]] static PrecomputedGmm from(const GmmModel& model, double minWeight = 1e-12);
+
+        // Wraps existing blocks in this layout: means and invVars K x
+        // paddedDim(D), 64-byte aligned, logConst K. Nothing is copied.
+        [[nodiscard]] static PrecomputedGmm view(std::size_t K, std::size_t D, const double* means,
+                                                 const double* invVars, const double* logConst,
+                                                 std::shared_ptr<const void> backing);
+
+        // From flat row-major blocks (e.g. a mapped v2 model file); T is float or double.
+        template <class T>
+        [[nodiscard]] static PrecomputedGmm fromFlat(std::size_t K, std::size_t D,
+                                                     const T* weights, const T* means, const T* vars,
+                                                     double minWeight = 1e-12);
+
+        // Same size and the same inverse variances, e.g. a means-only MAP
+        // speaker and its UBM. Weights may differ; they only enter logConst.
+        // Cheap enough for every trial: it compares the variance blocks'
+        // identities, which copies keep and linkVariances() hands on, not
+        // their contents.
+        [[nodiscard]] bool sharesVariances(const PrecomputedGmm& other) const;
+
+        // Compares the inverse variances with other's once (at load, not per
+        // trial) and, when they are equal, makes sharesVariances(other) hold.
+        // Returns whether they were.
+        bool linkVariances(const PrecomputedGmm& other);
+
+        // Owned deep copy, a view's blocks included. The storage is allocated
+        // and written by the calling thread, so a copy made on a thread pinned
+        // to a NUMA node is local to that node.
+        [[nodiscard]] PrecomputedGmm copy() const;
+
+        // out[k] = log(w_k) + log N(x | mean_k, var_k), out has K entries;
+        // goes through kernels::select(dim)
+        void componentLogLikelihoods(const float* x, double* out) const;
+
+    private:
+        const double* _means = nullptr;
+        const double* _invVars = nullptr;
+        const double* _logConst = nullptr;
+        std::shared_ptr<const void> _backing;
+
+        // equal ids mean equal inverse variances; 0 = empty
+        std::uint64_t _varianceId = 0;
+
+        // points the accessors at the owned vectors (or keeps a view's blocks)
+        void bind(const PrecomputedGmm& from);
+    };
+}
@@ -3,7 +3,11 @@
 #include <libvoicefeat/types.h>
 #include <libvoicefeat/config.h>
 
+#include "sv/gmm/gaussian_shortlist.h"
 #include "sv/gmm/gmm_model.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/gmm/ubm_posterior_cache.h"
+#include "sv/util/workspace.h"
 
 namespace sv::gmm
 {
@@ -14,6 +18,18 @@ namespace sv::gmm
         {
             double minWeight = 1e-12;
             bool normalizeByFrames = true;
+
+            // Top-C scoring: per frame the speaker is evaluated only on the C
+            // best UBM components (speaker and UBM must have the same K, as
+            // MAP-adapted models do). 0 = every component.
+            std::size_t topC = 0;
+
+            // Full scoring of speakers that share the UBM's variances
+            // (means-only MAP): speakers and UBM are evaluated together in
+            // one pass over each block of frames (see
+            // FrameKernels::logLikelihoodsShared). Same scores as the
+            // separate passes.
+            bool fuseSharedVariances = true;
         };
 
         GmmLlrScorer() : GmmLlrScorer(Options())
@@ -24,17 +40,71 @@ namespace sv::gmm
         [[nodiscard]] double score(const GmmModel& spk, const GmmModel& ubm,
                                    const libvoicefeat::FeatureMatrix& m) const;
 
+        // Fast path: constants are built once per model and reused across trials.
+        // Both sides carry their own constants, so fully MAP-adapted speakers work too.
+        // Overloads without a Workspace use the calling thread's Workspace::local().
+        [[nodiscard]] double score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                                   const libvoicefeat::FeatureMatrix& m) const;
+        [[nodiscard]] double score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                                   const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const;
+
+        // Scores several speakers against one utterance in a single pass over
+        // the frames; the UBM side is evaluated once and shared by all trials.
+        [[nodiscard]] std::vector<double> scoreBatch(const std::vector<const PrecomputedGmm*>& spks,
+                                                     const PrecomputedGmm& ubm,
+                                                     const libvoicefeat::FeatureMatrix& m) const;
+        void scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const PrecomputedGmm& ubm,
+                        const libvoicefeat::FeatureMatrix& m, std::vector<double>& out,
+                        sv::util::Workspace& ws) const;
+
+        // UBM side through a shortlist built from ubm: per frame only the
+        // coarse level and the shortlisted components are evaluated, and the
+        // speaker uses the top-C of those (topC = 0: all shortlisted ones).
+        [[nodiscard]] double score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                                   const GaussianShortlist& shortlist, const libvoicefeat::FeatureMatrix& m,
+                                   sv::util::Workspace& ws) const;
+        void scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const PrecomputedGmm& ubm,
+                        const GaussianShortlist& shortlist, const libvoicefeat::FeatureMatrix& m,
+                        std::vector<double>& out, sv::util::Workspace& ws) const;
+
+        // UBM side from cached posteriors of m (see UbmPosteriorCache): the
+        // UBM is not evaluated, its frame log-likelihoods come from the cache
+        // and the speaker uses the cached top-C components (topC = 0: all of
+        // them, otherwise at most topC). Cohort scoring of one utterance goes
+        // through scoreBatch and so shares one cache entry.
+        [[nodiscard]] double score(const PrecomputedGmm& spk, const UtterancePosteriors& post,
+                                   const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const;
+        void scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const UtterancePosteriors& post,
+                        const libvoicefeat::FeatureMatrix& m, std::vector<double>& out,
+                        sv::util::Workspace& ws) const;
+
         [[nodiscard]] double avgLogLikelihood(const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const;
+        [[nodiscard]] double avgLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m) const;
+        [[nodiscard]] double avgLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                                              sv::util::Workspace& ws) const;
+
+        [[nodiscard]] PrecomputedGmm precompute(const GmmModel& model) const;
+
+        // A speaker to score against ubm: when its variances are the UBM's
+        // (means-only MAP) that is established here, once, for the fused path.
+        [[nodiscard]] PrecomputedGmm precompute(const GmmModel& spk, const PrecomputedGmm& ubm) const;
 
     private:
         Options _opt;
 
-        static double logSumExp(const std::vector<double>& v);
+        [[nodiscard]] double sumLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                                              sv::util::Workspace& ws) const;
+
+        // Top-C / shortlist scoring of n speakers into out[0..n) (shortlist may be null).
+        void scoreTopC(const PrecomputedGmm* const* spks, std::size_t n, const PrecomputedGmm& ubm,
+                       const GaussianShortlist* shortlist, const libvoicefeat::FeatureMatrix& m, double* out,
+                       sv::util::Workspace& ws) const;
 
-        [[nodiscard]] static double logGaussianDiag(const std::vector<float>& x,
-                                             const std::vector<double>& mean,
-                                             const std::vector<double>& var) ;
+        // Fused scoring of n speakers that share the UBM's variances into out[0..n).
+        void scoreShared(const PrecomputedGmm* const* spks, std::size_t n, const PrecomputedGmm& ubm,
+                         const libvoicefeat::FeatureMatrix& m, double* out, sv::util::Workspace& ws) const;
 
-        [[nodiscard]] double sumLogLikelihood(const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const;
+        void scoreCached(const PrecomputedGmm* const* spks, std::size_t n, const UtterancePosteriors& post,
+                         const libvoicefeat::FeatureMatrix& m, double* out, sv::util::Workspace& ws) const;
     };
 }
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/model_registry.h"
+#include "sv/gmm/precomputed_gmm.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+    class SharedModelSegment;
+    using SharedModelSegmentPtr = std::shared_ptr<const SharedModelSegment>;
+
+    // Publishes a UBM and a set of speaker models once, in scoring form, for
+    // every process on the machine. The default root is /dev/shm, so a
+    // segment is POSIX shared memory; attached processes map it read-only
+    // and score straight out of the page cache, one physical copy in all.
+    //
+    // Layout of <root>/<name>.<generation>.svshm:
+    //   128-byte header: magic, version, K, D, speaker count, UBM fingerprint,
+    //   generation, directory offset, XXH64 of everything after the header,
+    //   offset and size of the feature projection (0 without one);
+    //   the UBM parameters (weights K, means K x D, vars K x D, float64);
+    //   PrecomputedGmm blocks (means and inverse variances K x stride,
+    //   constants K) of the UBM and then every speaker, each 64-byte aligned;
+    //   a directory sorted by speaker id and the id strings; the projection
+    //   the UBM was trained on, as FeatureProjectionSerdes::encode() writes it.
+    //   Attached UBMs carry it, so consumers project features for the UBM of
+    //   the generation they score against.
+    // Means-only adapted speakers share the UBM's variances and weights, so
+    // their inverse variances and constants point at the UBM's blocks and
+    // only their means are stored.
+    //
+    // <root>/<name>.svshm is a symlink to the current generation. publish()
+    // writes a new generation next to it and swaps the link with a rename,
+    // so attach() sees either the old or the new segment, never a partial
+    // one. Older generations are unlinked; processes that still map them
+    // keep a valid mapping until they attach again. One publisher per name.
+    class SharedModelStore
+    {
+    public:
+        struct Options
+        {
+            fs::path root{"/dev/shm"};
+            bool verifyChecksum = true; // on attach
+            double minWeight = 1e-12;
+        };
+
+        SharedModelStore() : SharedModelStore(Options()) {}
+        explicit SharedModelStore(Options opt);
+
+        // Returns the new generation. projection: the one ubm was trained on
+        // (see FeatureProjectionSerdes), nullptr for unprojected features.
+        uint64_t publish(const std::string& name, const GmmModel& ubm,
+                         const std::vector<std::pair<std::string, const GmmModel*>>& speakers,
+                         const sv::io::FeatureProjection* projection = nullptr) const;
+
+        // Speaker models from v1/v2 model files (e.g. a ModelRegistry modelDir).
+        uint64_t publishFiles(const std::string& name, const GmmModel& ubm,
+                              const std::vector<std::pair<std::string, fs::path>>& speakers,
+                              const sv::io::FeatureProjection* projection = nullptr) const;
+
+        [[nodiscard]] SharedModelSegmentPtr attach(const std::string& name) const;
+
+        // 0 if nothing is published under name. Reads one header; cheap to poll.
+        [[nodiscard]] uint64_t currentGeneration(const std::string& name) const;
+
+        // Unlinks every generation and the link; attached processes are unaffected.
+        void remove(const std::string& name) const;
+
+        [[nodiscard]] fs::path linkPath(const std::string& name) const;
+
+    private:
+        Options _opt;
+
+        // load(i) gives the scoring form of speaker ids[i]
+        uint64_t publishImpl(const std::string& name, const GmmModel& ubm, const std::vector<std::string>& ids,
+                             const std::function<PrecomputedGmm(std::size_t)>& load,
+                             const sv::io::FeatureProjection* projection) const;
+    };
+
+    // One mapped generation. Models handed out keep the mapping alive, so a
+    // segment may be dropped (or superseded) while they are still in use.
+    class SharedModelSegment
+    {
+    public:
+        [[nodiscard]] uint64_t generation() const { return _generation; }
+        [[nodiscard]] std::size_t numGaussians() const { return _K; }
+        [[nodiscard]] std::size_t dim() const { return _D; }
+        [[nodiscard]] std::size_t size() const { return _count; }
+        [[nodiscard]] std::size_t bytes() const;
+
+        // UBM in both forms; model is a private copy (small), precomputed a view.
+        [[nodiscard]] const SharedUbmPtr& ubm() const { return _ubm; }
+
+        // nullptr if the segment has no such speaker
+        [[nodiscard]] SpeakerModelPtr find(std::string_view speakerId) const;
+
+        [[nodiscard]] std::string_view speakerId(std::size_t i) const;
+
+    private:
+        friend class SharedModelStore;
+
+        struct Mapping;
+
+        std::shared_ptr<const Mapping> _map;
+        uint64_t _generation = 0;
+        std::size_t _K = 0;
+        std::size_t _D = 0;
+        std::size_t _count = 0;
+        const char* _directory = nullptr;
+        SharedUbmPtr _ubm;
+
+        SharedModelSegment() = default;
+
+        [[nodiscard]] std::optional<std::size_t> indexOf(std::string_view speakerId) const;
+        [[nodiscard]] PrecomputedGmm modelAt(std::size_t i) const;
+    };
+}
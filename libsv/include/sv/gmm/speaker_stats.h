@@ -0,0 +1,60 @@
+#pragma once
+
+#include "sv/gmm/bw_stats.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sv::gmm
+{
+    // Zeroth/first-order statistics of a single enrollment utterance.
+    // S is dropped on purpose: means-only MAP never reads it.
+    struct UtteranceStats
+    {
+        std::string id;
+        std::size_t frames = 0;
+
+        std::vector<double> N; // K
+        std::vector<double> F; // K x D, row-major
+
+        [[nodiscard]] static UtteranceStats fromBwStats(std::string id, const BwStats& stats);
+    };
+
+    // Running per-speaker sums of N and F plus the per-utterance terms they
+    // were built from, so utterances can be added or removed and the model
+    // re-adapted in O(K*D) without touching the original features.
+    class SpeakerStats
+    {
+    public:
+        SpeakerStats() = default;
+        SpeakerStats(std::size_t k, std::size_t d) { reset(k, d); }
+
+        void reset(std::size_t k, std::size_t d);
+
+        void addUtterance(UtteranceStats utt);
+        bool removeUtterance(const std::string& id);
+        [[nodiscard]] bool hasUtterance(const std::string& id) const;
+
+        [[nodiscard]] std::size_t numGaussians() const { return _K; }
+        [[nodiscard]] std::size_t dim() const { return _D; }
+        [[nodiscard]] std::size_t totalFrames() const { return _totalFrames; }
+        [[nodiscard]] bool empty() const { return _utts.empty(); }
+
+        [[nodiscard]] const std::vector<double>& N() const { return _N; }
+        [[nodiscard]] const std::vector<double>& F() const { return _F; }
+        [[nodiscard]] const std::vector<UtteranceStats>& utterances() const { return _utts; }
+
+    private:
+        std::size_t _K = 0;
+        std::size_t _D = 0;
+        std::size_t _totalFrames = 0;
+
+        std::vector<double> _N; // K
+        std::vector<double> _F; // K x D, row-major
+
+        std::vector<UtteranceStats> _utts;
+
+        void checkShape(const UtteranceStats& utt) const;
+    };
+}
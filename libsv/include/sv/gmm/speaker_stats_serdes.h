@@ -0,0 +1,79 @@
+#pragma once
+
+#include <filesystem>
+#include <cstdint>
+#include <array>
+#include <fstream>
+#include <string>
+
+#include "sv/gmm/speaker_stats.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+
+    // On-disk per-utterance enrollment statistics.
+    //
+    // v2 adds the fingerprint of the UBM the statistics were accumulated
+    // against (GmmModelSerdes::fingerprint), so they are not reused for
+    // another UBM of the same size. v3 adds how the UBM posteriors were
+    // obtained (exact, or cached top-C renormalized), so utterances of the
+    // two modes are never summed into one speaker. Older files are no longer
+    // loaded.
+    class SpeakerStatsSerdes
+    {
+    public:
+        struct SaveOptions
+        {
+            uint64_t ubmFingerprint = 0;
+            uint32_t posteriorTopC = 0; // 0: exact posteriors over all components
+        };
+
+        struct Header
+        {
+            uint32_t version = 0;
+            uint64_t numGaussians = 0;
+            uint64_t dim = 0;
+            uint64_t ubmFingerprint = 0; // 0 for v1
+            uint32_t posteriorTopC = 0;  // 0 for v1 and v2
+        };
+
+        SpeakerStatsSerdes() = default;
+
+        void save(const fs::path& file, const SpeakerStats& stats, const SaveOptions& opt) const;
+        // Throws if the stored shape or utterance count cannot fit in the file.
+        [[nodiscard]] SpeakerStats load(const fs::path& file) const;
+
+        // Reads v1, v2 and v3 headers.
+        [[nodiscard]] Header readHeader(const fs::path& file) const;
+
+        // The stored statistics when they were saved with opt (current
+        // version, same UBM fingerprint and posterior mode) and have the
+        // UBM's shape. Otherwise, or when there is no file, empty statistics
+        // of that shape, so every utterance is accumulated again.
+        [[nodiscard]] SpeakerStats loadMatching(const fs::path& file, const SaveOptions& opt,
+                                                std::size_t numGaussians, std::size_t dim) const;
+
+    private:
+        static constexpr uint32_t kVersion = 3;
+        static constexpr uint32_t kVersion2 = 2;
+        static constexpr uint32_t kVersion1 = 1;
+        static constexpr std::array<char, 8> kMagic = {'S','V','S','T','A','T','\0','\0'};
+
+        static void writeU32(std::ofstream& out, uint32_t v);
+        static void readU32(std::ifstream& in, uint32_t& v);
+
+        static void writeU64(std::ofstream& out, uint64_t v);
+        static void readU64(std::ifstream& in, uint64_t& v);
+
+        static void writeString(std::ofstream& out, const std::string& s);
+        // Fails the stream instead of allocating when the stored length
+        // exceeds maxSize.
+        static void readString(std::ifstream& in, std::string& s, std::size_t maxSize);
+
+        static void writeF64Block(std::ofstream& out, const std::vector<double>& v);
+        static void readF64Block(std::ifstream& in, std::vector<double>& v);
+    };
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::gmm
+{
+    // Fixed-length embedding of a MAP mean-adapted speaker model.
+    //
+    // Component k contributes sqrt(w_k) (mu_spk,k - mu_ubm,k) / sigma_ubm,k,
+    // the scaling under which the squared Euclidean distance of two
+    // supervectors bounds the KL divergence of their GMMs (Campbell et al.
+    // 2006). The K * D entries are optionally reduced to projectionDim by a
+    // fixed Gaussian random projection (distances are preserved in
+    // expectation) and scaled to unit length, so inner product ranks like
+    // cosine similarity. Vectors from one exporter are comparable only with
+    // vectors from an exporter over the same UBM and options.
+    class SupervectorExporter
+    {
+    public:
+        struct Options
+        {
+            // 0 = keep all K * D entries
+            std::size_t projectionDim = 0;
+            bool lengthNormalize = true;
+            uint32_t seed = 777;
+            std::size_t numThreads = 0; // exportBatch, 0 = all hardware threads
+        };
+
+        SupervectorExporter() = default;
+        explicit SupervectorExporter(const GmmModel& ubm) : SupervectorExporter(ubm, Options()) {}
+        SupervectorExporter(const GmmModel& ubm, Options opt);
+
+        [[nodiscard]] bool empty() const { return _K == 0; }
+        [[nodiscard]] std::size_t dim() const { return _opt.projectionDim ? _opt.projectionDim : _K * _D; }
+
+        // out has dim() entries. spk must have the UBM's shape.
+        void exportModel(const GmmModel& spk, float* out) const;
+        [[nodiscard]] std::vector<float> exportModel(const GmmModel& spk) const;
+
+        // out: models.size() x dim(), row-major.
+        void exportBatch(const std::vector<const GmmModel*>& models, std::vector<float>& out) const;
+
+    private:
+        Options _opt;
+        std::size_t _K = 0;
+        std::size_t _D = 0;
+
+        std::vector<double> _means; // K x D
+        std::vector<double> _scale; // K x D: sqrt(w_k) / sigma_kd
+        std::vector<float> _projection; // K*D x projectionDim
+    };
+}
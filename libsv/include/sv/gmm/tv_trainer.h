@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/ivector_extractor.h"
+#include "sv/gmm/speaker_stats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::gmm
+{
+    // EM training of the total-variability matrix behind IvectorExtractor
+    // from per-utterance zeroth/first-order stats against one UBM.
+    //
+    // E-step: the posterior mean and second moment of every utterance's w,
+    // batch by batch through the extractor. The accumulators
+    //   A_k = sum_u N_uk E[w w^T]_u   and   C_k = sum_u F~_uk E[w]_u^T
+    // are updated split by component, so every thread owns its rows and no
+    // reduction is needed: the matrix does not depend on numThreads.
+    // M-step: T_k = C_k A_k^-1 per component. With minDivergence, T is then
+    // rescaled so the average E[w w^T] becomes I (Kenny 2008), which speeds
+    // up convergence.
+    class TvTrainer
+    {
+    public:
+        struct Options
+        {
+            std::size_t rank = 200;
+            std::size_t iterations = 10;
+            bool minDivergence = true;
+
+            // scale of the random initial T (whitened units)
+            double initScale = 0.1;
+            uint32_t seed = 777;
+
+            std::size_t numThreads = 0; // 0 = all hardware threads
+            std::size_t batchSize = 64;
+            bool verbose = true;
+        };
+
+        TvTrainer() : TvTrainer(Options()) {}
+        explicit TvTrainer(Options opt);
+
+        [[nodiscard]] IvectorExtractor train(const GmmModel& ubm, const std::vector<UtteranceStats>& utts) const;
+
+    private:
+        Options _opt;
+    };
+}
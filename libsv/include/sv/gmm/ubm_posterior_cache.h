@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <libvoicefeat/config.h>
+
+#include "sv/gmm/gmm_model.h"
+#include "sv/gmm/precomputed_gmm.h"
+#include "sv/io/feature_serdes.h"
+#include "sv/util/workspace.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::gmm
+{
+    // The UBM side of one utterance: per frame the C most likely UBM
+    // components (by descending posterior), their posteriors renormalized
+    // over those C, and the full log p(x | UBM).
+    struct UtterancePosteriors
+    {
+        uint64_t ubmFingerprint = 0;
+        uint64_t featureHash = 0;
+        std::size_t numGaussians = 0;
+        std::size_t numFrames = 0;
+        std::size_t topC = 0;
+
+        std::vector<std::uint32_t> indices; // numFrames x topC
+        std::vector<float> posteriors;      // numFrames x topC
+        std::vector<double> frameLogLik;    // numFrames
+
+        [[nodiscard]] const std::uint32_t* frameIndices(std::size_t t) const { return indices.data() + t * topC; }
+        [[nodiscard]] const float* framePosteriors(std::size_t t) const { return posteriors.data() + t * topC; }
+    };
+
+    // Persists UtterancePosteriors per feature file, so enrollment, scoring
+    // and cohort scoring against an unchanged UBM evaluate each utterance's
+    // UBM side once instead of on every pass.
+    //
+    // An entry is keyed by the UBM fingerprint (GmmModelSerdes::fingerprint),
+    // an XXH64 of the feature file's bytes and topC. Any mismatch (a retrained
+    // UBM, re-extracted features, another topC) or a damaged file makes the
+    // entry stale: load() ignores it and fetch() / precompute() rewrite it.
+    //
+    // File format (.upc): 64-byte header, then frameLogLik (T float64),
+    // indices (T x C uint32) and posteriors (T x C float32), with an XXH64 of
+    // that payload in the header. Files are written to a temporary name and
+    // renamed, so concurrent writers never expose a partial entry.
+    class UbmPosteriorCache
+    {
+    public:
+        struct Options
+        {
+            std::size_t topC = 20;
+
+            // Empty: the entry sits next to its feature file (x.lvf -> x.upc).
+            // Otherwise all entries go here, named by stem and a hash of the
+            // feature file's path.
+            fs::path directory{};
+
+            std::size_t numThreads = 0; // precompute(); 0 = all hardware threads
+            double minWeight = 1e-12;
+        };
+
+        explicit UbmPosteriorCache(const GmmModel& ubm) : UbmPosteriorCache(ubm, Options()) {}
+        UbmPosteriorCache(const GmmModel& ubm, Options opt);
+
+        [[nodiscard]] uint64_t ubmFingerprint() const { return _fingerprint; }
+        [[nodiscard]] std::size_t topC() const { return _topC; }
+        [[nodiscard]] const PrecomputedGmm& ubm() const { return _ubm; }
+
+        [[nodiscard]] fs::path entryPath(const fs::path& lvf) const;
+
+        // Evaluates the UBM on every frame of m.
+        void compute(const libvoicefeat::FeatureMatrix& m, uint64_t featureHash, UtterancePosteriors& out,
+                     sv::util::Workspace& ws) const;
+
+        // Reads the entry of lvf into out; false when it is missing or stale.
+        bool load(const fs::path& lvf, UtterancePosteriors& out, sv::util::Workspace& ws) const;
+
+        // The entry of lvf, whose decoded features are m; computed and written
+        // when missing or stale.
+        void fetch(const fs::path& lvf, const libvoicefeat::FeatureMatrix& m, UtterancePosteriors& out,
+                   sv::util::Workspace& ws) const;
+
+        // Brings the entries of all files up to date on numThreads threads.
+        // Features are only decoded for stale entries. Returns how many
+        // entries were (re)computed.
+        std::size_t precompute(const std::vector<fs::path>& lvfs, const sv::io::FeatureSerdes& serdes) const;
+
+        // XXH64 of a file's bytes (read into ws.bytes()).
+        [[nodiscard]] static uint64_t hashFile(const fs::path& file, sv::util::Workspace& ws);
+
+    private:
+        static constexpr uint32_t kVersion = 1;
+        static constexpr std::size_t kHeaderBytes = 64;
+        static constexpr std::array<char, 8> kMagic = {'S','V','U','P','C','\0','\0','\0'};
+
+        Options _opt;
+        PrecomputedGmm _ubm;
+        uint64_t _fingerprint = 0;
+        std::size_t _topC = 0;
+
+        // Header of an entry matches this UBM, topC and featureHash.
+        [[nodiscard]] bool isCurrent(const fs::path& entry, uint64_t featureHash) const;
+
+        // Payload of a current, intact entry into out; false otherwise.
+        bool read(const fs::path& entry, uint64_t featureHash, UtterancePosteriors& out,
+                  sv::util::Workspace& ws) const;
+
+        void save(const fs::path& entry, const UtterancePosteriors& p) const;
+    };
+}
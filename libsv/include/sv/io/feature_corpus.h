@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <libvoicefeat/features/feature.h>
+
+#include "sv/io/feature_serdes.h"
+#include "sv/util/workspace.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::io
+{
+    // A training corpus held in memory as one contiguous T x D frame buffer
+    // with an utterance offset table, so repeated EM passes touch no files and
+    // no per-row vectors. Frames are stored as float32, or as IEEE float16 to
+    // halve the footprint (decoded per utterance on access).
+    class FeatureCorpus
+    {
+    public:
+        struct Options
+        {
+            bool float16 = false;
+
+            // keep only frames flagged as speech; utterances without VAD
+            // flags (or with a flag count that does not match) keep all frames
+            bool speechOnly = false;
+
+            std::size_t numIoThreads = 2;
+        };
+
+        FeatureCorpus() : FeatureCorpus(Options()) {}
+        explicit FeatureCorpus(Options opt);
+
+        // Loads every file through a FeaturePrefetcher.
+        [[nodiscard]] static FeatureCorpus load(const std::vector<fs::path>& files, const FeatureSerdes& serdes,
+                                                Options opt);
+
+        // Upper bound on the memory load() would use, from the file headers.
+        [[nodiscard]] static std::size_t estimateBytes(const std::vector<fs::path>& files, const Options& opt);
+
+        // Appends one utterance (after speechOnly selection). Empty selections
+        // are still recorded, as zero-frame utterances.
+        void append(const libvoicefeat::features::Feature& feat);
+
+        void reserveFrames(std::size_t frames);
+
+        [[nodiscard]] std::size_t numUtterances() const { return _offsets.size() - 1; }
+        [[nodiscard]] std::size_t numFrames() const { return _offsets.back(); }
+        [[nodiscard]] std::size_t dim() const { return _dim; }
+        [[nodiscard]] bool isFloat16() const { return _opt.float16; }
+        [[nodiscard]] std::size_t bytes() const;
+
+        [[nodiscard]] std::size_t frames(std::size_t u) const { return _offsets[u + 1] - _offsets[u]; }
+
+        // Utterance u as frames(u) x dim() row-major floats. Float32 corpora
+        // return their own storage; float16 ones decode into ws.floats().
+        [[nodiscard]] const float* utterance(std::size_t u, sv::util::Workspace& ws) const;
+
+        // Frames of a Feature as one row-major block in ws.floats(), with the
+        // same speechOnly selection as append(). Returns the block; T and D
+        // receive its shape.
+        static const float* pack(const libvoicefeat::features::Feature& feat, bool speechOnly,
+                                 sv::util::Workspace& ws, std::size_t& T, std::size_t& D);
+
+    private:
+        Options _opt;
+        std::size_t _dim = 0;
+        std::vector<std::size_t> _offsets{0}; // frame offset per utterance, U + 1 entries
+        std::vector<float> _f32;
+        std::vector<std::uint16_t> _f16;
+
+        static bool keepFrame(const libvoicefeat::VADFlags& vad, bool useVad, std::size_t t);
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <libvoicefeat/features/feature.h>
+
+#include "sv/io/feature_serdes.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::io
+{
+    // Loads a list of .lvf files on background I/O threads and hands them to
+    // the consumer in list order, so results stay bitwise identical to a
+    // synchronous loop. At most maxInFlightBytes of decoded-but-unconsumed
+    // features (estimated from each file's header as rows x dims floats,
+    // dims after any projection) are held at once; one file is always
+    // admitted so an oversized utterance cannot stall the pipeline. Headers
+    // are read once per file, outside the lock.
+    //
+    //   FeaturePrefetcher pf(serdes, files);
+    //   Feature f;
+    //   while (pf.next(f)) accumulate(f);
+    class FeaturePrefetcher
+    {
+    public:
+        struct Options
+        {
+            std::size_t numIoThreads = 2;
+            std::size_t maxInFlightBytes = std::size_t(256) << 20;
+
+            // posix_fadvise(WILLNEED) this many files past the newest claimed
+            // one so the kernel starts reading before a thread gets there.
+            std::size_t adviseAhead = 8;
+        };
+
+        FeaturePrefetcher(const FeatureSerdes& serdes, std::vector<fs::path> files)
+            : FeaturePrefetcher(serdes, std::move(files), Options())
+        {
+        }
+        FeaturePrefetcher(const FeatureSerdes& serdes, std::vector<fs::path> files, Options opt);
+        ~FeaturePrefetcher();
+
+        FeaturePrefetcher(const FeaturePrefetcher&) = delete;
+        FeaturePrefetcher& operator=(const FeaturePrefetcher&) = delete;
+
+        // Moves the next file's feature into out; false once every file was
+        // returned. A load error is rethrown for the file that caused it. The
+        // previous contents of out are recycled for later loads.
+        bool next(libvoicefeat::features::Feature& out);
+
+        // Index into the file list of the feature last returned by next().
+        [[nodiscard]] std::size_t index() const { return _consumed - 1; }
+
+        [[nodiscard]] std::size_t size() const { return _files.size(); }
+
+    private:
+        struct Slot
+        {
+            libvoicefeat::features::Feature feat;
+            std::exception_ptr error;
+            std::size_t bytes = 0;
+        };
+
+        const FeatureSerdes& _serdes;
+        std::vector<fs::path> _files;
+        Options _opt;
+
+        std::mutex _mutex;
+        std::condition_variable _ready;  // consumer waits for its slot
+        std::condition_variable _budget; // I/O threads wait for room
+        std::vector<std::optional<std::size_t>> _estimates; // per file, once its header was read
+        std::map<std::size_t, Slot> _done;
+        std::vector<libvoicefeat::features::Feature> _free;
+        std::size_t _claimed = 0;
+        std::size_t _consumed = 0;
+        std::size_t _advised = 0;
+        std::size_t _inFlightBytes = 0;
+        bool _stop = false;
+
+        std::vector<std::thread> _threads;
+
+        void ioLoop();
+        // decoded size of file as float frames at the dims handed out;
+        // unreadable headers count as their file size, and the real load
+        // reports the error
+        std::size_t estimateBytes(const fs::path& file) const;
+        static void adviseWillNeed(const fs::path& file);
+    };
+}
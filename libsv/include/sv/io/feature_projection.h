@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::io
+{
+    // Linear map y = W (x - mean) from inDim to outDim feature dims. Given to
+    // FeatureSerdes it is applied to every utterance as it is loaded, so the
+    // trainer, accumulators and scorers all run at outDim. Estimated by
+    // ProjectionTrainer (PCA or LDA) and stored next to the UBM it was used
+    // for by FeatureProjectionSerdes.
+    class FeatureProjection
+    {
+    public:
+        enum class Kind : uint32_t
+        {
+            Pca = 0,
+            Lda = 1,
+        };
+
+        FeatureProjection() = default;
+
+        // W: outDim x inDim, row-major.
+        FeatureProjection(Kind kind, std::size_t inDim, std::size_t outDim, std::vector<double> mean,
+                          std::vector<double> W);
+
+        [[nodiscard]] bool empty() const { return _out == 0; }
+        [[nodiscard]] Kind kind() const { return _kind; }
+        [[nodiscard]] std::size_t inDim() const { return _in; }
+        [[nodiscard]] std::size_t outDim() const { return _out; }
+        [[nodiscard]] const std::vector<double>& mean() const { return _mean; }
+        [[nodiscard]] const std::vector<double>& matrix() const { return _W; }
+
+        // Content hash of kind, shape, mean and W.
+        [[nodiscard]] uint64_t fingerprint() const;
+
+        // x: T x inDim frames, y: T x outDim, both row-major; must not overlap.
+        void apply(const float* x, std::size_t T, float* y) const;
+
+    private:
+        Kind _kind = Kind::Pca;
+        std::size_t _in = 0;
+        std::size_t _out = 0;
+        std::vector<double> _mean; // inDim
+        std::vector<double> _W;    // outDim x inDim
+
+        // apply() form: W transposed (inDim x outDim) and -W mean, as float
+        std::vector<float> _Wt;
+        std::vector<float> _bias;
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "sv/io/feature_projection.h"
+#include "sv/io/feature_serdes.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::io
+{
+    // Projection on disk: 64-byte header (kind, inDim, outDim, the
+    // fingerprint of the UBM trained on the projected features and an XXH64
+    // of the payload) followed by the mean (inDim) and W (outDim x inDim) as
+    // float64. Kept next to the UBM (ubm.bin -> ubm.proj, see pathFor()),
+    // and in the same form inside a shared model segment (encode() /
+    // decode()).
+    class FeatureProjectionSerdes
+    {
+    public:
+        struct SaveOptions
+        {
+            uint64_t ubmFingerprint = 0;
+        };
+
+        FeatureProjectionSerdes() = default;
+
+        void save(const fs::path& file, const FeatureProjection& projection) const;
+        void save(const fs::path& file, const FeatureProjection& projection, const SaveOptions& opt) const;
+
+        [[nodiscard]] FeatureProjection load(const fs::path& file) const;
+
+        // As load(), but refuses a projection saved for another UBM.
+        [[nodiscard]] FeatureProjection load(const fs::path& file, uint64_t ubmFingerprint) const;
+
+        // The file contents, for embedding elsewhere.
+        [[nodiscard]] std::vector<char> encode(const FeatureProjection& projection, const SaveOptions& opt) const;
+
+        // Parses encode() output; source names it in errors. Refuses a
+        // projection saved for another UBM.
+        [[nodiscard]] FeatureProjection decode(const char* data, std::size_t size, uint64_t ubmFingerprint,
+                                               const std::string& source) const;
+
+        // Where the projection for a UBM file lives.
+        [[nodiscard]] static fs::path pathFor(const fs::path& ubmFile);
+
+        // FeatureSerdes options for features scored against the UBM in
+        // ubmFile: projecting if pathFor(ubmFile) exists (and was saved for
+        // that UBM), plain otherwise.
+        [[nodiscard]] FeatureSerdes::Options featureOptionsFor(const fs::path& ubmFile, uint64_t ubmFingerprint) const;
+
+    private:
+        static constexpr uint32_t kVersion = 1;
+        static constexpr std::size_t kHeaderBytes = 64;
+        static constexpr std::array<char, 8> kMagic = {'S','V','P','R','O','J','\0','\0'};
+
+        [[nodiscard]] FeatureProjection decodeImpl(const char* data, std::size_t size, uint64_t& ubmFingerprint,
+                                                   const std::string& source) const;
+        [[nodiscard]] FeatureProjection loadImpl(const fs::path& file, uint64_t& ubmFingerprint) const;
+    };
+}
@@ -3,43 +3,144 @@
     #include <filesystem>
     #include <cstdint>
     #include <array>
+    #include <memory>
     #include <vector>
     #include <fstream>
 
     #include <libvoicefeat/libvoicefeat.h>
     #include <libvoicefeat/features/feature.h>
 
+    #include "sv/io/feature_projection.h"
+    #include "sv/util/workspace.h"
+
     namespace fs = std::filesystem;
 
     namespace sv::io
     {
+        // On-disk feature format (.lvf).
+        //
+        // v1: header and options, then every frame value as a float32 and one
+        //     byte per VAD flag.
+        // v2: fixed 64-byte header (shape, encoding, cepstral type, XXH64 of
+        //     the payload) followed by 64-byte aligned blocks: the options, the
+        //     per-dim int16 offsets and steps (int16 only), the T x D matrix as
+        //     float32, float16 or int16, and the VAD flags one bit per frame.
+        //     int16 stores round((x - offset[d]) / step[d]), with offset and
+        //     step spanning each dim's range over the utterance.
+        //
+        // save() writes v2; load() reads both. With a projection in the
+        // options, frames are projected as they are loaded, so callers see
+        // features of the projection's outDim; save() stores what it is given.
         class FeatureSerdes
         {
         public:
-            FeatureSerdes() = default;
+            enum class Encoding : uint32_t
+            {
+                Float32 = 0,
+                Float16 = 1,
+                Int16 = 2, // per-dim scaled
+            };
+
+            struct Options
+            {
+                std::shared_ptr<const FeatureProjection> projection;
+            };
+
+            struct SaveOptions
+            {
+                Encoding encoding = Encoding::Float32;
+            };
+
+            struct Header
+            {
+                uint32_t version = 0;
+                Encoding encoding = Encoding::Float32;
+                uint32_t rows = 0;
+                uint32_t cols = 0;
+                uint32_t numFlags = 0;
+                uint64_t payloadChecksum = 0;
+                uint64_t payloadOffset = 0; // v1: start of the matrix
+                uint64_t payloadBytes = 0;
+
+                [[nodiscard]] std::size_t scalarSize() const;
+                // relative to payloadOffset
+                [[nodiscard]] uint64_t scalesOffset() const;
+                [[nodiscard]] uint64_t matrixOffset() const;
+                [[nodiscard]] uint64_t vadOffset() const;
+            };
+
+            static constexpr uint32_t kVersion = 2;
+            static constexpr std::size_t kAlignment = 64;
+
+            FeatureSerdes() : FeatureSerdes(Options()) {}
+            explicit FeatureSerdes(Options opt);
+
+            // nullptr unless frames are projected on load
+            [[nodiscard]] const std::shared_ptr<const FeatureProjection>& projection() const { return _opt.projection; }
 
             void save(const fs::path& file, const libvoicefeat::features::Feature& feat) const;
+            void save(const fs::path& file, const libvoicefeat::features::Feature& feat, const SaveOptions& opt) const;
+
             [[nodiscard]] libvoicefeat::features::Feature load(const fs::path& file) const;
 
+            // Loads into an existing Feature, reusing its matrix rows and the
+            // workspace buffers; allocation-free once both have held an
+            // utterance at least this long.
+            void load(const fs::path& file, libvoicefeat::features::Feature& out, sv::util::Workspace& ws) const;
+
+            // Frames only, decoded straight from the file into one T x D
+            // row-major block (ws.floats(), or the read buffer itself for
+            // unprojected v2 float32), VAD flags into ws.vadFlags. No Feature
+            // is built; the block is valid until ws is used again.
+            const float* loadFrames(const fs::path& file, sv::util::Workspace& ws, std::size_t& T, std::size_t& D) const;
+
+            // Shape and encoding from the first bytes of the file; throws if the
+            // shape does not fit in the file.
+            [[nodiscard]] Header readHeader(const fs::path& file) const;
+
         private:
-            static constexpr uint32_t kVersion = 1;
+            Options _opt;
+
+            static constexpr uint32_t kVersion1 = 1;
+            static constexpr std::size_t kHeaderBytes = 64;
             static constexpr std::array<char, 8> kMagic = {'L', 'V', 'F', 'E', 'A', 'T', '\0', '\0'};
 
+            // bounds-checked cursor over a file read in one go
+            struct Reader
+            {
+                const char* p;
+                const char* end;
+                bool ok = true;
+
+                void read(void* dst, std::size_t n);
+                template <class T> T get();
+            };
+
             static void writeU32(std::ofstream& out, uint32_t v);
-            static void readU32(std::ifstream& in, uint32_t& v);
+            static void writeU64(std::ofstream& out, uint64_t v);
+
+            static char* writeFeatureOptions(char* p, const libvoicefeat::FeatureOptions& o);
+            static void readFeatureOptions(Reader& in, libvoicefeat::FeatureOptions& o);
 
-            static void writeI32(std::ofstream& out, int32_t v);
-            static void readI32(std::ifstream& in, int32_t& v);
+            static bool checkRectangular(const libvoicefeat::FeatureMatrix& m);
 
-            static void writeF64(std::ofstream& out, double v);
-            static void readF64(std::ifstream& in, double& v);
+            // whole file into ws.bytes(); returns it, size receives the length
+            static const char* readFile(const fs::path& file, sv::util::Workspace& ws, std::size_t& size);
 
-            static void writeU8(std::ofstream& out, uint8_t v);
-            static void readU8(std::ifstream& in, uint8_t& v);
+            // Header, cepstral type and options of a whole file, validated
+            // against its size (and for v2 its checksum).
+            static void parse(const char* data, std::size_t size, Header& h, libvoicefeat::CepstralType& ct,
+                              libvoicefeat::FeatureOptions& opts, const fs::path& file);
 
-            static void writeFeatureOptions(std::ofstream& out, const libvoicefeat::FeatureOptions& o);
-            static void readFeatureOptions(std::ifstream& in, libvoicefeat::FeatureOptions& o);
+            static void encodeMatrix(const libvoicefeat::FeatureMatrix& m, const Header& h, char* payload);
+            // frame i of a parsed file
+            static void decodeRow(const char* data, const Header& h, std::size_t i, float* dst);
+            // all frames: the file's own block for v2 float32, else decoded into buffer
+            static const float* decodeFrames(const char* data, const Header& h, float* buffer);
 
-            static bool checkRectangular(const libvoicefeat::FeatureMatrix& m);
+            // the projected frames of a parsed file into ws.floats()
+            const float* project(const char* data, const Header& h, sv::util::Workspace& ws,
+                                 const fs::path& file) const;
+            static void decodeVad(const char* data, const Header& h, libvoicefeat::VADFlags& flags);
         };
     }
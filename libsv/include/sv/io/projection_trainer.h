@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <libvoicefeat/features/feature.h>
+
+#include "sv/io/feature_projection.h"
+#include "sv/io/feature_serdes.h"
+
+namespace fs = std::filesystem;
+
+namespace sv::io
+{
+    // Estimates a FeatureProjection from training frames.
+    //
+    // PCA keeps the outDim leading eigenvectors of the total covariance, so
+    // the projected dims are decorrelated (which suits diagonal-covariance
+    // GMMs) and ordered by variance. LDA solves Sb w = lambda Sw w for the
+    // between- and within-speaker scatters and keeps the outDim most
+    // discriminative directions, scaled so the within-speaker covariance of
+    // the output is the identity; it needs a speaker label per utterance.
+    // At most (speakers - 1) LDA directions carry between-speaker
+    // information, so outDim beyond that adds little.
+    //
+    // Scatter is accumulated in float64 with the work split by matrix row, so
+    // the result does not depend on numThreads.
+    class ProjectionTrainer
+    {
+    public:
+        struct Options
+        {
+            FeatureProjection::Kind kind = FeatureProjection::Kind::Pca;
+            std::size_t outDim = 20;
+            bool speechOnly = true;
+
+            // added to the within-speaker scatter's diagonal, relative to its
+            // mean diagonal entry (LDA)
+            double withinFloor = 1e-4;
+
+            std::size_t numThreads = 0; // 0 = all hardware threads
+            std::size_t numIoThreads = 2;
+            bool verbose = false;
+        };
+
+        ProjectionTrainer() : ProjectionTrainer(Options()) {}
+        explicit ProjectionTrainer(Options opt);
+
+        // LDA takes speaker labels from the directory layout (speakerLabels()).
+        // serdes must not project itself.
+        [[nodiscard]] FeatureProjection train(const std::vector<fs::path>& files, const FeatureSerdes& serdes);
+
+        // labels: one speaker index per file; may be empty for PCA.
+        [[nodiscard]] FeatureProjection train(const std::vector<fs::path>& files, const std::vector<std::size_t>& labels,
+                                              const FeatureSerdes& serdes);
+
+        [[nodiscard]] FeatureProjection train(const std::vector<libvoicefeat::features::Feature>& feats,
+                                              const std::vector<std::size_t>& labels);
+
+        // Speaker index per file from the directory holding it (.../<speaker>/<utt>.lvf),
+        // numbered in sorted directory order.
+        [[nodiscard]] static std::vector<std::size_t> speakerLabels(const std::vector<fs::path>& files);
+
+        // Share of the total variance the projection keeps (PCA), or of the
+        // between-speaker separation (LDA), from the last train() call.
+        [[nodiscard]] double retained() const { return _retained; }
+
+    private:
+        struct Scatter
+        {
+            std::size_t dim = 0;
+            double frames = 0.0;
+            std::vector<double> sum;        // D
+            std::vector<double> second;     // D x D, sum of x x^T (lower triangle)
+            std::vector<double> classFrames; // per label
+            std::vector<double> classSum;    // per label x D
+
+            std::vector<float> pending;     // frames not yet in second
+        };
+
+        Options _opt;
+        double _retained = 0.0;
+
+        void checkLabels(std::size_t count, const std::vector<std::size_t>& labels) const;
+        void accumulate(const float* X, std::size_t T, std::size_t D, std::size_t label, Scatter& s) const;
+        // adds the pending frames to the second-moment matrix
+        void flush(Scatter& s) const;
+        [[nodiscard]] FeatureProjection solve(const Scatter& s);
+    };
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace sv::service
+{
+    // Keeps the most recent `capacity` request latencies for percentile reporting.
+    class LatencyRecorder
+    {
+    public:
+        struct Summary
+        {
+            std::uint64_t count = 0; // all requests ever recorded
+            double p50Us = 0.0;
+            double p99Us = 0.0;
+            double maxUs = 0.0;
+        };
+
+        explicit LatencyRecorder(std::size_t capacity = 100000);
+
+        void record(std::chrono::nanoseconds latency);
+        [[nodiscard]] Summary summary() const;
+
+    private:
+        mutable std::mutex _mutex;
+        std::vector<double> _samplesUs; // ring buffer
+        std::size_t _next = 0;
+        std::uint64_t _count = 0;
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "sv/gmm/bw_stats_accumulator.h"
+#include "sv/gmm/map_adaptor.h"
+#include "sv/gmm/model_registry.h"
+#include "sv/gmm/scorer.h"
+#include "sv/gmm/supervector.h"
+#include "sv/util/ivf_index.h"
+#include "sv/util/workspace.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sv::service
+{
+    // Closed-set identification over a large gallery in two stages.
+    //
+    // Every enrolled speaker is represented by the supervector of its
+    // means-adapted model in an IVF index. A query utterance is MAP-adapted
+    // the same way, its supervector picks `shortlist` candidates from the
+    // index, and only those are scored exactly with GmmLlrScorer::scoreBatch
+    // (one UBM pass shared by all candidates). The cost per query is one
+    // accumulation, one index search and `shortlist` speaker passes instead
+    // of one speaker pass per gallery entry.
+    //
+    // Candidate models come from the registry, so each enrolled id must be
+    // loadable there (model file in modelDir, or put()); ids it cannot find
+    // are dropped from the result. identify() may run concurrently;
+    // enroll() and train() take an exclusive lock.
+    class SpeakerIdentifier
+    {
+    public:
+        struct Options
+        {
+            // candidates rescored with the exact LLR
+            std::size_t shortlist = 50;
+
+            // supervector: K * D entries projected to this many (0 = none)
+            std::size_t projectionDim = 256;
+            uint32_t seed = 777;
+            double relevanceFactor = 16.0;
+
+            std::size_t nlist = 1024;
+            std::size_t nprobe = 16;
+
+            std::size_t numThreads = 0; // train(), 0 = all hardware threads
+        };
+
+        struct Candidate
+        {
+            std::string speakerId;
+            double llr = 0.0;
+            float similarity = 0.0f; // supervector inner product
+        };
+
+        SpeakerIdentifier(sv::gmm::ModelRegistry& registry, Options opt);
+
+        // Before train() enrolled speakers are only collected; afterwards
+        // they go straight into the index. Throws for an id enrolled twice.
+        void enroll(const std::string& speakerId, const sv::gmm::GmmModel& model);
+
+        // Clusters the supervectors enrolled so far and indexes them.
+        void train();
+
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] bool trained() const;
+
+        // Best topN of the shortlisted speakers by descending LLR.
+        [[nodiscard]] std::vector<Candidate> identify(const libvoicefeat::FeatureMatrix& m, std::size_t topN) const;
+        [[nodiscard]] std::vector<Candidate> identify(const libvoicefeat::FeatureMatrix& m, std::size_t topN,
+                                                      sv::util::Workspace& ws) const;
+
+    private:
+        sv::gmm::ModelRegistry& _registry;
+        Options _opt;
+
+        sv::gmm::GmmBwStatsAccumulator _accumulator;
+        sv::gmm::GmmMapAdaptor _adaptor;
+        sv::gmm::GmmLlrScorer _scorer;
+        sv::gmm::SupervectorExporter _exporter;
+
+        mutable std::shared_mutex _mutex;
+        sv::util::IvfIndex _index;
+        std::vector<std::string> _ids; // by index id
+        std::unordered_map<std::string, uint32_t> _byId;
+        std::vector<float> _pending; // supervectors enrolled before train()
+    };
+}
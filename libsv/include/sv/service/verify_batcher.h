@@ -0,0 +1,118 @@
+#pragma once
+
+#include "sv/gmm/model_registry.h"
+#include "sv/gmm/scorer.h"
+#include "sv/io/feature_serdes.h"
+#include "sv/util/numa.h"
+#include "sv/util/workspace.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace sv::service
+{
+    // Collects verification requests for up to maxWait after the first one
+    // arrives (or until maxBatch are queued) and scores them together:
+    // requests against the same test file share one feature load and one
+    // UBM pass through GmmLlrScorer::scoreBatch; distinct files are scored
+    // in parallel on a pool of workers started and pinned once, with the
+    // batcher. Features are loaded with the projection of the UBM the
+    // batch is scored against. When the threads span several NUMA nodes, the
+    // file groups of a batch are split across the nodes, each scoring against
+    // its own copy of the UBM with scratch that lives on that node.
+    class VerifyBatcher
+    {
+    public:
+        struct Options
+        {
+            std::size_t maxBatch = 32;
+            std::chrono::microseconds maxWait{2000};
+            std::size_t numThreads = 0;
+
+            // nullptr = NumaTopology::system(); must outlive the batcher
+            const sv::util::NumaTopology* topology = nullptr;
+        };
+
+        struct Counters
+        {
+            std::uint64_t batches = 0;
+            std::uint64_t requests = 0;
+            std::uint64_t featureLoads = 0;
+        };
+
+        VerifyBatcher(sv::gmm::ModelRegistry& registry, Options opt);
+        ~VerifyBatcher();
+
+        VerifyBatcher(const VerifyBatcher&) = delete;
+        VerifyBatcher& operator=(const VerifyBatcher&) = delete;
+
+        [[nodiscard]] std::future<double> submit(std::string speakerId, fs::path featureFile);
+
+        [[nodiscard]] Counters counters() const;
+
+    private:
+        struct Request
+        {
+            std::string speakerId;
+            fs::path featureFile;
+            std::promise<double> result;
+        };
+
+        // Everything one file group needs while scoring. Kept across batches
+        // in a free list per node, so it is reused by that node's workers.
+        struct Scratch
+        {
+            sv::util::Workspace ws;
+            libvoicefeat::features::Feature feat;
+            std::vector<sv::gmm::SpeakerModelPtr> models;
+            std::vector<const sv::gmm::PrecomputedGmm*> spks;
+            std::vector<Request*> scored;
+            std::vector<double> scores;
+        };
+
+        sv::gmm::ModelRegistry& _registry;
+        Options _opt;
+
+        sv::gmm::GmmLlrScorer _scorer;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _cv;
+        std::deque<Request> _queue;
+        bool _stop = false;
+        Counters _counters;
+
+        // NUMA nodes the threads span; with more than one, the UBM copied
+        // onto each (redone when the registry's UBM changes). Only the batch
+        // thread touches the copies.
+        sv::util::NodeThreadPool _pool;
+        std::size_t _nodes;
+        sv::gmm::SharedUbmPtr _replicaOf;
+        std::vector<sv::gmm::PrecomputedGmm> _ubmReplicas;
+        std::vector<std::size_t> _groupsPerNode;
+
+        std::mutex _scratchMutex;
+        std::vector<std::vector<std::unique_ptr<Scratch>>> _scratch; // per node
+
+        std::thread _worker;
+
+        void run();
+        void processBatch(std::deque<Request>& batch);
+        void scoreGroup(std::vector<Request*>& reqs, const sv::io::FeatureSerdes& features,
+                        const sv::gmm::PrecomputedGmm& ubm, std::size_t node);
+
+        std::unique_ptr<Scratch> acquireScratch(std::size_t node);
+        void releaseScratch(std::size_t node, std::unique_ptr<Scratch> s);
+    };
+}
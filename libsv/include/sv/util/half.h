@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace sv::util
+{
+    // IEEE 754 binary16 <-> binary32, round-to-nearest-even; subnormals,
+    // infinities and NaN are preserved. Portable bit manipulation so no F16C
+    // or _Float16 support is needed.
+
+    inline std::uint16_t floatToHalf(float f)
+    {
+        std::uint32_t x;
+        std::memcpy(&x, &f, sizeof(x));
+
+        const std::uint32_t sign = (x >> 16) & 0x8000u;
+        const std::uint32_t absx = x & 0x7fffffffu;
+
+        if (absx >= 0x7f800000u) // inf / nan
+            return static_cast<std::uint16_t>(sign | 0x7c00u | (absx > 0x7f800000u ? 0x200u : 0u));
+
+        if (absx >= 0x477ff000u) // rounds to >= 65520: overflow to inf
+            return static_cast<std::uint16_t>(sign | 0x7c00u);
+
+        if (absx < 0x38800000u) // below the smallest normal half: subnormal or zero
+        {
+            if (absx < 0x33000000u) return static_cast<std::uint16_t>(sign); // < 2^-25 rounds to 0
+            const std::uint32_t mant = (absx & 0x007fffffu) | 0x00800000u;
+            const int shift = 126 - static_cast<int>(absx >> 23); // 14..24
+            const std::uint32_t h = mant >> shift;
+            const std::uint32_t rem = mant & ((1u << shift) - 1u);
+            const std::uint32_t half = 1u << (shift - 1);
+            const std::uint32_t round = (rem > half || (rem == half && (h & 1u))) ? 1u : 0u;
+            return static_cast<std::uint16_t>(sign | (h + round));
+        }
+
+        // normal: rebias exponent 127 -> 15 and round the 13 dropped bits
+        const std::uint32_t h = (absx - 0x38000000u) >> 13;
+        const std::uint32_t rem = absx & 0x1fffu;
+        const std::uint32_t round = (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) ? 1u : 0u;
+        return static_cast<std::uint16_t>(sign | (h + round));
+    }
+
+    inline float halfToFloat(std::uint16_t h)
+    {
+        const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+        const std::uint32_t exp = (h >> 10) & 0x1fu;
+        std::uint32_t mant = h & 0x3ffu;
+        std::uint32_t x;
+
+        if (exp == 0x1fu)
+        {
+            x = sign | 0x7f800000u | (mant << 13);
+        }
+        else if (exp != 0)
+        {
+            x = sign | ((exp + 112u) << 23) | (mant << 13);
+        }
+        else if (mant == 0)
+        {
+            x = sign;
+        }
+        else // subnormal half -> normal float
+        {
+            std::uint32_t e = 113;
+            while ((mant & 0x400u) == 0)
+            {
+                mant <<= 1;
+                --e;
+            }
+            x = sign | (e << 23) | ((mant & 0x3ffu) << 13);
+        }
+
+        float f;
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    // Same result as halfToFloat() without data-dependent branches, so loops
+    // over it vectorize: the half's exponent and mantissa, shifted into float
+    // position, read as a float 2^112 too small (subnormals included), and
+    // only inf / NaN need their exponent forced. Relies on float denormals
+    // being honoured (no flush-to-zero).
+    inline float halfToFloatBranchless(std::uint16_t h)
+    {
+        const std::uint32_t a = static_cast<std::uint32_t>(h & 0x7fffu) << 13;
+        float f;
+        std::memcpy(&f, &a, sizeof(f));
+        f *= 0x1p112f;
+
+        std::uint32_t x;
+        std::memcpy(&x, &f, sizeof(x));
+        const std::uint32_t special = 0u - static_cast<std::uint32_t>((h & 0x7c00u) == 0x7c00u); // all ones
+        x = (x & ~special) | ((0x7f800000u | a) & special);
+        x |= static_cast<std::uint32_t>(h & 0x8000u) << 16;
+
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    inline void halfToFloat(const std::uint16_t* in, float* out, std::size_t n)
+    {
+        #pragma omp simd
+        for (std::size_t i = 0; i < n; ++i) out[i] = halfToFloatBranchless(in[i]);
+    }
+}
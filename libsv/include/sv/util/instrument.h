@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Lightweight scoped timers and counters for the libsv hot paths.
+//
+// Compiled in only when SV_INSTRUMENTATION is defined to 1 (CMake option
+// SV_ENABLE_INSTRUMENTATION); otherwise the macros expand to nothing. Each
+// thread records into its own buffer, keyed by the address of the string
+// literal passed to the macro, so recording never contends across threads.
+// Buffers are merged on export; a thread that exits folds its buffer into
+// process-wide totals, so memory does not grow with the number of threads.
+//
+//   SV_TRACE_SCOPE("trainer.estep");
+//   SV_COUNTER_ADD("trainer.frames", m.size());
+
+#ifndef SV_INSTRUMENTATION
+#define SV_INSTRUMENTATION 0
+#endif
+
+namespace sv::util
+{
+    inline constexpr bool kInstrumentationEnabled = SV_INSTRUMENTATION != 0;
+
+    class Instrumentation
+    {
+    public:
+        // Also record individual scope events for the Chrome trace export
+        // (per-thread buffers, at most maxEventsPerThread each; exited threads
+        // share one buffer of the same size).
+        static void enableTrace(bool on, std::size_t maxEventsPerThread = 1 << 20);
+
+        static void recordScope(const char* name, std::chrono::steady_clock::time_point start,
+                                std::chrono::steady_clock::time_point end);
+        static void addCounter(const char* name, std::int64_t delta);
+
+        // {"scopes":{name:{count,total_ms,min_us,max_us,threads}}, "counters":{name:value}}
+        [[nodiscard]] static std::string toJson();
+        static void writeJson(const fs::path& file);
+
+        // chrome://tracing / Perfetto "traceEvents" format
+        static void writeChromeTrace(const fs::path& file);
+
+        static void reset();
+    };
+
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(const char* name) : _name(name), _start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { Instrumentation::recordScope(_name, _start, std::chrono::steady_clock::now()); }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        const char* _name;
+        std::chrono::steady_clock::time_point _start;
+    };
+}
+
+#define SV_INSTR_CONCAT_INNER(a, b) a##b
+#define SV_INSTR_CONCAT(a, b) SV_INSTR_CONCAT_INNER(a, b)
+
+#if SV_INSTRUMENTATION
+#define SV_TRACE_SCOPE(name) ::sv::util::ScopedTimer SV_INSTR_CONCAT(svScopedTimer_, __LINE__)(name)
+#define SV_COUNTER_ADD(name, delta) ::sv::util::Instrumentation::addCounter(name, static_cast<std::int64_t>(delta))
+#else
+#define SV_TRACE_SCOPE(name) ((void)0)
+#define SV_COUNTER_ADD(name, delta) ((void)0)
+#endif
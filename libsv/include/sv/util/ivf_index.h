@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::util
+{
+    // Inverted-file index for maximum inner product search over float
+    // vectors of one dimension (Jegou et al. 2011, "IVF-Flat").
+    //
+    // train() clusters a sample of the data into nlist centroids with
+    // KMeans; every added vector is stored, uncompressed, in the list of its
+    // nearest centroid. A query ranks the centroids by distance and scans
+    // only the nprobe nearest lists, so a search costs about
+    // nprobe / nlist of a brute-force scan. For unit-length vectors the
+    // inner product and the Euclidean distance give the same ranking, which
+    // is what makes the L2 coarse quantizer a good filter.
+    //
+    // search() may run concurrently with other searches; train() and add()
+    // need exclusive access.
+    class IvfIndex
+    {
+    public:
+        struct Options
+        {
+            std::size_t nlist = 1024;
+            std::size_t nprobe = 16;
+
+            std::size_t kmeansIterations = 10;
+            // training sample cap, per list (0 = train on everything)
+            std::size_t trainPointsPerList = 32;
+            uint32_t seed = 777;
+
+            std::size_t numThreads = 0; // train, addBatch, searchBatch; 0 = all hardware threads
+        };
+
+        struct Hit
+        {
+            float score = 0.0f; // inner product with the query
+            uint32_t id = 0;
+        };
+
+        IvfIndex() = default;
+        explicit IvfIndex(std::size_t dim) : IvfIndex(dim, Options()) {}
+        IvfIndex(std::size_t dim, Options opt);
+
+        [[nodiscard]] std::size_t dim() const { return _dim; }
+        [[nodiscard]] std::size_t size() const { return _size; }
+        [[nodiscard]] std::size_t nlist() const { return _lists.size(); }
+        [[nodiscard]] bool trained() const { return !_lists.empty(); }
+
+        void setNprobe(std::size_t nprobe) { _opt.nprobe = nprobe; }
+
+        // X: n x dim. nlist is capped at n. Drops any vectors already added.
+        void train(const float* X, std::size_t n);
+
+        // Ids are assigned in insertion order, starting at 0; returns the first.
+        uint32_t add(const float* v) { return addBatch(v, 1); }
+        uint32_t addBatch(const float* X, std::size_t n);
+
+        // Best k hits by descending score (fewer if the probed lists hold fewer).
+        void search(const float* q, std::size_t k, std::vector<Hit>& out) const;
+        void searchBatch(const float* Q, std::size_t nq, std::size_t k, std::vector<std::vector<Hit>>& out) const;
+
+        // Scans every list; the reference for recall measurements.
+        void searchExact(const float* q, std::size_t k, std::vector<Hit>& out) const;
+
+    private:
+        struct List
+        {
+            std::vector<float> vectors; // count x dim
+            std::vector<uint32_t> ids;
+        };
+
+        Options _opt;
+        std::size_t _dim = 0;
+        std::size_t _size = 0;
+
+        std::vector<float> _centroids; // nlist x dim
+        std::vector<float> _centroidNorms; // |c|^2
+        std::vector<List> _lists;
+
+        [[nodiscard]] std::size_t nearestList(const float* v) const;
+        void scanList(const List& list, const float* q, std::size_t k, std::vector<Hit>& heap) const;
+    };
+}
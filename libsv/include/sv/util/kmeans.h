@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sv::util
+{
+    // k-means++ seeding followed by Lloyd iterations over n points of
+    // dimension D (row-major). The seeding distance updates and the
+    // assignment step run on numThreads threads; every point is handled
+    // independently, and the seeding totals and centroid sums are taken in a
+    // fixed order, so the result does not depend on numThreads.
+    class KMeans
+    {
+    public:
+        struct Options
+        {
+            std::size_t iterations = 20;
+            std::uint32_t seed = 777;
+            std::size_t numThreads = 1; // 0 = all hardware threads
+        };
+
+        KMeans() : KMeans(Options()) {}
+        explicit KMeans(Options opt);
+
+        // M x D centroids. An empty cluster keeps its previous centroid.
+        [[nodiscard]] std::vector<double> fit(const double* P, std::size_t n, std::size_t D, std::size_t M) const;
+
+        // The k-means++ seeds alone: M x D rows of P, each drawn with
+        // probability proportional to its squared distance from the nearest
+        // seed so far.
+        [[nodiscard]] std::vector<double> seed(const double* P, std::size_t n, std::size_t D, std::size_t M) const;
+
+        // Index of the centroid in C (M x D) nearest to x.
+        [[nodiscard]] static std::size_t nearest(const double* x, const double* C, std::size_t M, std::size_t D);
+
+        [[nodiscard]] static double squaredDistance(const double* a, const double* b, std::size_t D);
+
+    private:
+        Options _opt;
+    };
+}
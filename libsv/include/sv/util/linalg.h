@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+namespace sv::util
+{
+    // Small dense symmetric routines for the i-vector and projection code.
+    // Matrices are row-major n x n; "packed" symmetric matrices keep the lower
+    // triangle row by row, n(n+1)/2 entries, (i, j) with j <= i at i(i+1)/2 + j.
+
+    [[nodiscard]] constexpr std::size_t packedSize(std::size_t n) { return n * (n + 1) / 2; }
+    [[nodiscard]] constexpr std::size_t packedIndex(std::size_t i, std::size_t j) { return i * (i + 1) / 2 + j; }
+
+    // full[n x n] = the symmetric matrix stored in packed
+    void unpackSymmetric(const double* packed, std::size_t n, double* full);
+
+    // In-place Cholesky A = L L^T; on success the lower triangle holds L and
+    // the strict upper triangle is zeroed. false if A is not positive definite.
+    bool cholesky(double* A, std::size_t n);
+
+    // Solves L L^T x = b in place given the factor from cholesky().
+    void choleskySolve(const double* L, std::size_t n, double* b);
+
+    // packed = (L L^T)^-1 given the factor from cholesky(); scratch needs n entries.
+    void choleskyInversePacked(const double* L, std::size_t n, double* packed, double* scratch);
+
+    // Eigen-decomposition of the symmetric A (destroyed) by cyclic Jacobi
+    // rotations: values in descending order, vectors row-major n x n with
+    // eigenvector i in row i. Meant for n up to a few hundred.
+    void symmetricEigen(double* A, std::size_t n, double* values, double* vectors);
+}
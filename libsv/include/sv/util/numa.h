@@ -0,0 +1,163 @@
+#pragma once
+
+#include "sv/util/parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace sv::util
+{
+    // CPUs per NUMA node, from /sys/devices/system/node on Linux. Machines
+    // without it, or with one node, get a single node holding every CPU, and
+    // the NUMA-aware paths (ParallelEStep, VerifyBatcher) fall back to their
+    // plain form there.
+    //
+    // Memory is placed by first touch: a buffer lands on the node of the
+    // thread that first writes it, so node-local data is allocated (or
+    // copied) by a thread pinned to that node, see NodeThreadPool.
+    class NumaTopology
+    {
+    public:
+        struct Node
+        {
+            std::size_t id = 0;
+            std::vector<unsigned> cpus;
+        };
+
+        // Detected once; only CPUs this process may run on are kept, and
+        // nodes left without any are dropped.
+        [[nodiscard]] static const NumaTopology& system();
+
+        // From a sysfs-style directory holding node<N>/cpulist files.
+        [[nodiscard]] static NumaTopology fromSysfs(const fs::path& root);
+
+        // One node with every CPU this process may use (NUMA placement off).
+        [[nodiscard]] static NumaTopology singleNode();
+
+        // The CPUs of this process dealt round-robin into `nodes` groups
+        // (shared when there are fewer CPUs than nodes), so the multi-node
+        // paths run, and can be tested, on a one-node machine.
+        [[nodiscard]] static NumaTopology emulated(std::size_t nodes);
+
+        [[nodiscard]] std::size_t numNodes() const { return _nodes.size(); }
+        [[nodiscard]] const Node& node(std::size_t g) const { return _nodes[g]; }
+
+        // Nodes a pool of numThreads workers spreads over: min(numNodes, threads).
+        [[nodiscard]] std::size_t activeNodes(std::size_t numThreads) const;
+
+        // Share of [0, n) that node g of `nodes` takes: contiguous, in node
+        // order, sizes differing by at most one.
+        [[nodiscard]] static std::size_t shareBegin(std::size_t g, std::size_t nodes, std::size_t n)
+        {
+            return n * g / nodes;
+        }
+        [[nodiscard]] static std::size_t shareSize(std::size_t g, std::size_t nodes, std::size_t n)
+        {
+            return shareBegin(g + 1, nodes, n) - shareBegin(g, nodes, n);
+        }
+
+    private:
+        std::vector<Node> _nodes;
+    };
+
+    // Restricts the calling thread to the node's CPUs. Returns false when the
+    // OS refuses (or is not Linux); the thread then just stays unpinned.
+    bool pinToNode(const NumaTopology::Node& node);
+
+    // Worker threads per NUMA node, started and pinned once and kept for the
+    // pool's lifetime, so hot paths that run many small parallel steps (a
+    // verify micro-batch, an E-step batch) pay neither thread creation nor
+    // re-pinning. numThreads (0 = all hardware threads) are split over
+    // topo.activeNodes(numThreads) nodes by shareSize(), at least one each.
+    // A pool of one thread runs everything on the calling thread.
+    //
+    // run() hands one job to the workers and waits for it; concurrent calls
+    // queue up and run one after the other.
+    class NodeThreadPool
+    {
+    public:
+        NodeThreadPool(const NumaTopology& topo, std::size_t numThreads);
+        ~NodeThreadPool();
+
+        NodeThreadPool(const NodeThreadPool&) = delete;
+        NodeThreadPool& operator=(const NodeThreadPool&) = delete;
+
+        [[nodiscard]] std::size_t numNodes() const { return _nodes; }
+        [[nodiscard]] std::size_t numThreads() const { return _threads; }
+
+        // Calls fn(g, i) for every i in [0, counts[g]) of every node g <
+        // counts.size() (at most numNodes()). A node's indices go to its own
+        // workers only. The first exception thrown by fn is rethrown here.
+        template <class Fn>
+        void run(const std::vector<std::size_t>& counts, Fn&& fn)
+        {
+            dispatch(counts.data(), counts.size(), false, &call<std::remove_reference_t<Fn>>, erase(fn));
+        }
+
+        // Calls fn(i) for every i in [0, n) on any worker, whatever its node.
+        template <class Fn>
+        void run(std::size_t n, Fn&& fn)
+        {
+            auto each = [&fn](std::size_t, std::size_t i) { fn(i); };
+            dispatch(&n, 1, true, &call<decltype(each)>, erase(each));
+        }
+
+    private:
+        using Call = void (*)(void* fn, std::size_t g, std::size_t i);
+
+        template <class F>
+        static void call(void* fn, std::size_t g, std::size_t i)
+        {
+            (*static_cast<F*>(fn))(g, i);
+        }
+
+        template <class F>
+        static void* erase(F& fn)
+        {
+            return const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        }
+
+        struct Job
+        {
+            const std::size_t* counts = nullptr;
+            std::size_t groups = 0;
+            bool flat = false; // every worker takes from counts[0]
+            Call call = nullptr;
+            void* fn = nullptr;
+        };
+
+        std::size_t _threads;
+        std::size_t _nodes;
+
+        std::mutex _runMutex; // one job at a time
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::uint64_t _generation = 0;
+        std::size_t _busy = 0;
+        bool _stop = false;
+
+        Job _job;
+        std::unique_ptr<std::atomic<std::size_t>[]> _next; // per node
+        std::exception_ptr _error;
+        std::mutex _errorMutex;
+
+        std::vector<std::thread> _workers;
+
+        void dispatch(const std::size_t* counts, std::size_t groups, bool flat, Call call, void* fn);
+        void work(std::size_t g);
+        void loop(std::size_t g, NumaTopology::Node node);
+    };
+}
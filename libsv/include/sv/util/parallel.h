@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sv::util
+{
+    // 0 means "use all hardware threads".
+    inline std::size_t resolveNumThreads(std::size_t requested)
+    {
+        if (requested != 0) return requested;
+        return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Calls fn(i) for every i in [0, n) on up to numThreads threads. Indices are
+    // handed out dynamically; the first exception thrown by fn is rethrown here.
+    template <class Fn>
+    void parallelFor(std::size_t n, std::size_t numThreads, Fn&& fn)
+    {
+        const std::size_t T = std::min(resolveNumThreads(numThreads), n);
+        if (T <= 1)
+        {
+            for (std::size_t i = 0; i < n; ++i) fn(i);
+            return;
+        }
+
+        std::atomic<std::size_t> next{0};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                for (std::size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) fn(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+                next.store(n);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(T - 1);
+        for (std::size_t t = 1; t < T; ++t) threads.emplace_back(worker);
+        worker();
+        for (auto& th : threads) th.join();
+
+        if (error) std::rethrow_exception(error);
+    }
+}
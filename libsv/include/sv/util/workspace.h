@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <libvoicefeat/config.h>
+
+#include "sv/util/aligned_allocator.h"
+
+namespace sv::util
+{
+    // Reusable scratch memory for the load / accumulate / score paths.
+    //
+    // Buffers only ever grow, so once a thread has seen its largest utterance
+    // and model the steady state does not touch the allocator. A workspace is
+    // not thread-safe; pass one per thread, or use local().
+    class Workspace
+    {
+    public:
+        Workspace() = default;
+
+        Workspace(const Workspace&) = delete;
+        Workspace& operator=(const Workspace&) = delete;
+
+        // The calling thread's workspace.
+        [[nodiscard]] static Workspace& local();
+
+        // Per-frame component log-likelihoods; at least n entries, contents unspecified.
+        [[nodiscard]] double* logp(std::size_t n);
+
+        // A second buffer like logp(), for paths that need two at once
+        // (e.g. UBM and speaker, or coarse and fine levels).
+        [[nodiscard]] double* logpAux(std::size_t n);
+
+        // Component index lists (shortlists, top-C); at least n entries.
+        [[nodiscard]] std::uint32_t* indices(std::size_t n);
+
+        // Contiguous frames (e.g. a packed or decoded utterance); at least n floats.
+        [[nodiscard]] float* floats(std::size_t n);
+
+        // A second buffer like floats(), e.g. frames before a projection.
+        [[nodiscard]] float* floatsAux(std::size_t n);
+
+        // Raw file bytes; at least n bytes, 64-byte aligned, contents unspecified.
+        [[nodiscard]] char* bytes(std::size_t n);
+
+        // Resizes m to rows x cols. Rows dropped by a shrink are parked here and
+        // handed back on the next grow, so their storage is reused.
+        void resizeMatrix(libvoicefeat::FeatureMatrix& m, std::size_t rows, std::size_t cols);
+
+        libvoicefeat::VADFlags vadFlags;
+
+    private:
+        std::vector<double> _logp;
+        std::vector<double> _logpAux;
+        std::vector<std::uint32_t> _indices;
+        std::vector<float> _floats;
+        std::vector<float> _floatsAux;
+        AlignedVector<char> _bytes; // aligned blocks in a file stay aligned once read
+        libvoicefeat::FeatureMatrix _spareRows;
+    };
+}
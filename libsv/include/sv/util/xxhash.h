@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sv::util
+{
+    // XXH64 (https://github.com/Cyan4973/xxHash), used for payload checksums
+    // and model fingerprints in the on-disk formats.
+    [[nodiscard]] std::uint64_t xxh64(const void* data, std::size_t len, std::uint64_t seed = 0);
+}
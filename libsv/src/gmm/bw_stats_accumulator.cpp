@@ -1,7 +1,10 @@
 #include "sv/gmm/bw_stats_accumulator.h"
 
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/gmm/parallel_estep.h"
+#include "sv/util/instrument.h"
+
 #include <cmath>
-#include <algorithm>
 #include <stdexcept>
 
 namespace sv::gmm
@@ -9,69 +12,144 @@ namespace sv::gmm
 
 GmmBwStatsAccumulator::GmmBwStatsAccumulator(Options opt) : _opt(opt) {}
 
-double GmmBwStatsAccumulator::logSumExp(const std::vector<double>& v)
+PrecomputedGmm GmmBwStatsAccumulator::precompute(const GmmModel& model) const
+{
+    if (model.empty()) throw std::runtime_error("BW accumulate: model is empty");
+    return PrecomputedGmm::from(model, _opt.minWeight);
+}
+
+void GmmBwStatsAccumulator::accumulate(BwStats& stats, const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const
+{
+    accumulate(stats, model, m, sv::util::Workspace::local());
+}
+
+void GmmBwStatsAccumulator::accumulate(BwStats& stats, const GmmModel& model, const libvoicefeat::FeatureMatrix& m,
+                                       sv::util::Workspace& ws) const
 {
-    double m = *std::max_element(v.begin(), v.end());
-    double s = 0.0;
-    for (double x : v) s += std::exp(x - m);
-    return m + std::log(s);
+    if (stats.K != model.numGaussians || stats.D != model.dim) stats.reset(model.numGaussians, model.dim);
+    if (m.empty()) return;
+
+    accumulate(stats, precompute(model), m, ws);
 }
 
-double GmmBwStatsAccumulator::logGaussianDiag(const std::vector<float>& x,
-                                             const std::vector<double>& mean,
-                                             const std::vector<double>& var) const
+void GmmBwStatsAccumulator::accumulate(BwStats& stats, const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                                       sv::util::Workspace& ws) const
 {
-    const std::size_t D = x.size();
-    double logDet = 0.0;
-    double quad = 0.0;
-
-    for (std::size_t d = 0; d < D; ++d) {
-        const double vd = var[d];
-        const double diff = static_cast<double>(x[d]) - mean[d];
-        logDet += std::log(vd);
-        quad += (diff * diff) / vd;
+    SV_TRACE_SCOPE("accumulator.accumulate");
+    SV_COUNTER_ADD("accumulator.frames", m.size());
+
+    const std::size_t K = model.numGaussians;
+    const std::size_t D = model.dim;
+
+    if (stats.K != K || stats.D != D) stats.reset(K, D);
+
+    if (_opt.numThreads != 1 || _opt.deterministic)
+    {
+        ParallelEStep::Options eo;
+        eo.numThreads = _opt.numThreads;
+        eo.chunkFrames = _opt.chunkFrames;
+        eo.deterministic = _opt.deterministic;
+
+        // one utterance is too short to pay for per-node model copies
+        static const auto oneNode = sv::util::NumaTopology::singleNode();
+        eo.topology = &oneNode;
+
+        ParallelEStep estep(model, eo);
+        for (const auto& x : m)
+        {
+            if (x.size() != D)
+                throw std::runtime_error("BW accumulate: feature dim mismatch");
+            estep.add(x.data(), 1);
+        }
+        stats.merge(estep.finish());
+        return;
     }
 
-    const double logNorm = -0.5 * (static_cast<double>(D) * std::log(2.0 * M_PI) + logDet);
-    return logNorm - 0.5 * quad;
+    const auto& kern = kernels::select(D);
+    double* logp = ws.logp(K);
+
+    for (const auto& x : m)
+    {
+        if (x.size() != D)
+            throw std::runtime_error("BW accumulate: feature dim mismatch");
+
+        kernels::accumulateFrame(kern, model, x.data(), stats, logp);
+    }
 }
 
-void GmmBwStatsAccumulator::accumulate(BwStats& stats, const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const
+void GmmBwStatsAccumulator::accumulate(BwStats& stats, const PrecomputedGmm& model, const GaussianShortlist& shortlist,
+                                       const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const
 {
+    SV_TRACE_SCOPE("accumulator.accumulate_shortlist");
+    SV_COUNTER_ADD("accumulator.frames", m.size());
+
     const std::size_t K = model.numGaussians;
     const std::size_t D = model.dim;
 
+    if (shortlist.numGaussians() != K) throw std::runtime_error("BW accumulate: shortlist does not match model");
     if (stats.K != K || stats.D != D) stats.reset(K, D);
 
-    std::vector<double> logp(K);
+    const auto& kern = kernels::select(D);
+    double* logp = ws.logp(K);
+    std::uint32_t* idx = ws.indices(shortlist.maxCandidates());
 
     for (const auto& x : m)
     {
         if (x.size() != D)
             throw std::runtime_error("BW accumulate: feature dim mismatch");
 
-        for (std::size_t k = 0; k < K; ++k) {
-            const double w = std::max(model.weights[k], _opt.minWeight);
-            logp[k] = std::log(w) + logGaussianDiag(x, model.means[k], model.vars[k]);
+        const std::size_t n = shortlist.candidates(x.data(), idx, ws);
+        kern.logLikelihoodsSubset(model, x.data(), idx, n, logp);
+
+        const double logDen = kernels::logSumExp(logp, idx, n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const std::size_t k = idx[i];
+            logp[k] = kernels::posterior(logp[k], logDen);
+            stats.N[k] += logp[k];
         }
 
-        const double logDen = logSumExp(logp);
+        kern.accumulateSubset(x.data(), logp, idx, n, D, stats.F.data(), stats.S.data());
         stats.totalLogLikelihood += logDen;
         stats.totalFrames++;
+    }
+}
+
+void GmmBwStatsAccumulator::accumulate(BwStats& stats, const UtterancePosteriors& post,
+                                       const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const
+{
+    SV_TRACE_SCOPE("accumulator.accumulate_cached");
+    SV_COUNTER_ADD("accumulator.frames", m.size());
+
+    if (post.numFrames != m.size()) throw std::runtime_error("BW accumulate: cached posteriors do not match features");
+    if (m.empty()) return;
+
+    const std::size_t K = post.numGaussians;
+    const std::size_t D = m.front().size();
+    const std::size_t C = post.topC;
+
+    if (stats.K != K || stats.D != D) stats.reset(K, D);
 
-        for (std::size_t k = 0; k < K; ++k) {
-            const double gamma = std::exp(logp[k] - logDen);
-            stats.N[k] += gamma;
+    const auto& kern = kernels::select(D);
+    double* gamma = ws.logp(K);
 
-            auto& Fk = stats.F[k];
-            auto& Sk = stats.S[k];
+    for (std::size_t t = 0; t < m.size(); ++t)
+    {
+        const auto& x = m[t];
+        if (x.size() != D)
+            throw std::runtime_error("BW accumulate: feature dim mismatch");
 
-            for (std::size_t d = 0; d < D; ++d) {
-                const auto xd = static_cast<double>(x[d]);
-                Fk[d] += gamma * xd;
-                Sk[d] += gamma * xd * xd;
-            }
+        const std::uint32_t* idx = post.frameIndices(t);
+        const float* p = post.framePosteriors(t);
+        for (std::size_t i = 0; i < C; ++i)
+        {
+            gamma[idx[i]] = p[i];
+            stats.N[idx[i]] += p[i];
         }
+
+        kern.accumulateSubset(x.data(), gamma, idx, C, D, stats.F.data(), stats.S.data());
+        stats.totalLogLikelihood += post.frameLogLik[t];
+        stats.totalFrames++;
     }
 }
 
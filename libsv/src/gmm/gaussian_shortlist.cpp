@@ -0,0 +1,195 @@
+#include "sv/gmm/gaussian_shortlist.h"
+
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/util/kmeans.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        double squaredDistance(const double* a, const double* b, std::size_t D)
+        {
+            return sv::util::KMeans::squaredDistance(a, b, D);
+        }
+    }
+
+    GaussianShortlist::GaussianShortlist(const GmmModel& ubm, Options opt)
+        : _opt(opt), _numGaussians(ubm.numGaussians)
+    {
+        if (ubm.empty()) throw std::runtime_error("Shortlist: model is empty");
+
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t D = ubm.dim;
+        const std::size_t M = std::clamp<std::size_t>(_opt.numClusters, 1, K);
+        const std::size_t perComponent = std::clamp<std::size_t>(_opt.clustersPerComponent, 1, M);
+
+        // means in units of the average per-dimension standard deviation
+        std::vector<double> scale(D, 0.0);
+        for (std::size_t k = 0; k < K; ++k)
+            for (std::size_t d = 0; d < D; ++d) scale[d] += ubm.vars[k][d];
+        for (double& s : scale) s = 1.0 / std::sqrt(std::max(s / static_cast<double>(K), 1e-12));
+
+        std::vector<double> P(K * D);
+        for (std::size_t k = 0; k < K; ++k)
+            for (std::size_t d = 0; d < D; ++d) P[k * D + d] = ubm.means[k][d] * scale[d];
+
+        sv::util::KMeans::Options ko;
+        ko.iterations = _opt.kmeansIterations;
+        ko.seed = _opt.seed;
+        const auto C = sv::util::KMeans(ko).fit(P.data(), K, D, M);
+
+        // each component under its perComponent nearest centroids
+        _groupsPerComponent = perComponent;
+        _componentGroups.resize(K * perComponent);
+
+        std::vector<std::vector<std::uint32_t>> groups(M);
+        std::vector<std::size_t> order(M);
+        std::vector<double> dist(M);
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            for (std::size_t c = 0; c < M; ++c) dist[c] = squaredDistance(P.data() + k * D, C.data() + c * D, D);
+            std::iota(order.begin(), order.end(), std::size_t(0));
+            std::partial_sort(order.begin(), order.begin() + static_cast<std::ptrdiff_t>(perComponent), order.end(),
+                              [&](std::size_t a, std::size_t b) { return dist[a] < dist[b]; });
+            for (std::size_t j = 0; j < perComponent; ++j)
+            {
+                groups[order[j]].push_back(static_cast<std::uint32_t>(k));
+                _componentGroups[k * perComponent + j] = static_cast<std::uint32_t>(order[j]);
+            }
+        }
+
+        // drop empty groups (no component lists them, so no renumbering conflicts)
+        std::vector<std::uint32_t> renumber(M);
+        std::vector<std::vector<std::uint32_t>> kept;
+        for (std::size_t c = 0; c < M; ++c)
+        {
+            renumber[c] = static_cast<std::uint32_t>(kept.size());
+            if (!groups[c].empty()) kept.push_back(std::move(groups[c]));
+        }
+        groups = std::move(kept);
+        for (auto& g : _componentGroups) g = renumber[g];
+
+        // one moment-matched Gaussian per group
+        GmmModel coarse;
+        coarse.numGaussians = groups.size();
+        coarse.dim = D;
+        coarse.weights.assign(groups.size(), 0.0);
+        coarse.means.assign(groups.size(), std::vector<double>(D, 0.0));
+        coarse.vars.assign(groups.size(), std::vector<double>(D, 0.0));
+
+        _offsets.assign(1, 0);
+        for (std::size_t g = 0; g < groups.size(); ++g)
+        {
+            double w = 0.0;
+            for (auto k : groups[g]) w += ubm.weights[k];
+
+            auto& mean = coarse.means[g];
+            auto& var = coarse.vars[g];
+            for (auto k : groups[g])
+            {
+                const double a = w > 0.0 ? ubm.weights[k] / w : 1.0 / static_cast<double>(groups[g].size());
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    mean[d] += a * ubm.means[k][d];
+                    var[d] += a * (ubm.vars[k][d] + ubm.means[k][d] * ubm.means[k][d]);
+                }
+            }
+            for (std::size_t d = 0; d < D; ++d) var[d] = std::max(var[d] - mean[d] * mean[d], 1e-12);
+            coarse.weights[g] = w;
+
+            _members.insert(_members.end(), groups[g].begin(), groups[g].end());
+            _offsets.push_back(_members.size());
+        }
+
+        // overlapping groups count a component's weight more than once
+        const double wsum = std::accumulate(coarse.weights.begin(), coarse.weights.end(), 0.0);
+        for (double& w : coarse.weights) w = wsum > 0.0 ? w / wsum : 1.0 / static_cast<double>(groups.size());
+
+        _coarse = PrecomputedGmm::from(coarse);
+    }
+
+    std::size_t GaussianShortlist::candidates(const float* x, std::uint32_t* out, sv::util::Workspace& ws) const
+    {
+        const std::size_t M = _coarse.numGaussians;
+        const std::size_t beam = std::clamp<std::size_t>(_opt.clustersPerFrame, 1, M);
+
+        double* coarse = ws.logpAux(M);
+        _coarse.componentLogLikelihoods(x, coarse);
+
+        // The beam is small, so repeated max scans beat sorting M scores. A
+        // picked group's score becomes -inf, which also marks it: a member is
+        // skipped when another of its groups was picked before this one.
+        std::size_t n = 0;
+        for (std::size_t b = 0; b < beam; ++b)
+        {
+            const std::size_t g = static_cast<std::size_t>(std::max_element(coarse, coarse + M) - coarse);
+            coarse[g] = -std::numeric_limits<double>::infinity();
+
+            for (std::size_t i = _offsets[g]; i < _offsets[g + 1]; ++i)
+            {
+                const std::uint32_t k = _members[i];
+                const std::uint32_t* own = _componentGroups.data() + k * _groupsPerComponent;
+
+                bool seen = false;
+                for (std::size_t j = 0; j < _groupsPerComponent; ++j)
+                {
+                    seen |= own[j] != g && coarse[own[j]] == -std::numeric_limits<double>::infinity();
+                }
+                if (!seen) out[n++] = k;
+            }
+        }
+        return n;
+    }
+
+    GaussianShortlist::Recall GaussianShortlist::evaluate(const PrecomputedGmm& ubm,
+                                                          const libvoicefeat::FeatureMatrix& m,
+                                                          std::size_t topC, sv::util::Workspace& ws) const
+    {
+        Recall r;
+        if (m.empty()) return r;
+        if (ubm.numGaussians != _numGaussians) throw std::runtime_error("Shortlist: model size mismatch");
+
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t C = std::clamp<std::size_t>(topC, 1, K);
+
+        std::vector<std::uint32_t> exact(K);
+        std::vector<char> listed(K);
+        double* logp = ws.logp(K);
+        std::uint32_t* cand = ws.indices(maxCandidates());
+
+        std::size_t hits = 0;
+        std::size_t candidates = 0;
+        double error = 0.0;
+
+        for (const auto& x : m)
+        {
+            if (x.size() != ubm.dim) throw std::runtime_error("Shortlist: feature dim mismatch");
+
+            ubm.componentLogLikelihoods(x.data(), logp);
+            std::iota(exact.begin(), exact.end(), 0u);
+            std::nth_element(exact.begin(), exact.begin() + static_cast<std::ptrdiff_t>(C) - 1, exact.end(),
+                             [logp](std::uint32_t a, std::uint32_t b) { return logp[a] > logp[b]; });
+
+            const std::size_t n = this->candidates(x.data(), cand, ws);
+            std::fill(listed.begin(), listed.end(), 0);
+            for (std::size_t i = 0; i < n; ++i) listed[cand[i]] = 1;
+
+            for (std::size_t i = 0; i < C; ++i) hits += listed[exact[i]];
+            candidates += n;
+            error += std::abs(kernels::logSumExp(logp, K) - kernels::logSumExp(logp, cand, n));
+        }
+
+        const auto T = static_cast<double>(m.size());
+        r.topCRecall = static_cast<double>(hits) / (T * static_cast<double>(C));
+        r.avgCandidates = static_cast<double>(candidates) / T;
+        r.avgLogLikError = error / T;
+        return r;
+    }
+}
@@ -0,0 +1,343 @@
+#include "sv/gmm/gmm_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace sv::gmm::kernels
+{
+    namespace
+    {
+        // Runtime D: the loop bound is unknown, x is read as float per component.
+        void logLikelihoodsGeneric(const PrecomputedGmm& g, const float* x, double* out)
+        {
+            const std::size_t K = g.numGaussians;
+            const std::size_t D = g.dim;
+
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                const double* mk = g.meanRow(k);
+                const double* ik = g.invVarRow(k);
+
+                double quad = 0.0;
+                #pragma omp simd reduction(+:quad)
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    const double diff = static_cast<double>(x[d]) - mk[d];
+                    quad += diff * diff * ik[d];
+                }
+
+                out[k] = g.logConstants()[k] - 0.5 * quad;
+            }
+        }
+
+        void logLikelihoodsSubsetGeneric(const PrecomputedGmm& g, const float* x, const std::uint32_t* idx,
+                                         std::size_t n, double* out)
+        {
+            const std::size_t D = g.dim;
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const std::size_t k = idx[i];
+                const double* mk = g.meanRow(k);
+                const double* ik = g.invVarRow(k);
+
+                double quad = 0.0;
+                #pragma omp simd reduction(+:quad)
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    const double diff = static_cast<double>(x[d]) - mk[d];
+                    quad += diff * diff * ik[d];
+                }
+
+                out[k] = g.logConstants()[k] - 0.5 * quad;
+            }
+        }
+
+        void logLikelihoodsSharedGeneric(const PrecomputedGmm& vars, const PrecomputedGmm* const* models,
+                                         std::size_t numModels, const float* const* x, std::size_t n, double* out)
+        {
+            const std::size_t K = vars.numGaussians;
+            const std::size_t D = vars.dim;
+
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                const double* ik = vars.invVarRow(k);
+
+                for (std::size_t j = 0; j < numModels; ++j)
+                {
+                    const double* mk = models[j]->meanRow(k);
+                    const double c = models[j]->logConstants()[k];
+
+                    for (std::size_t t = 0; t < n; ++t)
+                    {
+                        const float* xt = x[t];
+
+                        double quad = 0.0;
+                        #pragma omp simd reduction(+:quad)
+                        for (std::size_t d = 0; d < D; ++d)
+                        {
+                            const double diff = static_cast<double>(xt[d]) - mk[d];
+                            quad += diff * diff * ik[d];
+                        }
+
+                        out[(j * n + t) * K + k] = c - 0.5 * quad;
+                    }
+                }
+            }
+        }
+
+        void accumulateGeneric(const float* x, const double* gamma, std::size_t K, std::size_t D,
+                               double* N, double* F, double* S)
+        {
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                const double gk = gamma[k];
+                N[k] += gk;
+
+                double* Fk = F + k * D;
+                double* Sk = S + k * D;
+
+                #pragma omp simd
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    const auto xd = static_cast<double>(x[d]);
+                    Fk[d] += gk * xd;
+                    Sk[d] += gk * xd * xd;
+                }
+            }
+        }
+
+        void accumulateSubsetGeneric(const float* x, const double* gamma, const std::uint32_t* idx, std::size_t n,
+                                     std::size_t D, double* F, double* S)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const std::size_t k = idx[i];
+                const double gk = gamma[k];
+
+                double* Fk = F + k * D;
+                double* Sk = S + k * D;
+
+                #pragma omp simd
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    const auto xd = static_cast<double>(x[d]);
+                    Fk[d] += gk * xd;
+                    Sk[d] += gk * xd * xd;
+                }
+            }
+        }
+
+        // Compile-time D: x is widened once per frame into a padded, aligned
+        // row and every component runs the same fixed-length loop.
+        template <std::size_t D>
+        struct Fixed
+        {
+            static constexpr std::size_t kStride = PrecomputedGmm::paddedDim(D);
+
+            static void logLikelihoods(const PrecomputedGmm& g, const float* x, double* out)
+            {
+                alignas(64) double xd[kStride] = {};
+                for (std::size_t d = 0; d < D; ++d) xd[d] = static_cast<double>(x[d]);
+
+                const std::size_t K = g.numGaussians;
+                for (std::size_t k = 0; k < K; ++k)
+                {
+                    const double* mk = std::assume_aligned<64>(g.meanRow(k));
+                    const double* ik = std::assume_aligned<64>(g.invVarRow(k));
+
+                    double quad = 0.0;
+                    #pragma omp simd reduction(+:quad) aligned(xd:64)
+                    for (std::size_t d = 0; d < kStride; ++d)
+                    {
+                        const double diff = xd[d] - mk[d];
+                        quad += diff * diff * ik[d];
+                    }
+
+                    out[k] = g.logConstants()[k] - 0.5 * quad;
+                }
+            }
+
+            static void logLikelihoodsSubset(const PrecomputedGmm& g, const float* x, const std::uint32_t* idx,
+                                             std::size_t n, double* out)
+            {
+                alignas(64) double xd[kStride] = {};
+                for (std::size_t d = 0; d < D; ++d) xd[d] = static_cast<double>(x[d]);
+
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const std::size_t k = idx[i];
+                    const double* mk = std::assume_aligned<64>(g.meanRow(k));
+                    const double* ik = std::assume_aligned<64>(g.invVarRow(k));
+
+                    double quad = 0.0;
+                    #pragma omp simd reduction(+:quad) aligned(xd:64)
+                    for (std::size_t d = 0; d < kStride; ++d)
+                    {
+                        const double diff = xd[d] - mk[d];
+                        quad += diff * diff * ik[d];
+                    }
+
+                    out[k] = g.logConstants()[k] - 0.5 * quad;
+                }
+            }
+
+            static void logLikelihoodsShared(const PrecomputedGmm& vars, const PrecomputedGmm* const* models,
+                                             std::size_t numModels, const float* const* x, std::size_t n,
+                                             double* out)
+            {
+                alignas(64) double xd[kFrameBlock][kStride] = {};
+                for (std::size_t t = 0; t < n; ++t)
+                    for (std::size_t d = 0; d < D; ++d) xd[t][d] = static_cast<double>(x[t][d]);
+
+                const std::size_t K = vars.numGaussians;
+                for (std::size_t k = 0; k < K; ++k)
+                {
+                    const double* ik = std::assume_aligned<64>(vars.invVarRow(k));
+
+                    for (std::size_t j = 0; j < numModels; ++j)
+                    {
+                        const double* mk = std::assume_aligned<64>(models[j]->meanRow(k));
+                        const double c = models[j]->logConstants()[k];
+
+                        for (std::size_t t = 0; t < n; ++t)
+                        {
+                            const double* xt = xd[t];
+
+                            double quad = 0.0;
+                            #pragma omp simd reduction(+:quad) aligned(xt:64)
+                            for (std::size_t d = 0; d < kStride; ++d)
+                            {
+                                const double diff = xt[d] - mk[d];
+                                quad += diff * diff * ik[d];
+                            }
+
+                            out[(j * n + t) * K + k] = c - 0.5 * quad;
+                        }
+                    }
+                }
+            }
+
+            static void accumulate(const float* x, const double* gamma, std::size_t K, std::size_t,
+                                   double* N, double* F, double* S)
+            {
+                double xd[D];
+                double x2[D];
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    xd[d] = static_cast<double>(x[d]);
+                    x2[d] = xd[d] * xd[d];
+                }
+
+                for (std::size_t k = 0; k < K; ++k)
+                {
+                    const double gk = gamma[k];
+                    N[k] += gk;
+
+                    double* Fk = F + k * D;
+                    double* Sk = S + k * D;
+
+                    #pragma omp simd
+                    for (std::size_t d = 0; d < D; ++d)
+                    {
+                        Fk[d] += gk * xd[d];
+                        Sk[d] += gk * x2[d];
+                    }
+                }
+            }
+
+            static void accumulateSubset(const float* x, const double* gamma, const std::uint32_t* idx,
+                                         std::size_t n, std::size_t, double* F, double* S)
+            {
+                double xd[D];
+                double x2[D];
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    xd[d] = static_cast<double>(x[d]);
+                    x2[d] = xd[d] * xd[d];
+                }
+
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    const std::size_t k = idx[i];
+                    const double gk = gamma[k];
+
+                    double* Fk = F + k * D;
+                    double* Sk = S + k * D;
+
+                    #pragma omp simd
+                    for (std::size_t d = 0; d < D; ++d)
+                    {
+                        Fk[d] += gk * xd[d];
+                        Sk[d] += gk * x2[d];
+                    }
+                }
+            }
+        };
+
+        template <std::size_t D>
+        constexpr FrameKernels fixedKernels()
+        {
+            return {D, &Fixed<D>::logLikelihoods, &Fixed<D>::logLikelihoodsSubset, &Fixed<D>::accumulate,
+                    &Fixed<D>::accumulateSubset, &Fixed<D>::logLikelihoodsShared};
+        }
+
+        constexpr FrameKernels kGeneric{0, &logLikelihoodsGeneric, &logLikelihoodsSubsetGeneric, &accumulateGeneric,
+                                        &accumulateSubsetGeneric, &logLikelihoodsSharedGeneric};
+        constexpr FrameKernels kD39 = fixedKernels<39>();
+        constexpr FrameKernels kD60 = fixedKernels<60>();
+    }
+
+    const FrameKernels& select(std::size_t D)
+    {
+        switch (D)
+        {
+        case 39: return kD39;
+        case 60: return kD60;
+        default: return kGeneric;
+        }
+    }
+
+    double logSumExp(const double* v, std::size_t n)
+    {
+        const double m = *std::max_element(v, v + n);
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i) s += posterior(v[i], m);
+        return m + std::log(s);
+    }
+
+    double logSumExp(const double* v, const std::uint32_t* idx, std::size_t n)
+    {
+        double m = v[idx[0]];
+        for (std::size_t i = 1; i < n; ++i) m = std::max(m, v[idx[i]]);
+
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i) s += posterior(v[idx[i]], m);
+        return m + std::log(s);
+    }
+
+    double accumulateFrame(const FrameKernels& kern, const PrecomputedGmm& g, const float* x,
+                           BwStats& stats, double* logp, const std::vector<std::uint32_t>* components)
+    {
+        const std::size_t K = g.numGaussians;
+
+        kern.logLikelihoods(g, x, logp);
+        const double logDen = logSumExp(logp, K);
+        for (std::size_t k = 0; k < K; ++k) logp[k] = posterior(logp[k], logDen);
+
+        if (components == nullptr)
+        {
+            kern.accumulate(x, logp, K, g.dim, stats.N.data(), stats.F.data(), stats.S.data());
+        }
+        else
+        {
+            for (std::size_t k = 0; k < K; ++k) stats.N[k] += logp[k];
+            kern.accumulateSubset(x, logp, components->data(), components->size(), g.dim,
+                                  stats.F.data(), stats.S.data());
+        }
+        stats.totalLogLikelihood += logDen;
+        stats.totalFrames++;
+        return logDen;
+    }
+}
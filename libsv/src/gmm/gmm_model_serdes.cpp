@@ -1,38 +1,64 @@
 #include "sv/gmm/gmm_model_serdes.h"
 
+#include "sv/util/instrument.h"
+#include "sv/util/xxhash.h"
+
+#include <cstring>
 #include <stdexcept>
 #include <numeric>
+#include <type_traits>
 
 namespace sv::gmm
 {
-    void GmmModelSerdes::writeU32(std::ofstream& out, uint32_t v)
-    {
-        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
-    }
-
-    void GmmModelSerdes::readU32(std::ifstream& in, uint32_t& v)
+    namespace
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
-    }
+        constexpr uint64_t alignUp(uint64_t n, uint64_t a) { return (n + a - 1) / a * a; }
 
-    void GmmModelSerdes::writeU64(std::ofstream& out, uint64_t v)
-    {
-        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
-    }
+        template <class T>
+        void readBlock(const char* src, std::size_t K, std::size_t D, std::vector<std::vector<double>>& dst)
+        {
+            dst.assign(K, std::vector<double>(D));
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                if constexpr (std::is_same_v<T, double>)
+                {
+                    std::memcpy(dst[k].data(), src + k * D * sizeof(T), D * sizeof(T));
+                }
+                else
+                {
+                    const char* row = src + k * D * sizeof(T);
+                    for (std::size_t d = 0; d < D; ++d)
+                    {
+                        T v;
+                        std::memcpy(&v, row + d * sizeof(T), sizeof(T));
+                        dst[k][d] = static_cast<double>(v);
+                    }
+                }
+            }
+        }
 
-    void GmmModelSerdes::readU64(std::ifstream& in, uint64_t& v)
-    {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        template <class T>
+        void writeBlock(char* dst, const std::vector<std::vector<double>>& src, std::size_t D)
+        {
+            for (std::size_t k = 0; k < src.size(); ++k)
+            {
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    const auto v = static_cast<T>(src[k][d]);
+                    std::memcpy(dst + (k * D + d) * sizeof(T), &v, sizeof(T));
+                }
+            }
+        }
     }
 
-    void GmmModelSerdes::writeF64(std::ofstream& out, double v)
+    void GmmModelSerdes::writeU32(std::ofstream& out, uint32_t v)
     {
         out.write(reinterpret_cast<const char*>(&v), sizeof(v));
     }
 
-    void GmmModelSerdes::readF64(std::ifstream& in, double& v)
+    void GmmModelSerdes::writeU64(std::ofstream& out, uint64_t v)
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
     }
 
     void GmmModelSerdes::ensureWritable(std::ofstream& out, const fs::path& file)
@@ -68,102 +94,213 @@ namespace sv::gmm
         }
     }
 
-    void GmmModelSerdes::save(const fs::path& file, const GmmModel& model) const
+    uint64_t GmmModelSerdes::Header::meansOffset() const
+    {
+        const uint64_t w = numGaussians * scalarSize();
+        return version == kVersion1 ? w : alignUp(w, kAlignment);
+    }
+
+    uint64_t GmmModelSerdes::Header::varsOffset() const
+    {
+        const uint64_t m = numGaussians * dim * scalarSize();
+        return meansOffset() + (version == kVersion1 ? m : alignUp(m, kAlignment));
+    }
+
+    uint64_t GmmModelSerdes::fingerprint(const GmmModel& model)
     {
         validateModel(model);
-        fs::create_directories(file.parent_path());
 
-        std::ofstream out(file, std::ios::binary);
-        ensureWritable(out, file);
+        uint64_t h = util::xxh64(model.weights.data(), model.weights.size() * sizeof(double));
+        for (const auto& row : model.means) h = util::xxh64(row.data(), row.size() * sizeof(double), h);
+        for (const auto& row : model.vars) h = util::xxh64(row.data(), row.size() * sizeof(double), h);
+        return h;
+    }
 
-        out.write(kMagic.data(), (std::streamsize)kMagic.size());
-        writeU32(out, kVersion);
+    void GmmModelSerdes::parseHeader(const char* data, std::size_t size, Header& h, const fs::path& file)
+    {
+        auto u32At = [&](std::size_t off) { uint32_t v; std::memcpy(&v, data + off, sizeof(v)); return v; };
+        auto u64At = [&](std::size_t off) { uint64_t v; std::memcpy(&v, data + off, sizeof(v)); return v; };
 
-        writeU64(out, static_cast<uint64_t>(model.numGaussians));
-        writeU64(out, static_cast<uint64_t>(model.dim));
+        if (size < kMagic.size() + sizeof(uint32_t) || std::memcmp(data, kMagic.data(), kMagic.size()) != 0)
+        {
+            throw std::runtime_error("Bad magic: " + file.string());
+        }
 
-        // weights
-        for (double w : model.weights) writeF64(out, w);
+        h = Header{};
+        h.version = u32At(8);
 
-        // means
-        for (size_t k = 0; k < model.numGaussians; ++k)
+        if (h.version == kVersion1)
         {
-            for (size_t d = 0; d < model.dim; ++d)
-            {
-                writeF64(out, model.means[k][d]);
-            }
+            if (size < 28) throw std::runtime_error("Truncated header: " + file.string());
+            h.numGaussians = u64At(12);
+            h.dim = u64At(20);
+            h.payloadOffset = 28;
+            h.payloadBytes = (h.numGaussians + 2 * h.numGaussians * h.dim) * sizeof(double);
+        }
+        else if (h.version == kVersion)
+        {
+            if (size < kHeaderBytes) throw std::runtime_error("Truncated header: " + file.string());
+            h.float32 = (u32At(12) & kFlagFloat32) != 0;
+            h.numGaussians = u64At(16);
+            h.dim = u64At(24);
+            h.ubmFingerprint = u64At(32);
+            h.payloadChecksum = u64At(40);
+            h.payloadOffset = u64At(48);
+            h.payloadBytes = u64At(56);
+        }
+        else
+        {
+            throw std::runtime_error("Unsupported version: " + file.string());
         }
 
-        // vars
-        for (size_t k = 0; k < model.numGaussians; ++k)
+        if (h.numGaussians == 0 || h.dim == 0)
+        {
+            throw std::runtime_error("Invalid model shape in file: " + file.string());
+        }
+        if (h.version == kVersion && h.payloadBytes != h.varsOffset() + alignUp(h.numGaussians * h.dim * h.scalarSize(), kAlignment))
+        {
+            throw std::runtime_error("Inconsistent payload size in file: " + file.string());
+        }
+    }
+
+    std::vector<char> GmmModelSerdes::buildPayload(const GmmModel& model, const Header& h)
+    {
+        std::vector<char> payload(h.payloadBytes, 0);
+
+        if (h.float32)
         {
-            for (size_t d = 0; d < model.dim; ++d)
+            for (std::size_t k = 0; k < model.numGaussians; ++k)
             {
-                writeF64(out, model.vars[k][d]);
+                const auto w = static_cast<float>(model.weights[k]);
+                std::memcpy(payload.data() + k * sizeof(float), &w, sizeof(float));
             }
+            writeBlock<float>(payload.data() + h.meansOffset(), model.means, model.dim);
+            writeBlock<float>(payload.data() + h.varsOffset(), model.vars, model.dim);
+        }
+        else
+        {
+            std::memcpy(payload.data(), model.weights.data(), model.numGaussians * sizeof(double));
+            writeBlock<double>(payload.data() + h.meansOffset(), model.means, model.dim);
+            writeBlock<double>(payload.data() + h.varsOffset(), model.vars, model.dim);
         }
 
-        if (!out) throw std::runtime_error("Write failed: " + file.string());
+        return payload;
     }
 
-    GmmModel GmmModelSerdes::load(const fs::path& file) const
+    GmmModel GmmModelSerdes::decodePayload(const char* payload, const Header& h)
     {
-        std::ifstream in(file, std::ios::binary);
-        ensureReadable(in, file);
+        GmmModel model;
+        model.numGaussians = static_cast<size_t>(h.numGaussians);
+        model.dim = static_cast<size_t>(h.dim);
+
+        const std::size_t K = model.numGaussians;
+        const std::size_t D = model.dim;
 
-        std::array<char, 8> magic{};
-        in.read(magic.data(), (std::streamsize)magic.size());
-        if (magic != kMagic)
+        model.weights.resize(K);
+        if (h.float32)
         {
-            throw std::runtime_error("Bad magic: " + file.string());
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                float w;
+                std::memcpy(&w, payload + k * sizeof(float), sizeof(float));
+                model.weights[k] = w;
+            }
+            readBlock<float>(payload + h.meansOffset(), K, D, model.means);
+            readBlock<float>(payload + h.varsOffset(), K, D, model.vars);
         }
-
-        uint32_t version = 0;
-        readU32(in, version);
-        if (version != kVersion)
+        else
         {
-            throw std::runtime_error("Unsupported version: " + file.string());
+            std::memcpy(model.weights.data(), payload, K * sizeof(double));
+            readBlock<double>(payload + h.meansOffset(), K, D, model.means);
+            readBlock<double>(payload + h.varsOffset(), K, D, model.vars);
         }
 
-        uint64_t K64 = 0, D64 = 0;
-        readU64(in, K64);
-        readU64(in, D64);
+        return model;
+    }
 
-        const size_t K = static_cast<size_t>(K64);
-        const size_t D = static_cast<size_t>(D64);
+    void GmmModelSerdes::save(const fs::path& file, const GmmModel& model) const
+    {
+        save(file, model, SaveOptions{});
+    }
 
-        if (K == 0 || D == 0)
-        {
-            throw std::runtime_error("Invalid model shape in file: " + file.string());
-        }
+    void GmmModelSerdes::save(const fs::path& file, const GmmModel& model, const SaveOptions& opt) const
+    {
+        SV_TRACE_SCOPE("serdes.model_save");
 
-        GmmModel model;
-        model.numGaussians = K;
-        model.dim = D;
+        validateModel(model);
+        fs::create_directories(file.parent_path());
 
-        model.weights.resize(K);
-        model.means.assign(K, std::vector<double>(D));
-        model.vars.assign(K, std::vector<double>(D));
+        Header h;
+        h.version = kVersion;
+        h.float32 = opt.float32;
+        h.numGaussians = model.numGaussians;
+        h.dim = model.dim;
+        h.ubmFingerprint = opt.ubmFingerprint;
+        h.payloadOffset = kHeaderBytes;
+        h.payloadBytes = h.varsOffset() + alignUp(h.numGaussians * h.dim * h.scalarSize(), kAlignment);
 
-        for (size_t k = 0; k < K; ++k) readF64(in, model.weights[k]);
+        const auto payload = buildPayload(model, h);
+        h.payloadChecksum = util::xxh64(payload.data(), payload.size());
 
-        for (size_t k = 0; k < K; ++k)
+        std::ofstream out(file, std::ios::binary);
+        ensureWritable(out, file);
+
+        out.write(kMagic.data(), (std::streamsize)kMagic.size());
+        writeU32(out, h.version);
+        writeU32(out, h.float32 ? kFlagFloat32 : 0u);
+        writeU64(out, h.numGaussians);
+        writeU64(out, h.dim);
+        writeU64(out, h.ubmFingerprint);
+        writeU64(out, h.payloadChecksum);
+        writeU64(out, h.payloadOffset);
+        writeU64(out, h.payloadBytes);
+
+        out.write(payload.data(), (std::streamsize)payload.size());
+
+        if (!out) throw std::runtime_error("Write failed: " + file.string());
+    }
+
+    GmmModelSerdes::Header GmmModelSerdes::readHeader(const fs::path& file) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        ensureReadable(in, file);
+
+        std::array<char, kHeaderBytes> buf{};
+        in.read(buf.data(), (std::streamsize)buf.size());
+
+        Header h;
+        parseHeader(buf.data(), static_cast<std::size_t>(in.gcount()), h, file);
+        return h;
+    }
+
+    GmmModel GmmModelSerdes::load(const fs::path& file) const
+    {
+        SV_TRACE_SCOPE("serdes.model_load");
+
+        std::ifstream in(file, std::ios::binary);
+        ensureReadable(in, file);
+
+        // one bulk read instead of a read() per value
+        std::vector<char> bytes(static_cast<std::size_t>(fs::file_size(file)));
+        in.read(bytes.data(), (std::streamsize)bytes.size());
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+
+        Header h;
+        parseHeader(bytes.data(), bytes.size(), h, file);
+
+        // no offset + bytes: a corrupted header could wrap the sum
+        if (h.payloadOffset > bytes.size() || h.payloadBytes > bytes.size() - h.payloadOffset)
         {
-            for (size_t d = 0; d < D; ++d)
-            {
-                readF64(in, model.means[k][d]);
-            }
+            throw std::runtime_error("Read failed: " + file.string());
         }
 
-        for (size_t k = 0; k < K; ++k)
+        const char* payload = bytes.data() + h.payloadOffset;
+        if (h.version == kVersion && util::xxh64(payload, h.payloadBytes) != h.payloadChecksum)
         {
-            for (size_t d = 0; d < D; ++d)
-            {
-                readF64(in, model.vars[k][d]);
-            }
+            throw std::runtime_error("Checksum mismatch: " + file.string());
         }
 
-        if (!in) throw std::runtime_error("Read failed: " + file.string());
+        GmmModel model = decodePayload(payload, h);
 
         validateModel(model);
         return model;
@@ -1,87 +1,64 @@
 #include "sv/gmm/gmm_ubm_trainer.h"
 
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/gmm/parallel_estep.h"
+#include "sv/util/instrument.h"
+#include "sv/util/kmeans.h"
+#include "sv/util/parallel.h"
+
 #include <cmath>
 #include <algorithm>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
 #include <stdexcept>
 #include <iostream>
 
 namespace sv::gmm
 {
 
-GmmUbmTrainer::GmmUbmTrainer(Options opt)
-    : _opt(opt), _rng(opt.seed)
-{
-}
-
-double GmmUbmTrainer::logSumExp(const std::vector<double>& v)
-{
-    double m = *std::max_element(v.begin(), v.end());
-    double s = 0.0;
-    for (double x : v) s += std::exp(x - m);
-    return m + std::log(s);
-}
-
-double GmmUbmTrainer::logGaussianDiag(const std::vector<float>& x,
-                                     const std::vector<double>& mean,
-                                     const std::vector<double>& var) const
+namespace
 {
-    const std::size_t D = x.size();
-
-    double logDet = 0.0;
-    double quad = 0.0;
-    for (std::size_t d = 0; d < D; ++d) {
-        const double vd = var[d];
-        const double diff = static_cast<double>(x[d]) - mean[d];
-        logDet += std::log(vd);
-        quad += (diff * diff) / vd;
-    }
-
-    const double logNorm = -0.5 * (static_cast<double>(D) * std::log(2.0 * M_PI) + logDet);
-    return logNorm - 0.5 * quad;
+    // frames per assignment task in the k-means initialization
+    constexpr std::size_t kInitBlock = 256;
 }
 
-void GmmUbmTrainer::accumulateBwStats(BwStats& stats, const GmmModel& model, const FeatureMatrix& m)
+// One model of a (possibly single-model) sweep and its EM bookkeeping.
+struct GmmUbmTrainer::EmState
 {
-    const std::size_t K = model.numGaussians;
-    const std::size_t D = model.dim;
-
-    std::vector<double> logp(K);
-
-    for (const auto& x : m)
-    {
-        // TODO: VAD
-        // Feature.getVADFlags()[frameIdx] == Speech
+    GmmModel model;
+    std::mt19937 rng;
+    BwStats stats;
 
-        if (x.size() != D) {
-            throw std::runtime_error("Feature dim mismatch while accumulating BW stats");
-        }
+    std::vector<char> frozen;
+    std::vector<std::uint32_t> active; // components still updated, once any is frozen
 
-        for (std::size_t k = 0; k < K; ++k) {
-            const double lw = std::log(std::max(model.weights[k], _opt.minWeight));
-            logp[k] = lw + logGaussianDiag(x, model.means[k], model.vars[k]);
-        }
-
-        const double logDen = logSumExp(logp);
-        stats.totalLogLikelihood += logDen;
-        stats.totalFrames++;
+    double prevAvgLL = -1e100;
+    const char* converged = nullptr;
 
-        for (std::size_t k = 0; k < K; ++k) {
-            const double gamma = std::exp(logp[k] - logDen);
-            stats.N[k] += gamma;
+    // best held-out model so far
+    GmmModel bestModel;
+    double bestHeldOutLL = -std::numeric_limits<double>::infinity();
+    std::size_t staleEvaluations = 0;
+};
 
-            auto& Fk = stats.F[k];
-            auto& Sk = stats.S[k];
+GmmUbmTrainer::GmmUbmTrainer(Options opt)
+    : _opt(opt)
+{
+}
 
-            for (std::size_t d = 0; d < D; ++d) {
-                const double xd = static_cast<double>(x[d]);
-                Fk[d] += gamma * xd;
-                Sk[d] += gamma * xd * xd;
-            }
-        }
-    }
+sv::io::FeaturePrefetcher::Options GmmUbmTrainer::prefetchOptions() const
+{
+    sv::io::FeaturePrefetcher::Options o;
+    o.numIoThreads = _opt.prefetchThreads;
+    o.maxInFlightBytes = _opt.prefetchBytes;
+    return o;
 }
 
-void GmmUbmTrainer::reinitComponent(GmmModel& model, std::size_t k, const GlobalStats& gs)
+void GmmUbmTrainer::reinitComponent(GmmModel& model, std::size_t k, const GlobalStats& gs, std::mt19937& rng)
 {
     std::normal_distribution<double> nd(0.0, 1.0);
 
@@ -89,13 +66,16 @@ void GmmUbmTrainer::reinitComponent(GmmModel& model, std::size_t k, const Global
 
     for (std::size_t d = 0; d < model.dim; ++d) {
         const double sigma = std::sqrt(std::max(gs.var[d], 1e-12));
-        model.means[k][d] = gs.mean[d] + 0.1 * sigma * nd(_rng);
+        model.means[k][d] = gs.mean[d] + 0.1 * sigma * nd(rng);
         model.vars[k][d] = std::max(gs.var[d], 1e-12);
     }
 }
 
-void GmmUbmTrainer::maximize(GmmModel& model, const BwStats& stats, const GlobalStats& gs)
+double GmmUbmTrainer::maximize(GmmModel& model, const BwStats& stats, const GlobalStats& gs,
+                               std::vector<char>& frozen, std::mt19937& rng)
 {
+    SV_TRACE_SCOPE("trainer.mstep");
+
     const std::size_t K = model.numGaussians;
     const std::size_t D = model.dim;
 
@@ -112,301 +92,673 @@ void GmmUbmTrainer::maximize(GmmModel& model, const BwStats& stats, const Global
     for (double w : model.weights) wsum += w;
     for (double& w : model.weights) w /= wsum;
 
+    double maxChange = 0.0;
+
     // means + variances
     for (std::size_t k = 0; k < K; ++k)
     {
+        if (frozen[k]) continue;
+
         const double Nk = stats.N[k];
 
         if (Nk < _opt.minComponentOcc) {
-            reinitComponent(model, k, gs);
+            reinitComponent(model, k, gs, rng);
+            maxChange = std::numeric_limits<double>::infinity();
             continue;
         }
 
+        const double* Fk = stats.Frow(k);
+        const double* Sk = stats.Srow(k);
+
+        double change = 0.0;
         for (std::size_t d = 0; d < D; ++d)
         {
-            const double mean = stats.F[k][d] / Nk;
-            const double ex2  = stats.S[k][d] / Nk;
+            const double mean = Fk[d] / Nk;
+            const double ex2  = Sk[d] / Nk;
             double var = ex2 - mean * mean;
 
             const double floorVar = _opt.varianceFloor * std::max(gs.var[d], 1e-12);
             if (var < floorVar) var = floorVar;
 
+            const double oldVar = model.vars[k][d];
+            change = std::max(change, std::abs(mean - model.means[k][d]) / std::sqrt(oldVar));
+            change = std::max(change, std::abs(std::log(var / oldVar)));
+
             model.means[k][d] = mean;
             model.vars[k][d] = var;
         }
+
+        maxChange = std::max(maxChange, change);
+        if (change < _opt.freezeTolerance) frozen[k] = 1;
     }
+
+    return maxChange;
 }
 
-GmmUbmTrainer::GlobalStats GmmUbmTrainer::computeGlobalStats(const std::vector<Feature>& feats)
+GmmUbmTrainer::GlobalStats GmmUbmTrainer::computeGlobalStats(const CorpusPass& pass)
 {
-    GlobalStats gs;
+    SV_TRACE_SCOPE("trainer.global_stats");
 
-    bool dimSet = false;
-    for (const auto& f : feats) {
-        const auto& m = const_cast<Feature&>(f).getComputedMatrix();
-        if (m.empty()) continue;
-        gs.D = m[0].size();
-        dimSet = true;
-        break;
-    }
-    if (!dimSet) return gs;
+    GlobalStats gs;
 
-    gs.mean.assign(gs.D, 0.0);
-    gs.var.assign(gs.D, 0.0);
+    // mean (D comes from the first non-empty utterance)
+    pass([&](const float* X, std::size_t T, std::size_t D)
+    {
+        if (T == 0) return;
+        if (gs.D == 0) {
+            gs.D = D;
+            gs.mean.assign(D, 0.0);
+            gs.var.assign(D, 0.0);
+        }
+        if (D != gs.D) throw std::runtime_error("Feature dim mismatch while computing global stats");
 
-    // mean
-    for (const auto& f : feats) {
-        const auto& m = const_cast<Feature&>(f).getComputedMatrix();
-        for (const auto& x : m) {
+        for (std::size_t t = 0; t < T; ++t) {
+            const float* x = X + t * D;
             gs.frames++;
-            for (std::size_t d = 0; d < gs.D; ++d) gs.mean[d] += x[d];
+            for (std::size_t d = 0; d < D; ++d) gs.mean[d] += x[d];
         }
-    }
+    });
     if (gs.frames == 0) return gs;
 
     for (double& v : gs.mean) v /= static_cast<double>(gs.frames);
 
     // var
-    for (const auto& f : feats) {
-        const auto& m = const_cast<Feature&>(f).getComputedMatrix();
-        for (const auto& x : m) {
-            for (std::size_t d = 0; d < gs.D; ++d) {
+    pass([&](const float* X, std::size_t T, std::size_t D)
+    {
+        for (std::size_t t = 0; t < T; ++t) {
+            const float* x = X + t * D;
+            for (std::size_t d = 0; d < D; ++d) {
                 const double diff = static_cast<double>(x[d]) - gs.mean[d];
                 gs.var[d] += diff * diff;
             }
         }
-    }
+    });
     for (double& v : gs.var) v /= static_cast<double>(gs.frames);
 
     return gs;
 }
 
-GmmUbmTrainer::GlobalStats GmmUbmTrainer::computeGlobalStatsFromLfv(const std::vector<fs::path>& lvfFiles,
-                                                                   const sv::io::FeatureSerdes& serdes)
+void GmmUbmTrainer::initModels(std::vector<EmState>& states, const GlobalStats& gs, const CorpusPass& pass)
 {
-    GlobalStats gs;
+    SV_TRACE_SCOPE("trainer.init");
 
-    // find D
-    for (const auto& p : lvfFiles) {
-        auto f = serdes.load(p);
-        const auto& m = f.getComputedMatrix();
-        if (!m.empty()) { gs.D = m[0].size(); break; }
-    }
-    if (gs.D == 0) return gs;
+    const std::size_t D = gs.D;
 
-    gs.mean.assign(gs.D, 0.0);
-    gs.var.assign(gs.D, 0.0);
+    for (auto& st : states) {
+        GmmModel& model = st.model;
+        model.dim = D;
 
-    // mean
-    for (const auto& p : lvfFiles) {
-        auto f = serdes.load(p);
-        const auto& m = f.getComputedMatrix();
-        for (const auto& x : m) {
-            gs.frames++;
-            for (std::size_t d = 0; d < gs.D; ++d) gs.mean[d] += x[d];
+        const std::size_t K = model.numGaussians;
+        model.weights.assign(K, 1.0 / static_cast<double>(K));
+        model.means.assign(K, std::vector<double>(D, 0.0));
+        model.vars.assign(K, std::vector<double>(D, 0.0));
+
+        for (std::size_t k = 0; k < K; ++k) {
+            for (std::size_t d = 0; d < D; ++d) {
+                model.vars[k][d] = std::max(gs.var[d], 1e-12);
+            }
         }
     }
-    if (gs.frames == 0) return gs;
-    for (double& v : gs.mean) v /= static_cast<double>(gs.frames);
 
-    // var
-    for (const auto& p : lvfFiles) {
-        auto f = serdes.load(p);
-        const auto& m = f.getComputedMatrix();
-        for (const auto& x : m) {
-            for (std::size_t d = 0; d < gs.D; ++d) {
-                const double diff = static_cast<double>(x[d]) - gs.mean[d];
-                gs.var[d] += diff * diff;
+    // reservoir sample per model (K frames, or initSamplesPerComponent * K
+    // for k-means), all models in one pass, each drawing from its own generator
+    std::vector<std::vector<float>> picked(states.size());
+    std::vector<std::size_t> capacity(states.size());
+    std::vector<std::size_t> filled(states.size(), 0);
+    for (std::size_t m = 0; m < states.size(); ++m) {
+        const std::size_t K = states[m].model.numGaussians;
+        capacity[m] = _opt.kmeansInit ? K * std::max<std::size_t>(1, _opt.initSamplesPerComponent) : K;
+        capacity[m] = std::min(capacity[m], gs.frames);
+        picked[m].resize(capacity[m] * D);
+    }
+
+    std::size_t seen = 0;
+    pass([&](const float* X, std::size_t T, std::size_t)
+    {
+        for (std::size_t t = 0; t < T; ++t) {
+            const float* x = X + t * D;
+            ++seen;
+            for (std::size_t m = 0; m < states.size(); ++m) {
+                if (filled[m] < capacity[m]) {
+                    std::copy_n(x, D, picked[m].data() + filled[m]++ * D);
+                } else {
+                    std::uniform_int_distribution<std::size_t> ud(0, seen - 1);
+                    const std::size_t j = ud(states[m].rng);
+                    if (j < capacity[m]) {
+                        std::copy_n(x, D, picked[m].data() + j * D);
+                    }
+                }
             }
         }
-    }
-    for (double& v : gs.var) v /= static_cast<double>(gs.frames);
+    });
 
-    return gs;
+    for (std::size_t m = 0; m < states.size(); ++m) {
+        GmmModel& model = states[m].model;
+        const std::size_t K = model.numGaussians;
+
+        if (filled[m] < K) {
+            for (std::size_t k = 0; k < K; ++k) reinitComponent(model, k, gs, states[m].rng);
+            continue;
+        }
+
+        if (_opt.kmeansInit) {
+            kmeansInitModel(model, picked[m].data(), filled[m], gs, states[m].rng);
+            continue;
+        }
+
+        for (std::size_t k = 0; k < K; ++k) {
+            for (std::size_t d = 0; d < D; ++d) model.means[k][d] = picked[m][k * D + d];
+        }
+    }
 }
 
-void GmmUbmTrainer::initModel(GmmModel& model, const GlobalStats& gs, const std::vector<Feature>& feats)
+void GmmUbmTrainer::kmeansInitModel(GmmModel& model, float* X, std::size_t n, const GlobalStats& gs,
+                                    std::mt19937& rng) const
 {
-    model.numGaussians = _opt.numGaussians;
-    model.dim = gs.D;
+    SV_TRACE_SCOPE("trainer.kmeans");
 
     const std::size_t K = model.numGaussians;
     const std::size_t D = model.dim;
 
-    model.weights.assign(K, 1.0 / static_cast<double>(K));
-    model.means.assign(K, std::vector<double>(D, 0.0));
-    model.vars.assign(K, std::vector<double>(D, 0.0));
+    // the reservoir keeps corpus order where it was never replaced, and the
+    // mini-batches should not follow utterances
+    for (std::size_t i = n; i > 1; --i) {
+        const std::size_t j = std::uniform_int_distribution<std::size_t>(0, i - 1)(rng);
+        std::swap_ranges(X + (i - 1) * D, X + i * D, X + j * D);
+    }
 
-    for (std::size_t k = 0; k < K; ++k) {
-        for (std::size_t d = 0; d < D; ++d) {
-            model.vars[k][d] = std::max(gs.var[d], 1e-12);
+    std::vector<double> sigma(D);
+    for (std::size_t d = 0; d < D; ++d) sigma[d] = std::sqrt(std::max(gs.var[d], 1e-12));
+
+    // k-means++ seeds in standardized units
+    {
+        std::vector<double> Z(n * D);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t d = 0; d < D; ++d) Z[i * D + d] = (X[i * D + d] - gs.mean[d]) / sigma[d];
         }
-    }
 
-    std::vector<std::vector<double>> picked;
-    picked.reserve(K);
+        sv::util::KMeans::Options ko;
+        ko.seed = static_cast<std::uint32_t>(rng());
+        ko.numThreads = _opt.numThreads;
+        const auto C = sv::util::KMeans(ko).seed(Z.data(), n, D, K);
 
-    std::size_t seen = 0;
-    for (const auto& f : feats) {
-        const auto& m = const_cast<Feature&>(f).getComputedMatrix();
-        for (const auto& x : m) {
-            ++seen;
-            if (picked.size() < K) {
-                picked.emplace_back(x.begin(), x.end());
-            } else {
-                std::uniform_int_distribution<std::size_t> ud(0, seen - 1);
-                const std::size_t j = ud(_rng);
-                if (j < K) {
-                    picked[j].assign(x.begin(), x.end());
-                }
+        for (std::size_t k = 0; k < K; ++k) {
+            for (std::size_t d = 0; d < D; ++d) {
+                model.means[k][d] = gs.mean[d] + C[k * D + d] * sigma[d];
+                model.vars[k][d] = sigma[d] * sigma[d];
             }
         }
     }
 
-    if (picked.size() < K) {
-        for (std::size_t k = 0; k < K; ++k) reinitComponent(model, k, gs);
-        return;
+    // With equal weights and the global variances, the likelihood kernel's
+    // best component is the nearest centroid in standardized units.
+    const auto& kern = kernels::select(D);
+    PrecomputedGmm pre = PrecomputedGmm::from(model, _opt.minWeight);
+    std::vector<std::uint32_t> assign(n);
+
+    const auto assignFrames = [&](std::size_t begin, std::size_t end) {
+        const std::size_t blocks = (end - begin + kInitBlock - 1) / kInitBlock;
+        sv::util::parallelFor(blocks, _opt.numThreads, [&](std::size_t b) {
+            double* logp = sv::util::Workspace::local().logp(K);
+            const std::size_t first = begin + b * kInitBlock;
+            const std::size_t last = std::min(end, first + kInitBlock);
+            for (std::size_t i = first; i < last; ++i) {
+                kern.logLikelihoods(pre, X + i * D, logp);
+                assign[i] = static_cast<std::uint32_t>(std::max_element(logp, logp + K) - logp);
+            }
+        });
+    };
+
+    // mini-batch k-means (Sculley 2010): frames are assigned a batch at a
+    // time, then each moves its centroid by 1 / (frames the centroid has
+    // taken so far), in sample order
+    std::vector<double> taken(K, 0.0);
+    const std::size_t batch = std::max<std::size_t>(1, _opt.initBatchFrames);
+    for (std::size_t it = 0; it < _opt.initIterations; ++it) {
+        for (std::size_t begin = 0; begin < n; begin += batch) {
+            const std::size_t end = std::min(n, begin + batch);
+            assignFrames(begin, end);
+
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t k = assign[i];
+                const double eta = 1.0 / ++taken[k];
+                const float* x = X + i * D;
+                for (std::size_t d = 0; d < D; ++d) model.means[k][d] += eta * (x[d] - model.means[k][d]);
+            }
+            pre = PrecomputedGmm::from(model, _opt.minWeight);
+        }
+    }
+
+    // final clusters give the components
+    assignFrames(0, n);
+    BwStats stats(K, D);
+    for (std::size_t i = 0; i < n; ++i) {
+        const std::size_t k = assign[i];
+        const float* x = X + i * D;
+        double* Fk = stats.Frow(k);
+        double* Sk = stats.Srow(k);
+        stats.N[k] += 1.0;
+        for (std::size_t d = 0; d < D; ++d) {
+            const auto xd = static_cast<double>(x[d]);
+            Fk[d] += xd;
+            Sk[d] += xd * xd;
+        }
     }
 
+    double wsum = 0.0;
     for (std::size_t k = 0; k < K; ++k) {
-        for (std::size_t d = 0; d < D; ++d) model.means[k][d] = picked[k][d];
+        const double Nk = stats.N[k];
+        model.weights[k] = std::max(Nk, 1.0);
+        wsum += model.weights[k];
+
+        // too few frames for a variance: keep the centroid and the global variance
+        if (Nk < 2.0) continue;
+
+        for (std::size_t d = 0; d < D; ++d) {
+            const double mean = stats.Frow(k)[d] / Nk;
+            const double var = stats.Srow(k)[d] / Nk - mean * mean;
+            model.means[k][d] = mean;
+            model.vars[k][d] = std::max(var, _opt.varianceFloor * sigma[d] * sigma[d]);
+        }
+    }
+    for (double& w : model.weights) w /= wsum;
+
+    if (_opt.verbose) {
+        std::cout << "[UBM K=" << K << "] k-means init: " << n << " frames, "
+                  << _opt.initIterations << " mini-batch passes\n";
     }
 }
 
-void GmmUbmTrainer::initModelFromLfv(GmmModel& model,
-                                    const GlobalStats& gs,
-                                    const std::vector<fs::path>& lvfFiles,
-                                    const sv::io::FeatureSerdes& serdes)
+ParallelEStep::Options GmmUbmTrainer::estepOptions() const
 {
-    model.numGaussians = _opt.numGaussians;
-    model.dim = gs.D;
+    ParallelEStep::Options eo;
+    eo.numThreads = _opt.numThreads;
+    eo.chunkFrames = _opt.chunkFrames;
+    eo.deterministic = _opt.deterministic;
+    eo.topology = _opt.topology;
+    return eo;
+}
 
-    const std::size_t K = model.numGaussians;
-    const std::size_t D = model.dim;
+std::size_t GmmUbmTrainer::holdoutPeriod() const
+{
+    if (_opt.validationFraction <= 0.0) return 0;
+    return std::max<std::size_t>(2, static_cast<std::size_t>(std::llround(1.0 / _opt.validationFraction)));
+}
 
-    model.weights.assign(K, 1.0 / static_cast<double>(K));
-    model.means.assign(K, std::vector<double>(D, 0.0));
-    model.vars.assign(K, std::vector<double>(D, 0.0));
+GmmUbmTrainer::CorpusPass GmmUbmTrainer::everyNth(CorpusPass pass, std::size_t period, bool heldOut)
+{
+    return [pass = std::move(pass), period, heldOut](const UtteranceFn& visit)
+    {
+        std::size_t u = 0;
+        pass([&](const float* X, std::size_t T, std::size_t D) {
+            if ((u++ % period == period - 1) == heldOut) visit(X, T, D);
+        });
+    };
+}
 
-    for (std::size_t k = 0; k < K; ++k) {
-        for (std::size_t d = 0; d < D; ++d) model.vars[k][d] = std::max(gs.var[d], 1e-12);
+void GmmUbmTrainer::splitBySpeaker(const std::vector<fs::path>& files,
+                                   std::vector<fs::path>& train, std::vector<fs::path>& validation) const
+{
+    train.clear();
+    validation.clear();
+    if (_opt.validationFraction <= 0.0) {
+        train = files;
+        return;
     }
 
-    std::vector<std::vector<double>> picked;
-    picked.reserve(K);
+    // a speaker is the directory holding its files
+    std::map<fs::path, std::size_t> fileCount;
+    for (const auto& f : files) fileCount[f.parent_path()]++;
 
-    std::size_t seen = 0;
-    for (const auto& p : lvfFiles)
-    {
-        auto f = serdes.load(p);
-        const auto& m = f.getComputedMatrix();
-        for (const auto& x : m) {
-            ++seen;
-            if (picked.size() < K) {
-                picked.emplace_back(x.begin(), x.end());
-            } else {
-                std::uniform_int_distribution<std::size_t> ud(0, seen - 1);
-                const std::size_t j = ud(_rng);
-                if (j < K) {
-                    picked[j].assign(x.begin(), x.end());
-                }
-            }
-        }
-    }
+    std::vector<fs::path> speakers;
+    for (const auto& [spk, n] : fileCount) speakers.push_back(spk);
 
-    if (picked.size() < K) {
-        for (std::size_t k = 0; k < K; ++k) reinitComponent(model, k, gs);
-        return;
+    // own generator, so the split does not shift the initialization draws
+    std::mt19937 rng(_opt.seed + 1);
+    std::shuffle(speakers.begin(), speakers.end(), rng);
+
+    const auto target = static_cast<std::size_t>(std::llround(_opt.validationFraction * static_cast<double>(files.size())));
+    std::set<fs::path> held;
+    std::size_t heldFiles = 0;
+    for (std::size_t i = 0; i + 1 < speakers.size() && heldFiles < std::max<std::size_t>(1, target); ++i) {
+        held.insert(speakers[i]);
+        heldFiles += fileCount[speakers[i]];
     }
 
-    for (std::size_t k = 0; k < K; ++k) {
-        for (std::size_t d = 0; d < D; ++d) model.means[k][d] = picked[k][d];
+    for (const auto& f : files) {
+        (held.count(f.parent_path()) ? validation : train).push_back(f);
     }
 }
 
-GmmModel GmmUbmTrainer::train(const std::vector<Feature>& feats)
+std::vector<BwStats> GmmUbmTrainer::evaluateHeldOut(const std::vector<const PrecomputedGmm*>& models,
+                                                     const CorpusPass& validation, sv::util::NodeThreadPool& pool) const
+{
+    SV_TRACE_SCOPE("trainer.validation");
+
+    auto eo = estepOptions();
+    eo.pool = &pool;
+
+    const std::vector<std::uint32_t> scoreOnly;
+    std::vector<ParallelEStep> esteps;
+    esteps.reserve(models.size());
+    for (const auto* m : models) esteps.emplace_back(*m, eo, &scoreOnly);
+
+    validation([&](const float* X, std::size_t T, std::size_t D)
+    {
+        if (D != models.front()->dim && T != 0) {
+            throw std::runtime_error("Feature dim mismatch while scoring validation data");
+        }
+        for (auto& e : esteps) e.add(X, T);
+    });
+
+    std::vector<BwStats> out;
+    out.reserve(esteps.size());
+    for (auto& e : esteps) out.push_back(e.finish());
+    return out;
+}
+
+std::vector<GmmModel> GmmUbmTrainer::sweepImpl(const std::vector<std::size_t>& numGaussians,
+                                                const CorpusPass& pass, const CorpusPass& validation)
 {
-    const auto gs = computeGlobalStats(feats);
+    if (numGaussians.empty()) throw std::runtime_error("UBM sweep: no model sizes given");
+
+    const auto gs = computeGlobalStats(pass);
     if (gs.frames == 0 || gs.D == 0) throw std::runtime_error("No frames to train UBM");
 
-    GmmModel model;
-    initModel(model, gs, feats);
+    // every model starts from the same seed, so it matches a single-K run
+    std::vector<EmState> states(numGaussians.size());
+    for (std::size_t m = 0; m < states.size(); ++m) {
+        states[m].model.numGaussians = numGaussians[m];
+        states[m].rng.seed(_opt.seed);
+        states[m].frozen.assign(numGaussians[m], 0);
+    }
+    initModels(states, gs, pass);
+
+    // pinned once for the whole run: the E-step workers, and a share of the
+    // threads matching the data for the held-out pass that runs next to them
+    const auto& topo = _opt.topology ? *_opt.topology : sv::util::NumaTopology::system();
+    sv::util::NodeThreadPool pool(topo, _opt.numThreads);
+    std::unique_ptr<sv::util::NodeThreadPool> heldOutPool;
+    if (validation) {
+        const auto threads = static_cast<double>(pool.numThreads());
+        heldOutPool = std::make_unique<sv::util::NodeThreadPool>(
+            topo, std::max<std::size_t>(1, static_cast<std::size_t>(std::llround(threads * _opt.validationFraction))));
+    }
 
-    BwStats stats(model.numGaussians, model.dim);
+    auto eo = estepOptions();
+    eo.pool = &pool;
+    const std::size_t interval = std::max<std::size_t>(1, _opt.validationInterval);
+    const std::size_t patience = std::max<std::size_t>(1, _opt.validationPatience);
+
+    // returns true when it beats the model's best so far (and keeps a copy)
+    const auto recordHeldOut = [&](EmState& st, double heldOutLL, const GmmModel& evaluated) {
+        if (heldOutLL > st.bestHeldOutLL + _opt.validationTolerance) {
+            st.bestHeldOutLL = heldOutLL;
+            if (_opt.keepBestModel) st.bestModel = evaluated;
+            st.staleEvaluations = 0;
+            return true;
+        }
+        ++st.staleEvaluations;
+        return false;
+    };
 
-    double prevAvgLL = -1e100;
+    const auto tag = [&](const EmState& st) {
+        return states.size() == 1 ? std::string("[UBM] ") : "[UBM K=" + std::to_string(st.model.numGaussians) + "] ";
+    };
 
     for (std::size_t it = 0; it < _opt.maxIterations; ++it)
     {
-        stats.clearAccumulators();
+        std::vector<EmState*> running;
+        for (auto& st : states) {
+            if (!st.converged) running.push_back(&st);
+        }
+        if (running.empty()) break;
 
-        for (const auto& f : feats) {
-            const auto& m = const_cast<Feature&>(f).getComputedMatrix();
-            accumulateBwStats(stats, model, m);
+        std::size_t utterances = 0;
+        const bool evaluate = validation && it % interval == 0;
+        std::vector<BwStats> heldOutStats;
+
+        {
+            SV_TRACE_SCOPE("trainer.estep");
+
+            std::vector<PrecomputedGmm> pre;
+            std::vector<const PrecomputedGmm*> preRefs;
+            pre.reserve(running.size());
+            for (auto* st : running) {
+                st->active.clear();
+                for (std::size_t k = 0; k < st->model.numGaussians; ++k) {
+                    if (!st->frozen[k]) st->active.push_back(static_cast<std::uint32_t>(k));
+                }
+                pre.push_back(PrecomputedGmm::from(st->model, _opt.minWeight));
+                preRefs.push_back(&pre.back());
+            }
+
+            // the held-out pass scores the same models on its own threads
+            std::future<std::vector<BwStats>> heldOut;
+            if (evaluate) {
+                heldOut = std::async(std::launch::async, [&] { return evaluateHeldOut(preRefs, validation, *heldOutPool); });
+            }
+
+            // one read of the corpus feeds every model's E-step
+            std::vector<ParallelEStep> esteps;
+            esteps.reserve(running.size());
+            for (std::size_t m = 0; m < running.size(); ++m) {
+                const auto& active = running[m]->active;
+                esteps.emplace_back(pre[m], eo, active.size() == running[m]->model.numGaussians ? nullptr : &active);
+            }
+
+            pass([&](const float* X, std::size_t T, std::size_t D)
+            {
+                if (D != gs.D && T != 0) {
+                    throw std::runtime_error("Feature dim mismatch while accumulating BW stats");
+                }
+                for (auto& e : esteps) e.add(X, T);
+                ++utterances;
+            });
+            for (std::size_t m = 0; m < running.size(); ++m) running[m]->stats = esteps[m].finish();
+            if (evaluate) heldOutStats = heldOut.get();
         }
+        SV_COUNTER_ADD("trainer.iterations", 1);
+        SV_COUNTER_ADD("trainer.frames", running.front()->stats.totalFrames);
 
-        const double avgLL = stats.totalLogLikelihood / std::max<std::size_t>(1, stats.totalFrames);
+        for (std::size_t m = 0; m < running.size(); ++m)
+        {
+            EmState& st = *running[m];
+            const BwStats& stats = st.stats;
+            const std::size_t K = st.model.numGaussians;
+
+            const double avgLL = stats.totalLogLikelihood / std::max<std::size_t>(1, stats.totalFrames);
+            double heldOutLL = 0.0;
+            if (evaluate) {
+                heldOutLL = heldOutStats[m].totalLogLikelihood / std::max<std::size_t>(1, heldOutStats[m].totalFrames);
+            }
 
-        if (_opt.verbose) {
-            std::cout << "[UBM] iter " << it
-                      << " frames=" << stats.totalFrames
-                      << " avgLL=" << avgLL << "\n";
+            if (_opt.verbose) {
+                std::cout << tag(st) << "iter " << it
+                          << " utts=" << utterances
+                          << " frames=" << stats.totalFrames
+                          << " avgLL=" << avgLL;
+                if (evaluate) std::cout << " heldOutLL=" << heldOutLL;
+                if (_opt.freezeTolerance > 0.0) std::cout << " frozen=" << K - st.active.size();
+                std::cout << "\n";
+            }
+
+            // the model the E-step (and the held-out pass) saw, before it is updated
+            if (evaluate && heldOutStats[m].totalFrames != 0) {
+                recordHeldOut(st, heldOutLL, st.model);
+            }
+
+            const double paramChange = maximize(st.model, stats, gs, st.frozen, st.rng);
+
+            if (it > 0) {
+                const double dLL = std::abs(avgLL - st.prevAvgLL);
+                if (_opt.llTolerance > 0.0 && dLL < _opt.llTolerance) {
+                    st.converged = "log-likelihood change";
+                } else if (_opt.relativeLlTolerance > 0.0 && dLL < _opt.relativeLlTolerance * std::abs(st.prevAvgLL)) {
+                    st.converged = "relative log-likelihood change";
+                } else if (_opt.paramTolerance > 0.0 && paramChange < _opt.paramTolerance) {
+                    st.converged = "parameter change";
+                }
+            }
+            if (!st.converged && validation && st.staleEvaluations >= patience) {
+                st.converged = "held-out log-likelihood";
+            }
+            if (!st.converged && std::find(st.frozen.begin(), st.frozen.end(), 0) == st.frozen.end()) {
+                st.converged = "all components frozen";
+            }
+
+            if (st.converged && _opt.verbose) std::cout << tag(st) << "converged: " << st.converged << ".\n";
+            st.prevAvgLL = avgLL;
         }
+    }
+
+    std::vector<GmmModel> out;
+    out.reserve(states.size());
 
-        maximize(model, stats, gs);
+    if (!validation || !_opt.keepBestModel) {
+        for (auto& st : states) out.push_back(std::move(st.model));
+        return out;
+    }
+
+    // the last M-step of each model has not been scored yet
+    std::vector<PrecomputedGmm> pre;
+    std::vector<const PrecomputedGmm*> preRefs;
+    pre.reserve(states.size());
+    for (const auto& st : states) {
+        pre.push_back(PrecomputedGmm::from(st.model, _opt.minWeight));
+        preRefs.push_back(&pre.back());
+    }
+    const auto last = evaluateHeldOut(preRefs, validation, *heldOutPool);
 
-        if (it > 0 && std::abs(avgLL - prevAvgLL) < 1e-4) {
-            if (_opt.verbose) std::cout << "[UBM] converged.\n";
-            break;
+    for (std::size_t m = 0; m < states.size(); ++m)
+    {
+        EmState& st = states[m];
+        if (last[m].totalFrames == 0
+            || recordHeldOut(st, last[m].totalLogLikelihood / static_cast<double>(last[m].totalFrames), st.model)
+            || st.bestModel.empty()) {
+            out.push_back(std::move(st.model));
+            continue;
         }
-        prevAvgLL = avgLL;
+
+        if (_opt.verbose) std::cout << tag(st) << "keeping best held-out model: heldOutLL=" << st.bestHeldOutLL << "\n";
+        out.push_back(std::move(st.bestModel));
     }
+    return out;
+}
 
-    return model;
+GmmUbmTrainer::CorpusPass GmmUbmTrainer::featurePass(const std::vector<Feature>& feats) const
+{
+    return [&feats, speechOnly = _opt.speechOnly](const UtteranceFn& visit)
+    {
+        auto& ws = sv::util::Workspace::local();
+        for (const auto& f : feats) {
+            std::size_t T = 0, D = 0;
+            const float* X = sv::io::FeatureCorpus::pack(f, speechOnly, ws, T, D);
+            visit(X, T, D);
+        }
+    };
 }
 
-GmmModel GmmUbmTrainer::trainFromLfv(const std::vector<fs::path>& lvfFiles, const sv::io::FeatureSerdes& serdes)
+GmmUbmTrainer::CorpusPass GmmUbmTrainer::corpusPass(const sv::io::FeatureCorpus& corpus)
 {
-    const auto gs = computeGlobalStatsFromLfv(lvfFiles, serdes);
-    if (gs.frames == 0 || gs.D == 0) throw std::runtime_error("No frames to train UBM");
+    return [&corpus](const UtteranceFn& visit)
+    {
+        auto& ws = sv::util::Workspace::local();
+        for (std::size_t u = 0; u < corpus.numUtterances(); ++u) {
+            visit(corpus.utterance(u, ws), corpus.frames(u), corpus.dim());
+        }
+    };
+}
 
-    GmmModel model;
-    initModelFromLfv(model, gs, lvfFiles, serdes);
+GmmUbmTrainer::CorpusPass GmmUbmTrainer::streamPass(const std::vector<fs::path>& files,
+                                                    const sv::io::FeatureSerdes& serdes) const
+{
+    return [&files, &serdes, prefetch = prefetchOptions(), speechOnly = _opt.speechOnly](const UtteranceFn& visit)
+    {
+        auto& ws = sv::util::Workspace::local();
+        Feature f;
+        // upcoming files are read on I/O threads while this one is processed
+        for (sv::io::FeaturePrefetcher pf(serdes, files, prefetch); pf.next(f);) {
+            std::size_t T = 0, D = 0;
+            const float* X = sv::io::FeatureCorpus::pack(f, speechOnly, ws, T, D);
+            visit(X, T, D);
+        }
+    };
+}
 
-    BwStats stats(model.numGaussians, model.dim);
+GmmModel GmmUbmTrainer::train(const std::vector<Feature>& feats)
+{
+    return std::move(trainSweep({_opt.numGaussians}, feats).front());
+}
 
-    double prevAvgLL = -1e100;
+GmmModel GmmUbmTrainer::train(const sv::io::FeatureCorpus& corpus)
+{
+    return std::move(trainSweep({_opt.numGaussians}, corpus).front());
+}
 
-    for (std::size_t it = 0; it < _opt.maxIterations; ++it)
-    {
-        stats.clearAccumulators();
+GmmModel GmmUbmTrainer::trainFromLfv(const std::vector<fs::path>& lvfFiles, const sv::io::FeatureSerdes& serdes)
+{
+    return std::move(trainSweepFromLfv({_opt.numGaussians}, lvfFiles, serdes).front());
+}
 
-        for (const auto& p : lvfFiles) {
-            auto f = serdes.load(p);
-            const auto& m = f.getComputedMatrix();
-            accumulateBwStats(stats, model, m);
-        }
+std::vector<GmmModel> GmmUbmTrainer::trainSweep(const std::vector<std::size_t>& numGaussians,
+                                                const std::vector<Feature>& feats)
+{
+    const std::size_t period = holdoutPeriod();
+    if (period == 0) return sweepImpl(numGaussians, featurePass(feats), {});
+    return sweepImpl(numGaussians, everyNth(featurePass(feats), period, false),
+                     everyNth(featurePass(feats), period, true));
+}
 
-        const double avgLL = stats.totalLogLikelihood / std::max<std::size_t>(1, stats.totalFrames);
+std::vector<GmmModel> GmmUbmTrainer::trainSweep(const std::vector<std::size_t>& numGaussians,
+                                                const sv::io::FeatureCorpus& corpus)
+{
+    const std::size_t period = holdoutPeriod();
+    if (period == 0) return sweepImpl(numGaussians, corpusPass(corpus), {});
+    return sweepImpl(numGaussians, everyNth(corpusPass(corpus), period, false),
+                     everyNth(corpusPass(corpus), period, true));
+}
 
-        if (_opt.verbose) {
-            std::cout << "[UBM] iter " << it
-                      << " files=" << lvfFiles.size()
-                      << " frames=" << stats.totalFrames
-                      << " avgLL=" << avgLL << "\n";
-        }
+std::vector<GmmModel> GmmUbmTrainer::trainSweepFromLfv(const std::vector<std::size_t>& numGaussians,
+                                                       const std::vector<fs::path>& lvfFiles,
+                                                       const sv::io::FeatureSerdes& serdes)
+{
+    std::vector<fs::path> trainFiles;
+    std::vector<fs::path> validationFiles;
+    splitBySpeaker(lvfFiles, trainFiles, validationFiles);
 
-        maximize(model, stats, gs);
+    if (_opt.verbose && !validationFiles.empty()) {
+        std::cout << "[UBM] validation: files=" << validationFiles.size()
+                  << " of " << lvfFiles.size() << " (held out by speaker)\n";
+    }
 
-        if (it > 0 && std::abs(avgLL - prevAvgLL) < 1e-4) {
-            if (_opt.verbose) std::cout << "[UBM] converged.\n";
-            break;
+    sv::io::FeatureCorpus::Options co;
+    co.float16 = _opt.corpusFloat16;
+    co.speechOnly = _opt.speechOnly;
+    co.numIoThreads = _opt.prefetchThreads;
+
+    // load once and iterate from memory when the corpus fits the budget
+    const std::size_t estimate = sv::io::FeatureCorpus::estimateBytes(trainFiles, co)
+                               + sv::io::FeatureCorpus::estimateBytes(validationFiles, co);
+    if (_opt.corpusCacheBytes != 0 && estimate <= _opt.corpusCacheBytes)
+    {
+        const auto corpus = sv::io::FeatureCorpus::load(trainFiles, serdes, co);
+        const auto heldOut = sv::io::FeatureCorpus::load(validationFiles, serdes, co);
+        if (_opt.verbose) {
+            std::cout << "[UBM] corpus cached: utts=" << corpus.numUtterances()
+                      << " frames=" << corpus.numFrames()
+                      << " MiB=" << static_cast<double>(corpus.bytes() + heldOut.bytes()) / (1 << 20) << "\n";
         }
-        prevAvgLL = avgLL;
+        return sweepImpl(numGaussians, corpusPass(corpus),
+                         validationFiles.empty() ? CorpusPass() : corpusPass(heldOut));
     }
 
-    return model;
-}
+    if (_opt.verbose) {
+        std::cout << "[UBM] streaming corpus (estimated " << estimate / (1 << 20) << " MiB > budget)\n";
+    }
 
+    return sweepImpl(numGaussians, streamPass(trainFiles, serdes),
+                     validationFiles.empty() ? CorpusPass() : streamPass(validationFiles, serdes));
 }
 
+}
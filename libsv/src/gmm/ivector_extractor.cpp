@@ -0,0 +1,326 @@
+#include "sv/gmm/ivector_extractor.h"
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/util/instrument.h"
+#include "sv/util/linalg.h"
+#include "sv/util/parallel.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        // packed precision entries handled per task in assemblePrecisions()
+        constexpr std::size_t kTile = 1024;
+
+        // utterances whose linear terms share one pass over T in solve()
+        constexpr std::size_t kLinearGroup = 8;
+    }
+
+    IvectorExtractor::IvectorExtractor(const GmmModel& ubm, std::size_t rank, std::vector<double> T, Options opt)
+        : _opt(opt), _K(ubm.numGaussians), _D(ubm.dim), _R(rank), _T(std::move(T))
+    {
+        if (ubm.empty()) throw std::runtime_error("i-vector: model is empty");
+        if (_R == 0) throw std::runtime_error("i-vector: rank must be > 0");
+        if (_T.size() != _K * _D * _R) throw std::runtime_error("i-vector: T matrix shape mismatch");
+        if (_opt.batchSize == 0) _opt.batchSize = 1;
+
+        _ubmFingerprint = GmmModelSerdes::fingerprint(ubm);
+
+        _means.resize(_K * _D);
+        _invStd.resize(_K * _D);
+        for (std::size_t k = 0; k < _K; ++k)
+        {
+            for (std::size_t d = 0; d < _D; ++d)
+            {
+                _means[k * _D + d] = ubm.means[k][d];
+                _invStd[k * _D + d] = 1.0 / std::sqrt(std::max(ubm.vars[k][d], 1e-12));
+            }
+        }
+
+        rebuildTerms();
+    }
+
+    void IvectorExtractor::rebuildTerms()
+    {
+        const std::size_t P = util::packedSize(_R);
+        _TtT.assign(P * _K, 0.0);
+
+        // entry (i, j) of every T_k^T T_k, contiguous over k
+        sv::util::parallelFor(_R, _opt.numThreads, [&](std::size_t i)
+        {
+            for (std::size_t j = 0; j <= i; ++j)
+            {
+                double* out = _TtT.data() + util::packedIndex(i, j) * _K;
+                for (std::size_t k = 0; k < _K; ++k)
+                {
+                    const double* t = _T.data() + k * _D * _R;
+                    double s = 0.0;
+                    for (std::size_t d = 0; d < _D; ++d) s += t[d * _R + i] * t[d * _R + j];
+                    out[k] = s;
+                }
+            }
+        });
+    }
+
+    void IvectorExtractor::checkShape(std::size_t nSize, std::size_t fSize) const
+    {
+        if (nSize != _K || fSize != _K * _D) throw std::runtime_error("i-vector: stats shape mismatch");
+    }
+
+    void IvectorExtractor::prepare(const StatsRef* stats, std::size_t n, Batch& b) const
+    {
+        const std::size_t KD = _K * _D;
+
+        b.size = n;
+        b.N.resize(n * _K);
+        b.F.resize(n * KD);
+
+        for (std::size_t u = 0; u < n; ++u)
+        {
+            std::copy_n(stats[u].N, _K, b.N.data() + u * _K);
+
+            // F~ = (F - N mean) / sigma
+            double* f = b.F.data() + u * KD;
+            for (std::size_t k = 0; k < _K; ++k)
+            {
+                const double occ = stats[u].N[k];
+                for (std::size_t d = 0; d < _D; ++d)
+                {
+                    const std::size_t i = k * _D + d;
+                    f[i] = (stats[u].F[i] - occ * _means[i]) * _invStd[i];
+                }
+            }
+        }
+    }
+
+    void IvectorExtractor::assemblePrecisions(Batch& b) const
+    {
+        SV_TRACE_SCOPE("ivector.assemble");
+
+        const std::size_t P = util::packedSize(_R);
+        const std::size_t n = b.size;
+        b.L.resize(n * P);
+
+        // L_u = I + sum_k N_uk T_k^T T_k, i.e. the product of the batch's
+        // occupancies (n x K) with the terms (P x K, transposed). Blocks of 4
+        // entries x 2 utterances keep 8 running sums over k, so every load of
+        // a term row or an occupancy row feeds several multiply-adds.
+        const std::size_t tiles = (P + kTile - 1) / kTile;
+        sv::util::parallelFor(tiles, _opt.numThreads, [&](std::size_t tile)
+        {
+            const std::size_t begin = tile * kTile;
+            const std::size_t end = std::min(begin + kTile, P);
+
+            std::size_t p = begin;
+            for (; p + 4 <= end; p += 4)
+            {
+                const double* t0 = _TtT.data() + p * _K;
+                const double* t1 = t0 + _K;
+                const double* t2 = t1 + _K;
+                const double* t3 = t2 + _K;
+
+                std::size_t u = 0;
+                for (; u + 2 <= n; u += 2)
+                {
+                    const double* n0 = b.N.data() + u * _K;
+                    const double* n1 = n0 + _K;
+                    double s00 = 0, s01 = 0, s02 = 0, s03 = 0, s10 = 0, s11 = 0, s12 = 0, s13 = 0;
+                    #pragma omp simd reduction(+:s00, s01, s02, s03, s10, s11, s12, s13)
+                    for (std::size_t k = 0; k < _K; ++k)
+                    {
+                        s00 += n0[k] * t0[k];
+                        s01 += n0[k] * t1[k];
+                        s02 += n0[k] * t2[k];
+                        s03 += n0[k] * t3[k];
+                        s10 += n1[k] * t0[k];
+                        s11 += n1[k] * t1[k];
+                        s12 += n1[k] * t2[k];
+                        s13 += n1[k] * t3[k];
+                    }
+                    double* l0 = b.L.data() + u * P + p;
+                    double* l1 = l0 + P;
+                    l0[0] = s00; l0[1] = s01; l0[2] = s02; l0[3] = s03;
+                    l1[0] = s10; l1[1] = s11; l1[2] = s12; l1[3] = s13;
+                }
+                for (; u < n; ++u)
+                {
+                    const double* n0 = b.N.data() + u * _K;
+                    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+                    #pragma omp simd reduction(+:s0, s1, s2, s3)
+                    for (std::size_t k = 0; k < _K; ++k)
+                    {
+                        s0 += n0[k] * t0[k];
+                        s1 += n0[k] * t1[k];
+                        s2 += n0[k] * t2[k];
+                        s3 += n0[k] * t3[k];
+                    }
+                    double* l0 = b.L.data() + u * P + p;
+                    l0[0] = s0; l0[1] = s1; l0[2] = s2; l0[3] = s3;
+                }
+            }
+            for (; p < end; ++p)
+            {
+                const double* t0 = _TtT.data() + p * _K;
+                for (std::size_t u = 0; u < n; ++u)
+                {
+                    const double* n0 = b.N.data() + u * _K;
+                    double s0 = 0;
+                    #pragma omp simd reduction(+:s0)
+                    for (std::size_t k = 0; k < _K; ++k) s0 += n0[k] * t0[k];
+                    b.L[u * P + p] = s0;
+                }
+            }
+        });
+
+        for (std::size_t u = 0; u < n; ++u)
+        {
+            double* L = b.L.data() + u * P;
+            for (std::size_t i = 0; i < _R; ++i) L[util::packedIndex(i, i)] += 1.0;
+        }
+    }
+
+    void IvectorExtractor::solve(Batch& b, bool secondOrder) const
+    {
+        SV_TRACE_SCOPE("ivector.solve");
+
+        const std::size_t P = util::packedSize(_R);
+        const std::size_t KD = _K * _D;
+        const std::size_t n = b.size;
+
+        b.W.assign(n * _R, 0.0);
+        if (secondOrder) b.Cov.resize(n * P);
+
+        // linear terms sum_k T_k^T F~_k for groups of utterances, so each row
+        // of T is read once per group rather than once per utterance
+        const std::size_t groups = (n + kLinearGroup - 1) / kLinearGroup;
+        sv::util::parallelFor(groups, _opt.numThreads, [&](std::size_t g)
+        {
+            const std::size_t first = g * kLinearGroup;
+            const std::size_t last = std::min(first + kLinearGroup, n);
+
+            for (std::size_t i = 0; i < KD; ++i)
+            {
+                const double* t = _T.data() + i * _R;
+                for (std::size_t u = first; u < last; ++u)
+                {
+                    const double fi = b.F[u * KD + i];
+                    double* w = b.W.data() + u * _R;
+                    #pragma omp simd
+                    for (std::size_t r = 0; r < _R; ++r) w[r] += fi * t[r];
+                }
+            }
+        });
+
+        sv::util::parallelFor(n, _opt.numThreads, [&](std::size_t u)
+        {
+            auto& ws = sv::util::Workspace::local();
+            double* full = ws.logp(_R * _R);
+            double* scratch = ws.logpAux(_R);
+
+            double* w = b.W.data() + u * _R;
+            util::unpackSymmetric(b.L.data() + u * P, _R, full);
+            if (!util::cholesky(full, _R)) throw std::runtime_error("i-vector: precision is not positive definite");
+            util::choleskySolve(full, _R, w);
+
+            if (secondOrder)
+            {
+                double* cov = b.Cov.data() + u * P;
+                util::choleskyInversePacked(full, _R, cov, scratch);
+                for (std::size_t i = 0; i < _R; ++i)
+                {
+                    double* row = cov + util::packedIndex(i, 0);
+                    for (std::size_t j = 0; j <= i; ++j) row[j] += w[i] * w[j];
+                }
+            }
+        });
+    }
+
+    void IvectorExtractor::extractRefs(const StatsRef* stats, std::size_t n,
+                                       std::vector<std::vector<double>>& out) const
+    {
+        SV_TRACE_SCOPE("ivector.extract");
+        SV_COUNTER_ADD("ivector.utterances", n);
+
+        if (empty()) throw std::runtime_error("i-vector: extractor is empty");
+
+        out.resize(n);
+        Batch b;
+        for (std::size_t begin = 0; begin < n; begin += _opt.batchSize)
+        {
+            const std::size_t count = std::min(_opt.batchSize, n - begin);
+            prepare(stats + begin, count, b);
+            assemblePrecisions(b);
+            solve(b, false);
+
+            for (std::size_t u = 0; u < count; ++u)
+            {
+                out[begin + u].assign(b.W.begin() + static_cast<std::ptrdiff_t>(u * _R),
+                                      b.W.begin() + static_cast<std::ptrdiff_t>((u + 1) * _R));
+            }
+        }
+    }
+
+    std::vector<double> IvectorExtractor::extract(const UtteranceStats& utt) const
+    {
+        checkShape(utt.N.size(), utt.F.size());
+
+        const StatsRef ref{utt.N.data(), utt.F.data()};
+        std::vector<std::vector<double>> out;
+        extractRefs(&ref, 1, out);
+        return std::move(out.front());
+    }
+
+    std::vector<double> IvectorExtractor::extract(const SpeakerStats& spk) const
+    {
+        checkShape(spk.N().size(), spk.F().size());
+
+        const StatsRef ref{spk.N().data(), spk.F().data()};
+        std::vector<std::vector<double>> out;
+        extractRefs(&ref, 1, out);
+        return std::move(out.front());
+    }
+
+    void IvectorExtractor::extractBatch(const std::vector<const UtteranceStats*>& utts,
+                                        std::vector<std::vector<double>>& out) const
+    {
+        std::vector<StatsRef> refs;
+        refs.reserve(utts.size());
+        for (const auto* u : utts)
+        {
+            if (!u) throw std::runtime_error("i-vector: null stats");
+            checkShape(u->N.size(), u->F.size());
+            refs.push_back({u->N.data(), u->F.data()});
+        }
+        extractRefs(refs.data(), refs.size(), out);
+    }
+
+    void IvectorExtractor::lengthNormalize(std::vector<double>& w)
+    {
+        double norm = 0.0;
+        for (double v : w) norm += v * v;
+        if (norm <= 0.0) return;
+
+        const double inv = 1.0 / std::sqrt(norm);
+        for (double& v : w) v *= inv;
+    }
+
+    double IvectorExtractor::cosineScore(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        if (a.size() != b.size()) throw std::runtime_error("i-vector: dim mismatch");
+
+        double dot = 0.0, na = 0.0, nb = 0.0;
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            dot += a[i] * b[i];
+            na += a[i] * a[i];
+            nb += b[i] * b[i];
+        }
+        if (na <= 0.0 || nb <= 0.0) return 0.0;
+        return dot / std::sqrt(na * nb);
+    }
+}
@@ -0,0 +1,102 @@
+#include "sv/gmm/ivector_extractor_serdes.h"
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/util/xxhash.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        template <class T>
+        void put(char*& p, T v)
+        {
+            std::memcpy(p, &v, sizeof(T));
+            p += sizeof(T);
+        }
+
+        template <class T>
+        T take(const char*& p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+    }
+
+    void IvectorExtractorSerdes::save(const fs::path& file, const IvectorExtractor& extractor) const
+    {
+        if (extractor.empty()) throw std::runtime_error("i-vector: extractor is empty");
+        if (file.has_parent_path()) fs::create_directories(file.parent_path());
+
+        const auto& T = extractor.matrix();
+        const uint64_t payloadBytes = T.size() * sizeof(double);
+
+        std::array<char, kHeaderBytes> header{};
+        char* p = header.data();
+        std::memcpy(p, kMagic.data(), kMagic.size());
+        p += kMagic.size();
+        put<uint32_t>(p, kVersion);
+        put<uint32_t>(p, 0u);
+        put<uint64_t>(p, extractor.numGaussians());
+        put<uint64_t>(p, extractor.dim());
+        put<uint64_t>(p, extractor.rank());
+        put<uint64_t>(p, extractor.ubmFingerprint());
+        put<uint64_t>(p, util::xxh64(T.data(), payloadBytes));
+        put<uint64_t>(p, payloadBytes);
+
+        std::ofstream out(file, std::ios::binary);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+
+        out.write(header.data(), (std::streamsize)header.size());
+        out.write(reinterpret_cast<const char*>(T.data()), (std::streamsize)payloadBytes);
+
+        if (!out) throw std::runtime_error("Write failed: " + file.string());
+    }
+
+    IvectorExtractor IvectorExtractorSerdes::load(const fs::path& file, const GmmModel& ubm) const
+    {
+        return load(file, ubm, IvectorExtractor::Options());
+    }
+
+    IvectorExtractor IvectorExtractorSerdes::load(const fs::path& file, const GmmModel& ubm,
+                                                  IvectorExtractor::Options opt) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        std::array<char, kHeaderBytes> header{};
+        in.read(header.data(), (std::streamsize)header.size());
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+        if (std::memcmp(header.data(), kMagic.data(), kMagic.size()) != 0)
+            throw std::runtime_error("Bad magic: " + file.string());
+
+        const char* p = header.data() + kMagic.size();
+        const auto version = take<uint32_t>(p);
+        take<uint32_t>(p);
+        const auto K = take<uint64_t>(p);
+        const auto D = take<uint64_t>(p);
+        const auto R = take<uint64_t>(p);
+        const auto fingerprint = take<uint64_t>(p);
+        const auto checksum = take<uint64_t>(p);
+        const auto payloadBytes = take<uint64_t>(p);
+
+        if (version != kVersion) throw std::runtime_error("Unsupported version: " + file.string());
+        if (R == 0 || payloadBytes != K * D * R * sizeof(double))
+            throw std::runtime_error("Invalid extractor shape in file: " + file.string());
+        if (K != ubm.numGaussians || D != ubm.dim || fingerprint != GmmModelSerdes::fingerprint(ubm))
+            throw std::runtime_error("i-vector: extractor was trained against another UBM: " + file.string());
+
+        std::vector<double> T(K * D * R);
+        in.read(reinterpret_cast<char*>(T.data()), (std::streamsize)payloadBytes);
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+        if (util::xxh64(T.data(), payloadBytes) != checksum) throw std::runtime_error("Checksum mismatch: " + file.string());
+
+        return IvectorExtractor(ubm, static_cast<std::size_t>(R), std::move(T), opt);
+    }
+}
@@ -1,5 +1,8 @@
 #include "sv/gmm/map_adaptor.h"
 
+#include "sv/util/instrument.h"
+#include "sv/util/parallel.h"
+
 #include <stdexcept>
 #include <algorithm>
 
@@ -9,35 +12,125 @@ namespace sv::gmm
     {
     }
 
-    GmmModel GmmMapAdaptor::adaptMeansOnly(const GmmModel& ubm, const BwStats& s) const
+    void GmmMapAdaptor::checkShape(const GmmModel& ubm, std::size_t K, std::size_t D)
     {
         if (ubm.empty()) throw std::runtime_error("MAP: UBM is empty");
-        if (s.K != ubm.numGaussians || s.D != ubm.dim)
+        if (K != ubm.numGaussians || D != ubm.dim)
             throw std::runtime_error("MAP: stats shape mismatch");
+    }
 
-        GmmModel out = ubm; 
-
+    void GmmMapAdaptor::adaptMeans(GmmModel& out, const GmmModel& ubm, const double* N, const double* F) const
+    {
         const std::size_t K = ubm.numGaussians;
         const std::size_t D = ubm.dim;
         const double r = _opt.relevanceFactor;
 
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            const double Nk = N[k];
+            if (Nk <= _opt.minOcc) continue;
+
+            const double alpha = Nk / (Nk + r);
+            const double invNk = 1.0 / Nk;
+            const double* Fk = F + k * D;
+            const double* mu = ubm.means[k].data();
+            double* outMu = out.means[k].data();
+
+            #pragma omp simd
+            for (std::size_t d = 0; d < D; ++d)
+            {
+                outMu[d] = alpha * (Fk[d] * invNk) + (1.0 - alpha) * mu[d];
+            }
+        }
+    }
+
+    GmmModel GmmMapAdaptor::adaptMeansOnly(const GmmModel& ubm, const BwStats& s) const
+    {
+        SV_TRACE_SCOPE("map.adapt_means");
+        checkShape(ubm, s.K, s.D);
+
+        GmmModel out = ubm;
+        adaptMeans(out, ubm, s.N.data(), s.F.data());
+        return out;
+    }
+
+    GmmModel GmmMapAdaptor::adaptMeansOnly(const GmmModel& ubm, const SpeakerStats& s) const
+    {
+        SV_TRACE_SCOPE("map.adapt_means");
+        checkShape(ubm, s.numGaussians(), s.dim());
+
+        GmmModel out = ubm;
+        adaptMeans(out, ubm, s.N().data(), s.F().data());
+        return out;
+    }
+
+    GmmModel GmmMapAdaptor::adapt(const GmmModel& ubm, const BwStats& s) const
+    {
+        SV_TRACE_SCOPE("map.adapt");
+        checkShape(ubm, s.K, s.D);
+
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t D = ubm.dim;
+
+        GmmModel out = ubm;
+
+        double T = 0.0;
+        for (double n : s.N) T += n;
+        if (T <= 0.0) return out;
+
         for (std::size_t k = 0; k < K; ++k)
         {
             const double Nk = s.N[k];
-            if (Nk <= _opt.minOcc)
+
+            if (_opt.adaptWeights)
             {
-                out.means[k] = ubm.means[k];
-                continue;
+                const double aw = Nk / (Nk + _opt.weightRelevanceFactor);
+                out.weights[k] = std::max(aw * (Nk / T) + (1.0 - aw) * ubm.weights[k], _opt.minWeight);
             }
 
-            const double alpha = Nk / (Nk + r);
+            if (Nk <= _opt.minOcc) continue;
+
+            const double am = Nk / (Nk + _opt.relevanceFactor);
+            const double av = _opt.adaptVariances ? Nk / (Nk + _opt.varianceRelevanceFactor) : 0.0;
+            const double invNk = 1.0 / Nk;
+            const double floorScale = _opt.varianceFloor;
+
+            const double* Fk = s.Frow(k);
+            const double* Sk = s.Srow(k);
+            const double* mu = ubm.means[k].data();
+            const double* var = ubm.vars[k].data();
+            double* outMu = out.means[k].data();
+            double* outVar = out.vars[k].data();
+
+            #pragma omp simd
             for (std::size_t d = 0; d < D; ++d)
             {
-                const double mlMean = s.F[k][d] / Nk;
-                out.means[k][d] = alpha * mlMean + (1.0 - alpha) * ubm.means[k][d];
+                const double ex = Fk[d] * invNk;
+                const double ex2 = Sk[d] * invNk;
+                const double m = am * ex + (1.0 - am) * mu[d];
+                const double v = av * ex2 + (1.0 - av) * (var[d] + mu[d] * mu[d]) - m * m;
+                const double vFloor = floorScale * var[d];
+
+                outMu[d] = m;
+                if (av > 0.0) outVar[d] = v < vFloor ? vFloor : v;
             }
         }
 
+        if (_opt.adaptWeights)
+        {
+            double wsum = 0.0;
+            for (double w : out.weights) wsum += w;
+            for (double& w : out.weights) w /= wsum;
+        }
+
+        return out;
+    }
+
+    std::vector<GmmModel> GmmMapAdaptor::adaptBatch(const GmmModel& ubm, const std::vector<BwStats>& spkStats) const
+    {
+        std::vector<GmmModel> out(spkStats.size());
+        sv::util::parallelFor(spkStats.size(), _opt.numThreads,
+                              [&](std::size_t i) { out[i] = adapt(ubm, spkStats[i]); });
         return out;
     }
-} 
+}
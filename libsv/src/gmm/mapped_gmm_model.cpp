@@ -0,0 +1,173 @@
+#include "sv/gmm/mapped_gmm_model.h"
+
+#include "sv/util/instrument.h"
+#include "sv/util/xxhash.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sv::gmm
+{
+    MappedGmmModel::MappedGmmModel(const fs::path& file, bool verifyChecksum)
+    {
+        SV_TRACE_SCOPE("serdes.model_map");
+
+        const int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat: " + file.string());
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+
+        void* p = _size ? ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("mmap failed: " + file.string() + ": " + std::strerror(errno));
+        _base = p;
+
+        try
+        {
+            GmmModelSerdes::parseHeader(static_cast<const char*>(_base), _size, _header, file);
+
+            if (_header.version != GmmModelSerdes::kVersion)
+                throw std::runtime_error("MappedGmmModel: only v2 files can be mapped: " + file.string());
+            if (_header.payloadOffset % GmmModelSerdes::kAlignment != 0
+                || _header.payloadOffset > _size || _header.payloadBytes > _size - _header.payloadOffset)
+                throw std::runtime_error("MappedGmmModel: bad payload layout: " + file.string());
+
+            if (verifyChecksum && util::xxh64(payload(), _header.payloadBytes) != _header.payloadChecksum)
+                throw std::runtime_error("Checksum mismatch: " + file.string());
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    MappedGmmModel::~MappedGmmModel()
+    {
+        unmap();
+    }
+
+    MappedGmmModel::MappedGmmModel(MappedGmmModel&& other) noexcept
+        : _base(std::exchange(other._base, nullptr)),
+          _size(std::exchange(other._size, 0)),
+          _header(other._header)
+    {
+    }
+
+    MappedGmmModel& MappedGmmModel::operator=(MappedGmmModel&& other) noexcept
+    {
+        if (this != &other)
+        {
+            unmap();
+            _base = std::exchange(other._base, nullptr);
+            _size = std::exchange(other._size, 0);
+            _header = other._header;
+        }
+        return *this;
+    }
+
+    void MappedGmmModel::unmap()
+    {
+        if (_base) ::munmap(_base, _size);
+        _base = nullptr;
+        _size = 0;
+    }
+
+    const char* MappedGmmModel::payload() const
+    {
+        return static_cast<const char*>(_base) + _header.payloadOffset;
+    }
+
+    void MappedGmmModel::requireScalar(bool f32) const
+    {
+        if (_header.float32 != f32)
+            throw std::runtime_error(f32 ? "MappedGmmModel: model is float64" : "MappedGmmModel: model is float32");
+    }
+
+    const double* MappedGmmModel::weights() const
+    {
+        requireScalar(false);
+        return reinterpret_cast<const double*>(payload() + _header.weightsOffset());
+    }
+
+    const double* MappedGmmModel::means() const
+    {
+        requireScalar(false);
+        return reinterpret_cast<const double*>(payload() + _header.meansOffset());
+    }
+
+    const double* MappedGmmModel::vars() const
+    {
+        requireScalar(false);
+        return reinterpret_cast<const double*>(payload() + _header.varsOffset());
+    }
+
+    const float* MappedGmmModel::weightsF32() const
+    {
+        requireScalar(true);
+        return reinterpret_cast<const float*>(payload() + _header.weightsOffset());
+    }
+
+    const float* MappedGmmModel::meansF32() const
+    {
+        requireScalar(true);
+        return reinterpret_cast<const float*>(payload() + _header.meansOffset());
+    }
+
+    const float* MappedGmmModel::varsF32() const
+    {
+        requireScalar(true);
+        return reinterpret_cast<const float*>(payload() + _header.varsOffset());
+    }
+
+    PrecomputedGmm MappedGmmModel::precompute(double minWeight) const
+    {
+        if (_header.float32)
+            return PrecomputedGmm::fromFlat(numGaussians(), dim(), weightsF32(), meansF32(), varsF32(), minWeight);
+        return PrecomputedGmm::fromFlat(numGaussians(), dim(), weights(), means(), vars(), minWeight);
+    }
+
+    GmmModel MappedGmmModel::toModel() const
+    {
+        const std::size_t K = numGaussians();
+        const std::size_t D = dim();
+
+        GmmModel model;
+        model.numGaussians = K;
+        model.dim = D;
+        model.weights.resize(K);
+        model.means.assign(K, std::vector<double>(D));
+        model.vars.assign(K, std::vector<double>(D));
+
+        auto fill = [&](const auto* w, const auto* m, const auto* v)
+        {
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                model.weights[k] = w[k];
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    model.means[k][d] = m[k * D + d];
+                    model.vars[k][d] = v[k * D + d];
+                }
+            }
+        };
+
+        if (_header.float32) fill(weightsF32(), meansF32(), varsF32());
+        else fill(weights(), means(), vars());
+
+        return model;
+    }
+}
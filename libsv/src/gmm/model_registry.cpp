@@ -0,0 +1,272 @@
+#include "sv/gmm/model_registry.h"
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/mapped_gmm_model.h"
+#include "sv/gmm/shared_model_store.h"
+#include "sv/io/feature_projection_serdes.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace sv::gmm
+{
+    ModelRegistry::ModelRegistry(SharedUbmPtr ubm, Options opt)
+        : _ubm(std::move(ubm)), _opt(std::move(opt))
+    {
+        if (!_ubm || _ubm->model.empty()) throw std::runtime_error("ModelRegistry: UBM is empty");
+    }
+
+    SharedUbmPtr ModelRegistry::loadUbm(const fs::path& file, double minWeight)
+    {
+        auto ubm = std::make_shared<SharedUbm>();
+        ubm->model = GmmModelSerdes().load(file);
+        ubm->precomputed = PrecomputedGmm::from(ubm->model, minWeight);
+        ubm->fingerprint = GmmModelSerdes::fingerprint(ubm->model);
+        ubm->projection = sv::io::FeatureProjectionSerdes().featureOptionsFor(file, ubm->fingerprint).projection;
+        return ubm;
+    }
+
+    SharedUbmPtr ModelRegistry::ubm() const
+    {
+        std::shared_lock lock(_mutex);
+        return _ubm;
+    }
+
+    void ModelRegistry::attach(std::shared_ptr<const SharedModelSegment> segment)
+    {
+        if (!segment) throw std::runtime_error("ModelRegistry: null segment");
+
+        std::unique_lock lock(_mutex);
+        // the feature files being scored do not change with the UBM
+        if (segment->ubm()->featureDim() != _ubm->featureDim())
+            throw std::runtime_error("ModelRegistry: segment UBM expects " + std::to_string(segment->ubm()->featureDim())
+                                     + "-dim features, not " + std::to_string(_ubm->featureDim()));
+        _ubm = segment->ubm();
+        _segment = std::move(segment);
+        _epoch++;
+
+        _slots.clear();
+        _residentBytes = 0;
+    }
+
+    uint64_t ModelRegistry::attachedGeneration() const
+    {
+        std::shared_lock lock(_mutex);
+        return _segment ? _segment->generation() : 0;
+    }
+
+    PrecomputedGmm ModelRegistry::loadModel(const fs::path& file, const SharedUbm& ubm) const
+    {
+        const GmmModelSerdes serdes;
+        const auto header = serdes.readHeader(file);
+
+        if (header.numGaussians != ubm.model.numGaussians || header.dim != ubm.model.dim)
+            throw std::runtime_error("ModelRegistry: model shape does not match UBM: " + file.string());
+
+        PrecomputedGmm model;
+        if (header.version == GmmModelSerdes::kVersion)
+        {
+            if (header.ubmFingerprint != 0 && header.ubmFingerprint != ubm.fingerprint)
+                throw std::runtime_error("ModelRegistry: model was adapted from a different UBM: " + file.string());
+
+            model = MappedGmmModel(file).precompute(_opt.minWeight);
+        }
+        else
+        {
+            model = PrecomputedGmm::from(serdes.load(file), _opt.minWeight);
+        }
+
+        // once per load, so scoring can take the fused path without comparing
+        model.linkVariances(ubm.precomputed);
+        return model;
+    }
+
+    bool ModelRegistry::isValidSpeakerId(const std::string& speakerId)
+    {
+        if (speakerId.empty() || speakerId.size() > kMaxSpeakerIdLength) return false;
+
+        return std::all_of(speakerId.begin(), speakerId.end(), [](char c) {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        });
+    }
+
+    fs::path ModelRegistry::modelPath(const std::string& speakerId) const
+    {
+        if (!isValidSpeakerId(speakerId)) throw std::runtime_error("ModelRegistry: invalid speaker id: " + speakerId);
+        return _opt.modelDir / (_opt.filePrefix + speakerId + _opt.fileExtension);
+    }
+
+    fs::path ModelRegistry::statsPath(const std::string& speakerId) const
+    {
+        if (!isValidSpeakerId(speakerId)) throw std::runtime_error("ModelRegistry: invalid speaker id: " + speakerId);
+        return _opt.modelDir / (_opt.filePrefix + speakerId + _opt.statsExtension);
+    }
+
+    std::size_t ModelRegistry::footprint(const PrecomputedGmm& model)
+    {
+        return sizeof(PrecomputedGmm)
+            + (model.means.capacity() + model.invVars.capacity() + model.logConst.capacity()) * sizeof(double);
+    }
+
+    SpeakerModelPtr ModelRegistry::lookup(const std::string& speakerId, Snapshot* snapshot) const
+    {
+        std::shared_lock lock(_mutex);
+        auto it = _slots.find(speakerId);
+        if (it == _slots.end())
+        {
+            *snapshot = {_ubm, _putIds.count(speakerId) ? nullptr : _segment, _epoch};
+            return nullptr;
+        }
+
+        it->second->lastUse.store(_tick.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+        return it->second->model;
+    }
+
+    SpeakerModelPtr ModelRegistry::find(const std::string& speakerId)
+    {
+        Snapshot snap;
+        if (auto model = lookup(speakerId, &snap))
+        {
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return model;
+        }
+        _misses.fetch_add(1, std::memory_order_relaxed);
+
+        if (snap.segment)
+        {
+            if (auto model = snap.segment->find(speakerId)) return insert(speakerId, std::move(model), false, snap.epoch);
+        }
+
+        const fs::path file = modelPath(speakerId);
+        if (!fs::exists(file)) return nullptr;
+
+        std::shared_ptr<const PrecomputedGmm> pre;
+        try
+        {
+            pre = std::make_shared<const PrecomputedGmm>(loadModel(file, *snap.ubm));
+        }
+        catch (const std::exception&)
+        {
+            _loadFailures.fetch_add(1, std::memory_order_relaxed);
+            throw;
+        }
+
+        return insert(speakerId, std::move(pre), false, snap.epoch);
+    }
+
+    SpeakerModelPtr ModelRegistry::get(const std::string& speakerId)
+    {
+        auto model = find(speakerId);
+        if (!model) throw std::runtime_error("ModelRegistry: unknown speaker: " + speakerId);
+        return model;
+    }
+
+    void ModelRegistry::put(const std::string& speakerId, const GmmModel& model)
+    {
+        uint64_t epoch;
+        SharedUbmPtr ubm;
+        {
+            std::unique_lock lock(_mutex);
+            if (model.numGaussians != _ubm->model.numGaussians || model.dim != _ubm->model.dim)
+                throw std::runtime_error("ModelRegistry: model shape does not match UBM");
+            epoch = _epoch;
+            ubm = _ubm;
+            _putIds.insert(speakerId);
+        }
+
+        PrecomputedGmm pre = PrecomputedGmm::from(model, _opt.minWeight);
+        pre.linkVariances(ubm->precomputed);
+        insert(speakerId, std::make_shared<const PrecomputedGmm>(std::move(pre)), true, epoch);
+    }
+
+    void ModelRegistry::invalidate(const std::string& speakerId)
+    {
+        std::unique_lock lock(_mutex);
+        auto it = _slots.find(speakerId);
+        if (it == _slots.end()) return;
+
+        _residentBytes -= it->second->bytes;
+        _slots.erase(it);
+    }
+
+    SpeakerModelPtr ModelRegistry::insert(const std::string& speakerId, SpeakerModelPtr model, bool replace,
+                                          uint64_t epoch)
+    {
+        const std::size_t bytes = footprint(*model);
+
+        std::unique_lock lock(_mutex);
+
+        // loaded against a UBM that attach() has replaced since
+        if (epoch != _epoch) return model;
+
+        auto it = _slots.find(speakerId);
+        if (it != _slots.end())
+        {
+            // another thread loaded it while we were reading the file
+            if (!replace) return it->second->model;
+
+            _residentBytes -= it->second->bytes;
+            _slots.erase(it);
+        }
+
+        evictLocked(bytes);
+
+        auto slot = std::make_unique<Slot>();
+        slot->model = model;
+        slot->bytes = bytes;
+        slot->lastUse.store(_tick.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+
+        _residentBytes += bytes;
+        _slots.emplace(speakerId, std::move(slot));
+        return model;
+    }
+
+    void ModelRegistry::evictLocked(std::size_t incomingBytes)
+    {
+        if (_residentBytes + incomingBytes <= _opt.maxBytes || _slots.empty()) return;
+
+        const auto target = static_cast<std::size_t>(static_cast<double>(_opt.maxBytes) * _opt.lowWatermark);
+
+        std::vector<std::pair<std::uint64_t, const std::string*>> byAge;
+        byAge.reserve(_slots.size());
+        for (const auto& [id, slot] : _slots)
+        {
+            byAge.emplace_back(slot->lastUse.load(std::memory_order_relaxed), &id);
+        }
+        std::sort(byAge.begin(), byAge.end());
+
+        std::vector<std::string> victims;
+        std::size_t resident = _residentBytes;
+        for (const auto& [tick, id] : byAge)
+        {
+            if (resident + incomingBytes <= target) break;
+            resident -= _slots.at(*id)->bytes;
+            victims.push_back(*id);
+        }
+
+        for (const auto& id : victims)
+        {
+            auto it = _slots.find(id);
+            _residentBytes -= it->second->bytes;
+            _slots.erase(it);
+        }
+        _evictions.fetch_add(victims.size(), std::memory_order_relaxed);
+    }
+
+    ModelRegistry::Counters ModelRegistry::counters() const
+    {
+        Counters c;
+        c.hits = _hits.load(std::memory_order_relaxed);
+        c.misses = _misses.load(std::memory_order_relaxed);
+        c.evictions = _evictions.load(std::memory_order_relaxed);
+        c.loadFailures = _loadFailures.load(std::memory_order_relaxed);
+
+        std::shared_lock lock(_mutex);
+        c.residentModels = _slots.size();
+        c.residentBytes = _residentBytes;
+        return c;
+    }
+}
@@ -0,0 +1,273 @@
+#include "sv/gmm/parallel_estep.h"
+
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/util/instrument.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    ParallelEStep::ParallelEStep(const PrecomputedGmm& model, Options opt,
+                                 const std::vector<std::uint32_t>* components)
+        : _model(model), _opt(opt), _components(components), _pool(opt.pool)
+    {
+        if (_opt.chunkFrames == 0) throw std::runtime_error("E-step: chunkFrames must be > 0");
+
+        if (!_pool)
+        {
+            _ownPool = std::make_unique<sv::util::NodeThreadPool>(
+                _opt.topology ? *_opt.topology : sv::util::NumaTopology::system(), _opt.numThreads);
+            _pool = _ownPool.get();
+        }
+
+        // one chunk per thread per batch; the batch size never changes which
+        // frames share a chunk, only how many are staged at once. Slot c
+        // holds chunk c of a batch and, without determinism, worker c.
+        _threads = _pool->numThreads();
+        _batchChunks = _threads;
+        _nodes = _pool->numNodes();
+
+        const std::size_t K = _model.numGaussians;
+        const std::size_t D = _model.dim;
+        const std::size_t slotFloats = _opt.chunkFrames * D;
+
+        _stage = std::make_unique_for_overwrite<float[]>(_batchChunks * slotFloats);
+        _logp.resize(_batchChunks);
+        if (_opt.deterministic) _batch.resize(_batchChunks);
+        else _workers.resize(_batchChunks);
+
+        const auto initSlot = [&](std::size_t c)
+        {
+            std::fill_n(_stage.get() + c * slotFloats, slotFloats, 0.0f);
+            _logp[c].assign(K, 0.0);
+            (_opt.deterministic ? _batch[c] : _workers[c]).reset(K, D);
+        };
+
+        if (_nodes == 1)
+        {
+            for (std::size_t c = 0; c < _batchChunks; ++c) initSlot(c);
+            return;
+        }
+
+        // first touch on the node that will use the slot
+        _replicas.resize(_nodes);
+        _pool->run(slotsPerNode(_batchChunks), [&](std::size_t g, std::size_t i)
+        {
+            if (i == 0) _replicas[g] = _model.copy();
+            initSlot(slotBegin(g) + i);
+        });
+    }
+
+    std::size_t ParallelEStep::slotBegin(std::size_t g) const
+    {
+        return sv::util::NumaTopology::shareBegin(g, _nodes, _batchChunks);
+    }
+
+    std::vector<std::size_t> ParallelEStep::slotsPerNode(std::size_t n) const
+    {
+        std::vector<std::size_t> counts(_nodes);
+        for (std::size_t g = 0; g < _nodes; ++g)
+        {
+            counts[g] = std::min(slotBegin(g + 1), n) - std::min(slotBegin(g), n);
+        }
+        return counts;
+    }
+
+    void ParallelEStep::add(const float* X, std::size_t T)
+    {
+        const std::size_t D = _model.dim;
+        const std::size_t capacity = _batchChunks * _opt.chunkFrames;
+
+        while (T > 0)
+        {
+            const std::size_t n = std::min(T, capacity - _staged);
+            std::memcpy(_stage.get() + _staged * D, X, n * D * sizeof(float));
+            _staged += n;
+            X += n * D;
+            T -= n;
+
+            if (_staged == capacity) runBatch();
+        }
+    }
+
+    void ParallelEStep::accumulateChunk(const PrecomputedGmm& model, std::size_t c, BwStats& stats, double* logp) const
+    {
+        const std::size_t D = _model.dim;
+        const std::size_t begin = c * _opt.chunkFrames;
+        const std::size_t end = std::min(begin + _opt.chunkFrames, _staged);
+        const auto& kern = kernels::select(D);
+
+        for (std::size_t t = begin; t < end; ++t)
+        {
+            kernels::accumulateFrame(kern, model, _stage.get() + t * D, stats, logp, _components);
+        }
+    }
+
+    void ParallelEStep::runBatch()
+    {
+        if (_staged == 0) return;
+
+        SV_TRACE_SCOPE("estep.batch");
+
+        const std::size_t chunks = (_staged + _opt.chunkFrames - 1) / _opt.chunkFrames;
+        SV_COUNTER_ADD("estep.chunks", chunks);
+
+        if (_opt.deterministic)
+        {
+            if (_nodes == 1)
+            {
+                _pool->run(chunks, [&](std::size_t c)
+                {
+                    _batch[c].clearAccumulators();
+                    accumulateChunk(_model, c, _batch[c], _logp[c].data());
+                });
+            }
+            else
+            {
+                _pool->run(slotsPerNode(chunks), [&](std::size_t g, std::size_t i)
+                {
+                    const std::size_t c = slotBegin(g) + i;
+                    _batch[c].clearAccumulators();
+                    accumulateChunk(_replicas[g], c, _batch[c], _logp[c].data());
+                });
+            }
+
+            // chunk order, whichever thread finished first. Node-local chunk
+            // stats stay in their slot and the tree sums copies of them.
+            for (std::size_t c = 0; c < chunks; ++c)
+            {
+                if (_nodes == 1)
+                {
+                    pushChunk(std::move(_batch[c]));
+                    _batch[c] = acquire();
+                }
+                else
+                {
+                    BwStats s = acquire();
+                    s = _batch[c];
+                    pushChunk(std::move(s));
+                }
+            }
+        }
+        else if (_nodes == 1)
+        {
+            const std::size_t workers = std::min(_threads, chunks);
+            std::atomic<std::size_t> next{0};
+
+            _pool->run(workers, [&](std::size_t w)
+            {
+                for (std::size_t c = next.fetch_add(1); c < chunks; c = next.fetch_add(1))
+                {
+                    accumulateChunk(_model, c, _workers[w], _logp[w].data());
+                }
+            });
+        }
+        else
+        {
+            // a node's workers only take the chunks staged in its own slots
+            const auto perNode = slotsPerNode(chunks);
+            std::vector<std::size_t> workers(_nodes);
+            std::vector<std::atomic<std::size_t>> next(_nodes);
+            for (std::size_t g = 0; g < _nodes; ++g)
+            {
+                workers[g] = std::min(slotBegin(g + 1) - slotBegin(g), perNode[g]);
+                next[g].store(0);
+            }
+
+            _pool->run(workers, [&](std::size_t g, std::size_t i)
+            {
+                const std::size_t w = slotBegin(g) + i;
+                for (std::size_t j = next[g].fetch_add(1); j < perNode[g]; j = next[g].fetch_add(1))
+                {
+                    accumulateChunk(_replicas[g], slotBegin(g) + j, _workers[w], _logp[w].data());
+                }
+            });
+        }
+
+        _staged = 0;
+    }
+
+    BwStats ParallelEStep::acquire()
+    {
+        if (_free.empty()) return BwStats(_model.numGaussians, _model.dim);
+
+        BwStats s = std::move(_free.back());
+        _free.pop_back();
+        return s;
+    }
+
+    // Binary-counter pairwise summation: the new chunk enters at level 0 and
+    // two partial sums of the same level merge (older += newer) into the next
+    // one, so at most log2(chunks) + 1 partial sums are alive.
+    void ParallelEStep::pushChunk(BwStats&& s)
+    {
+        _tree.emplace_back(0u, std::move(s));
+
+        while (_tree.size() >= 2 && _tree[_tree.size() - 1].first == _tree[_tree.size() - 2].first)
+        {
+            auto& older = _tree[_tree.size() - 2];
+            older.second.merge(_tree.back().second);
+            older.first++;
+
+            _free.push_back(std::move(_tree.back().second));
+            _tree.pop_back();
+        }
+    }
+
+    BwStats ParallelEStep::finish()
+    {
+        runBatch();
+
+        BwStats out(_model.numGaussians, _model.dim);
+
+        if (_opt.deterministic)
+        {
+            // fold the remaining partial sums, newest first
+            while (_tree.size() >= 2)
+            {
+                _tree[_tree.size() - 2].second.merge(_tree.back().second);
+                _free.push_back(std::move(_tree.back().second));
+                _tree.pop_back();
+            }
+
+            if (!_tree.empty())
+            {
+                out = std::move(_tree.back().second);
+                _tree.clear();
+            }
+        }
+        else if (_nodes == 1)
+        {
+            for (auto& w : _workers)
+            {
+                out.merge(w);
+                w.clearAccumulators();
+            }
+        }
+        else
+        {
+            // each node sums its own workers, then the node totals meet here
+            _pool->run(std::vector<std::size_t>(_nodes, 1), [&](std::size_t g, std::size_t)
+            {
+                BwStats& head = _workers[slotBegin(g)];
+                for (std::size_t w = slotBegin(g) + 1; w < slotBegin(g + 1); ++w)
+                {
+                    head.merge(_workers[w]);
+                    _workers[w].clearAccumulators();
+                }
+            });
+
+            for (std::size_t g = 0; g < _nodes; ++g)
+            {
+                out.merge(_workers[slotBegin(g)]);
+                _workers[slotBegin(g)].clearAccumulators();
+            }
+        }
+
+        return out;
+    }
+}
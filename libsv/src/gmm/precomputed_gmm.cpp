@@ -0,0 +1,219 @@
+#include "sv/gmm/precomputed_gmm.h"
+
+#include "sv/gmm/gmm_kernels.h"
+
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <utility>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        // never reused, so an id cannot outlive the block it stood for
+        std::uint64_t newVarianceId()
+        {
+            static std::atomic<std::uint64_t> next{1};
+            return next.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PrecomputedGmm::PrecomputedGmm(const PrecomputedGmm& other)
+        : numGaussians(other.numGaussians), dim(other.dim), stride(other.stride),
+          means(other.means), invVars(other.invVars), logConst(other.logConst), _varianceId(other._varianceId)
+    {
+        bind(other);
+    }
+
+    PrecomputedGmm::PrecomputedGmm(PrecomputedGmm&& other) noexcept
+        : numGaussians(other.numGaussians), dim(other.dim), stride(other.stride),
+          means(std::move(other.means)), invVars(std::move(other.invVars)), logConst(std::move(other.logConst)),
+          _varianceId(other._varianceId)
+    {
+        bind(other);
+        other.bind(PrecomputedGmm());
+        other._varianceId = 0;
+    }
+
+    PrecomputedGmm& PrecomputedGmm::operator=(const PrecomputedGmm& other)
+    {
+        if (this != &other)
+        {
+            PrecomputedGmm copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    PrecomputedGmm& PrecomputedGmm::operator=(PrecomputedGmm&& other) noexcept
+    {
+        if (this != &other)
+        {
+            numGaussians = other.numGaussians;
+            dim = other.dim;
+            stride = other.stride;
+            means = std::move(other.means);
+            invVars = std::move(other.invVars);
+            logConst = std::move(other.logConst);
+            _varianceId = other._varianceId;
+            bind(other);
+            other.bind(PrecomputedGmm());
+            other._varianceId = 0;
+        }
+        return *this;
+    }
+
+    void PrecomputedGmm::bind(const PrecomputedGmm& from)
+    {
+        _backing = from._backing;
+        if (_backing)
+        {
+            _means = from._means;
+            _invVars = from._invVars;
+            _logConst = from._logConst;
+        }
+        else
+        {
+            _means = means.data();
+            _invVars = invVars.data();
+            _logConst = logConst.data();
+        }
+    }
+
+    PrecomputedGmm PrecomputedGmm::view(std::size_t K, std::size_t D, const double* means,
+                                        const double* invVars, const double* logConst,
+                                        std::shared_ptr<const void> backing)
+    {
+        if (K == 0 || D == 0) throw std::runtime_error("PrecomputedGmm: model is empty");
+        if (!backing) throw std::runtime_error("PrecomputedGmm: view needs a backing");
+
+        PrecomputedGmm p;
+        p.numGaussians = K;
+        p.dim = D;
+        p.stride = paddedDim(D);
+        p._means = means;
+        p._invVars = invVars;
+        p._logConst = logConst;
+        p._backing = std::move(backing);
+        p._varianceId = newVarianceId();
+        return p;
+    }
+
+    PrecomputedGmm PrecomputedGmm::from(const GmmModel& model, double minWeight)
+    {
+        if (model.empty()) throw std::runtime_error("PrecomputedGmm: model is empty");
+
+        const std::size_t K = model.numGaussians;
+        const std::size_t D = model.dim;
+
+        PrecomputedGmm p;
+        p.numGaussians = K;
+        p.dim = D;
+        p.stride = paddedDim(D);
+        p.means.assign(K * p.stride, 0.0);
+        p.invVars.assign(K * p.stride, 0.0);
+        p.logConst.resize(K);
+
+        const double log2Pi = std::log(2.0 * M_PI);
+
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            double logDet = 0.0;
+            for (std::size_t d = 0; d < D; ++d)
+            {
+                const double vd = model.vars[k][d];
+                p.means[k * p.stride + d] = model.means[k][d];
+                p.invVars[k * p.stride + d] = 1.0 / vd;
+                logDet += std::log(vd);
+            }
+
+            const double w = std::max(model.weights[k], minWeight);
+            p.logConst[k] = std::log(w) - 0.5 * (static_cast<double>(D) * log2Pi + logDet);
+        }
+
+        p.bind(PrecomputedGmm());
+        p._varianceId = newVarianceId();
+        return p;
+    }
+
+    template <class T>
+    PrecomputedGmm PrecomputedGmm::fromFlat(std::size_t K, std::size_t D,
+                                            const T* weights, const T* means, const T* vars,
+                                            double minWeight)
+    {
+        if (K == 0 || D == 0) throw std::runtime_error("PrecomputedGmm: model is empty");
+
+        PrecomputedGmm p;
+        p.numGaussians = K;
+        p.dim = D;
+        p.stride = paddedDim(D);
+        p.means.assign(K * p.stride, 0.0);
+        p.invVars.assign(K * p.stride, 0.0);
+        p.logConst.resize(K);
+
+        const double log2Pi = std::log(2.0 * M_PI);
+
+        for (std::size_t k = 0; k < K; ++k)
+        {
+            double logDet = 0.0;
+            for (std::size_t d = 0; d < D; ++d)
+            {
+                const auto vd = static_cast<double>(vars[k * D + d]);
+                p.means[k * p.stride + d] = static_cast<double>(means[k * D + d]);
+                p.invVars[k * p.stride + d] = 1.0 / vd;
+                logDet += std::log(vd);
+            }
+
+            const double w = std::max(static_cast<double>(weights[k]), minWeight);
+            p.logConst[k] = std::log(w) - 0.5 * (static_cast<double>(D) * log2Pi + logDet);
+        }
+
+        p.bind(PrecomputedGmm());
+        p._varianceId = newVarianceId();
+        return p;
+    }
+
+    template PrecomputedGmm PrecomputedGmm::fromFlat<float>(std::size_t, std::size_t,
+                                                           const float*, const float*, const float*, double);
+    template PrecomputedGmm PrecomputedGmm::fromFlat<double>(std::size_t, std::size_t,
+                                                            const double*, const double*, const double*, double);
+
+    bool PrecomputedGmm::sharesVariances(const PrecomputedGmm& other) const
+    {
+        if (empty() || numGaussians != other.numGaussians || dim != other.dim) return false;
+        return _varianceId == other._varianceId;
+    }
+
+    bool PrecomputedGmm::linkVariances(const PrecomputedGmm& other)
+    {
+        if (empty() || numGaussians != other.numGaussians || dim != other.dim) return false;
+        if (_varianceId == other._varianceId) return true;
+
+        if (_invVars != other._invVars && !std::equal(_invVars, _invVars + numGaussians * stride, other._invVars))
+            return false;
+
+        _varianceId = other._varianceId;
+        return true;
+    }
+
+    PrecomputedGmm PrecomputedGmm::copy() const
+    {
+        PrecomputedGmm p;
+        p.numGaussians = numGaussians;
+        p.dim = dim;
+        p.stride = stride;
+        p.means.assign(_means, _means + numGaussians * stride);
+        p.invVars.assign(_invVars, _invVars + numGaussians * stride);
+        p.logConst.assign(_logConst, _logConst + numGaussians);
+        p.bind(PrecomputedGmm());
+        p._varianceId = _varianceId; // same contents
+        return p;
+    }
+
+    void PrecomputedGmm::componentLogLikelihoods(const float* x, double* out) const
+    {
+        kernels::select(dim).logLikelihoods(*this, x, out);
+    }
+}
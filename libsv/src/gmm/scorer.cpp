@@ -1,50 +1,47 @@
 #include "sv/gmm/scorer.h"
 
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/util/instrument.h"
+
 #include <cmath>
 #include <algorithm>
+#include <numeric>
 #include <stdexcept>
 
 namespace sv::gmm
 {
-    GmmLlrScorer::GmmLlrScorer(Options opt) : _opt(opt)
+    namespace
     {
+        // models (UBM included) per logLikelihoodsShared() call, so the
+        // block's log-likelihoods stay in cache until they are summed
+        constexpr std::size_t kSharedModels = 4;
     }
 
-    double GmmLlrScorer::logSumExp(const std::vector<double>& v)
+    GmmLlrScorer::GmmLlrScorer(Options opt) : _opt(opt)
     {
-        double m = *std::max_element(v.begin(), v.end());
-        double s = 0.0;
-        for (double x : v) s += std::exp(x - m);
-        return m + std::log(s);
     }
 
-    double GmmLlrScorer::logGaussianDiag(const std::vector<float>& x,
-                                         const std::vector<double>& mean,
-                                         const std::vector<double>& var)
+    PrecomputedGmm GmmLlrScorer::precompute(const GmmModel& model) const
     {
-        const std::size_t D = x.size();
-        double logDet = 0.0;
-        double quad = 0.0;
-
-        for (std::size_t d = 0; d < D; ++d)
-        {
-            const double vd = var[d];
-            const double diff = static_cast<double>(x[d]) - mean[d];
-            logDet += std::log(vd);
-            quad += (diff * diff) / vd;
-        }
+        if (model.empty()) throw std::runtime_error("LLR: model is empty");
+        return PrecomputedGmm::from(model, _opt.minWeight);
+    }
 
-        const double logNorm = -0.5 * (static_cast<double>(D) * std::log(2.0 * M_PI) + logDet);
-        return logNorm - 0.5 * quad;
+    PrecomputedGmm GmmLlrScorer::precompute(const GmmModel& spk, const PrecomputedGmm& ubm) const
+    {
+        PrecomputedGmm p = precompute(spk);
+        p.linkVariances(ubm);
+        return p;
     }
 
-    double GmmLlrScorer::sumLogLikelihood(const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const
+    double GmmLlrScorer::sumLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                                          sv::util::Workspace& ws) const
     {
         if (model.empty()) throw std::runtime_error("LLR: model is empty");
         const std::size_t K = model.numGaussians;
         const std::size_t D = model.dim;
 
-        std::vector<double> logp(K);
+        double* logp = ws.logp(K);
         double sum = 0.0;
 
         for (const auto& x : m)
@@ -52,12 +49,8 @@ namespace sv::gmm
             if (x.size() != D)
                 throw std::runtime_error("LLR: feature dim mismatch");
 
-            for (std::size_t k = 0; k < K; ++k)
-            {
-                const double w = std::max(model.weights[k], _opt.minWeight);
-                logp[k] = std::log(w) + logGaussianDiag(x, model.means[k], model.vars[k]);
-            }
-            sum += logSumExp(logp);
+            model.componentLogLikelihoods(x.data(), logp);
+            sum += kernels::logSumExp(logp, K);
         }
 
         return sum;
@@ -66,16 +59,61 @@ namespace sv::gmm
     double GmmLlrScorer::avgLogLikelihood(const GmmModel& model, const libvoicefeat::FeatureMatrix& m) const
     {
         if (m.empty()) return 0.0;
-        const double ll = sumLogLikelihood(model, m);
+        return avgLogLikelihood(precompute(model), m);
+    }
+
+    double GmmLlrScorer::avgLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m) const
+    {
+        return avgLogLikelihood(model, m, sv::util::Workspace::local());
+    }
+
+    double GmmLlrScorer::avgLogLikelihood(const PrecomputedGmm& model, const libvoicefeat::FeatureMatrix& m,
+                                          sv::util::Workspace& ws) const
+    {
+        if (m.empty()) return 0.0;
+        const double ll = sumLogLikelihood(model, m, ws);
         return ll / static_cast<double>(m.size());
     }
 
     double GmmLlrScorer::score(const GmmModel& spk, const GmmModel& ubm, const libvoicefeat::FeatureMatrix& m) const
     {
         if (m.empty()) return 0.0;
+        const PrecomputedGmm ubmPre = precompute(ubm);
+        return score(precompute(spk, ubmPre), ubmPre, m);
+    }
+
+    double GmmLlrScorer::score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                               const libvoicefeat::FeatureMatrix& m) const
+    {
+        return score(spk, ubm, m, sv::util::Workspace::local());
+    }
+
+    double GmmLlrScorer::score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                               const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const
+    {
+        if (m.empty()) return 0.0;
+
+        if (_opt.topC != 0)
+        {
+            const PrecomputedGmm* one = &spk;
+            double out = 0.0;
+            scoreTopC(&one, 1, ubm, nullptr, m, &out, ws);
+            return out;
+        }
+
+        if (_opt.fuseSharedVariances && spk.sharesVariances(ubm))
+        {
+            const PrecomputedGmm* one = &spk;
+            double out = 0.0;
+            scoreShared(&one, 1, ubm, m, &out, ws);
+            return out;
+        }
+
+        SV_TRACE_SCOPE("scorer.score");
+        SV_COUNTER_ADD("scorer.frames", m.size());
 
-        const double llSpk = sumLogLikelihood(spk, m);
-        const double llUbm = sumLogLikelihood(ubm, m);
+        const double llSpk = sumLogLikelihood(spk, m, ws);
+        const double llUbm = sumLogLikelihood(ubm, m, ws);
 
         if (_opt.normalizeByFrames)
         {
@@ -84,4 +122,277 @@ namespace sv::gmm
         }
         return (llSpk - llUbm);
     }
+
+    std::vector<double> GmmLlrScorer::scoreBatch(const std::vector<const PrecomputedGmm*>& spks,
+                                                 const PrecomputedGmm& ubm,
+                                                 const libvoicefeat::FeatureMatrix& m) const
+    {
+        std::vector<double> out;
+        scoreBatch(spks, ubm, m, out, sv::util::Workspace::local());
+        return out;
+    }
+
+    void GmmLlrScorer::scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const PrecomputedGmm& ubm,
+                                  const libvoicefeat::FeatureMatrix& m, std::vector<double>& out,
+                                  sv::util::Workspace& ws) const
+    {
+        out.assign(spks.size(), 0.0);
+        if (m.empty() || spks.empty()) return;
+
+        if (_opt.topC != 0)
+        {
+            scoreTopC(spks.data(), spks.size(), ubm, nullptr, m, out.data(), ws);
+            return;
+        }
+
+        if (ubm.empty()) throw std::runtime_error("LLR: model is empty");
+
+        const std::size_t D = ubm.dim;
+        std::size_t maxK = ubm.numGaussians;
+        for (const auto* spk : spks)
+        {
+            if (!spk || spk->empty()) throw std::runtime_error("LLR: model is empty");
+            if (spk->dim != D) throw std::runtime_error("LLR: model dim mismatch");
+            maxK = std::max(maxK, spk->numGaussians);
+        }
+
+        if (_opt.fuseSharedVariances &&
+            std::all_of(spks.begin(), spks.end(), [&](const PrecomputedGmm* spk) { return spk->sharesVariances(ubm); }))
+        {
+            scoreShared(spks.data(), spks.size(), ubm, m, out.data(), ws);
+            return;
+        }
+
+        // after the fused check: scoreShared() counts its own trials
+        SV_TRACE_SCOPE("scorer.score_batch");
+        SV_COUNTER_ADD("scorer.frames", m.size());
+        SV_COUNTER_ADD("scorer.trials", spks.size());
+
+        double* logp = ws.logp(maxK);
+        double llUbm = 0.0;
+
+        for (const auto& x : m)
+        {
+            if (x.size() != D)
+                throw std::runtime_error("LLR: feature dim mismatch");
+
+            ubm.componentLogLikelihoods(x.data(), logp);
+            llUbm += kernels::logSumExp(logp, ubm.numGaussians);
+
+            for (std::size_t i = 0; i < spks.size(); ++i)
+            {
+                spks[i]->componentLogLikelihoods(x.data(), logp);
+                out[i] += kernels::logSumExp(logp, spks[i]->numGaussians);
+            }
+        }
+
+        const double T = _opt.normalizeByFrames ? static_cast<double>(m.size()) : 1.0;
+        for (double& s : out) s = (s - llUbm) / T;
+    }
+
+    void GmmLlrScorer::scoreShared(const PrecomputedGmm* const* spks, std::size_t n, const PrecomputedGmm& ubm,
+                                   const libvoicefeat::FeatureMatrix& m, double* out, sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("scorer.score_shared");
+        SV_COUNTER_ADD("scorer.frames", m.size());
+        SV_COUNTER_ADD("scorer.trials", n);
+
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t D = ubm.dim;
+        const auto& kern = kernels::select(D);
+        double* logp = ws.logp(kSharedModels * kernels::kFrameBlock * K);
+
+        // model 0 is the UBM, model i + 1 speaker i
+        const std::size_t numModels = n + 1;
+        const auto model = [&](std::size_t j) { return j == 0 ? &ubm : spks[j - 1]; };
+
+        std::fill(out, out + n, 0.0);
+        double llUbm = 0.0;
+
+        for (std::size_t t0 = 0; t0 < m.size(); t0 += kernels::kFrameBlock)
+        {
+            const std::size_t nb = std::min(kernels::kFrameBlock, m.size() - t0);
+            const float* x[kernels::kFrameBlock];
+            for (std::size_t t = 0; t < nb; ++t)
+            {
+                if (m[t0 + t].size() != D)
+                    throw std::runtime_error("LLR: feature dim mismatch");
+                x[t] = m[t0 + t].data();
+            }
+
+            for (std::size_t j0 = 0; j0 < numModels; j0 += kSharedModels)
+            {
+                const std::size_t nm = std::min(kSharedModels, numModels - j0);
+                const PrecomputedGmm* group[kSharedModels];
+                for (std::size_t j = 0; j < nm; ++j) group[j] = model(j0 + j);
+
+                kern.logLikelihoodsShared(ubm, group, nm, x, nb, logp);
+
+                // frame order within each model, as the separate passes sum
+                for (std::size_t j = 0; j < nm; ++j)
+                {
+                    double& sum = j0 + j == 0 ? llUbm : out[j0 + j - 1];
+                    for (std::size_t t = 0; t < nb; ++t) sum += kernels::logSumExp(logp + (j * nb + t) * K, K);
+                }
+            }
+        }
+
+        const double T = _opt.normalizeByFrames ? static_cast<double>(m.size()) : 1.0;
+        for (std::size_t i = 0; i < n; ++i) out[i] = (out[i] - llUbm) / T;
+    }
+
+    double GmmLlrScorer::score(const PrecomputedGmm& spk, const PrecomputedGmm& ubm,
+                               const GaussianShortlist& shortlist, const libvoicefeat::FeatureMatrix& m,
+                               sv::util::Workspace& ws) const
+    {
+        if (m.empty()) return 0.0;
+
+        const PrecomputedGmm* one = &spk;
+        double out = 0.0;
+        scoreTopC(&one, 1, ubm, &shortlist, m, &out, ws);
+        return out;
+    }
+
+    void GmmLlrScorer::scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const PrecomputedGmm& ubm,
+                                  const GaussianShortlist& shortlist, const libvoicefeat::FeatureMatrix& m,
+                                  std::vector<double>& out, sv::util::Workspace& ws) const
+    {
+        out.assign(spks.size(), 0.0);
+        if (m.empty() || spks.empty()) return;
+
+        scoreTopC(spks.data(), spks.size(), ubm, &shortlist, m, out.data(), ws);
+    }
+
+    void GmmLlrScorer::scoreTopC(const PrecomputedGmm* const* spks, std::size_t n, const PrecomputedGmm& ubm,
+                                 const GaussianShortlist* shortlist, const libvoicefeat::FeatureMatrix& m,
+                                 double* out, sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("scorer.score_topc");
+        SV_COUNTER_ADD("scorer.frames", m.size());
+        SV_COUNTER_ADD("scorer.trials", n);
+
+        if (ubm.empty()) throw std::runtime_error("LLR: model is empty");
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t D = ubm.dim;
+
+        if (shortlist && shortlist->numGaussians() != K) throw std::runtime_error("LLR: shortlist does not match UBM");
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (!spks[i] || spks[i]->empty()) throw std::runtime_error("LLR: model is empty");
+            if (spks[i]->dim != D) throw std::runtime_error("LLR: model dim mismatch");
+            if (spks[i]->numGaussians != K) throw std::runtime_error("LLR: top-C needs speaker and UBM of the same size");
+        }
+
+        const auto& kern = kernels::select(D);
+        double* ubmLogp = ws.logp(K);
+        double* spkLogp = ws.logpAux(K);
+        std::uint32_t* idx = ws.indices(shortlist ? std::max(K, shortlist->maxCandidates()) : K);
+
+        std::fill(out, out + n, 0.0);
+        double llUbm = 0.0;
+
+        for (const auto& x : m)
+        {
+            if (x.size() != D)
+                throw std::runtime_error("LLR: feature dim mismatch");
+
+            // UBM: every component, or the shortlist (its coarse level uses logpAux)
+            std::size_t cand = K;
+            if (shortlist)
+            {
+                cand = shortlist->candidates(x.data(), idx, ws);
+                kern.logLikelihoodsSubset(ubm, x.data(), idx, cand, ubmLogp);
+            }
+            else
+            {
+                std::iota(idx, idx + K, 0u);
+                kern.logLikelihoods(ubm, x.data(), ubmLogp);
+            }
+            llUbm += kernels::logSumExp(ubmLogp, idx, cand);
+
+            const std::size_t C = _opt.topC == 0 ? cand : std::min(_opt.topC, cand);
+            if (C < cand)
+            {
+                std::nth_element(idx, idx + C, idx + cand,
+                                 [ubmLogp](std::uint32_t a, std::uint32_t b) { return ubmLogp[a] > ubmLogp[b]; });
+            }
+
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                kern.logLikelihoodsSubset(*spks[i], x.data(), idx, C, spkLogp);
+                out[i] += kernels::logSumExp(spkLogp, idx, C);
+            }
+        }
+
+        const double T = _opt.normalizeByFrames ? static_cast<double>(m.size()) : 1.0;
+        for (std::size_t i = 0; i < n; ++i) out[i] = (out[i] - llUbm) / T;
+    }
+
+    double GmmLlrScorer::score(const PrecomputedGmm& spk, const UtterancePosteriors& post,
+                               const libvoicefeat::FeatureMatrix& m, sv::util::Workspace& ws) const
+    {
+        if (m.empty()) return 0.0;
+
+        const PrecomputedGmm* one = &spk;
+        double out = 0.0;
+        scoreCached(&one, 1, post, m, &out, ws);
+        return out;
+    }
+
+    void GmmLlrScorer::scoreBatch(const std::vector<const PrecomputedGmm*>& spks, const UtterancePosteriors& post,
+                                  const libvoicefeat::FeatureMatrix& m, std::vector<double>& out,
+                                  sv::util::Workspace& ws) const
+    {
+        out.assign(spks.size(), 0.0);
+        if (m.empty() || spks.empty()) return;
+
+        scoreCached(spks.data(), spks.size(), post, m, out.data(), ws);
+    }
+
+    void GmmLlrScorer::scoreCached(const PrecomputedGmm* const* spks, std::size_t n, const UtterancePosteriors& post,
+                                   const libvoicefeat::FeatureMatrix& m, double* out, sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("scorer.score_cached");
+        SV_COUNTER_ADD("scorer.frames", m.size());
+        SV_COUNTER_ADD("scorer.trials", n);
+
+        if (post.numFrames != m.size()) throw std::runtime_error("LLR: cached posteriors do not match features");
+
+        const std::size_t K = post.numGaussians;
+        const std::size_t D = m.front().size();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (!spks[i] || spks[i]->empty()) throw std::runtime_error("LLR: model is empty");
+            if (spks[i]->dim != D) throw std::runtime_error("LLR: model dim mismatch");
+            if (spks[i]->numGaussians != K) throw std::runtime_error("LLR: top-C needs speaker and UBM of the same size");
+        }
+
+        // cached indices are ordered by descending posterior, so a prefix is the top-C
+        const std::size_t C = _opt.topC == 0 ? post.topC : std::min(_opt.topC, post.topC);
+
+        const auto& kern = kernels::select(D);
+        double* spkLogp = ws.logpAux(K);
+
+        std::fill(out, out + n, 0.0);
+        double llUbm = 0.0;
+
+        for (std::size_t t = 0; t < m.size(); ++t)
+        {
+            const auto& x = m[t];
+            if (x.size() != D)
+                throw std::runtime_error("LLR: feature dim mismatch");
+
+            llUbm += post.frameLogLik[t];
+
+            const std::uint32_t* idx = post.frameIndices(t);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                kern.logLikelihoodsSubset(*spks[i], x.data(), idx, C, spkLogp);
+                out[i] += kernels::logSumExp(spkLogp, idx, C);
+            }
+        }
+
+        const double T = _opt.normalizeByFrames ? static_cast<double>(m.size()) : 1.0;
+        for (std::size_t i = 0; i < n; ++i) out[i] = (out[i] - llUbm) / T;
+    }
 }
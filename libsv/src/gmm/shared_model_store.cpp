@@ -0,0 +1,555 @@
+#include "sv/gmm/shared_model_store.h"
+
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/gmm/mapped_gmm_model.h"
+#include "sv/io/feature_projection_serdes.h"
+#include "sv/util/instrument.h"
+#include "sv/util/xxhash.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        constexpr std::array<char, 8> kMagic = {'S', 'V', 'S', 'H', 'M', '\0', '\0', '\0'};
+        constexpr uint32_t kVersion = 2;
+        constexpr std::size_t kHeaderBytes = 128;
+        constexpr std::size_t kAlignment = 64;
+        constexpr std::size_t kEntryBytes = 40; // nameOffset, nameLen, means, invVars, logConst
+
+        constexpr uint64_t alignUp(uint64_t n, uint64_t a) { return (n + a - 1) / a * a; }
+
+        template <class T>
+        void put(char*& p, T v)
+        {
+            std::memcpy(p, &v, sizeof(T));
+            p += sizeof(T);
+        }
+
+        template <class T>
+        T get(const char*& p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+
+        struct Header
+        {
+            uint32_t version = 0;
+            uint32_t K = 0;
+            uint32_t D = 0;
+            uint64_t count = 0;
+            uint64_t fingerprint = 0;
+            uint64_t generation = 0;
+            uint64_t directoryOffset = 0;
+            uint64_t checksum = 0;
+            uint64_t projectionOffset = 0;
+            uint64_t projectionBytes = 0;
+        };
+
+        bool parseHeader(const char* data, std::size_t size, Header& h)
+        {
+            if (size < kHeaderBytes || std::memcmp(data, kMagic.data(), kMagic.size()) != 0) return false;
+
+            const char* p = data + kMagic.size();
+            h.version = get<uint32_t>(p);
+            h.K = get<uint32_t>(p);
+            h.D = get<uint32_t>(p);
+            p += sizeof(uint32_t); // reserved
+            h.count = get<uint64_t>(p);
+            h.fingerprint = get<uint64_t>(p);
+            h.generation = get<uint64_t>(p);
+            h.directoryOffset = get<uint64_t>(p);
+            h.checksum = get<uint64_t>(p);
+            h.projectionOffset = get<uint64_t>(p);
+            h.projectionBytes = get<uint64_t>(p);
+            return true;
+        }
+
+        // Sizes shared by the writer and the reader.
+        struct Layout
+        {
+            std::size_t K, D, stride;
+            uint64_t rawBytes;   // UBM weights, means, vars
+            uint64_t rowsBytes;  // K x stride doubles
+            uint64_t constBytes; // K doubles, padded
+
+            Layout(std::size_t k, std::size_t d)
+                : K(k), D(d), stride(PrecomputedGmm::paddedDim(d)),
+                  rawBytes(alignUp((k + 2 * k * d) * sizeof(double), kAlignment)),
+                  rowsBytes(k * PrecomputedGmm::paddedDim(d) * sizeof(double)),
+                  constBytes(alignUp(k * sizeof(double), kAlignment))
+            {
+            }
+
+            [[nodiscard]] uint64_t ubmBlock() const { return kHeaderBytes + rawBytes; }
+            [[nodiscard]] uint64_t modelBytes() const { return 2 * rowsBytes + constBytes; }
+        };
+
+        struct Entry
+        {
+            uint64_t nameOffset = 0;
+            uint64_t nameLen = 0;
+            uint64_t means = 0;
+            uint64_t invVars = 0;
+            uint64_t logConst = 0;
+        };
+
+        // offset + len can wrap for a corrupted entry, so compare against what remains after offset.
+        bool inBounds(uint64_t offset, uint64_t len, uint64_t size)
+        {
+            return offset <= size && len <= size - offset;
+        }
+
+        Entry readEntry(const char* directory, std::size_t i)
+        {
+            const char* p = directory + i * kEntryBytes;
+            Entry e;
+            e.nameOffset = get<uint64_t>(p);
+            e.nameLen = get<uint64_t>(p);
+            e.means = get<uint64_t>(p);
+            e.invVars = get<uint64_t>(p);
+            e.logConst = get<uint64_t>(p);
+            return e;
+        }
+
+        GmmModel modelFromRaw(std::size_t K, std::size_t D, const double* raw)
+        {
+            GmmModel model;
+            model.numGaussians = K;
+            model.dim = D;
+            model.weights.assign(raw, raw + K);
+            model.means.resize(K);
+            model.vars.resize(K);
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                model.means[k].assign(raw + K + k * D, raw + K + (k + 1) * D);
+                model.vars[k].assign(raw + K + K * D + k * D, raw + K + K * D + (k + 1) * D);
+            }
+            return model;
+        }
+
+        bool isGenerationFile(const std::string& file, const std::string& name)
+        {
+            // <name>.<digits>.svshm
+            static const std::string kSuffix = ".svshm";
+            if (file.size() <= name.size() + 1 + kSuffix.size()) return false;
+            if (file.compare(0, name.size() + 1, name + ".") != 0) return false;
+            if (file.compare(file.size() - kSuffix.size(), kSuffix.size(), kSuffix) != 0) return false;
+
+            const std::string mid = file.substr(name.size() + 1, file.size() - name.size() - 1 - kSuffix.size());
+            return !mid.empty() && std::all_of(mid.begin(), mid.end(), [](char c) { return c >= '0' && c <= '9'; });
+        }
+    }
+
+    struct SharedModelSegment::Mapping
+    {
+        void* base = nullptr;
+        std::size_t size = 0;
+
+        Mapping(void* b, std::size_t s) : base(b), size(s) {}
+        ~Mapping()
+        {
+            if (base) ::munmap(base, size);
+        }
+
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        [[nodiscard]] const char* data() const { return static_cast<const char*>(base); }
+    };
+
+    SharedModelStore::SharedModelStore(Options opt) : _opt(std::move(opt)) {}
+
+    fs::path SharedModelStore::linkPath(const std::string& name) const
+    {
+        return _opt.root / (name + ".svshm");
+    }
+
+    uint64_t SharedModelStore::currentGeneration(const std::string& name) const
+    {
+        const int fd = ::open(linkPath(name).c_str(), O_RDONLY);
+        if (fd < 0) return 0;
+
+        char buf[kHeaderBytes];
+        const ssize_t n = ::pread(fd, buf, sizeof(buf), 0);
+        ::close(fd);
+
+        Header h;
+        if (n != static_cast<ssize_t>(sizeof(buf)) || !parseHeader(buf, sizeof(buf), h)) return 0;
+        return h.generation;
+    }
+
+    uint64_t SharedModelStore::publish(const std::string& name, const GmmModel& ubm,
+                                       const std::vector<std::pair<std::string, const GmmModel*>>& speakers,
+                                       const sv::io::FeatureProjection* projection) const
+    {
+        std::vector<std::string> ids;
+        ids.reserve(speakers.size());
+        for (const auto& [id, model] : speakers)
+        {
+            if (!model) throw std::runtime_error("Shared store: null model for " + id);
+            ids.push_back(id);
+        }
+
+        return publishImpl(name, ubm, ids, [&](std::size_t i)
+        {
+            return PrecomputedGmm::from(*speakers[i].second, _opt.minWeight);
+        }, projection);
+    }
+
+    uint64_t SharedModelStore::publishFiles(const std::string& name, const GmmModel& ubm,
+                                            const std::vector<std::pair<std::string, fs::path>>& speakers,
+                                            const sv::io::FeatureProjection* projection) const
+    {
+        std::vector<std::string> ids;
+        ids.reserve(speakers.size());
+        for (const auto& s : speakers) ids.push_back(s.first);
+
+        const uint64_t fingerprint = GmmModelSerdes::fingerprint(ubm);
+        const GmmModelSerdes serdes;
+
+        return publishImpl(name, ubm, ids, [&](std::size_t i)
+        {
+            const fs::path& file = speakers[i].second;
+            const auto header = serdes.readHeader(file);
+            if (header.version != GmmModelSerdes::kVersion) return PrecomputedGmm::from(serdes.load(file), _opt.minWeight);
+
+            if (header.ubmFingerprint != 0 && header.ubmFingerprint != fingerprint)
+                throw std::runtime_error("Shared store: model was adapted from a different UBM: " + file.string());
+            return MappedGmmModel(file).precompute(_opt.minWeight);
+        }, projection);
+    }
+
+    uint64_t SharedModelStore::publishImpl(const std::string& name, const GmmModel& ubm,
+                                           const std::vector<std::string>& ids,
+                                           const std::function<PrecomputedGmm(std::size_t)>& load,
+                                           const sv::io::FeatureProjection* projection) const
+    {
+        SV_TRACE_SCOPE("shared_store.publish");
+
+        GmmModelSerdes::validateModel(ubm);
+        if (name.empty() || name.find('/') != std::string::npos) throw std::runtime_error("Shared store: bad name: " + name);
+
+        const std::size_t n = ids.size();
+        const Layout L(ubm.numGaussians, ubm.dim);
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return ids[a] < ids[b]; });
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            if (ids[order[i]] == ids[order[i - 1]]) throw std::runtime_error("Shared store: duplicate speaker " + ids[order[i]]);
+        }
+
+        const uint64_t fingerprint = GmmModelSerdes::fingerprint(ubm);
+        std::vector<char> projectionBytes;
+        if (projection)
+        {
+            if (projection->outDim() != ubm.dim) throw std::runtime_error("Shared store: projection does not match UBM dim");
+            projectionBytes = sv::io::FeatureProjectionSerdes().encode(*projection, {.ubmFingerprint = fingerprint});
+        }
+
+        uint64_t namesBytes = 0;
+        for (const auto& id : ids) namesBytes += id.size();
+
+        // worst case, every speaker with its own variances; trimmed below
+        const uint64_t maxBytes = L.ubmBlock() + (n + 1) * L.modelBytes() + n * kEntryBytes + namesBytes
+                                + projectionBytes.size();
+
+        const uint64_t generation = currentGeneration(name) + 1;
+        const fs::path file = _opt.root / (name + "." + std::to_string(generation) + ".svshm");
+        fs::path tmp = file;
+        tmp += ".tmp." + std::to_string(::getpid());
+
+        fs::create_directories(_opt.root);
+        const int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw std::runtime_error("Cannot open for write: " + tmp.string());
+
+        void* base = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(maxBytes)) == 0)
+            base = ::mmap(nullptr, maxBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            const std::string err = std::strerror(errno);
+            ::close(fd);
+            fs::remove(tmp);
+            throw std::runtime_error("Shared store: cannot map " + tmp.string() + ": " + err);
+        }
+
+        uint64_t size = 0;
+        try
+        {
+            char* data = static_cast<char*>(base);
+            const std::size_t K = L.K;
+            const std::size_t D = L.D;
+
+            // UBM parameters, for consumers that need the GmmModel (adaptation)
+            auto* raw = reinterpret_cast<double*>(data + kHeaderBytes);
+            for (std::size_t k = 0; k < K; ++k)
+            {
+                raw[k] = ubm.weights[k];
+                std::copy_n(ubm.means[k].data(), D, raw + K + k * D);
+                std::copy_n(ubm.vars[k].data(), D, raw + K + K * D + k * D);
+            }
+
+            uint64_t off = L.ubmBlock();
+            auto writeRows = [&](const double* src, uint64_t bytes)
+            {
+                std::memcpy(data + off, src, bytes);
+                const uint64_t at = off;
+                off += alignUp(bytes, kAlignment);
+                return at;
+            };
+
+            const PrecomputedGmm pu = PrecomputedGmm::from(ubm, _opt.minWeight);
+            writeRows(pu.meanRow(0), L.rowsBytes);
+            const uint64_t ubmInvVars = writeRows(pu.invVarRow(0), L.rowsBytes);
+            const uint64_t ubmLogConst = writeRows(pu.logConstants(), K * sizeof(double));
+
+            std::vector<Entry> entries(n);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const std::size_t s = order[i];
+                const PrecomputedGmm p = load(s);
+                if (p.numGaussians != K || p.dim != D)
+                    throw std::runtime_error("Shared store: model shape does not match UBM: " + ids[s]);
+
+                Entry& e = entries[i];
+                e.means = writeRows(p.meanRow(0), L.rowsBytes);
+
+                const bool sameVars = std::memcmp(p.invVarRow(0), pu.invVarRow(0), L.rowsBytes) == 0;
+                const bool sameConst = std::memcmp(p.logConstants(), pu.logConstants(), K * sizeof(double)) == 0;
+                e.invVars = sameVars ? ubmInvVars : writeRows(p.invVarRow(0), L.rowsBytes);
+                e.logConst = sameConst ? ubmLogConst : writeRows(p.logConstants(), K * sizeof(double));
+            }
+
+            const uint64_t directoryOffset = off;
+            uint64_t nameOff = directoryOffset + n * kEntryBytes;
+            char* p = data + directoryOffset;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const std::string& id = ids[order[i]];
+                entries[i].nameOffset = nameOff;
+                entries[i].nameLen = id.size();
+                std::memcpy(data + nameOff, id.data(), id.size());
+                nameOff += id.size();
+
+                put<uint64_t>(p, entries[i].nameOffset);
+                put<uint64_t>(p, entries[i].nameLen);
+                put<uint64_t>(p, entries[i].means);
+                put<uint64_t>(p, entries[i].invVars);
+                put<uint64_t>(p, entries[i].logConst);
+            }
+            const uint64_t projectionOffset = projectionBytes.empty() ? 0 : nameOff;
+            if (!projectionBytes.empty()) std::memcpy(data + nameOff, projectionBytes.data(), projectionBytes.size());
+            size = nameOff + projectionBytes.size();
+
+            p = data;
+            std::memcpy(p, kMagic.data(), kMagic.size());
+            p += kMagic.size();
+            put<uint32_t>(p, kVersion);
+            put<uint32_t>(p, static_cast<uint32_t>(K));
+            put<uint32_t>(p, static_cast<uint32_t>(D));
+            put<uint32_t>(p, 0);
+            put<uint64_t>(p, n);
+            put<uint64_t>(p, fingerprint);
+            put<uint64_t>(p, generation);
+            put<uint64_t>(p, directoryOffset);
+            put<uint64_t>(p, util::xxh64(data + kHeaderBytes, size - kHeaderBytes));
+            put<uint64_t>(p, projectionOffset);
+            put<uint64_t>(p, projectionBytes.size());
+        }
+        catch (...)
+        {
+            ::munmap(base, maxBytes);
+            ::close(fd);
+            fs::remove(tmp);
+            throw;
+        }
+
+        ::munmap(base, maxBytes);
+        const int rc = ::ftruncate(fd, static_cast<off_t>(size));
+        ::close(fd);
+        if (rc != 0)
+        {
+            fs::remove(tmp);
+            throw std::runtime_error("Shared store: cannot resize " + tmp.string());
+        }
+        fs::rename(tmp, file);
+
+        // swap the link; rename() replaces it atomically
+        fs::path linkTmp = linkPath(name);
+        linkTmp += ".tmp." + std::to_string(::getpid());
+        fs::remove(linkTmp);
+        fs::create_symlink(file.filename(), linkTmp);
+        fs::rename(linkTmp, linkPath(name));
+
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(_opt.root, ec))
+        {
+            const std::string f = entry.path().filename().string();
+            if (f != file.filename().string() && isGenerationFile(f, name)) fs::remove(entry.path(), ec);
+        }
+
+        return generation;
+    }
+
+    SharedModelSegmentPtr SharedModelStore::attach(const std::string& name) const
+    {
+        SV_TRACE_SCOPE("shared_store.attach");
+
+        const fs::path link = linkPath(name);
+
+        // a publisher may unlink the generation the link pointed at between
+        // path resolution and open; the link then names a newer one
+        int fd = -1;
+        for (int attempt = 0; attempt < 3 && fd < 0; ++attempt)
+        {
+            fd = ::open(link.c_str(), O_RDONLY);
+            if (fd < 0 && errno != ENOENT) break;
+        }
+        if (fd < 0) throw std::runtime_error("Shared store: nothing published as " + link.string());
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat: " + link.string());
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+
+        void* base = size ? ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (base == MAP_FAILED) throw std::runtime_error("mmap failed: " + link.string() + ": " + std::strerror(errno));
+        auto map = std::make_shared<const SharedModelSegment::Mapping>(base, size);
+
+        Header h;
+        if (!parseHeader(map->data(), size, h)) throw std::runtime_error("Shared store: bad magic: " + link.string());
+        if (h.version != kVersion) throw std::runtime_error("Shared store: unsupported version: " + link.string());
+        if (h.K == 0 || h.D == 0) throw std::runtime_error("Shared store: empty model: " + link.string());
+        // Bound K and D by the file size before Layout multiplies them.
+        if (h.D > size / sizeof(double) || h.K > size / (sizeof(double) * (2 * uint64_t{h.D} + 1)))
+            throw std::runtime_error("Shared store: bad layout: " + link.string());
+
+        const Layout L(h.K, h.D);
+        if (h.directoryOffset < L.ubmBlock() + L.modelBytes() || h.directoryOffset % kAlignment != 0
+            || h.directoryOffset > size || h.count > (size - h.directoryOffset) / kEntryBytes)
+            throw std::runtime_error("Shared store: bad layout: " + link.string());
+
+        if (_opt.verifyChecksum && util::xxh64(map->data() + kHeaderBytes, size - kHeaderBytes) != h.checksum)
+            throw std::runtime_error("Checksum mismatch: " + link.string());
+
+        std::shared_ptr<SharedModelSegment> seg(new SharedModelSegment());
+        seg->_map = map;
+        seg->_generation = h.generation;
+        seg->_K = h.K;
+        seg->_D = h.D;
+        seg->_count = h.count;
+        seg->_directory = map->data() + h.directoryOffset;
+
+        auto ubm = std::make_shared<SharedUbm>();
+        const auto* raw = reinterpret_cast<const double*>(map->data() + kHeaderBytes);
+        ubm->model = modelFromRaw(h.K, h.D, raw);
+        const char* block = map->data() + L.ubmBlock();
+        ubm->precomputed = PrecomputedGmm::view(h.K, h.D,
+                                                reinterpret_cast<const double*>(block),
+                                                reinterpret_cast<const double*>(block + L.rowsBytes),
+                                                reinterpret_cast<const double*>(block + 2 * L.rowsBytes),
+                                                map);
+        ubm->fingerprint = h.fingerprint;
+        if (h.projectionBytes != 0)
+        {
+            // refuses a projection saved for another UBM
+            if (!inBounds(h.projectionOffset, h.projectionBytes, size))
+                throw std::runtime_error("Shared store: bad layout: " + link.string());
+            auto projection = sv::io::FeatureProjectionSerdes().decode(map->data() + h.projectionOffset, h.projectionBytes,
+                                                                       h.fingerprint, link.string());
+            if (projection.outDim() != h.D)
+                throw std::runtime_error("Shared store: projection does not match UBM dim: " + link.string());
+            ubm->projection = std::make_shared<const sv::io::FeatureProjection>(std::move(projection));
+        }
+        seg->_ubm = std::move(ubm);
+
+        return seg;
+    }
+
+    void SharedModelStore::remove(const std::string& name) const
+    {
+        std::error_code ec;
+        fs::remove(linkPath(name), ec);
+        for (const auto& entry : fs::directory_iterator(_opt.root, ec))
+        {
+            if (isGenerationFile(entry.path().filename().string(), name)) fs::remove(entry.path(), ec);
+        }
+    }
+
+    std::size_t SharedModelSegment::bytes() const
+    {
+        return _map ? _map->size : 0;
+    }
+
+    std::string_view SharedModelSegment::speakerId(std::size_t i) const
+    {
+        if (i >= _count) throw std::runtime_error("Shared store: speaker index out of range");
+
+        const Entry e = readEntry(_directory, i);
+        if (!inBounds(e.nameOffset, e.nameLen, _map->size)) throw std::runtime_error("Shared store: bad directory entry");
+        return {_map->data() + e.nameOffset, e.nameLen};
+    }
+
+    std::optional<std::size_t> SharedModelSegment::indexOf(std::string_view speakerId) const
+    {
+        std::size_t lo = 0;
+        std::size_t hi = _count;
+        while (lo < hi)
+        {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            const int c = this->speakerId(mid).compare(speakerId);
+            if (c == 0) return mid;
+            if (c < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return std::nullopt;
+    }
+
+    PrecomputedGmm SharedModelSegment::modelAt(std::size_t i) const
+    {
+        const Entry e = readEntry(_directory, i);
+        const Layout L(_K, _D);
+        if (!inBounds(e.means, L.rowsBytes, _map->size) || !inBounds(e.invVars, L.rowsBytes, _map->size)
+            || !inBounds(e.logConst, _K * sizeof(double), _map->size)
+            || e.means % kAlignment != 0 || e.invVars % kAlignment != 0)
+            throw std::runtime_error("Shared store: bad directory entry");
+
+        const char* data = _map->data();
+        PrecomputedGmm model = PrecomputedGmm::view(_K, _D,
+                                                     reinterpret_cast<const double*>(data + e.means),
+                                                     reinterpret_cast<const double*>(data + e.invVars),
+                                                     reinterpret_cast<const double*>(data + e.logConst),
+                                                     _map);
+        // speakers published with the UBM's variance block point at it
+        if (model.invVarRow(0) == _ubm->precomputed.invVarRow(0)) model.linkVariances(_ubm->precomputed);
+        return model;
+    }
+
+    SpeakerModelPtr SharedModelSegment::find(std::string_view speakerId) const
+    {
+        const auto i = indexOf(speakerId);
+        if (!i) return nullptr;
+        return std::make_shared<const PrecomputedGmm>(modelAt(*i));
+    }
+}
@@ -0,0 +1,73 @@
+#include "sv/gmm/speaker_stats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    UtteranceStats UtteranceStats::fromBwStats(std::string id, const BwStats& stats)
+    {
+        UtteranceStats u;
+        u.id = std::move(id);
+        u.frames = stats.totalFrames;
+        u.N = stats.N;
+        u.F = stats.F;
+        return u;
+    }
+
+    void SpeakerStats::reset(std::size_t k, std::size_t d)
+    {
+        _K = k;
+        _D = d;
+        _totalFrames = 0;
+        _N.assign(_K, 0.0);
+        _F.assign(_K * _D, 0.0);
+        _utts.clear();
+    }
+
+    void SpeakerStats::checkShape(const UtteranceStats& utt) const
+    {
+        if (utt.N.size() != _K || utt.F.size() != _K * _D)
+            throw std::runtime_error("SpeakerStats: utterance stats shape mismatch");
+    }
+
+    bool SpeakerStats::hasUtterance(const std::string& id) const
+    {
+        return std::any_of(_utts.begin(), _utts.end(),
+                           [&](const UtteranceStats& u) { return u.id == id; });
+    }
+
+    void SpeakerStats::addUtterance(UtteranceStats utt)
+    {
+        checkShape(utt);
+        if (hasUtterance(utt.id))
+            throw std::runtime_error("SpeakerStats: duplicate utterance id: " + utt.id);
+
+        for (std::size_t k = 0; k < _K; ++k) _N[k] += utt.N[k];
+        for (std::size_t i = 0; i < _F.size(); ++i) _F[i] += utt.F[i];
+        _totalFrames += utt.frames;
+
+        _utts.push_back(std::move(utt));
+    }
+
+    bool SpeakerStats::removeUtterance(const std::string& id)
+    {
+        auto it = std::find_if(_utts.begin(), _utts.end(),
+                               [&](const UtteranceStats& u) { return u.id == id; });
+        if (it == _utts.end()) return false;
+
+        if (_utts.size() == 1)
+        {
+            reset(_K, _D);
+            return true;
+        }
+
+        // occupancies cannot go negative; clamp the rounding residue
+        for (std::size_t k = 0; k < _K; ++k) _N[k] = std::max(0.0, _N[k] - it->N[k]);
+        for (std::size_t i = 0; i < _F.size(); ++i) _F[i] -= it->F[i];
+        _totalFrames -= it->frames;
+
+        _utts.erase(it);
+        return true;
+    }
+}
@@ -0,0 +1,193 @@
+#include "sv/gmm/speaker_stats_serdes.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    void SpeakerStatsSerdes::writeU32(std::ofstream& out, uint32_t v)
+    {
+        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    void SpeakerStatsSerdes::readU32(std::ifstream& in, uint32_t& v)
+    {
+        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+    }
+
+    void SpeakerStatsSerdes::writeU64(std::ofstream& out, uint64_t v)
+    {
+        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+
+    void SpeakerStatsSerdes::readU64(std::ifstream& in, uint64_t& v)
+    {
+        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+    }
+
+    void SpeakerStatsSerdes::writeString(std::ofstream& out, const std::string& s)
+    {
+        writeU32(out, static_cast<uint32_t>(s.size()));
+        out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+
+    void SpeakerStatsSerdes::readString(std::ifstream& in, std::string& s, std::size_t maxSize)
+    {
+        uint32_t n = 0;
+        readU32(in, n);
+        if (!in || n > maxSize)
+        {
+            in.setstate(std::ios::failbit);
+            return;
+        }
+        s.resize(n);
+        in.read(s.data(), static_cast<std::streamsize>(n));
+    }
+
+    void SpeakerStatsSerdes::writeF64Block(std::ofstream& out, const std::vector<double>& v)
+    {
+        out.write(reinterpret_cast<const char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(double)));
+    }
+
+    void SpeakerStatsSerdes::readF64Block(std::ifstream& in, std::vector<double>& v)
+    {
+        in.read(reinterpret_cast<char*>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(double)));
+    }
+
+    void SpeakerStatsSerdes::save(const fs::path& file, const SpeakerStats& stats, const SaveOptions& opt) const
+    {
+        fs::create_directories(file.parent_path());
+
+        std::ofstream out(file, std::ios::binary);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+
+        out.write(kMagic.data(), (std::streamsize)kMagic.size());
+        writeU32(out, kVersion);
+
+        writeU64(out, static_cast<uint64_t>(stats.numGaussians()));
+        writeU64(out, static_cast<uint64_t>(stats.dim()));
+        writeU64(out, opt.ubmFingerprint);
+        writeU32(out, opt.posteriorTopC);
+        writeU32(out, static_cast<uint32_t>(stats.utterances().size()));
+
+        // per-utterance N and F; the speaker sums are rebuilt on load
+        for (const auto& u : stats.utterances())
+        {
+            writeString(out, u.id);
+            writeU64(out, static_cast<uint64_t>(u.frames));
+            writeF64Block(out, u.N);
+            writeF64Block(out, u.F);
+        }
+
+        if (!out) throw std::runtime_error("Write failed: " + file.string());
+    }
+
+    SpeakerStatsSerdes::Header SpeakerStatsSerdes::readHeader(const fs::path& file) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        std::array<char, 8> magic{};
+        in.read(magic.data(), (std::streamsize)magic.size());
+        if (magic != kMagic) throw std::runtime_error("Bad magic: " + file.string());
+
+        Header h;
+        readU32(in, h.version);
+        if (h.version != kVersion && h.version != kVersion2 && h.version != kVersion1)
+            throw std::runtime_error("Unsupported version: " + file.string());
+
+        readU64(in, h.numGaussians);
+        readU64(in, h.dim);
+        if (h.version >= kVersion2) readU64(in, h.ubmFingerprint);
+        if (h.version >= kVersion) readU32(in, h.posteriorTopC);
+
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+        return h;
+    }
+
+    SpeakerStats SpeakerStatsSerdes::loadMatching(const fs::path& file, const SaveOptions& opt,
+                                                  std::size_t numGaussians, std::size_t dim) const
+    {
+        if (fs::exists(file))
+        {
+            const Header h = readHeader(file);
+            if (h.version == kVersion && h.ubmFingerprint == opt.ubmFingerprint &&
+                h.posteriorTopC == opt.posteriorTopC && h.numGaussians == numGaussians && h.dim == dim)
+            {
+                return load(file);
+            }
+        }
+        return SpeakerStats(numGaussians, dim);
+    }
+
+    SpeakerStats SpeakerStatsSerdes::load(const fs::path& file) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        std::array<char, 8> magic{};
+        in.read(magic.data(), (std::streamsize)magic.size());
+        if (magic != kMagic) throw std::runtime_error("Bad magic: " + file.string());
+
+        uint32_t version = 0;
+        readU32(in, version);
+        if (version != kVersion) throw std::runtime_error("Unsupported version: " + file.string());
+
+        uint64_t K64 = 0, D64 = 0, fingerprint = 0;
+        uint32_t posteriorTopC = 0;
+        readU64(in, K64);
+        readU64(in, D64);
+        readU64(in, fingerprint);
+        readU32(in, posteriorTopC);
+
+        uint32_t numUtts = 0;
+        readU32(in, numUtts);
+
+        if (!in || K64 == 0 || D64 == 0)
+            throw std::runtime_error("Invalid stats shape in file: " + file.string());
+
+        // Each utterance stores an id length, a frame count and K*(D+1)
+        // doubles. The shape must not wrap, and when there are utterances
+        // they must fit in what is left of the file. Divide rather than
+        // multiply so the checks themselves cannot wrap.
+        constexpr uint64_t kMaxU64 = std::numeric_limits<uint64_t>::max();
+        constexpr uint64_t kUttOverhead = sizeof(uint32_t) + sizeof(uint64_t);
+        if (D64 > kMaxU64 / sizeof(double) - 1 ||
+            K64 > (kMaxU64 - kUttOverhead) / ((D64 + 1) * sizeof(double)))
+        {
+            throw std::runtime_error("Invalid stats shape in file: " + file.string());
+        }
+        const uint64_t uttBytes = kUttOverhead + K64 * (D64 + 1) * sizeof(double);
+
+        const uint64_t fileSize = fs::file_size(file);
+        const auto headerEnd = static_cast<uint64_t>(in.tellg());
+        const uint64_t avail = fileSize > headerEnd ? fileSize - headerEnd : 0;
+        if (numUtts > avail / uttBytes)
+            throw std::runtime_error("Utterance count exceeds file size: " + file.string());
+
+        const auto K = static_cast<std::size_t>(K64);
+        const auto D = static_cast<std::size_t>(D64);
+
+        SpeakerStats stats(K, D);
+
+        for (uint32_t i = 0; i < numUtts; ++i)
+        {
+            UtteranceStats u;
+            readString(in, u.id, static_cast<std::size_t>(fileSize - static_cast<uint64_t>(in.tellg())));
+
+            uint64_t frames = 0;
+            readU64(in, frames);
+            u.frames = static_cast<std::size_t>(frames);
+
+            u.N.resize(K);
+            u.F.resize(K * D);
+            readF64Block(in, u.N);
+            readF64Block(in, u.F);
+
+            if (!in) throw std::runtime_error("Read failed: " + file.string());
+            stats.addUtterance(std::move(u));
+        }
+
+        return stats;
+    }
+}
@@ -0,0 +1,110 @@
+#include "sv/gmm/supervector.h"
+
+#include "sv/util/parallel.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    SupervectorExporter::SupervectorExporter(const GmmModel& ubm, Options opt)
+        : _opt(opt), _K(ubm.numGaussians), _D(ubm.dim)
+    {
+        if (ubm.empty()) throw std::runtime_error("Supervector: model is empty");
+
+        _means.resize(_K * _D);
+        _scale.resize(_K * _D);
+        for (std::size_t k = 0; k < _K; ++k)
+        {
+            const double sw = std::sqrt(std::max(ubm.weights[k], 0.0));
+            for (std::size_t d = 0; d < _D; ++d)
+            {
+                _means[k * _D + d] = ubm.means[k][d];
+                _scale[k * _D + d] = sw / std::sqrt(std::max(ubm.vars[k][d], 1e-12));
+            }
+        }
+
+        if (_opt.projectionDim != 0)
+        {
+            // entries N(0, 1/P): E[|Rx|^2] = |x|^2
+            const std::size_t P = _opt.projectionDim;
+            std::mt19937 rng(_opt.seed);
+            std::normal_distribution<float> normal(0.0f, 1.0f / std::sqrt(static_cast<float>(P)));
+            _projection.resize(_K * _D * P);
+            for (float& r : _projection) r = normal(rng);
+        }
+    }
+
+    void SupervectorExporter::exportModel(const GmmModel& spk, float* out) const
+    {
+        if (empty()) throw std::runtime_error("Supervector: exporter is empty");
+        if (spk.numGaussians != _K || spk.dim != _D) throw std::runtime_error("Supervector: model shape mismatch");
+
+        const std::size_t P = dim();
+
+        if (_opt.projectionDim == 0)
+        {
+            for (std::size_t k = 0; k < _K; ++k)
+            {
+                for (std::size_t d = 0; d < _D; ++d)
+                {
+                    const std::size_t i = k * _D + d;
+                    out[i] = static_cast<float>((spk.means[k][d] - _means[i]) * _scale[i]);
+                }
+            }
+        }
+        else
+        {
+            // components the speaker never occupied keep the UBM mean and
+            // contribute nothing, so their rows are skipped
+            double* acc = sv::util::Workspace::local().logp(P);
+            std::fill_n(acc, P, 0.0);
+            for (std::size_t k = 0; k < _K; ++k)
+            {
+                for (std::size_t d = 0; d < _D; ++d)
+                {
+                    const std::size_t i = k * _D + d;
+                    const double v = (spk.means[k][d] - _means[i]) * _scale[i];
+                    if (v == 0.0) continue;
+
+                    const float* r = _projection.data() + i * P;
+                    #pragma omp simd
+                    for (std::size_t p = 0; p < P; ++p) acc[p] += v * r[p];
+                }
+            }
+            for (std::size_t p = 0; p < P; ++p) out[p] = static_cast<float>(acc[p]);
+        }
+
+        if (_opt.lengthNormalize)
+        {
+            double norm = 0.0;
+            for (std::size_t p = 0; p < P; ++p) norm += static_cast<double>(out[p]) * out[p];
+            if (norm > 0.0)
+            {
+                const auto inv = static_cast<float>(1.0 / std::sqrt(norm));
+                for (std::size_t p = 0; p < P; ++p) out[p] *= inv;
+            }
+        }
+    }
+
+    std::vector<float> SupervectorExporter::exportModel(const GmmModel& spk) const
+    {
+        std::vector<float> out(dim());
+        exportModel(spk, out.data());
+        return out;
+    }
+
+    void SupervectorExporter::exportBatch(const std::vector<const GmmModel*>& models, std::vector<float>& out) const
+    {
+        const std::size_t P = dim();
+        out.resize(models.size() * P);
+        sv::util::parallelFor(models.size(), _opt.numThreads, [&](std::size_t i)
+        {
+            if (!models[i]) throw std::runtime_error("Supervector: null model");
+            exportModel(*models[i], out.data() + i * P);
+        });
+    }
+}
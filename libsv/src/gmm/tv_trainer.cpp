@@ -0,0 +1,157 @@
+#include "sv/gmm/tv_trainer.h"
+
+#include "sv/util/instrument.h"
+#include "sv/util/linalg.h"
+#include "sv/util/parallel.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace sv::gmm
+{
+    TvTrainer::TvTrainer(Options opt) : _opt(opt) {}
+
+    IvectorExtractor TvTrainer::train(const GmmModel& ubm, const std::vector<UtteranceStats>& utts) const
+    {
+        SV_TRACE_SCOPE("tv.train");
+
+        if (ubm.empty()) throw std::runtime_error("TV train: model is empty");
+        if (utts.empty()) throw std::runtime_error("TV train: no utterances");
+        if (_opt.rank == 0) throw std::runtime_error("TV train: rank must be > 0");
+
+        const std::size_t K = ubm.numGaussians;
+        const std::size_t D = ubm.dim;
+        const std::size_t R = _opt.rank;
+        const std::size_t P = util::packedSize(R);
+
+        std::vector<IvectorExtractor::StatsRef> refs;
+        refs.reserve(utts.size());
+        for (const auto& u : utts)
+        {
+            if (u.N.size() != K || u.F.size() != K * D) throw std::runtime_error("TV train: stats shape mismatch");
+            refs.push_back({u.N.data(), u.F.data()});
+        }
+
+        std::vector<double> T(K * D * R);
+        std::mt19937 rng(_opt.seed);
+        std::normal_distribution<double> normal(0.0, _opt.initScale);
+        for (double& t : T) t = normal(rng);
+
+        IvectorExtractor::Options eo;
+        eo.numThreads = _opt.numThreads;
+        eo.batchSize = _opt.batchSize;
+        IvectorExtractor ex(ubm, R, std::move(T), eo);
+
+        std::vector<double> A(K * P);
+        std::vector<double> C(K * D * R);
+        std::vector<double> H(P);
+        IvectorExtractor::Batch b;
+
+        for (std::size_t it = 0; it < _opt.iterations; ++it)
+        {
+            SV_TRACE_SCOPE("tv.iteration");
+
+            std::fill(A.begin(), A.end(), 0.0);
+            std::fill(C.begin(), C.end(), 0.0);
+            std::fill(H.begin(), H.end(), 0.0);
+
+            // E-step
+            for (std::size_t begin = 0; begin < refs.size(); begin += _opt.batchSize)
+            {
+                const std::size_t n = std::min(_opt.batchSize, refs.size() - begin);
+                ex.prepare(refs.data() + begin, n, b);
+                ex.assemblePrecisions(b);
+                ex.solve(b, true);
+
+                sv::util::parallelFor(K, _opt.numThreads, [&](std::size_t k)
+                {
+                    double* a = A.data() + k * P;
+                    for (std::size_t u = 0; u < n; ++u)
+                    {
+                        const double occ = b.N[u * K + k];
+                        if (occ == 0.0) continue;
+
+                        const double* cov = b.Cov.data() + u * P;
+                        #pragma omp simd
+                        for (std::size_t i = 0; i < P; ++i) a[i] += occ * cov[i];
+                    }
+
+                    for (std::size_t d = 0; d < D; ++d)
+                    {
+                        double* c = C.data() + (k * D + d) * R;
+                        for (std::size_t u = 0; u < n; ++u)
+                        {
+                            const double f = b.F[u * K * D + k * D + d];
+                            const double* w = b.W.data() + u * R;
+                            #pragma omp simd
+                            for (std::size_t r = 0; r < R; ++r) c[r] += f * w[r];
+                        }
+                    }
+                });
+
+                for (std::size_t u = 0; u < n; ++u)
+                {
+                    const double* cov = b.Cov.data() + u * P;
+                    for (std::size_t i = 0; i < P; ++i) H[i] += cov[i];
+                }
+            }
+
+            // M-step: T_k = C_k A_k^-1 (A_k symmetric, so each row solves A_k t = c)
+            sv::util::parallelFor(K, _opt.numThreads, [&](std::size_t k)
+            {
+                double* full = sv::util::Workspace::local().logp(R * R);
+                util::unpackSymmetric(A.data() + k * P, R, full);
+
+                // a component no utterance occupies keeps its block
+                if (!util::cholesky(full, R)) return;
+
+                for (std::size_t d = 0; d < D; ++d)
+                {
+                    double* t = ex._T.data() + (k * D + d) * R;
+                    std::copy_n(C.data() + (k * D + d) * R, R, t);
+                    util::choleskySolve(full, R, t);
+                }
+            });
+
+            const auto U = static_cast<double>(refs.size());
+            for (double& h : H) h /= U;
+
+            double trace = 0.0;
+            for (std::size_t i = 0; i < R; ++i) trace += H[util::packedIndex(i, i)];
+
+            // minimum divergence: with H = G G^T, w' = G^-1 w has E[w' w'^T] = I
+            // and T' = T G leaves the model unchanged
+            if (_opt.minDivergence)
+            {
+                std::vector<double> G(R * R);
+                util::unpackSymmetric(H.data(), R, G.data());
+                if (util::cholesky(G.data(), R))
+                {
+                    sv::util::parallelFor(K * D, _opt.numThreads, [&](std::size_t row)
+                    {
+                        double* t = ex._T.data() + row * R;
+                        for (std::size_t r = 0; r < R; ++r)
+                        {
+                            double s = 0.0;
+                            for (std::size_t q = r; q < R; ++q) s += t[q] * G[q * R + r];
+                            t[r] = s;
+                        }
+                    });
+                }
+            }
+
+            ex.rebuildTerms();
+
+            if (_opt.verbose)
+            {
+                std::cout << "[TV] iter " << it << " utts=" << refs.size()
+                          << " avgTrace(E[ww^T])/R=" << trace / static_cast<double>(R) << "\n";
+            }
+        }
+
+        return ex;
+    }
+}
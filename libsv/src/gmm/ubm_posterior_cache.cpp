@@ -0,0 +1,334 @@
+#include "sv/gmm/ubm_posterior_cache.h"
+
+#include "sv/gmm/gmm_kernels.h"
+#include "sv/gmm/gmm_model_serdes.h"
+#include "sv/util/instrument.h"
+#include "sv/util/parallel.h"
+#include "sv/util/xxhash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <unistd.h>
+
+namespace sv::gmm
+{
+    namespace
+    {
+        // 64-byte entry header
+        struct EntryHeader
+        {
+            uint32_t version = 0;
+            uint32_t topC = 0;
+            uint64_t ubmFingerprint = 0;
+            uint64_t featureHash = 0;
+            uint64_t numGaussians = 0;
+            uint64_t numFrames = 0;
+            uint64_t payloadChecksum = 0;
+            uint64_t payloadBytes = 0;
+        };
+
+        template <class T>
+        void put(char*& p, T v)
+        {
+            std::memcpy(p, &v, sizeof(T));
+            p += sizeof(T);
+        }
+
+        template <class T>
+        T take(const char*& p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+
+        uint64_t payloadBytes(uint64_t T, uint64_t C)
+        {
+            return T * sizeof(double) + T * C * (sizeof(std::uint32_t) + sizeof(float));
+        }
+
+        // false on a short read, bad magic, another version or a payload that
+        // does not fit in the fileSize-byte entry
+        bool readHeader(std::ifstream& in, uint64_t fileSize, const std::array<char, 8>& magic, uint32_t version,
+                        EntryHeader& h)
+        {
+            std::array<char, 64> buf{};
+            in.read(buf.data(), (std::streamsize)buf.size());
+            if (in.gcount() != (std::streamsize)buf.size()) return false;
+            if (std::memcmp(buf.data(), magic.data(), magic.size()) != 0) return false;
+
+            const char* p = buf.data() + magic.size();
+            h.version = take<uint32_t>(p);
+            h.topC = take<uint32_t>(p);
+            h.ubmFingerprint = take<uint64_t>(p);
+            h.featureHash = take<uint64_t>(p);
+            h.numGaussians = take<uint64_t>(p);
+            h.numFrames = take<uint64_t>(p);
+            h.payloadChecksum = take<uint64_t>(p);
+            h.payloadBytes = take<uint64_t>(p);
+
+            // bound T by the file before payloadBytes() multiplies it out
+            const uint64_t frameBytes = sizeof(double) + uint64_t{h.topC} * (sizeof(std::uint32_t) + sizeof(float));
+            if (fileSize < buf.size() || h.numFrames > (fileSize - buf.size()) / frameBytes) return false;
+
+            return h.version == version && h.payloadBytes == payloadBytes(h.numFrames, h.topC);
+        }
+
+        // 0 when the entry cannot be stat'ed (readHeader then rejects it)
+        uint64_t entrySize(const fs::path& entry)
+        {
+            std::error_code ec;
+            const auto size = fs::file_size(entry, ec);
+            return ec ? 0 : static_cast<uint64_t>(size);
+        }
+    }
+
+    UbmPosteriorCache::UbmPosteriorCache(const GmmModel& ubm, Options opt) : _opt(std::move(opt))
+    {
+        if (ubm.empty()) throw std::runtime_error("Posterior cache: model is empty");
+        if (_opt.topC == 0) throw std::runtime_error("Posterior cache: topC must be > 0");
+
+        _ubm = PrecomputedGmm::from(ubm, _opt.minWeight);
+        _fingerprint = GmmModelSerdes::fingerprint(ubm);
+        _topC = std::min(_opt.topC, ubm.numGaussians);
+    }
+
+    fs::path UbmPosteriorCache::entryPath(const fs::path& lvf) const
+    {
+        if (_opt.directory.empty())
+        {
+            fs::path p = lvf;
+            return p.replace_extension(".upc");
+        }
+
+        // utterance names repeat across speakers (e.g. TIMIT's SA1), so the
+        // name carries a hash of the full path
+        const std::string key = fs::absolute(lvf).lexically_normal().string();
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx",
+                      static_cast<unsigned long long>(util::xxh64(key.data(), key.size())));
+        return _opt.directory / (lvf.stem().string() + "-" + hex + ".upc");
+    }
+
+    uint64_t UbmPosteriorCache::hashFile(const fs::path& file, sv::util::Workspace& ws)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        const auto size = static_cast<std::size_t>(fs::file_size(file));
+        char* data = ws.bytes(size);
+        in.read(data, (std::streamsize)size);
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+
+        return util::xxh64(data, size);
+    }
+
+    void UbmPosteriorCache::compute(const libvoicefeat::FeatureMatrix& m, uint64_t featureHash,
+                                    UtterancePosteriors& out, sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("posterior_cache.compute");
+        SV_COUNTER_ADD("posterior_cache.frames", m.size());
+
+        const std::size_t K = _ubm.numGaussians;
+        const std::size_t D = _ubm.dim;
+        const std::size_t C = _topC;
+        const std::size_t T = m.size();
+
+        out.ubmFingerprint = _fingerprint;
+        out.featureHash = featureHash;
+        out.numGaussians = K;
+        out.numFrames = T;
+        out.topC = C;
+        out.indices.resize(T * C);
+        out.posteriors.resize(T * C);
+        out.frameLogLik.resize(T);
+
+        const auto& kern = kernels::select(D);
+        double* logp = ws.logp(K);
+        std::uint32_t* idx = ws.indices(K);
+
+        for (std::size_t t = 0; t < T; ++t)
+        {
+            const auto& x = m[t];
+            if (x.size() != D) throw std::runtime_error("Posterior cache: feature dim mismatch");
+
+            kern.logLikelihoods(_ubm, x.data(), logp);
+            const double ll = kernels::logSumExp(logp, K);
+
+            std::iota(idx, idx + K, 0u);
+            std::partial_sort(idx, idx + C, idx + K,
+                              [logp](std::uint32_t a, std::uint32_t b) { return logp[a] > logp[b]; });
+
+            const double logDen = kernels::logSumExp(logp, idx, C);
+            std::uint32_t* oi = out.indices.data() + t * C;
+            float* op = out.posteriors.data() + t * C;
+            for (std::size_t i = 0; i < C; ++i)
+            {
+                oi[i] = idx[i];
+                op[i] = static_cast<float>(kernels::posterior(logp[idx[i]], logDen));
+            }
+            out.frameLogLik[t] = ll;
+        }
+    }
+
+    bool UbmPosteriorCache::isCurrent(const fs::path& entry, uint64_t featureHash) const
+    {
+        std::ifstream in(entry, std::ios::binary);
+        if (!in) return false;
+
+        EntryHeader h;
+        return readHeader(in, entrySize(entry), kMagic, kVersion, h)
+            && h.ubmFingerprint == _fingerprint
+            && h.featureHash == featureHash
+            && h.numGaussians == _ubm.numGaussians
+            && h.topC == _topC;
+    }
+
+    bool UbmPosteriorCache::load(const fs::path& lvf, UtterancePosteriors& out, sv::util::Workspace& ws) const
+    {
+        return read(entryPath(lvf), hashFile(lvf, ws), out, ws);
+    }
+
+    bool UbmPosteriorCache::read(const fs::path& entry, uint64_t featureHash, UtterancePosteriors& out,
+                                 sv::util::Workspace& ws) const
+    {
+        std::ifstream in(entry, std::ios::binary);
+        if (!in) return false;
+
+        EntryHeader h;
+        if (!readHeader(in, entrySize(entry), kMagic, kVersion, h)) return false;
+        if (h.ubmFingerprint != _fingerprint || h.featureHash != featureHash ||
+            h.numGaussians != _ubm.numGaussians || h.topC != _topC)
+        {
+            SV_COUNTER_ADD("posterior_cache.stale", 1);
+            return false;
+        }
+
+        const std::size_t bytes = static_cast<std::size_t>(h.payloadBytes);
+        char* payload = ws.bytes(bytes);
+        in.read(payload, (std::streamsize)bytes);
+        if (in.gcount() != (std::streamsize)bytes) return false;
+        if (util::xxh64(payload, bytes) != h.payloadChecksum) return false;
+
+        const std::size_t T = static_cast<std::size_t>(h.numFrames);
+        const std::size_t C = h.topC;
+
+        out.ubmFingerprint = h.ubmFingerprint;
+        out.featureHash = h.featureHash;
+        out.numGaussians = static_cast<std::size_t>(h.numGaussians);
+        out.numFrames = T;
+        out.topC = C;
+        out.frameLogLik.resize(T);
+        out.indices.resize(T * C);
+        out.posteriors.resize(T * C);
+
+        const char* p = payload;
+        std::memcpy(out.frameLogLik.data(), p, T * sizeof(double));
+        p += T * sizeof(double);
+        std::memcpy(out.indices.data(), p, T * C * sizeof(std::uint32_t));
+        p += T * C * sizeof(std::uint32_t);
+        std::memcpy(out.posteriors.data(), p, T * C * sizeof(float));
+
+        // a damaged index would otherwise be used to address model rows
+        for (auto k : out.indices)
+        {
+            if (k >= out.numGaussians) return false;
+        }
+
+        SV_COUNTER_ADD("posterior_cache.hits", 1);
+        return true;
+    }
+
+    void UbmPosteriorCache::save(const fs::path& entry, const UtterancePosteriors& post) const
+    {
+        SV_TRACE_SCOPE("posterior_cache.save");
+
+        const uint64_t T = post.numFrames;
+        const uint64_t C = post.topC;
+
+        std::vector<char> buf(kHeaderBytes + payloadBytes(T, C));
+        char* payload = buf.data() + kHeaderBytes;
+        char* p = payload;
+        std::memcpy(p, post.frameLogLik.data(), T * sizeof(double));
+        p += T * sizeof(double);
+        std::memcpy(p, post.indices.data(), T * C * sizeof(std::uint32_t));
+        p += T * C * sizeof(std::uint32_t);
+        std::memcpy(p, post.posteriors.data(), T * C * sizeof(float));
+
+        p = buf.data();
+        std::memcpy(p, kMagic.data(), kMagic.size());
+        p += kMagic.size();
+        put<uint32_t>(p, kVersion);
+        put<uint32_t>(p, static_cast<uint32_t>(C));
+        put<uint64_t>(p, post.ubmFingerprint);
+        put<uint64_t>(p, post.featureHash);
+        put<uint64_t>(p, post.numGaussians);
+        put<uint64_t>(p, T);
+        put<uint64_t>(p, util::xxh64(payload, buf.size() - kHeaderBytes));
+        put<uint64_t>(p, buf.size() - kHeaderBytes);
+
+        if (entry.has_parent_path()) fs::create_directories(entry.parent_path());
+
+        // unique per process and thread; the rename replaces the entry atomically
+        fs::path tmp = entry;
+        tmp += ".tmp." + std::to_string(::getpid()) + "." +
+               std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+        {
+            std::ofstream out(tmp, std::ios::binary);
+            if (!out) throw std::runtime_error("Cannot open for write: " + tmp.string());
+            out.write(buf.data(), (std::streamsize)buf.size());
+            if (!out) throw std::runtime_error("Write failed: " + tmp.string());
+        }
+        fs::rename(tmp, entry);
+    }
+
+    void UbmPosteriorCache::fetch(const fs::path& lvf, const libvoicefeat::FeatureMatrix& m,
+                                  UtterancePosteriors& out, sv::util::Workspace& ws) const
+    {
+        const uint64_t featureHash = hashFile(lvf, ws);
+        const fs::path entry = entryPath(lvf);
+        if (read(entry, featureHash, out, ws) && out.numFrames == m.size()) return;
+
+        compute(m, featureHash, out, ws);
+        save(entry, out);
+    }
+
+    std::size_t UbmPosteriorCache::precompute(const std::vector<fs::path>& lvfs,
+                                              const sv::io::FeatureSerdes& serdes) const
+    {
+        SV_TRACE_SCOPE("posterior_cache.precompute");
+
+        std::atomic<std::size_t> computed{0};
+
+        sv::util::parallelFor(lvfs.size(), _opt.numThreads, [&](std::size_t i)
+        {
+            auto& ws = sv::util::Workspace::local();
+            const uint64_t featureHash = hashFile(lvfs[i], ws);
+            const fs::path entry = entryPath(lvfs[i]);
+            if (isCurrent(entry, featureHash)) return;
+
+            libvoicefeat::features::Feature feat;
+            serdes.load(lvfs[i], feat, ws);
+
+            UtterancePosteriors post;
+            compute(feat.getComputedMatrix(), featureHash, post, ws);
+            save(entry, post);
+            computed.fetch_add(1);
+        });
+
+        return computed.load();
+    }
+}
@@ -0,0 +1,168 @@
+#include "sv/io/feature_corpus.h"
+
+#include "sv/io/feature_prefetcher.h"
+#include "sv/util/half.h"
+#include "sv/util/instrument.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+using libvoicefeat::features::Feature;
+using libvoicefeat::VADFlags;
+using libvoicefeat::VADState;
+
+namespace sv::io
+{
+    namespace
+    {
+        constexpr auto kSpeech = static_cast<VADState>(1);
+
+        // Frame values in the files, from their headers; file size / 4 where
+        // a header cannot be read (the load reports the error).
+        std::size_t totalValues(const std::vector<fs::path>& files)
+        {
+            const FeatureSerdes serdes;
+            std::size_t total = 0;
+            for (const auto& f : files)
+            {
+                try
+                {
+                    const auto h = serdes.readHeader(f);
+                    total += std::size_t(h.rows) * h.cols;
+                }
+                catch (const std::exception&)
+                {
+                    std::error_code ec;
+                    const auto size = fs::file_size(f, ec);
+                    if (!ec) total += static_cast<std::size_t>(size) / sizeof(float);
+                }
+            }
+            return total;
+        }
+    }
+
+    FeatureCorpus::FeatureCorpus(Options opt) : _opt(opt)
+    {
+    }
+
+    bool FeatureCorpus::keepFrame(const VADFlags& vad, bool useVad, std::size_t t)
+    {
+        return !useVad || vad[t] == kSpeech;
+    }
+
+    std::size_t FeatureCorpus::estimateBytes(const std::vector<fs::path>& files, const Options& opt)
+    {
+        const std::size_t values = totalValues(files);
+        return values * (opt.float16 ? sizeof(std::uint16_t) : sizeof(float))
+             + (files.size() + 1) * sizeof(std::size_t);
+    }
+
+    void FeatureCorpus::reserveFrames(std::size_t frames)
+    {
+        if (_dim == 0) return;
+        if (_opt.float16) _f16.reserve(frames * _dim);
+        else _f32.reserve(frames * _dim);
+    }
+
+    void FeatureCorpus::append(const Feature& feat)
+    {
+        const auto& m = const_cast<Feature&>(feat).getComputedMatrix();
+        const VADFlags& vad = feat.getVADFlags();
+        const bool useVad = _opt.speechOnly && vad.size() == m.size();
+
+        std::size_t kept = 0;
+        for (std::size_t t = 0; t < m.size(); ++t)
+        {
+            if (!keepFrame(vad, useVad, t)) continue;
+
+            const auto& x = m[t];
+            if (_dim == 0) _dim = x.size();
+            if (x.size() != _dim) throw std::runtime_error("FeatureCorpus: feature dim mismatch");
+
+            if (_opt.float16)
+            {
+                for (float v : x) _f16.push_back(sv::util::floatToHalf(v));
+            }
+            else
+            {
+                _f32.insert(_f32.end(), x.begin(), x.end());
+            }
+            ++kept;
+        }
+
+        _offsets.push_back(_offsets.back() + kept);
+    }
+
+    FeatureCorpus FeatureCorpus::load(const std::vector<fs::path>& files, const FeatureSerdes& serdes, Options opt)
+    {
+        SV_TRACE_SCOPE("corpus.load");
+
+        FeatureCorpus corpus(opt);
+        corpus._offsets.reserve(files.size() + 1);
+
+        // an upper bound on the frames kept (speechOnly may drop some)
+        const std::size_t values = totalValues(files);
+
+        FeaturePrefetcher::Options po;
+        po.numIoThreads = opt.numIoThreads;
+        FeaturePrefetcher pf(serdes, files, po);
+
+        Feature feat;
+        bool reserved = false;
+        while (pf.next(feat))
+        {
+            corpus.append(feat);
+            if (!reserved && corpus._dim != 0)
+            {
+                corpus.reserveFrames(values / corpus._dim);
+                reserved = true;
+            }
+        }
+
+        SV_COUNTER_ADD("corpus.frames", corpus.numFrames());
+        return corpus;
+    }
+
+    std::size_t FeatureCorpus::bytes() const
+    {
+        return _f32.capacity() * sizeof(float)
+            + _f16.capacity() * sizeof(std::uint16_t)
+            + _offsets.capacity() * sizeof(std::size_t);
+    }
+
+    const float* FeatureCorpus::utterance(std::size_t u, sv::util::Workspace& ws) const
+    {
+        const std::size_t begin = _offsets[u] * _dim;
+        const std::size_t n = frames(u) * _dim;
+
+        if (!_opt.float16) return _f32.data() + begin;
+
+        float* out = ws.floats(n);
+        sv::util::halfToFloat(_f16.data() + begin, out, n);
+        return out;
+    }
+
+    const float* FeatureCorpus::pack(const Feature& feat, bool speechOnly, sv::util::Workspace& ws,
+                                     std::size_t& T, std::size_t& D)
+    {
+        const auto& m = const_cast<Feature&>(feat).getComputedMatrix();
+        const VADFlags& vad = feat.getVADFlags();
+        const bool useVad = speechOnly && vad.size() == m.size();
+
+        T = 0;
+        D = m.empty() ? 0 : m[0].size();
+
+        float* out = ws.floats(m.size() * D);
+        for (std::size_t t = 0; t < m.size(); ++t)
+        {
+            if (!keepFrame(vad, useVad, t)) continue;
+            if (m[t].size() != D) throw std::runtime_error("Non-rectangular FeatureMatrix");
+
+            std::memcpy(out + T * D, m[t].data(), D * sizeof(float));
+            ++T;
+        }
+        return out;
+    }
+}
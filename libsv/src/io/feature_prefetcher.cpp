@@ -0,0 +1,165 @@
+#include "sv/io/feature_prefetcher.h"
+
+#include "sv/util/instrument.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using libvoicefeat::features::Feature;
+
+namespace sv::io
+{
+    FeaturePrefetcher::FeaturePrefetcher(const FeatureSerdes& serdes, std::vector<fs::path> files, Options opt)
+        : _serdes(serdes), _files(std::move(files)), _opt(opt), _estimates(_files.size())
+    {
+        const std::size_t n = std::min(_opt.numIoThreads, _files.size());
+        _threads.reserve(n);
+        for (std::size_t t = 0; t < n; ++t) _threads.emplace_back([this] { ioLoop(); });
+    }
+
+    FeaturePrefetcher::~FeaturePrefetcher()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _budget.notify_all();
+        for (auto& t : _threads) t.join();
+    }
+
+    std::size_t FeaturePrefetcher::estimateBytes(const fs::path& file) const
+    {
+        // f16 / int16 files decode to twice their size, and projected frames
+        // are held at outDim, so budget by the header
+        try
+        {
+            const auto h = _serdes.readHeader(file);
+            const auto& projection = _serdes.projection();
+            return std::size_t(h.rows) * (projection ? projection->outDim() : h.cols) * sizeof(float);
+        }
+        catch (const std::exception&)
+        {
+            std::error_code ec;
+            const auto size = fs::file_size(file, ec);
+            return ec ? 0 : static_cast<std::size_t>(size);
+        }
+    }
+
+    void FeaturePrefetcher::adviseWillNeed(const fs::path& file)
+    {
+#if defined(POSIX_FADV_WILLNEED)
+        const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return; // the real load reports the error
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        ::close(fd);
+#else
+        (void)file;
+#endif
+    }
+
+    void FeaturePrefetcher::ioLoop()
+    {
+        std::vector<std::size_t> advise;
+
+        for (;;)
+        {
+            std::size_t i = 0;
+            std::size_t bytes = 0;
+            Feature feat;
+            advise.clear();
+
+            {
+                std::unique_lock lock(_mutex);
+                for (;;)
+                {
+                    if (_stop || _claimed >= _files.size()) return;
+
+                    const std::size_t c = _claimed;
+                    if (!_estimates[c])
+                    {
+                        // the header read may hit the disk: keep it from
+                        // stalling the other I/O threads and next()
+                        lock.unlock();
+                        const std::size_t estimate = estimateBytes(_files[c]);
+                        lock.lock();
+                        _estimates[c] = estimate;
+                        continue;
+                    }
+
+                    bytes = *_estimates[c];
+                    if (_inFlightBytes == 0 || _inFlightBytes + bytes <= _opt.maxInFlightBytes) break;
+                    _budget.wait(lock);
+                }
+
+                i = _claimed++;
+                _inFlightBytes += bytes;
+
+                if (!_free.empty())
+                {
+                    feat = std::move(_free.back());
+                    _free.pop_back();
+                }
+
+                const std::size_t horizon = std::min(_files.size(), _claimed + _opt.adviseAhead);
+                for (_advised = std::max(_advised, _claimed); _advised < horizon; ++_advised)
+                    advise.push_back(_advised);
+            }
+
+            for (std::size_t j : advise) adviseWillNeed(_files[j]);
+
+            Slot slot;
+            slot.bytes = bytes;
+            try
+            {
+                SV_TRACE_SCOPE("prefetch.load");
+                _serdes.load(_files[i], feat, sv::util::Workspace::local());
+            }
+            catch (...)
+            {
+                slot.error = std::current_exception();
+            }
+            slot.feat = std::move(feat);
+
+            {
+                std::lock_guard lock(_mutex);
+                _done.emplace(i, std::move(slot));
+            }
+            _ready.notify_all();
+        }
+    }
+
+    bool FeaturePrefetcher::next(Feature& out)
+    {
+        if (_consumed >= _files.size()) return false;
+
+        if (_threads.empty())
+        {
+            _serdes.load(_files[_consumed++], out, sv::util::Workspace::local());
+            return true;
+        }
+
+        std::unique_lock lock(_mutex);
+        {
+            SV_TRACE_SCOPE("prefetch.wait");
+            _ready.wait(lock, [&] { return _done.count(_consumed) != 0; });
+        }
+
+        auto node = _done.extract(_consumed++);
+        Slot& slot = node.mapped();
+        _inFlightBytes -= slot.bytes;
+
+        std::swap(out, slot.feat);
+        _free.push_back(std::move(slot.feat)); // the caller's previous buffers
+        const std::exception_ptr error = slot.error;
+
+        lock.unlock();
+        _budget.notify_all();
+
+        if (error) std::rethrow_exception(error);
+        return true;
+    }
+}
@@ -0,0 +1,105 @@
+#include "sv/io/feature_projection.h"
+
+#include "sv/util/instrument.h"
+#include "sv/util/xxhash.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sv::io
+{
+    namespace
+    {
+        // frames projected together, so each row of W^T is loaded once per block
+        constexpr std::size_t kFrameBlock = 4;
+    }
+
+    FeatureProjection::FeatureProjection(Kind kind, std::size_t inDim, std::size_t outDim, std::vector<double> mean,
+                                         std::vector<double> W)
+        : _kind(kind), _in(inDim), _out(outDim), _mean(std::move(mean)), _W(std::move(W))
+    {
+        if (_in == 0 || _out == 0) throw std::runtime_error("Projection: empty shape");
+        if (_out > _in) throw std::runtime_error("Projection: outDim exceeds inDim");
+        if (_mean.size() != _in || _W.size() != _out * _in) throw std::runtime_error("Projection: shape mismatch");
+
+        _Wt.resize(_in * _out);
+        _bias.resize(_out);
+        for (std::size_t o = 0; o < _out; ++o)
+        {
+            double b = 0.0;
+            for (std::size_t i = 0; i < _in; ++i)
+            {
+                _Wt[i * _out + o] = static_cast<float>(_W[o * _in + i]);
+                b -= _W[o * _in + i] * _mean[i];
+            }
+            _bias[o] = static_cast<float>(b);
+        }
+    }
+
+    uint64_t FeatureProjection::fingerprint() const
+    {
+        const uint64_t shape[3] = {static_cast<uint64_t>(_kind), _in, _out};
+        uint64_t h = util::xxh64(shape, sizeof(shape));
+        h = util::xxh64(_mean.data(), _mean.size() * sizeof(double), h);
+        return util::xxh64(_W.data(), _W.size() * sizeof(double), h);
+    }
+
+    void FeatureProjection::apply(const float* x, std::size_t T, float* y) const
+    {
+        SV_TRACE_SCOPE("projection.apply");
+
+        const std::size_t in = _in;
+        const std::size_t out = _out;
+        const float* Wt = _Wt.data();
+        const float* bias = _bias.data();
+
+        // y_t = bias + sum_i x_ti W^T_i: axpys over outDim, vectorized, for a
+        // block of frames at a time
+        std::size_t t = 0;
+        for (; t + kFrameBlock <= T; t += kFrameBlock)
+        {
+            const float* x0 = x + t * in;
+            const float* x1 = x0 + in;
+            const float* x2 = x1 + in;
+            const float* x3 = x2 + in;
+            float* y0 = y + t * out;
+            float* y1 = y0 + out;
+            float* y2 = y1 + out;
+            float* y3 = y2 + out;
+
+            std::copy_n(bias, out, y0);
+            std::copy_n(bias, out, y1);
+            std::copy_n(bias, out, y2);
+            std::copy_n(bias, out, y3);
+
+            for (std::size_t i = 0; i < in; ++i)
+            {
+                const float* w = Wt + i * out;
+                const float a0 = x0[i], a1 = x1[i], a2 = x2[i], a3 = x3[i];
+                #pragma omp simd
+                for (std::size_t o = 0; o < out; ++o)
+                {
+                    y0[o] += a0 * w[o];
+                    y1[o] += a1 * w[o];
+                    y2[o] += a2 * w[o];
+                    y3[o] += a3 * w[o];
+                }
+            }
+        }
+        for (; t < T; ++t)
+        {
+            const float* x0 = x + t * in;
+            float* y0 = y + t * out;
+            std::copy_n(bias, out, y0);
+            for (std::size_t i = 0; i < in; ++i)
+            {
+                const float* w = Wt + i * out;
+                const float a0 = x0[i];
+                #pragma omp simd
+                for (std::size_t o = 0; o < out; ++o) y0[o] += a0 * w[o];
+            }
+        }
+
+        SV_COUNTER_ADD("projection.frames", T);
+    }
+}
@@ -0,0 +1,168 @@
+#include "sv/io/feature_projection_serdes.h"
+
+#include "sv/util/xxhash.h"
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace sv::io
+{
+    namespace
+    {
+        template <class T>
+        void put(char*& p, T v)
+        {
+            std::memcpy(p, &v, sizeof(T));
+            p += sizeof(T);
+        }
+
+        template <class T>
+        T take(const char*& p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return v;
+        }
+    }
+
+    fs::path FeatureProjectionSerdes::pathFor(const fs::path& ubmFile)
+    {
+        fs::path p = ubmFile;
+        p.replace_extension(".proj");
+        return p;
+    }
+
+    FeatureSerdes::Options FeatureProjectionSerdes::featureOptionsFor(const fs::path& ubmFile,
+                                                                      uint64_t ubmFingerprint) const
+    {
+        FeatureSerdes::Options opt;
+        const fs::path file = pathFor(ubmFile);
+        if (fs::exists(file)) opt.projection = std::make_shared<const FeatureProjection>(load(file, ubmFingerprint));
+        return opt;
+    }
+
+    void FeatureProjectionSerdes::save(const fs::path& file, const FeatureProjection& projection) const
+    {
+        save(file, projection, SaveOptions{});
+    }
+
+    std::vector<char> FeatureProjectionSerdes::encode(const FeatureProjection& projection,
+                                                      const SaveOptions& opt) const
+    {
+        if (projection.empty()) throw std::runtime_error("Projection is empty");
+
+        const uint64_t payloadBytes = (projection.mean().size() + projection.matrix().size()) * sizeof(double);
+        std::vector<char> bytes(kHeaderBytes + payloadBytes);
+
+        char* payload = bytes.data() + kHeaderBytes;
+        std::memcpy(payload, projection.mean().data(), projection.mean().size() * sizeof(double));
+        std::memcpy(payload + projection.mean().size() * sizeof(double), projection.matrix().data(),
+                    projection.matrix().size() * sizeof(double));
+
+        char* p = bytes.data();
+        std::memcpy(p, kMagic.data(), kMagic.size());
+        p += kMagic.size();
+        put<uint32_t>(p, kVersion);
+        put<uint32_t>(p, static_cast<uint32_t>(projection.kind()));
+        put<uint64_t>(p, projection.inDim());
+        put<uint64_t>(p, projection.outDim());
+        put<uint64_t>(p, opt.ubmFingerprint);
+        put<uint64_t>(p, util::xxh64(payload, payloadBytes));
+        put<uint64_t>(p, payloadBytes);
+        return bytes;
+    }
+
+    void FeatureProjectionSerdes::save(const fs::path& file, const FeatureProjection& projection,
+                                       const SaveOptions& opt) const
+    {
+        const std::vector<char> bytes = encode(projection, opt);
+        if (file.has_parent_path()) fs::create_directories(file.parent_path());
+
+        std::ofstream out(file, std::ios::binary);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+
+        out.write(bytes.data(), (std::streamsize)bytes.size());
+        if (!out) throw std::runtime_error("Write failed: " + file.string());
+    }
+
+    FeatureProjection FeatureProjectionSerdes::load(const fs::path& file) const
+    {
+        uint64_t fingerprint = 0;
+        return loadImpl(file, fingerprint);
+    }
+
+    FeatureProjection FeatureProjectionSerdes::load(const fs::path& file, uint64_t ubmFingerprint) const
+    {
+        uint64_t fingerprint = 0;
+        auto projection = loadImpl(file, fingerprint);
+        if (fingerprint != ubmFingerprint)
+            throw std::runtime_error("Projection was saved for another UBM: " + file.string());
+        return projection;
+    }
+
+    FeatureProjection FeatureProjectionSerdes::decode(const char* data, std::size_t size, uint64_t ubmFingerprint,
+                                                      const std::string& source) const
+    {
+        uint64_t fingerprint = 0;
+        auto projection = decodeImpl(data, size, fingerprint, source);
+        if (fingerprint != ubmFingerprint) throw std::runtime_error("Projection was saved for another UBM: " + source);
+        return projection;
+    }
+
+    FeatureProjection FeatureProjectionSerdes::loadImpl(const fs::path& file, uint64_t& ubmFingerprint) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        std::error_code ec;
+        const auto size = fs::file_size(file, ec);
+        if (ec) throw std::runtime_error("Cannot stat: " + file.string());
+
+        std::vector<char> bytes(static_cast<std::size_t>(size));
+        in.read(bytes.data(), (std::streamsize)bytes.size());
+        if (!in) throw std::runtime_error("Read failed: " + file.string());
+
+        return decodeImpl(bytes.data(), bytes.size(), ubmFingerprint, file.string());
+    }
+
+    FeatureProjection FeatureProjectionSerdes::decodeImpl(const char* data, std::size_t size,
+                                                          uint64_t& ubmFingerprint, const std::string& source) const
+    {
+        if (size < kHeaderBytes) throw std::runtime_error("Read failed: " + source);
+        if (std::memcmp(data, kMagic.data(), kMagic.size()) != 0) throw std::runtime_error("Bad magic: " + source);
+
+        const char* p = data + kMagic.size();
+        const auto version = take<uint32_t>(p);
+        const auto kind = take<uint32_t>(p);
+        const auto inDim = take<uint64_t>(p);
+        const auto outDim = take<uint64_t>(p);
+        ubmFingerprint = take<uint64_t>(p);
+        const auto checksum = take<uint64_t>(p);
+        const auto payloadBytes = take<uint64_t>(p);
+
+        if (version != kVersion) throw std::runtime_error("Unsupported version: " + source);
+        // the shape is bounded by the size first, so the payload size below cannot wrap
+        if (kind > static_cast<uint32_t>(FeatureProjection::Kind::Lda) || inDim == 0 || outDim == 0
+            || outDim > inDim || inDim > size / sizeof(double) || outDim > size / sizeof(double) / inDim
+            || payloadBytes != (inDim + outDim * inDim) * sizeof(double))
+        {
+            throw std::runtime_error("Invalid projection: " + source);
+        }
+        if (payloadBytes > size - kHeaderBytes) throw std::runtime_error("Read failed: " + source);
+
+        const char* payload = data + kHeaderBytes;
+        if (util::xxh64(payload, payloadBytes) != checksum) throw std::runtime_error("Checksum mismatch: " + source);
+
+        std::vector<double> mean(inDim);
+        std::vector<double> W(outDim * inDim);
+        std::memcpy(mean.data(), payload, inDim * sizeof(double));
+        std::memcpy(W.data(), payload + inDim * sizeof(double), W.size() * sizeof(double));
+        return FeatureProjection(static_cast<FeatureProjection::Kind>(kind), inDim, outDim, std::move(mean),
+                                 std::move(W));
+    }
+}
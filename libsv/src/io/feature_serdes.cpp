@@ -1,7 +1,20 @@
 #include "sv/io/feature_serdes.h"
 
+#include "sv/util/half.h"
+#include "sv/util/instrument.h"
+#include "sv/util/xxhash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <stdexcept>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using libvoicefeat::features::Feature;
 using libvoicefeat::FeatureOptions;
 using libvoicefeat::FeatureMatrix;
@@ -11,44 +24,101 @@ using libvoicefeat::CepstralType;
 
 namespace sv::io
 {
+    namespace
+    {
+        constexpr uint64_t alignUp(uint64_t n, uint64_t a) { return (n + a - 1) / a * a; }
+
+        constexpr auto kNonSpeech = static_cast<VADState>(0);
+        constexpr auto kSpeech = static_cast<VADState>(1);
+
+        // v1: magic, version, cepstral type, options, rows, cols, matrix
+        constexpr std::size_t kOptionsBytes = 41;
+        constexpr std::size_t kV1OptionsOffset = 16;
+        constexpr std::size_t kV1MatrixOffset = kV1OptionsOffset + kOptionsBytes + 8;
+
+        // int16 codes span [-kInt16Max, kInt16Max], symmetric around the offset
+        constexpr int kInt16Max = 32767;
+
+        // rows x cols scalars fit in avail bytes; checked without multiplying
+        // out the (possibly crafted) shape, which could wrap
+        bool matrixFits(uint64_t rows, uint64_t cols, uint64_t scalarSize, uint64_t avail)
+        {
+            if (cols == 0) return rows == 0;
+            return rows <= avail / (cols * scalarSize);
+        }
+
+        template <class T>
+        T at(const char* p)
+        {
+            T v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        template <class T>
+        char* put(char* p, T v)
+        {
+            std::memcpy(p, &v, sizeof(v));
+            return p + sizeof(v);
+        }
+    }
+
+    FeatureSerdes::FeatureSerdes(Options opt) : _opt(std::move(opt))
+    {
+    }
+
     void FeatureSerdes::writeU32(std::ofstream& out, uint32_t v)
     {
         out.write(reinterpret_cast<const char*>(&v), sizeof(v));
     }
 
-    void FeatureSerdes::readU32(std::ifstream& in, uint32_t& v)
+    void FeatureSerdes::writeU64(std::ofstream& out, uint64_t v)
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
     }
 
-    void FeatureSerdes::writeI32(std::ofstream& out, int32_t v)
+    void FeatureSerdes::Reader::read(void* dst, std::size_t n)
     {
-        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+        if (!ok || static_cast<std::size_t>(end - p) < n)
+        {
+            ok = false;
+            std::memset(dst, 0, n);
+            return;
+        }
+        std::memcpy(dst, p, n);
+        p += n;
     }
 
-    void FeatureSerdes::readI32(std::ifstream& in, int32_t& v)
+    template <class T>
+    T FeatureSerdes::Reader::get()
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        T v{};
+        read(&v, sizeof(v));
+        return v;
     }
 
-    void FeatureSerdes::writeF64(std::ofstream& out, double v)
+    std::size_t FeatureSerdes::Header::scalarSize() const
     {
-        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+        return encoding == Encoding::Float32 ? sizeof(float) : sizeof(uint16_t);
     }
 
-    void FeatureSerdes::readF64(std::ifstream& in, double& v)
+    uint64_t FeatureSerdes::Header::scalesOffset() const
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        return version == kVersion1 ? 0 : alignUp(kOptionsBytes, kAlignment);
     }
 
-    void FeatureSerdes::writeU8(std::ofstream& out, uint8_t v)
+    uint64_t FeatureSerdes::Header::matrixOffset() const
     {
-        out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+        if (version == kVersion1) return 0;
+        const uint64_t scales = encoding == Encoding::Int16 ? 2 * uint64_t(cols) * sizeof(float) : 0;
+        return scalesOffset() + alignUp(scales, kAlignment);
     }
 
-    void FeatureSerdes::readU8(std::ifstream& in, uint8_t& v)
+    uint64_t FeatureSerdes::Header::vadOffset() const
     {
-        in.read(reinterpret_cast<char*>(&v), sizeof(v));
+        const uint64_t m = uint64_t(rows) * cols * scalarSize();
+        // v1: past the matrix and the flag count
+        return version == kVersion1 ? m + sizeof(uint32_t) : matrixOffset() + alignUp(m, kAlignment);
     }
 
     bool FeatureSerdes::checkRectangular(const FeatureMatrix& m)
@@ -62,162 +132,455 @@ namespace sv::io
         return true;
     }
 
-    void FeatureSerdes::writeFeatureOptions(std::ofstream& out, const FeatureOptions& o)
+    char* FeatureSerdes::writeFeatureOptions(char* p, const FeatureOptions& o)
     {
-        writeI32(out, o.sampleRate);
-        writeI32(out, o.numFilters);
-        writeI32(out, o.numCoeffs);
-        writeF64(out, o.minFreq);
-        writeF64(out, o.maxFreq);
-        writeU8(out, static_cast<uint8_t>(o.includeEnergy ? 1 : 0));
-        writeU32(out, static_cast<uint32_t>(o.filterbank));
-        writeU32(out, static_cast<uint32_t>(o.melScale));
-        writeU32(out, static_cast<uint32_t>(o.compressionType));
+        p = put<int32_t>(p, o.sampleRate);
+        p = put<int32_t>(p, o.numFilters);
+        p = put<int32_t>(p, o.numCoeffs);
+        p = put<double>(p, o.minFreq);
+        p = put<double>(p, o.maxFreq);
+        p = put<uint8_t>(p, o.includeEnergy ? 1 : 0);
+        p = put<uint32_t>(p, static_cast<uint32_t>(o.filterbank));
+        p = put<uint32_t>(p, static_cast<uint32_t>(o.melScale));
+        p = put<uint32_t>(p, static_cast<uint32_t>(o.compressionType));
+        return p;
     }
 
-    void FeatureSerdes::readFeatureOptions(std::ifstream& in, FeatureOptions& o)
+    void FeatureSerdes::readFeatureOptions(Reader& in, FeatureOptions& o)
     {
-        int32_t i32 = 0;
-        double f64 = 0.0;
-        uint8_t u8 = 0;
-        uint32_t u32 = 0;
+        o.sampleRate = in.get<int32_t>();
+        o.numFilters = in.get<int32_t>();
+        o.numCoeffs = in.get<int32_t>();
+
+        o.minFreq = in.get<double>();
+        o.maxFreq = in.get<double>();
+
+        o.includeEnergy = (in.get<uint8_t>() != 0);
 
-        readI32(in, i32);
-        o.sampleRate = i32;
-        readI32(in, i32);
-        o.numFilters = i32;
-        readI32(in, i32);
-        o.numCoeffs = i32;
+        o.filterbank = static_cast<libvoicefeat::FilterbankType>(in.get<uint32_t>());
+        o.melScale = static_cast<libvoicefeat::MelScale>(in.get<uint32_t>());
+        o.compressionType = static_cast<libvoicefeat::CompressionType>(in.get<uint32_t>());
+    }
 
-        readF64(in, f64);
-        o.minFreq = f64;
-        readF64(in, f64);
-        o.maxFreq = f64;
+    void FeatureSerdes::encodeMatrix(const FeatureMatrix& m, const Header& h, char* payload)
+    {
+        const std::size_t rows = h.rows;
+        const std::size_t cols = h.cols;
+        char* block = payload + h.matrixOffset();
 
-        readU8(in, u8);
-        o.includeEnergy = (u8 != 0);
+        switch (h.encoding)
+        {
+        case Encoding::Float32:
+            for (std::size_t i = 0; i < rows; ++i)
+                std::memcpy(block + i * cols * sizeof(float), m[i].data(), cols * sizeof(float));
+            break;
 
-        readU32(in, u32);
-        o.filterbank = static_cast<libvoicefeat::FilterbankType>(u32);
-        readU32(in, u32);
-        o.melScale = static_cast<libvoicefeat::MelScale>(u32);
-        readU32(in, u32);
-        o.compressionType = static_cast<libvoicefeat::CompressionType>(u32);
+        case Encoding::Float16:
+            for (std::size_t i = 0; i < rows; ++i)
+            {
+                char* row = block + i * cols * sizeof(uint16_t);
+                for (std::size_t d = 0; d < cols; ++d)
+                    put<uint16_t>(row + d * sizeof(uint16_t), sv::util::floatToHalf(m[i][d]));
+            }
+            break;
+
+        case Encoding::Int16:
+        {
+            // offset and step from each dim's finite range, so every dim gets
+            // the full code range however its scale compares to the others
+            std::vector<double> lo(cols, std::numeric_limits<double>::infinity());
+            std::vector<double> hi(cols, -std::numeric_limits<double>::infinity());
+            for (std::size_t i = 0; i < rows; ++i)
+            {
+                for (std::size_t d = 0; d < cols; ++d)
+                {
+                    const double v = m[i][d];
+                    if (!std::isfinite(v)) continue;
+                    lo[d] = std::min(lo[d], v);
+                    hi[d] = std::max(hi[d], v);
+                }
+            }
+
+            char* scales = payload + h.scalesOffset();
+            std::vector<float> offset(cols), step(cols);
+            for (std::size_t d = 0; d < cols; ++d)
+            {
+                if (lo[d] > hi[d]) lo[d] = hi[d] = 0.0; // no finite values
+                offset[d] = static_cast<float>(0.5 * (lo[d] + hi[d]));
+                step[d] = static_cast<float>((hi[d] - lo[d]) / (2.0 * kInt16Max));
+                put<float>(scales + d * sizeof(float), offset[d]);
+                put<float>(scales + (cols + d) * sizeof(float), step[d]);
+            }
+
+            for (std::size_t i = 0; i < rows; ++i)
+            {
+                char* row = block + i * cols * sizeof(int16_t);
+                for (std::size_t d = 0; d < cols; ++d)
+                {
+                    const double v = m[i][d];
+                    double q = 0.0;
+                    if (std::isinf(v)) q = v > 0 ? kInt16Max : -kInt16Max;
+                    else if (!std::isnan(v) && step[d] != 0.0f)
+                        q = std::clamp(std::nearbyint((v - offset[d]) / step[d]), double(-kInt16Max), double(kInt16Max));
+                    put<int16_t>(row + d * sizeof(int16_t), static_cast<int16_t>(q));
+                }
+            }
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Unknown feature encoding");
+        }
     }
 
-    void FeatureSerdes::save(const fs::path& file, const Feature& feat) const
+    void FeatureSerdes::decodeRow(const char* data, const Header& h, std::size_t i, float* dst)
     {
-        fs::create_directories(file.parent_path());
+        const std::size_t cols = h.cols;
+        const char* row = data + h.payloadOffset + h.matrixOffset() + i * cols * h.scalarSize();
 
-        std::ofstream out(file, std::ios::binary);
-        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+        switch (h.encoding)
+        {
+        case Encoding::Float32:
+            std::memcpy(dst, row, cols * sizeof(float));
+            break;
 
-        // header
-        out.write(kMagic.data(), (std::streamsize)kMagic.size());
-        writeU32(out, kVersion);
+        case Encoding::Float16:
+            #pragma omp simd
+            for (std::size_t d = 0; d < cols; ++d)
+                dst[d] = sv::util::halfToFloatBranchless(at<uint16_t>(row + d * sizeof(uint16_t)));
+            break;
 
-        // cepstral type
-        writeU32(out, static_cast<uint32_t>(feat.getCepstralType()));
+        case Encoding::Int16:
+        {
+            const char* scales = data + h.payloadOffset + h.scalesOffset();
+            #pragma omp simd
+            for (std::size_t d = 0; d < cols; ++d)
+            {
+                const float offset = at<float>(scales + d * sizeof(float));
+                const float step = at<float>(scales + (cols + d) * sizeof(float));
+                dst[d] = offset + step * static_cast<float>(at<int16_t>(row + d * sizeof(int16_t)));
+            }
+            break;
+        }
+        }
+    }
 
-        // options
-        FeatureOptions opts = feat.getOptions();
-        writeFeatureOptions(out, opts);
+    const float* FeatureSerdes::decodeFrames(const char* data, const Header& h, float* buffer)
+    {
+        // v2 float32 is already the block we want: 64-byte aligned in the file,
+        // and so in memory, since readFile() reads into Workspace::bytes()
+        if (h.version == kVersion && h.encoding == Encoding::Float32)
+        {
+            return reinterpret_cast<const float*>(data + h.payloadOffset + h.matrixOffset());
+        }
+
+        for (std::size_t i = 0; i < h.rows; ++i) decodeRow(data, h, i, buffer + i * h.cols);
+        return buffer;
+    }
+
+    const float* FeatureSerdes::project(const char* data, const Header& h, sv::util::Workspace& ws,
+                                        const fs::path& file) const
+    {
+        const FeatureProjection& p = *_opt.projection;
+        if (h.rows != 0 && h.cols != p.inDim())
+            throw std::runtime_error("Feature dim does not match the projection: " + file.string());
+
+        const std::size_t T = h.rows;
+        const float* X = decodeFrames(data, h, ws.floatsAux(T * h.cols));
+        float* Y = ws.floats(T * p.outDim());
+        p.apply(X, T, Y);
+        return Y;
+    }
+
+    void FeatureSerdes::decodeVad(const char* data, const Header& h, VADFlags& flags)
+    {
+        const char* p = data + h.payloadOffset + h.vadOffset();
+        flags.resize(h.numFlags);
+
+        if (h.version == kVersion1)
+        {
+            for (uint32_t t = 0; t < h.numFlags; ++t) flags[t] = static_cast<VADState>(at<uint8_t>(p + t));
+            return;
+        }
+
+        for (uint32_t t = 0; t < h.numFlags; ++t)
+        {
+            const auto byte = at<uint8_t>(p + t / 8);
+            flags[t] = (byte >> (t % 8)) & 1u ? kSpeech : kNonSpeech;
+        }
+    }
+
+    void FeatureSerdes::save(const fs::path& file, const Feature& feat) const
+    {
+        save(file, feat, SaveOptions{});
+    }
+
+    void FeatureSerdes::save(const fs::path& file, const Feature& feat, const SaveOptions& opt) const
+    {
+        SV_TRACE_SCOPE("serdes.feature_save");
 
-        // matrix
         const auto& M = const_cast<Feature&>(feat).getComputedMatrix();
         if (!checkRectangular(M))
         {
             throw std::runtime_error("Non-rectangular FeatureMatrix: " + file.string());
         }
-
-        const uint32_t rows = static_cast<uint32_t>(M.size());
-        const uint32_t cols = rows ? static_cast<uint32_t>(M[0].size()) : 0;
-        writeU32(out, rows);
-        writeU32(out, cols);
-
-        for (uint32_t i = 0; i < rows; ++i)
+        if (opt.encoding != Encoding::Float32 && opt.encoding != Encoding::Float16 && opt.encoding != Encoding::Int16)
         {
-            for (uint32_t j = 0; j < cols; ++j)
-            {
-                float v = M[i][j];
-                out.write(reinterpret_cast<const char*>(&v), sizeof(v));
-            }
+            throw std::runtime_error("Unknown feature encoding: " + file.string());
         }
 
         const VADFlags& flags = feat.getVADFlags();
-        writeU32(out, static_cast<uint32_t>(flags.size()));
-        for (auto st : flags)
+
+        Header h;
+        h.version = kVersion;
+        h.encoding = opt.encoding;
+        h.rows = static_cast<uint32_t>(M.size());
+        h.cols = h.rows ? static_cast<uint32_t>(M[0].size()) : 0;
+        h.numFlags = static_cast<uint32_t>(flags.size());
+        h.payloadOffset = kHeaderBytes;
+        h.payloadBytes = h.vadOffset() + alignUp((uint64_t(h.numFlags) + 7) / 8, kAlignment);
+
+        // the whole file is built in memory and written with one call
+        std::vector<char> payload(h.payloadBytes, 0);
+        writeFeatureOptions(payload.data(), feat.getOptions());
+        encodeMatrix(M, h, payload.data());
+
+        char* vad = payload.data() + h.vadOffset();
+        for (uint32_t t = 0; t < h.numFlags; ++t)
         {
-            writeU8(out, static_cast<uint8_t>(st));
+            if (flags[t] == kSpeech) vad[t / 8] = static_cast<char>(vad[t / 8] | (1u << (t % 8)));
         }
 
+        h.payloadChecksum = util::xxh64(payload.data(), payload.size());
+
+        fs::create_directories(file.parent_path());
+
+        std::ofstream out(file, std::ios::binary);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+
+        out.write(kMagic.data(), (std::streamsize)kMagic.size());
+        writeU32(out, h.version);
+        writeU32(out, static_cast<uint32_t>(h.encoding));
+        writeU32(out, static_cast<uint32_t>(feat.getCepstralType()));
+        writeU32(out, h.rows);
+        writeU32(out, h.cols);
+        writeU32(out, h.numFlags);
+        writeU64(out, h.payloadChecksum);
+        writeU64(out, h.payloadOffset);
+        writeU64(out, h.payloadBytes);
+        writeU64(out, 0); // reserved
+
+        out.write(payload.data(), (std::streamsize)payload.size());
+
         if (!out) throw std::runtime_error("Write failed: " + file.string());
     }
 
-    Feature FeatureSerdes::load(const fs::path& file) const
+    const char* FeatureSerdes::readFile(const fs::path& file, sv::util::Workspace& ws, std::size_t& size)
     {
-        std::ifstream in(file, std::ios::binary);
-        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+        // one read of the whole file into reusable scratch
+        const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat: " + file.string());
+        }
+
+        size = static_cast<std::size_t>(st.st_size);
+        char* data = ws.bytes(size);
+        std::size_t got = 0;
+        while (got < size)
+        {
+            const ssize_t n = ::read(fd, data + got, size - got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+        if (got != size) throw std::runtime_error("Read failed: " + file.string());
+
+        return data;
+    }
+
+    void FeatureSerdes::parse(const char* data, std::size_t size, Header& h, CepstralType& ct, FeatureOptions& opts,
+                              const fs::path& file)
+    {
+        Reader in{data, data + size};
 
-        // header
         std::array<char, 8> magic{};
-        in.read(magic.data(), (std::streamsize)magic.size());
+        in.read(magic.data(), magic.size());
         if (magic != kMagic) throw std::runtime_error("Bad magic: " + file.string());
 
-        uint32_t version = 0;
-        readU32(in, version);
-        if (version != kVersion) throw std::runtime_error("Unsupported version: " + file.string());
+        h = Header{};
+        h.version = in.get<uint32_t>();
 
-        // cepstral type
-        uint32_t ct_u32 = 0;
-        readU32(in, ct_u32);
-        auto ct = static_cast<CepstralType>(ct_u32);
+        if (h.version == kVersion1)
+        {
+            ct = static_cast<CepstralType>(in.get<uint32_t>());
+            readFeatureOptions(in, opts);
+            h.rows = in.get<uint32_t>();
+            h.cols = in.get<uint32_t>();
+            h.payloadOffset = kV1MatrixOffset;
+
+            if (!in.ok || size - kV1MatrixOffset < sizeof(uint32_t)
+                || !matrixFits(h.rows, h.cols, sizeof(float), size - kV1MatrixOffset - sizeof(uint32_t)))
+                throw std::runtime_error("Read failed: " + file.string());
+            const uint64_t matrixBytes = uint64_t(h.rows) * h.cols * sizeof(float);
+
+            h.numFlags = at<uint32_t>(data + kV1MatrixOffset + matrixBytes);
+            h.payloadBytes = h.vadOffset() + h.numFlags;
+            if (size - kV1MatrixOffset < h.payloadBytes) throw std::runtime_error("Read failed: " + file.string());
+            return;
+        }
+        if (h.version != kVersion) throw std::runtime_error("Unsupported version: " + file.string());
+
+        if (size < kHeaderBytes) throw std::runtime_error("Truncated header: " + file.string());
+        h.encoding = static_cast<Encoding>(at<uint32_t>(data + 12));
+        ct = static_cast<CepstralType>(at<uint32_t>(data + 16));
+        h.rows = at<uint32_t>(data + 20);
+        h.cols = at<uint32_t>(data + 24);
+        h.numFlags = at<uint32_t>(data + 28);
+        h.payloadChecksum = at<uint64_t>(data + 32);
+        h.payloadOffset = at<uint64_t>(data + 40);
+        h.payloadBytes = at<uint64_t>(data + 48);
+
+        if (h.encoding != Encoding::Float32 && h.encoding != Encoding::Float16 && h.encoding != Encoding::Int16)
+            throw std::runtime_error("Unknown feature encoding: " + file.string());
+        if (h.payloadOffset < kHeaderBytes || h.payloadOffset > size || h.matrixOffset() > size - h.payloadOffset
+            || !matrixFits(h.rows, h.cols, h.scalarSize(), size - h.payloadOffset - h.matrixOffset()))
+            throw std::runtime_error("Read failed: " + file.string());
+        if (h.payloadBytes != h.vadOffset() + alignUp((uint64_t(h.numFlags) + 7) / 8, kAlignment))
+            throw std::runtime_error("Inconsistent payload size in file: " + file.string());
+        if (size - h.payloadOffset < h.payloadBytes)
+            throw std::runtime_error("Read failed: " + file.string());
+
+        const char* payload = data + h.payloadOffset;
+        if (util::xxh64(payload, h.payloadBytes) != h.payloadChecksum)
+            throw std::runtime_error("Checksum mismatch: " + file.string());
+
+        Reader options{payload, payload + kOptionsBytes};
+        readFeatureOptions(options, opts);
+    }
 
-        // options
-        FeatureOptions opts{};
-        readFeatureOptions(in, opts);
+    FeatureSerdes::Header FeatureSerdes::readHeader(const fs::path& file) const
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open for read: " + file.string());
+
+        std::array<char, kHeaderBytes + 8> buf{};
+        in.read(buf.data(), (std::streamsize)buf.size());
+        const auto got = static_cast<std::size_t>(in.gcount());
+
+        std::error_code ec;
+        const uint64_t size = fs::file_size(file, ec);
+        if (ec) throw std::runtime_error("Cannot stat: " + file.string());
 
-        // matrix
-        uint32_t rows = 0, cols = 0;
-        readU32(in, rows);
-        readU32(in, cols);
+        if (got < 12 || std::memcmp(buf.data(), kMagic.data(), kMagic.size()) != 0)
+            throw std::runtime_error("Bad magic: " + file.string());
 
-        FeatureMatrix M;
-        M.resize(rows);
-        for (uint32_t i = 0; i < rows; ++i)
+        Header h;
+        h.version = at<uint32_t>(buf.data() + 8);
+        if (h.version == kVersion1)
         {
-            M[i].resize(cols);
-            for (uint32_t j = 0; j < cols; ++j)
-            {
-                float v = 0.f;
-                in.read(reinterpret_cast<char*>(&v), sizeof(v));
-                M[i][j] = v;
-            }
+            if (got < kV1MatrixOffset) throw std::runtime_error("Truncated header: " + file.string());
+            h.rows = at<uint32_t>(buf.data() + kV1MatrixOffset - 8);
+            h.cols = at<uint32_t>(buf.data() + kV1MatrixOffset - 4);
+            h.payloadOffset = kV1MatrixOffset;
+            if (size - kV1MatrixOffset < sizeof(uint32_t)
+                || !matrixFits(h.rows, h.cols, sizeof(float), size - kV1MatrixOffset - sizeof(uint32_t)))
+                throw std::runtime_error("Read failed: " + file.string());
+
+            // the flag count follows the matrix
+            in.clear();
+            in.seekg(static_cast<std::streamoff>(kV1MatrixOffset + uint64_t(h.rows) * h.cols * sizeof(float)));
+            uint32_t n = 0;
+            in.read(reinterpret_cast<char*>(&n), sizeof(n));
+            if (!in) throw std::runtime_error("Read failed: " + file.string());
+            h.numFlags = n;
+            h.payloadBytes = h.vadOffset() + h.numFlags;
+            return h;
         }
+        if (h.version != kVersion) throw std::runtime_error("Unsupported version: " + file.string());
+        if (got < kHeaderBytes) throw std::runtime_error("Truncated header: " + file.string());
+
+        h.encoding = static_cast<Encoding>(at<uint32_t>(buf.data() + 12));
+        h.rows = at<uint32_t>(buf.data() + 20);
+        h.cols = at<uint32_t>(buf.data() + 24);
+        h.numFlags = at<uint32_t>(buf.data() + 28);
+        h.payloadChecksum = at<uint64_t>(buf.data() + 32);
+        h.payloadOffset = at<uint64_t>(buf.data() + 40);
+        h.payloadBytes = at<uint64_t>(buf.data() + 48);
+
+        if (h.encoding != Encoding::Float32 && h.encoding != Encoding::Float16 && h.encoding != Encoding::Int16)
+            throw std::runtime_error("Unknown feature encoding: " + file.string());
+        if (h.payloadOffset > size || h.matrixOffset() > size - h.payloadOffset
+            || !matrixFits(h.rows, h.cols, h.scalarSize(), size - h.payloadOffset - h.matrixOffset()))
+            throw std::runtime_error("Read failed: " + file.string());
+        return h;
+    }
 
-        // VAD flags
-        uint32_t nFlags = 0;
-        readU32(in, nFlags);
+    Feature FeatureSerdes::load(const fs::path& file) const
+    {
+        Feature feat;
+        load(file, feat, sv::util::Workspace::local());
+        return feat;
+    }
 
-        VADFlags flags;
-        flags.resize(nFlags);
+    void FeatureSerdes::load(const fs::path& file, Feature& out, sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("serdes.feature_load");
 
-        for (uint32_t i = 0; i < nFlags; ++i)
+        std::size_t size = 0;
+        const char* data = readFile(file, ws, size);
+
+        Header h;
+        CepstralType ct{};
+        FeatureOptions opts{};
+        parse(data, size, h, ct, opts, file);
+
+        FeatureMatrix& M = out.getComputedMatrix();
+        if (_opt.projection)
+        {
+            const std::size_t D = _opt.projection->outDim();
+            const float* Y = project(data, h, ws, file);
+            ws.resizeMatrix(M, h.rows, D);
+            for (uint32_t i = 0; i < h.rows; ++i) std::memcpy(M[i].data(), Y + i * D, D * sizeof(float));
+        }
+        else
         {
-            uint8_t b = 0;
-            readU8(in, b);
-            flags[i] = static_cast<VADState>(b);
+            ws.resizeMatrix(M, h.rows, h.cols);
+            for (uint32_t i = 0; i < h.rows; ++i) decodeRow(data, h, i, M[i].data());
         }
 
-        if (!in) throw std::runtime_error("Read failed: " + file.string());
+        decodeVad(data, h, ws.vadFlags);
+        SV_COUNTER_ADD("serdes.feature_frames", h.rows);
 
-        // build Feature
-        Feature feat;
-        feat.setCepstralType(ct);
-        feat.setOptions(opts);
-        feat.getComputedMatrix() = std::move(M);
-        feat.setVADFlags(flags);
+        out.setCepstralType(ct);
+        out.setOptions(opts);
+        out.setVADFlags(ws.vadFlags);
+    }
 
-        return feat;
+    const float* FeatureSerdes::loadFrames(const fs::path& file, sv::util::Workspace& ws, std::size_t& T,
+                                           std::size_t& D) const
+    {
+        SV_TRACE_SCOPE("serdes.feature_load_frames");
+
+        std::size_t size = 0;
+        const char* data = readFile(file, ws, size);
+
+        Header h;
+        CepstralType ct{};
+        FeatureOptions opts{};
+        parse(data, size, h, ct, opts, file);
+
+        T = h.rows;
+        D = _opt.projection ? _opt.projection->outDim() : h.cols;
+        decodeVad(data, h, ws.vadFlags);
+        SV_COUNTER_ADD("serdes.feature_frames", h.rows);
+
+        if (_opt.projection) return project(data, h, ws, file);
+        return decodeFrames(data, h, ws.floats(T * D));
     }
 }
@@ -0,0 +1,300 @@
+#include "sv/io/projection_trainer.h"
+
+#include "sv/io/feature_corpus.h"
+#include "sv/io/feature_prefetcher.h"
+#include "sv/util/instrument.h"
+#include "sv/util/linalg.h"
+#include "sv/util/parallel.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+using libvoicefeat::features::Feature;
+
+namespace sv::io
+{
+    namespace
+    {
+        // frames buffered per second-moment update, so the threads are
+        // started once per chunk rather than once per utterance
+        constexpr std::size_t kChunkFrames = 16384;
+
+        // B = L^-1 B for lower-triangular L, column by column (n x n, row-major)
+        void lowerSolveColumns(const double* L, std::size_t n, double* B)
+        {
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const double* row = L + i * n;
+                double* bi = B + i * n;
+                for (std::size_t k = 0; k < i; ++k)
+                {
+                    const double l = row[k];
+                    const double* bk = B + k * n;
+                    #pragma omp simd
+                    for (std::size_t j = 0; j < n; ++j) bi[j] -= l * bk[j];
+                }
+                const double inv = 1.0 / row[i];
+                for (std::size_t j = 0; j < n; ++j) bi[j] *= inv;
+            }
+        }
+
+        // x = L^-T x for lower-triangular L
+        void upperTransposedSolve(const double* L, std::size_t n, double* x)
+        {
+            for (std::size_t i = n; i-- > 0;)
+            {
+                double s = x[i];
+                for (std::size_t k = i + 1; k < n; ++k) s -= L[k * n + i] * x[k];
+                x[i] = s / L[i * n + i];
+            }
+        }
+
+        const char* kindName(FeatureProjection::Kind k)
+        {
+            return k == FeatureProjection::Kind::Lda ? "LDA" : "PCA";
+        }
+    }
+
+    ProjectionTrainer::ProjectionTrainer(Options opt) : _opt(opt) {}
+
+    std::vector<std::size_t> ProjectionTrainer::speakerLabels(const std::vector<fs::path>& files)
+    {
+        std::map<fs::path, std::size_t> ids;
+        for (const auto& f : files) ids.emplace(f.parent_path(), 0);
+
+        std::size_t next = 0;
+        for (auto& [dir, id] : ids) id = next++;
+
+        std::vector<std::size_t> labels;
+        labels.reserve(files.size());
+        for (const auto& f : files) labels.push_back(ids.at(f.parent_path()));
+        return labels;
+    }
+
+    void ProjectionTrainer::checkLabels(std::size_t count, const std::vector<std::size_t>& labels) const
+    {
+        if (_opt.kind == FeatureProjection::Kind::Lda && labels.size() != count)
+            throw std::runtime_error("Projection train: LDA needs one speaker label per utterance");
+        if (!labels.empty() && labels.size() != count)
+            throw std::runtime_error("Projection train: label count mismatch");
+    }
+
+    void ProjectionTrainer::accumulate(const float* X, std::size_t T, std::size_t D, std::size_t label,
+                                       Scatter& s) const
+    {
+        if (T == 0) return;
+        if (s.dim == 0)
+        {
+            s.dim = D;
+            s.sum.assign(D, 0.0);
+            s.second.assign(D * D, 0.0);
+        }
+        if (D != s.dim) throw std::runtime_error("Projection train: feature dim mismatch");
+
+        if (label >= s.classFrames.size())
+        {
+            s.classFrames.resize(label + 1, 0.0);
+            s.classSum.resize((label + 1) * D, 0.0);
+        }
+
+        double* cls = s.classSum.data() + label * D;
+        for (std::size_t t = 0; t < T; ++t)
+        {
+            const float* x = X + t * D;
+            for (std::size_t d = 0; d < D; ++d)
+            {
+                s.sum[d] += x[d];
+                cls[d] += x[d];
+            }
+        }
+        s.frames += static_cast<double>(T);
+        s.classFrames[label] += static_cast<double>(T);
+
+        s.pending.insert(s.pending.end(), X, X + T * D);
+        if (s.pending.size() >= kChunkFrames * D) flush(s);
+    }
+
+    void ProjectionTrainer::flush(Scatter& s) const
+    {
+        const std::size_t D = s.dim;
+        if (D == 0 || s.pending.empty()) return;
+
+        const std::size_t T = s.pending.size() / D;
+        const float* X = s.pending.data();
+
+        // row i of the lower triangle: sum_t x_ti x_t[0..i]
+        sv::util::parallelFor(D, _opt.numThreads, [&](std::size_t i)
+        {
+            double* row = s.second.data() + i * D;
+            for (std::size_t t = 0; t < T; ++t)
+            {
+                const float* x = X + t * D;
+                const double xi = x[i];
+                #pragma omp simd
+                for (std::size_t j = 0; j <= i; ++j) row[j] += xi * static_cast<double>(x[j]);
+            }
+        });
+
+        s.pending.clear();
+    }
+
+    FeatureProjection ProjectionTrainer::train(const std::vector<fs::path>& files, const FeatureSerdes& serdes)
+    {
+        const auto labels = _opt.kind == FeatureProjection::Kind::Lda ? speakerLabels(files)
+                                                                       : std::vector<std::size_t>{};
+        return train(files, labels, serdes);
+    }
+
+    FeatureProjection ProjectionTrainer::train(const std::vector<fs::path>& files,
+                                               const std::vector<std::size_t>& labels, const FeatureSerdes& serdes)
+    {
+        SV_TRACE_SCOPE("projection.train");
+
+        if (serdes.projection()) throw std::runtime_error("Projection train: features must be loaded unprojected");
+        checkLabels(files.size(), labels);
+
+        FeaturePrefetcher::Options po;
+        po.numIoThreads = _opt.numIoThreads;
+        FeaturePrefetcher pf(serdes, files, po);
+
+        auto& ws = sv::util::Workspace::local();
+        Scatter s;
+        Feature f;
+        while (pf.next(f))
+        {
+            std::size_t T = 0, D = 0;
+            const float* X = FeatureCorpus::pack(f, _opt.speechOnly, ws, T, D);
+            accumulate(X, T, D, labels.empty() ? 0 : labels[pf.index()], s);
+        }
+        flush(s);
+
+        return solve(s);
+    }
+
+    FeatureProjection ProjectionTrainer::train(const std::vector<Feature>& feats, const std::vector<std::size_t>& labels)
+    {
+        SV_TRACE_SCOPE("projection.train");
+
+        checkLabels(feats.size(), labels);
+
+        auto& ws = sv::util::Workspace::local();
+        Scatter s;
+        for (std::size_t u = 0; u < feats.size(); ++u)
+        {
+            std::size_t T = 0, D = 0;
+            const float* X = FeatureCorpus::pack(feats[u], _opt.speechOnly, ws, T, D);
+            accumulate(X, T, D, labels.empty() ? 0 : labels[u], s);
+        }
+        flush(s);
+
+        return solve(s);
+    }
+
+    FeatureProjection ProjectionTrainer::solve(const Scatter& s)
+    {
+        const std::size_t D = s.dim;
+        const std::size_t R = _opt.outDim;
+        if (D == 0 || s.frames < 2.0) throw std::runtime_error("Projection train: not enough frames");
+        if (R == 0 || R > D) throw std::runtime_error("Projection train: outDim must be in [1, feature dim]");
+
+        const double N = s.frames;
+        std::vector<double> mean(D);
+        for (std::size_t d = 0; d < D; ++d) mean[d] = s.sum[d] / N;
+
+        // total covariance
+        std::vector<double> C(D * D);
+        for (std::size_t i = 0; i < D; ++i)
+        {
+            for (std::size_t j = 0; j <= i; ++j)
+            {
+                const double c = s.second[i * D + j] / N - mean[i] * mean[j];
+                C[i * D + j] = c;
+                C[j * D + i] = c;
+            }
+        }
+
+        std::vector<double> values(D);
+        std::vector<double> vectors(D * D);
+        std::vector<double> W(R * D);
+
+        if (_opt.kind == FeatureProjection::Kind::Pca)
+        {
+            util::symmetricEigen(C.data(), D, values.data(), vectors.data());
+            std::copy_n(vectors.begin(), R * D, W.begin());
+        }
+        else
+        {
+            std::size_t classes = 0;
+            for (double n : s.classFrames) classes += n > 0.0 ? 1 : 0;
+            if (classes < 2) throw std::runtime_error("Projection train: LDA needs at least two speakers");
+
+            // between-speaker scatter, and within = total - between
+            std::vector<double> Sb(D * D, 0.0);
+            std::vector<double> diff(D);
+            for (std::size_t c = 0; c < s.classFrames.size(); ++c)
+            {
+                const double n = s.classFrames[c];
+                if (n <= 0.0) continue;
+                for (std::size_t d = 0; d < D; ++d) diff[d] = s.classSum[c * D + d] / n - mean[d];
+                const double w = n / N;
+                for (std::size_t i = 0; i < D; ++i)
+                    for (std::size_t j = 0; j < D; ++j) Sb[i * D + j] += w * diff[i] * diff[j];
+            }
+
+            std::vector<double> L(D * D);
+            double trace = 0.0;
+            for (std::size_t i = 0; i < D * D; ++i) L[i] = C[i] - Sb[i];
+            for (std::size_t i = 0; i < D; ++i) trace += L[i * D + i];
+            const double floor = _opt.withinFloor * std::max(trace, 0.0) / static_cast<double>(D);
+            for (std::size_t i = 0; i < D; ++i) L[i * D + i] += floor;
+            if (!util::cholesky(L.data(), D))
+                throw std::runtime_error("Projection train: within-speaker scatter is singular");
+
+            // Sw = L L^T, so Sb w = lambda Sw w becomes the symmetric problem
+            // (L^-1 Sb L^-T) v = lambda v with w = L^-T v
+            lowerSolveColumns(L.data(), D, Sb.data()); // L^-1 Sb
+            for (std::size_t i = 0; i < D; ++i)        // transpose: (L^-1 Sb)^T = Sb L^-T
+                for (std::size_t j = i + 1; j < D; ++j) std::swap(Sb[i * D + j], Sb[j * D + i]);
+            lowerSolveColumns(L.data(), D, Sb.data()); // L^-1 Sb L^-T
+
+            // symmetrize away rounding before the eigensolver
+            for (std::size_t i = 0; i < D; ++i)
+            {
+                for (std::size_t j = i + 1; j < D; ++j)
+                {
+                    const double m = 0.5 * (Sb[i * D + j] + Sb[j * D + i]);
+                    Sb[i * D + j] = m;
+                    Sb[j * D + i] = m;
+                }
+            }
+
+            util::symmetricEigen(Sb.data(), D, values.data(), vectors.data());
+            for (std::size_t r = 0; r < R; ++r)
+            {
+                double* w = W.data() + r * D;
+                std::copy_n(vectors.data() + r * D, D, w);
+                upperTransposedSolve(L.data(), D, w);
+            }
+        }
+
+        double kept = 0.0, total = 0.0;
+        for (std::size_t i = 0; i < D; ++i)
+        {
+            const double v = std::max(values[i], 0.0);
+            total += v;
+            if (i < R) kept += v;
+        }
+        _retained = total > 0.0 ? kept / total : 1.0;
+
+        if (_opt.verbose)
+        {
+            std::cout << "[Projection] " << kindName(_opt.kind) << " " << D << " -> " << R
+                      << " frames=" << static_cast<std::size_t>(N) << " retained=" << _retained << "\n";
+        }
+
+        return FeatureProjection(_opt.kind, D, R, std::move(mean), std::move(W));
+    }
+}
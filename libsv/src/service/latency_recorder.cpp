@@ -0,0 +1,54 @@
+#include "sv/service/latency_recorder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sv::service
+{
+    LatencyRecorder::LatencyRecorder(std::size_t capacity)
+    {
+        if (capacity == 0) throw std::runtime_error("LatencyRecorder: capacity must be > 0");
+        _samplesUs.reserve(capacity);
+    }
+
+    void LatencyRecorder::record(std::chrono::nanoseconds latency)
+    {
+        const double us = static_cast<double>(latency.count()) / 1000.0;
+
+        std::lock_guard lock(_mutex);
+        if (_samplesUs.size() < _samplesUs.capacity())
+        {
+            _samplesUs.push_back(us);
+        }
+        else
+        {
+            _samplesUs[_next] = us;
+            _next = (_next + 1) % _samplesUs.size();
+        }
+        ++_count;
+    }
+
+    LatencyRecorder::Summary LatencyRecorder::summary() const
+    {
+        std::vector<double> v;
+        Summary s;
+        {
+            std::lock_guard lock(_mutex);
+            v = _samplesUs;
+            s.count = _count;
+        }
+        if (v.empty()) return s;
+
+        auto percentile = [&](double q)
+        {
+            const auto idx = static_cast<std::size_t>(q * static_cast<double>(v.size() - 1) + 0.5);
+            std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(idx), v.end());
+            return v[idx];
+        };
+
+        s.p50Us = percentile(0.50);
+        s.p99Us = percentile(0.99);
+        s.maxUs = *std::max_element(v.begin(), v.end());
+        return s;
+    }
+}
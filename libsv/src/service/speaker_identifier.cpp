@@ -0,0 +1,148 @@
+#include "sv/service/speaker_identifier.h"
+
+#include "sv/util/instrument.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace sv::service
+{
+    namespace
+    {
+        sv::gmm::GmmMapAdaptor::Options adaptorOptions(const SpeakerIdentifier::Options& opt)
+        {
+            sv::gmm::GmmMapAdaptor::Options o;
+            o.relevanceFactor = opt.relevanceFactor;
+            return o;
+        }
+
+        sv::gmm::SupervectorExporter::Options exporterOptions(const SpeakerIdentifier::Options& opt)
+        {
+            sv::gmm::SupervectorExporter::Options o;
+            o.projectionDim = opt.projectionDim;
+            o.seed = opt.seed;
+            o.numThreads = opt.numThreads;
+            return o;
+        }
+
+        sv::util::IvfIndex::Options indexOptions(const SpeakerIdentifier::Options& opt)
+        {
+            sv::util::IvfIndex::Options o;
+            o.nlist = opt.nlist;
+            o.nprobe = opt.nprobe;
+            o.seed = opt.seed;
+            o.numThreads = opt.numThreads;
+            return o;
+        }
+    }
+
+    SpeakerIdentifier::SpeakerIdentifier(sv::gmm::ModelRegistry& registry, Options opt)
+        : _registry(registry), _opt(opt), _adaptor(adaptorOptions(opt)),
+          _exporter(registry.ubm()->model, exporterOptions(opt)),
+          _index(_exporter.dim(), indexOptions(opt))
+    {
+        if (_opt.shortlist == 0) throw std::runtime_error("SpeakerIdentifier: shortlist must be > 0");
+    }
+
+    void SpeakerIdentifier::enroll(const std::string& speakerId, const sv::gmm::GmmModel& model)
+    {
+        const auto vec = _exporter.exportModel(model);
+
+        std::unique_lock lock(_mutex);
+        if (_byId.count(speakerId)) throw std::runtime_error("SpeakerIdentifier: speaker already enrolled: " + speakerId);
+
+        if (_index.trained())
+        {
+            _index.add(vec.data());
+        }
+        else
+        {
+            _pending.insert(_pending.end(), vec.begin(), vec.end());
+        }
+
+        _byId.emplace(speakerId, static_cast<uint32_t>(_ids.size()));
+        _ids.push_back(speakerId);
+    }
+
+    void SpeakerIdentifier::train()
+    {
+        std::unique_lock lock(_mutex);
+
+        // the pending supervectors are in enrollment order, so the index
+        // ids line up with _ids
+        const std::size_t n = _pending.size() / _exporter.dim();
+        _index.train(_pending.data(), n);
+        _index.addBatch(_pending.data(), n);
+
+        _pending.clear();
+        _pending.shrink_to_fit();
+    }
+
+    std::size_t SpeakerIdentifier::size() const
+    {
+        std::shared_lock lock(_mutex);
+        return _ids.size();
+    }
+
+    bool SpeakerIdentifier::trained() const
+    {
+        std::shared_lock lock(_mutex);
+        return _index.trained();
+    }
+
+    std::vector<SpeakerIdentifier::Candidate> SpeakerIdentifier::identify(const libvoicefeat::FeatureMatrix& m,
+                                                                          std::size_t topN) const
+    {
+        return identify(m, topN, sv::util::Workspace::local());
+    }
+
+    std::vector<SpeakerIdentifier::Candidate> SpeakerIdentifier::identify(const libvoicefeat::FeatureMatrix& m,
+                                                                          std::size_t topN,
+                                                                          sv::util::Workspace& ws) const
+    {
+        SV_TRACE_SCOPE("identify");
+
+        const auto ubm = _registry.ubm();
+
+        sv::gmm::BwStats stats(ubm->model.numGaussians, ubm->model.dim);
+        _accumulator.accumulate(stats, ubm->precomputed, m, ws);
+        const auto query = _exporter.exportModel(_adaptor.adaptMeansOnly(ubm->model, stats));
+
+        std::vector<sv::util::IvfIndex::Hit> hits;
+        std::vector<std::string> ids;
+        {
+            std::shared_lock lock(_mutex);
+            if (!_index.trained()) throw std::runtime_error("SpeakerIdentifier: index is not trained");
+
+            SV_TRACE_SCOPE("identify.search");
+            _index.search(query.data(), _opt.shortlist, hits);
+            ids.reserve(hits.size());
+            for (const auto& h : hits) ids.push_back(_ids[h.id]);
+        }
+
+        std::vector<Candidate> out;
+        std::vector<sv::gmm::SpeakerModelPtr> models;
+        std::vector<const sv::gmm::PrecomputedGmm*> spks;
+        for (std::size_t i = 0; i < hits.size(); ++i)
+        {
+            auto model = _registry.find(ids[i]);
+            if (!model) continue;
+
+            spks.push_back(model.get());
+            models.push_back(std::move(model));
+            out.push_back(Candidate{std::move(ids[i]), 0.0, hits[i].score});
+        }
+        SV_COUNTER_ADD("identify.rescored", spks.size());
+
+        std::vector<double> llr;
+        _scorer.scoreBatch(spks, ubm->precomputed, m, llr, ws);
+        for (std::size_t i = 0; i < out.size(); ++i) out[i].llr = llr[i];
+
+        const std::size_t n = std::min(topN, out.size());
+        std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(n), out.end(),
+                          [](const Candidate& a, const Candidate& b) { return a.llr > b.llr; });
+        out.resize(n);
+        return out;
+    }
+}
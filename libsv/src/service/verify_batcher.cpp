@@ -0,0 +1,192 @@
+#include "sv/service/verify_batcher.h"
+
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace sv::service
+{
+    VerifyBatcher::VerifyBatcher(sv::gmm::ModelRegistry& registry, Options opt)
+        : _registry(registry), _opt(opt),
+          _pool(opt.topology ? *opt.topology : sv::util::NumaTopology::system(), opt.numThreads),
+          _nodes(_pool.numNodes())
+    {
+        if (_opt.maxBatch == 0) throw std::runtime_error("VerifyBatcher: maxBatch must be > 0");
+        _ubmReplicas.resize(_nodes);
+        _groupsPerNode.resize(_nodes);
+        _scratch.resize(_nodes);
+        _worker = std::thread([this] { run(); });
+    }
+
+    VerifyBatcher::~VerifyBatcher()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        if (_worker.joinable()) _worker.join();
+    }
+
+    std::future<double> VerifyBatcher::submit(std::string speakerId, fs::path featureFile)
+    {
+        Request r;
+        r.speakerId = std::move(speakerId);
+        r.featureFile = std::move(featureFile);
+        auto fut = r.result.get_future();
+
+        {
+            std::lock_guard lock(_mutex);
+            if (_stop) throw std::runtime_error("VerifyBatcher: stopped");
+            _queue.push_back(std::move(r));
+        }
+        _cv.notify_one();
+        return fut;
+    }
+
+    VerifyBatcher::Counters VerifyBatcher::counters() const
+    {
+        std::lock_guard lock(_mutex);
+        return _counters;
+    }
+
+    void VerifyBatcher::run()
+    {
+        for (;;)
+        {
+            std::deque<Request> batch;
+            {
+                std::unique_lock lock(_mutex);
+                _cv.wait(lock, [&] { return _stop || !_queue.empty(); });
+                if (_queue.empty()) return; // stopping and drained
+
+                // the window opens with the first queued request
+                const auto deadline = std::chrono::steady_clock::now() + _opt.maxWait;
+                _cv.wait_until(lock, deadline, [&] { return _stop || _queue.size() >= _opt.maxBatch; });
+
+                const std::size_t n = std::min(_queue.size(), _opt.maxBatch);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    batch.push_back(std::move(_queue.front()));
+                    _queue.pop_front();
+                }
+            }
+
+            processBatch(batch);
+        }
+    }
+
+    std::unique_ptr<VerifyBatcher::Scratch> VerifyBatcher::acquireScratch(std::size_t node)
+    {
+        std::lock_guard lock(_scratchMutex);
+        auto& pool = _scratch[node];
+        if (pool.empty()) return std::make_unique<Scratch>();
+
+        auto s = std::move(pool.back());
+        pool.pop_back();
+        return s;
+    }
+
+    void VerifyBatcher::releaseScratch(std::size_t node, std::unique_ptr<Scratch> s)
+    {
+        s->models.clear(); // do not pin evicted models
+        std::lock_guard lock(_scratchMutex);
+        _scratch[node].push_back(std::move(s));
+    }
+
+    void VerifyBatcher::processBatch(std::deque<Request>& batch)
+    {
+        std::map<fs::path, std::vector<Request*>> byFile;
+        for (auto& r : batch) byFile[r.featureFile].push_back(&r);
+
+        std::vector<std::vector<Request*>*> groups;
+        groups.reserve(byFile.size());
+        for (auto& [file, reqs] : byFile) groups.push_back(&reqs);
+
+        const auto ubm = _registry.ubm();
+        const sv::io::FeatureSerdes features({.projection = ubm->projection});
+
+        if (_nodes == 1)
+        {
+            _pool.run(groups.size(), [&](std::size_t g)
+            {
+                scoreGroup(*groups[g], features, ubm->precomputed, 0);
+            });
+        }
+        else
+        {
+            if (ubm != _replicaOf)
+            {
+                _pool.run(std::vector<std::size_t>(_nodes, 1), [&](std::size_t node, std::size_t)
+                {
+                    _ubmReplicas[node] = ubm->precomputed.copy();
+                });
+                _replicaOf = ubm;
+            }
+
+            // contiguous runs of groups per node
+            for (std::size_t node = 0; node < _nodes; ++node)
+            {
+                _groupsPerNode[node] = sv::util::NumaTopology::shareSize(node, _nodes, groups.size());
+            }
+
+            _pool.run(_groupsPerNode, [&](std::size_t node, std::size_t i)
+            {
+                const std::size_t g = sv::util::NumaTopology::shareBegin(node, _nodes, groups.size()) + i;
+                scoreGroup(*groups[g], features, _ubmReplicas[node], node);
+            });
+        }
+
+        std::lock_guard lock(_mutex);
+        _counters.batches++;
+        _counters.requests += batch.size();
+        _counters.featureLoads += groups.size();
+    }
+
+    void VerifyBatcher::scoreGroup(std::vector<Request*>& reqs, const sv::io::FeatureSerdes& features,
+                                   const sv::gmm::PrecomputedGmm& ubm, std::size_t node)
+    {
+        auto scratch = acquireScratch(node);
+        auto& [ws, feat, models, spks, scored, scores] = *scratch;
+
+        spks.clear();
+        scored.clear();
+
+        try
+        {
+            features.load(reqs.front()->featureFile, feat, ws);
+        }
+        catch (...)
+        {
+            for (auto* r : reqs) r->result.set_exception(std::current_exception());
+            releaseScratch(node, std::move(scratch));
+            return;
+        }
+
+        for (auto* r : reqs)
+        {
+            try
+            {
+                models.push_back(_registry.get(r->speakerId));
+                spks.push_back(models.back().get());
+                scored.push_back(r);
+            }
+            catch (...)
+            {
+                r->result.set_exception(std::current_exception());
+            }
+        }
+
+        try
+        {
+            _scorer.scoreBatch(spks, ubm, feat.getComputedMatrix(), scores, ws);
+            for (std::size_t i = 0; i < scored.size(); ++i) scored[i]->result.set_value(scores[i]);
+        }
+        catch (...)
+        {
+            for (auto* r : scored) r->result.set_exception(std::current_exception());
+        }
+
+        releaseScratch(node, std::move(scratch));
+    }
+}
@@ -0,0 +1,284 @@
+#include "sv/util/instrument.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sv::util
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        struct ScopeStat
+        {
+            std::uint64_t count = 0;
+            std::int64_t totalNs = 0;
+            std::int64_t minNs = std::numeric_limits<std::int64_t>::max();
+            std::int64_t maxNs = 0;
+        };
+
+        struct Event
+        {
+            const char* name;
+            std::int64_t startNs; // since epoch()
+            std::int64_t durNs;
+        };
+
+        // One per thread; the mutex is only contended while exporting.
+        struct ThreadBuffer
+        {
+            std::mutex mutex;
+            std::uint32_t tid = 0;
+            std::unordered_map<const char*, ScopeStat> scopes;
+            std::unordered_map<const char*, std::int64_t> counters;
+            std::vector<Event> events;
+        };
+
+        // What exited threads recorded: their stats summed, their events kept
+        // up to maxEvents in total, so short-lived threads do not pile up.
+        struct Retired
+        {
+            std::unordered_map<const char*, ScopeStat> scopes;
+            std::unordered_map<const char*, std::uint32_t> scopeThreads;
+            std::unordered_map<const char*, std::int64_t> counters;
+            std::vector<std::pair<std::uint32_t, Event>> events; // (tid, event)
+        };
+
+        // Exports hold the mutex throughout, so a thread retiring meanwhile is
+        // seen either live or retired, never both.
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadBuffer>> threads;
+            std::uint32_t nextTid = 0;
+            Retired retired;
+            std::atomic<bool> trace{false};
+            std::atomic<std::size_t> maxEvents{0};
+            Clock::time_point epoch = Clock::now();
+        };
+
+        Registry& registry()
+        {
+            static Registry r;
+            return r;
+        }
+
+        void mergeStat(ScopeStat& into, const ScopeStat& s)
+        {
+            into.count += s.count;
+            into.totalNs += s.totalNs;
+            into.minNs = std::min(into.minNs, s.minNs);
+            into.maxNs = std::max(into.maxNs, s.maxNs);
+        }
+
+        // Registered on first use; on thread exit its contents move into the
+        // registry's totals and the buffer is dropped.
+        struct LocalBuffer
+        {
+            std::shared_ptr<ThreadBuffer> buf = std::make_shared<ThreadBuffer>();
+
+            LocalBuffer()
+            {
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+                buf->tid = r.nextTid++;
+                r.threads.push_back(buf);
+            }
+
+            ~LocalBuffer()
+            {
+                auto& r = registry();
+                std::lock_guard lock(r.mutex);
+                std::lock_guard bufLock(buf->mutex);
+
+                for (const auto& [name, s] : buf->scopes)
+                {
+                    mergeStat(r.retired.scopes[name], s);
+                    r.retired.scopeThreads[name]++;
+                }
+                for (const auto& [name, v] : buf->counters) r.retired.counters[name] += v;
+
+                const std::size_t cap = r.maxEvents.load(std::memory_order_relaxed);
+                for (const auto& e : buf->events)
+                {
+                    if (r.retired.events.size() >= cap) break;
+                    r.retired.events.emplace_back(buf->tid, e);
+                }
+
+                r.threads.erase(std::find(r.threads.begin(), r.threads.end(), buf));
+            }
+        };
+
+        ThreadBuffer& local()
+        {
+            thread_local LocalBuffer buffer;
+            return *buffer.buf;
+        }
+
+        std::string escape(const std::string& s)
+        {
+            std::string out;
+            out.reserve(s.size());
+            for (char c : s)
+            {
+                if (c == '"' || c == '\\') out += '\\';
+                out += c;
+            }
+            return out;
+        }
+    }
+
+    void Instrumentation::enableTrace(bool on, std::size_t maxEventsPerThread)
+    {
+        auto& r = registry();
+        r.maxEvents.store(maxEventsPerThread);
+        r.trace.store(on);
+    }
+
+    void Instrumentation::recordScope(const char* name, Clock::time_point start, Clock::time_point end)
+    {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        auto& buf = local();
+        auto& r = registry();
+
+        std::lock_guard lock(buf.mutex);
+        auto& s = buf.scopes[name];
+        s.count++;
+        s.totalNs += ns;
+        s.minNs = std::min<std::int64_t>(s.minNs, ns);
+        s.maxNs = std::max<std::int64_t>(s.maxNs, ns);
+
+        if (r.trace.load(std::memory_order_relaxed) && buf.events.size() < r.maxEvents.load(std::memory_order_relaxed))
+        {
+            const auto startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - r.epoch).count();
+            buf.events.push_back({name, startNs, ns});
+        }
+    }
+
+    void Instrumentation::addCounter(const char* name, std::int64_t delta)
+    {
+        auto& buf = local();
+        std::lock_guard lock(buf.mutex);
+        buf.counters[name] += delta;
+    }
+
+    std::string Instrumentation::toJson()
+    {
+        struct Merged
+        {
+            ScopeStat stat;
+            std::uint32_t threads = 0;
+        };
+
+        // literals with equal text may live at different addresses; merge by text
+        std::map<std::string, Merged> scopes;
+        std::map<std::string, std::int64_t> counters;
+
+        auto& r = registry();
+        {
+            std::lock_guard registryLock(r.mutex);
+            for (const auto& t : r.threads)
+            {
+                std::lock_guard lock(t->mutex);
+                for (const auto& [name, s] : t->scopes)
+                {
+                    auto& m = scopes[name];
+                    mergeStat(m.stat, s);
+                    m.threads++;
+                }
+                for (const auto& [name, v] : t->counters) counters[name] += v;
+            }
+
+            for (const auto& [name, s] : r.retired.scopes)
+            {
+                auto& m = scopes[name];
+                mergeStat(m.stat, s);
+                m.threads += r.retired.scopeThreads[name];
+            }
+            for (const auto& [name, v] : r.retired.counters) counters[name] += v;
+        }
+
+        std::ostringstream out;
+        out << "{\n  \"scopes\": {";
+        bool first = true;
+        for (const auto& [name, m] : scopes)
+        {
+            out << (first ? "\n" : ",\n") << "    \"" << escape(name) << "\": {"
+                << "\"count\": " << m.stat.count
+                << ", \"total_ms\": " << static_cast<double>(m.stat.totalNs) / 1e6
+                << ", \"min_us\": " << static_cast<double>(m.stat.minNs) / 1e3
+                << ", \"max_us\": " << static_cast<double>(m.stat.maxNs) / 1e3
+                << ", \"threads\": " << m.threads << "}";
+            first = false;
+        }
+        out << "\n  },\n  \"counters\": {";
+        first = true;
+        for (const auto& [name, v] : counters)
+        {
+            out << (first ? "\n" : ",\n") << "    \"" << escape(name) << "\": " << v;
+            first = false;
+        }
+        out << "\n  }\n}\n";
+        return out.str();
+    }
+
+    void Instrumentation::writeJson(const fs::path& file)
+    {
+        if (file.has_parent_path()) fs::create_directories(file.parent_path());
+        std::ofstream out(file);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+        out << toJson();
+    }
+
+    void Instrumentation::writeChromeTrace(const fs::path& file)
+    {
+        if (file.has_parent_path()) fs::create_directories(file.parent_path());
+        std::ofstream out(file);
+        if (!out) throw std::runtime_error("Cannot open for write: " + file.string());
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        const auto write = [&](std::uint32_t tid, const Event& e)
+        {
+            out << (first ? "\n" : ",\n")
+                << "{\"name\":\"" << escape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << static_cast<double>(e.startNs) / 1e3
+                << ",\"dur\":" << static_cast<double>(e.durNs) / 1e3 << "}";
+            first = false;
+        };
+
+        auto& r = registry();
+        std::lock_guard registryLock(r.mutex);
+        for (const auto& [tid, e] : r.retired.events) write(tid, e);
+        for (const auto& t : r.threads)
+        {
+            std::lock_guard lock(t->mutex);
+            for (const auto& e : t->events) write(t->tid, e);
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+    void Instrumentation::reset()
+    {
+        auto& r = registry();
+        std::lock_guard registryLock(r.mutex);
+        for (const auto& t : r.threads)
+        {
+            std::lock_guard lock(t->mutex);
+            t->scopes.clear();
+            t->counters.clear();
+            t->events.clear();
+        }
+        r.retired = Retired{};
+    }
+}
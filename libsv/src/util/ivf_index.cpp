@@ -0,0 +1,198 @@
+#include "sv/util/ivf_index.h"
+
+#include "sv/util/instrument.h"
+#include "sv/util/kmeans.h"
+#include "sv/util/parallel.h"
+#include "sv/util/workspace.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace sv::util
+{
+    namespace
+    {
+        float dot(const float* a, const float* b, std::size_t D)
+        {
+            float s = 0.0f;
+            #pragma omp simd reduction(+:s)
+            for (std::size_t d = 0; d < D; ++d) s += a[d] * b[d];
+            return s;
+        }
+
+        // min-heap on score: the root is the weakest of the current top k
+        bool heapOrder(const IvfIndex::Hit& a, const IvfIndex::Hit& b)
+        {
+            return a.score > b.score || (a.score == b.score && a.id < b.id);
+        }
+
+        void pushHit(std::vector<IvfIndex::Hit>& heap, std::size_t k, IvfIndex::Hit h)
+        {
+            if (heap.size() < k)
+            {
+                heap.push_back(h);
+                std::push_heap(heap.begin(), heap.end(), heapOrder);
+            }
+            else if (heapOrder(h, heap.front()))
+            {
+                std::pop_heap(heap.begin(), heap.end(), heapOrder);
+                heap.back() = h;
+                std::push_heap(heap.begin(), heap.end(), heapOrder);
+            }
+        }
+    }
+
+    IvfIndex::IvfIndex(std::size_t dim, Options opt) : _opt(opt), _dim(dim)
+    {
+        if (_dim == 0) throw std::runtime_error("IVF: dim must be > 0");
+        if (_opt.nlist == 0) throw std::runtime_error("IVF: nlist must be > 0");
+    }
+
+    void IvfIndex::train(const float* X, std::size_t n)
+    {
+        SV_TRACE_SCOPE("ivf.train");
+
+        if (_dim == 0) throw std::runtime_error("IVF: index is empty");
+        if (n == 0) throw std::runtime_error("IVF: no training vectors");
+
+        const std::size_t M = std::min(_opt.nlist, n);
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::size_t sample = n;
+        if (_opt.trainPointsPerList != 0 && M * _opt.trainPointsPerList < n)
+        {
+            sample = M * _opt.trainPointsPerList;
+            std::mt19937 rng(_opt.seed);
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+
+        std::vector<double> P(sample * _dim);
+        for (std::size_t i = 0; i < sample; ++i)
+        {
+            std::copy_n(X + order[i] * _dim, _dim, P.data() + i * _dim);
+        }
+
+        KMeans::Options ko;
+        ko.iterations = _opt.kmeansIterations;
+        ko.seed = _opt.seed;
+        ko.numThreads = _opt.numThreads;
+        const auto C = KMeans(ko).fit(P.data(), sample, _dim, M);
+
+        _centroids.assign(C.begin(), C.end());
+        _centroidNorms.resize(M);
+        for (std::size_t c = 0; c < M; ++c)
+        {
+            const float* row = _centroids.data() + c * _dim;
+            _centroidNorms[c] = dot(row, row, _dim);
+        }
+
+        _lists.assign(M, List{});
+        _size = 0;
+    }
+
+    std::size_t IvfIndex::nearestList(const float* v) const
+    {
+        // |v - c|^2 = |v|^2 - 2 v.c + |c|^2; |v|^2 is the same for every c
+        std::size_t best = 0;
+        float bestDist = std::numeric_limits<float>::infinity();
+        for (std::size_t c = 0; c < _lists.size(); ++c)
+        {
+            const float dist = _centroidNorms[c] - 2.0f * dot(v, _centroids.data() + c * _dim, _dim);
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    uint32_t IvfIndex::addBatch(const float* X, std::size_t n)
+    {
+        SV_TRACE_SCOPE("ivf.add");
+
+        if (!trained()) throw std::runtime_error("IVF: index is not trained");
+        if (_size + n > std::numeric_limits<uint32_t>::max()) throw std::runtime_error("IVF: too many vectors");
+
+        // assignment in parallel, insertion in order so ids and list layout
+        // do not depend on numThreads
+        std::vector<uint32_t> assign(n);
+        parallelFor(n, _opt.numThreads, [&](std::size_t i)
+        {
+            assign[i] = static_cast<uint32_t>(nearestList(X + i * _dim));
+        });
+
+        const auto first = static_cast<uint32_t>(_size);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            List& list = _lists[assign[i]];
+            list.vectors.insert(list.vectors.end(), X + i * _dim, X + (i + 1) * _dim);
+            list.ids.push_back(first + static_cast<uint32_t>(i));
+        }
+        _size += n;
+        return first;
+    }
+
+    void IvfIndex::scanList(const List& list, const float* q, std::size_t k, std::vector<Hit>& heap) const
+    {
+        const std::size_t count = list.ids.size();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            pushHit(heap, k, Hit{dot(q, list.vectors.data() + i * _dim, _dim), list.ids[i]});
+        }
+    }
+
+    void IvfIndex::search(const float* q, std::size_t k, std::vector<Hit>& out) const
+    {
+        SV_TRACE_SCOPE("ivf.search");
+
+        if (!trained()) throw std::runtime_error("IVF: index is not trained");
+
+        out.clear();
+        if (k == 0) return;
+
+        const std::size_t M = _lists.size();
+        const std::size_t probes = std::clamp<std::size_t>(_opt.nprobe, 1, M);
+
+        auto& ws = Workspace::local();
+        double* dist = ws.logp(M);
+        uint32_t* order = ws.indices(M);
+        for (std::size_t c = 0; c < M; ++c)
+        {
+            dist[c] = _centroidNorms[c] - 2.0f * dot(q, _centroids.data() + c * _dim, _dim);
+            order[c] = static_cast<uint32_t>(c);
+        }
+        std::partial_sort(order, order + probes, order + M, [&](uint32_t a, uint32_t b)
+        {
+            return dist[a] < dist[b] || (dist[a] == dist[b] && a < b);
+        });
+
+        out.reserve(k);
+        for (std::size_t p = 0; p < probes; ++p) scanList(_lists[order[p]], q, k, out);
+        std::sort_heap(out.begin(), out.end(), heapOrder);
+    }
+
+    void IvfIndex::searchBatch(const float* Q, std::size_t nq, std::size_t k,
+                               std::vector<std::vector<Hit>>& out) const
+    {
+        out.resize(nq);
+        parallelFor(nq, _opt.numThreads, [&](std::size_t i)
+        {
+            search(Q + i * _dim, k, out[i]);
+        });
+    }
+
+    void IvfIndex::searchExact(const float* q, std::size_t k, std::vector<Hit>& out) const
+    {
+        out.clear();
+        if (k == 0) return;
+
+        out.reserve(k);
+        for (const auto& list : _lists) scanList(list, q, k, out);
+        std::sort_heap(out.begin(), out.end(), heapOrder);
+    }
+}
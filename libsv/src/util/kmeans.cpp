@@ -0,0 +1,153 @@
+#include "sv/util/kmeans.h"
+
+#include "sv/util/parallel.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace sv::util
+{
+    namespace
+    {
+        // points per assignment task
+        constexpr std::size_t kAssignBlock = 256;
+    }
+
+    KMeans::KMeans(Options opt) : _opt(opt)
+    {
+    }
+
+    double KMeans::squaredDistance(const double* a, const double* b, std::size_t D)
+    {
+        double s = 0.0;
+        #pragma omp simd reduction(+:s)
+        for (std::size_t d = 0; d < D; ++d)
+        {
+            const double diff = a[d] - b[d];
+            s += diff * diff;
+        }
+        return s;
+    }
+
+    std::size_t KMeans::nearest(const double* x, const double* C, std::size_t M, std::size_t D)
+    {
+        std::size_t best = 0;
+        double bestDist = std::numeric_limits<double>::infinity();
+        for (std::size_t c = 0; c < M; ++c)
+        {
+            const double dist = squaredDistance(x, C + c * D, D);
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    std::vector<double> KMeans::seed(const double* P, std::size_t n, std::size_t D, std::size_t M) const
+    {
+        if (n == 0 || D == 0 || M == 0) throw std::runtime_error("k-means: empty input");
+
+        std::mt19937 rng(_opt.seed);
+        std::vector<double> C(M * D);
+
+        const std::size_t blocks = (n + kAssignBlock - 1) / kAssignBlock;
+        std::vector<double> minDist(n, std::numeric_limits<double>::infinity());
+        std::vector<double> blockSum(blocks);
+        std::size_t pick = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+
+        for (std::size_t c = 0; c < M; ++c)
+        {
+            std::copy_n(P + pick * D, D, C.data() + c * D);
+            if (c + 1 == M) break;
+
+            const double* centre = C.data() + c * D;
+            parallelFor(blocks, _opt.numThreads, [&](std::size_t b)
+            {
+                const std::size_t end = std::min(n, (b + 1) * kAssignBlock);
+                double sum = 0.0;
+                for (std::size_t k = b * kAssignBlock; k < end; ++k)
+                {
+                    minDist[k] = std::min(minDist[k], squaredDistance(P + k * D, centre, D));
+                    sum += minDist[k];
+                }
+                blockSum[b] = sum;
+            });
+
+            const double total = std::accumulate(blockSum.begin(), blockSum.end(), 0.0);
+            if (total <= 0.0)
+            {
+                // fewer distinct points than clusters
+                pick = std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+                continue;
+            }
+
+            // find the block holding the draw, then the point within it
+            double r = std::uniform_real_distribution<double>(0.0, total)(rng);
+            std::size_t b = 0;
+            while (b + 1 < blocks && r > blockSum[b]) r -= blockSum[b++];
+
+            const std::size_t end = std::min(n, (b + 1) * kAssignBlock);
+            pick = end - 1;
+            for (std::size_t k = b * kAssignBlock; k < end; ++k)
+            {
+                r -= minDist[k];
+                if (r <= 0.0)
+                {
+                    pick = k;
+                    break;
+                }
+            }
+        }
+
+        return C;
+    }
+
+    std::vector<double> KMeans::fit(const double* P, std::size_t n, std::size_t D, std::size_t M) const
+    {
+        std::vector<double> C = seed(P, n, D, M);
+
+        std::vector<std::size_t> assign(n);
+        std::vector<char> blockChanged((n + kAssignBlock - 1) / kAssignBlock);
+        std::vector<double> sum(M * D);
+        std::vector<std::size_t> count(M);
+
+        for (std::size_t it = 0; it < _opt.iterations; ++it)
+        {
+            parallelFor(blockChanged.size(), _opt.numThreads, [&](std::size_t b)
+            {
+                bool changed = false;
+                const std::size_t end = std::min(n, (b + 1) * kAssignBlock);
+                for (std::size_t k = b * kAssignBlock; k < end; ++k)
+                {
+                    const std::size_t best = nearest(P + k * D, C.data(), M, D);
+                    changed |= (it == 0 || assign[k] != best);
+                    assign[k] = best;
+                }
+                blockChanged[b] = changed;
+            });
+            if (std::none_of(blockChanged.begin(), blockChanged.end(), [](char c) { return c != 0; })) break;
+
+            std::fill(sum.begin(), sum.end(), 0.0);
+            std::fill(count.begin(), count.end(), 0);
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                count[assign[k]]++;
+                for (std::size_t d = 0; d < D; ++d) sum[assign[k] * D + d] += P[k * D + d];
+            }
+
+            // an empty cluster keeps its previous centroid
+            for (std::size_t c = 0; c < M; ++c)
+            {
+                if (count[c] == 0) continue;
+                for (std::size_t d = 0; d < D; ++d) C[c * D + d] = sum[c * D + d] / static_cast<double>(count[c]);
+            }
+        }
+
+        return C;
+    }
+}
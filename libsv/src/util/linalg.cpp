@@ -0,0 +1,164 @@
+#include "sv/util/linalg.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace sv::util
+{
+    void unpackSymmetric(const double* packed, std::size_t n, double* full)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const double* row = packed + packedIndex(i, 0);
+            for (std::size_t j = 0; j <= i; ++j)
+            {
+                full[i * n + j] = row[j];
+                full[j * n + i] = row[j];
+            }
+        }
+    }
+
+    bool cholesky(double* A, std::size_t n)
+    {
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            double* rowJ = A + j * n;
+
+            double d = rowJ[j];
+            for (std::size_t k = 0; k < j; ++k) d -= rowJ[k] * rowJ[k];
+            if (!(d > 0.0)) return false;
+            d = std::sqrt(d);
+            rowJ[j] = d;
+
+            const double inv = 1.0 / d;
+            for (std::size_t i = j + 1; i < n; ++i)
+            {
+                double* rowI = A + i * n;
+                double s = rowI[j];
+                #pragma omp simd reduction(+:s)
+                for (std::size_t k = 0; k < j; ++k) s -= rowI[k] * rowJ[k];
+                rowI[j] = s * inv;
+            }
+
+            for (std::size_t k = j + 1; k < n; ++k) rowJ[k] = 0.0;
+        }
+        return true;
+    }
+
+    void choleskySolve(const double* L, std::size_t n, double* b)
+    {
+        // L y = b
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const double* row = L + i * n;
+            double s = b[i];
+            #pragma omp simd reduction(+:s)
+            for (std::size_t k = 0; k < i; ++k) s -= row[k] * b[k];
+            b[i] = s / row[i];
+        }
+
+        // L^T x = y
+        for (std::size_t i = n; i-- > 0;)
+        {
+            double s = b[i];
+            for (std::size_t k = i + 1; k < n; ++k) s -= L[k * n + i] * b[k];
+            b[i] = s / L[i * n + i];
+        }
+    }
+
+    void choleskyInversePacked(const double* L, std::size_t n, double* packed, double* scratch)
+    {
+        // column j of the inverse solves L L^T x = e_j; only rows >= j are kept
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            // L y = e_j: y is zero above row j
+            for (std::size_t i = 0; i < j; ++i) scratch[i] = 0.0;
+            for (std::size_t i = j; i < n; ++i)
+            {
+                const double* row = L + i * n;
+                double s = i == j ? 1.0 : 0.0;
+                #pragma omp simd reduction(+:s)
+                for (std::size_t k = j; k < i; ++k) s -= row[k] * scratch[k];
+                scratch[i] = s / row[i];
+            }
+
+            // L^T x = y, down to row j
+            for (std::size_t i = n; i-- > j;)
+            {
+                double s = scratch[i];
+                for (std::size_t k = i + 1; k < n; ++k) s -= L[k * n + i] * scratch[k];
+                scratch[i] = s / L[i * n + i];
+                packed[packedIndex(i, j)] = scratch[i];
+            }
+        }
+    }
+
+    void symmetricEigen(double* A, std::size_t n, double* values, double* vectors)
+    {
+        // V accumulates the rotations by columns: A_0 = V diag V^T
+        std::vector<double> V(n * n, 0.0);
+        for (std::size_t i = 0; i < n; ++i) V[i * n + i] = 1.0;
+
+        double total = 0.0;
+        for (std::size_t i = 0; i < n * n; ++i) total += A[i] * A[i];
+
+        for (int sweep = 0; sweep < 100; ++sweep)
+        {
+            double off = 0.0;
+            for (std::size_t p = 0; p < n; ++p)
+                for (std::size_t q = p + 1; q < n; ++q) off += A[p * n + q] * A[p * n + q];
+            if (off <= 1e-30 * total) break;
+
+            for (std::size_t p = 0; p < n; ++p)
+            {
+                for (std::size_t q = p + 1; q < n; ++q)
+                {
+                    const double apq = A[p * n + q];
+                    if (apq == 0.0) continue;
+
+                    // rotation angle that zeroes A[p][q]
+                    const double theta = (A[q * n + q] - A[p * n + p]) / (2.0 * apq);
+                    const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                    const double c = 1.0 / std::sqrt(t * t + 1.0);
+                    const double s = t * c;
+
+                    for (std::size_t k = 0; k < n; ++k)
+                    {
+                        const double akp = A[k * n + p];
+                        const double akq = A[k * n + q];
+                        A[k * n + p] = c * akp - s * akq;
+                        A[k * n + q] = s * akp + c * akq;
+                    }
+                    for (std::size_t k = 0; k < n; ++k)
+                    {
+                        const double apk = A[p * n + k];
+                        const double aqk = A[q * n + k];
+                        A[p * n + k] = c * apk - s * aqk;
+                        A[q * n + k] = s * apk + c * aqk;
+                    }
+                    for (std::size_t k = 0; k < n; ++k)
+                    {
+                        const double vkp = V[k * n + p];
+                        const double vkq = V[k * n + q];
+                        V[k * n + p] = c * vkp - s * vkq;
+                        V[k * n + q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) { return A[a * n + a] > A[b * n + b]; });
+
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            const std::size_t j = order[i];
+            values[i] = A[j * n + j];
+            for (std::size_t k = 0; k < n; ++k) vectors[i * n + k] = V[k * n + j];
+        }
+    }
+}
@@ -0,0 +1,233 @@
+#include "sv/util/numa.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace sv::util
+{
+    namespace
+    {
+        // "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+        std::vector<unsigned> parseCpuList(const std::string& text)
+        {
+            std::vector<unsigned> cpus;
+            std::stringstream ss(text);
+            std::string range;
+            while (std::getline(ss, range, ','))
+            {
+                range.erase(std::remove_if(range.begin(), range.end(), [](unsigned char c) { return std::isspace(c); }),
+                            range.end());
+                if (range.empty()) continue;
+
+                const auto dash = range.find('-');
+                const auto first = static_cast<unsigned>(std::stoul(range.substr(0, dash)));
+                const auto last = dash == std::string::npos ? first
+                                                            : static_cast<unsigned>(std::stoul(range.substr(dash + 1)));
+                for (unsigned c = first; c <= last; ++c) cpus.push_back(c);
+            }
+            return cpus;
+        }
+
+        // CPUs this process may run on (every hardware thread when unknown)
+        std::vector<unsigned> allowedCpus()
+        {
+            std::vector<unsigned> cpus;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            {
+                for (unsigned c = 0; c < CPU_SETSIZE; ++c)
+                    if (CPU_ISSET(c, &set)) cpus.push_back(c);
+            }
+#endif
+            if (cpus.empty())
+            {
+                const auto n = static_cast<unsigned>(resolveNumThreads(0));
+                for (unsigned c = 0; c < n; ++c) cpus.push_back(c);
+            }
+            return cpus;
+        }
+    }
+
+    const NumaTopology& NumaTopology::system()
+    {
+        static const NumaTopology topo = []
+        {
+            auto t = fromSysfs("/sys/devices/system/node");
+            return t.numNodes() > 1 ? t : singleNode();
+        }();
+        return topo;
+    }
+
+    NumaTopology NumaTopology::fromSysfs(const fs::path& root)
+    {
+        const auto allowed = allowedCpus();
+        const std::set<unsigned> usable(allowed.begin(), allowed.end());
+
+        NumaTopology t;
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(root, ec))
+        {
+            const auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4) continue;
+            if (!std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c); })) continue;
+
+            std::ifstream in(entry.path() / "cpulist");
+            std::string text;
+            if (!in || !std::getline(in, text)) continue;
+
+            Node n;
+            n.id = std::stoul(name.substr(4));
+            for (unsigned c : parseCpuList(text))
+                if (usable.count(c)) n.cpus.push_back(c);
+            if (!n.cpus.empty()) t._nodes.push_back(std::move(n));
+        }
+
+        std::sort(t._nodes.begin(), t._nodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+        return t;
+    }
+
+    NumaTopology NumaTopology::singleNode()
+    {
+        NumaTopology t;
+        t._nodes.push_back(Node{0, allowedCpus()});
+        return t;
+    }
+
+    NumaTopology NumaTopology::emulated(std::size_t nodes)
+    {
+        const auto cpus = allowedCpus();
+
+        NumaTopology t;
+        t._nodes.resize(std::max<std::size_t>(1, nodes));
+        for (std::size_t g = 0; g < t._nodes.size(); ++g) t._nodes[g].id = g;
+
+        const std::size_t slots = std::max(cpus.size(), t._nodes.size());
+        for (std::size_t i = 0; i < slots; ++i)
+        {
+            auto& n = t._nodes[i % t._nodes.size()];
+            const unsigned c = cpus[i % cpus.size()];
+            if (std::find(n.cpus.begin(), n.cpus.end(), c) == n.cpus.end()) n.cpus.push_back(c);
+        }
+        return t;
+    }
+
+    std::size_t NumaTopology::activeNodes(std::size_t numThreads) const
+    {
+        return std::max<std::size_t>(1, std::min(numNodes(), resolveNumThreads(numThreads)));
+    }
+
+    bool pinToNode(const NumaTopology::Node& node)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned c : node.cpus)
+            if (c < CPU_SETSIZE) CPU_SET(c, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        (void)node;
+        return false;
+#endif
+    }
+
+    NodeThreadPool::NodeThreadPool(const NumaTopology& topo, std::size_t numThreads)
+        : _threads(resolveNumThreads(numThreads)), _nodes(topo.activeNodes(numThreads))
+    {
+        _next = std::make_unique<std::atomic<std::size_t>[]>(_nodes);
+        if (_threads == 1) return; // runs on the caller
+
+        _workers.reserve(std::max(_threads, _nodes));
+        for (std::size_t g = 0; g < _nodes; ++g)
+        {
+            const std::size_t onNode = std::max<std::size_t>(1, NumaTopology::shareSize(g, _nodes, _threads));
+            for (std::size_t t = 0; t < onNode; ++t) _workers.emplace_back(&NodeThreadPool::loop, this, g, topo.node(g));
+        }
+    }
+
+    NodeThreadPool::~NodeThreadPool()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (auto& th : _workers) th.join();
+    }
+
+    void NodeThreadPool::loop(std::size_t g, NumaTopology::Node node)
+    {
+        pinToNode(node);
+
+        std::uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock lock(_mutex);
+                _wake.wait(lock, [&] { return _stop || _generation != seen; });
+                if (_stop) return;
+                seen = _generation;
+            }
+
+            work(g);
+
+            std::lock_guard lock(_mutex);
+            if (--_busy == 0) _done.notify_one();
+        }
+    }
+
+    void NodeThreadPool::work(std::size_t g)
+    {
+        const std::size_t slot = _job.flat ? 0 : g;
+        if (slot >= _job.groups) return;
+
+        const std::size_t n = _job.counts[slot];
+        try
+        {
+            for (std::size_t i = _next[slot].fetch_add(1); i < n; i = _next[slot].fetch_add(1)) _job.call(_job.fn, g, i);
+        }
+        catch (...)
+        {
+            std::lock_guard lock(_errorMutex);
+            if (!_error) _error = std::current_exception();
+            for (std::size_t h = 0; h < _job.groups; ++h) _next[h].store(_job.counts[h]);
+        }
+    }
+
+    void NodeThreadPool::dispatch(const std::size_t* counts, std::size_t groups, bool flat, Call call, void* fn)
+    {
+        if (groups > _nodes) throw std::runtime_error("NodeThreadPool: more node groups than nodes");
+
+        std::lock_guard run(_runMutex);
+
+        _job = Job{counts, groups, flat, call, fn};
+        for (std::size_t g = 0; g < _nodes; ++g) _next[g].store(0);
+        _error = nullptr;
+
+        if (_workers.empty())
+        {
+            for (std::size_t g = 0; g < groups; ++g) work(g);
+        }
+        else
+        {
+            std::unique_lock lock(_mutex);
+            _busy = _workers.size();
+            _generation++;
+            _wake.notify_all();
+            _done.wait(lock, [&] { return _busy == 0; });
+        }
+
+        if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+    }
+}
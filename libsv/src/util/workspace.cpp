@@ -0,0 +1,71 @@
+#include "sv/util/workspace.h"
+
+namespace sv::util
+{
+    Workspace& Workspace::local()
+    {
+        thread_local Workspace ws;
+        return ws;
+    }
+
+    double* Workspace::logp(std::size_t n)
+    {
+        if (_logp.size() < n) _logp.resize(n);
+        return _logp.data();
+    }
+
+    double* Workspace::logpAux(std::size_t n)
+    {
+        if (_logpAux.size() < n) _logpAux.resize(n);
+        return _logpAux.data();
+    }
+
+    std::uint32_t* Workspace::indices(std::size_t n)
+    {
+        if (_indices.size() < n) _indices.resize(n);
+        return _indices.data();
+    }
+
+    float* Workspace::floats(std::size_t n)
+    {
+        if (_floats.size() < n) _floats.resize(n);
+        return _floats.data();
+    }
+
+    float* Workspace::floatsAux(std::size_t n)
+    {
+        if (_floatsAux.size() < n) _floatsAux.resize(n);
+        return _floatsAux.data();
+    }
+
+    char* Workspace::bytes(std::size_t n)
+    {
+        if (_bytes.size() < n) _bytes.resize(n);
+        return _bytes.data();
+    }
+
+    void Workspace::resizeMatrix(libvoicefeat::FeatureMatrix& m, std::size_t rows, std::size_t cols)
+    {
+        while (m.size() > rows)
+        {
+            _spareRows.push_back(std::move(m.back()));
+            m.pop_back();
+        }
+
+        if (m.capacity() < rows) m.reserve(rows);
+        while (m.size() < rows)
+        {
+            if (_spareRows.empty())
+            {
+                m.emplace_back();
+            }
+            else
+            {
+                m.push_back(std::move(_spareRows.back()));
+                _spareRows.pop_back();
+            }
+        }
+
+        for (auto& row : m) row.resize(cols);
+    }
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Compare two Google Benchmark JSON outputs of libsv_bench.
+
+    libsv_bench --benchmark_out=new.json --benchmark_out_format=json
+    python3 scripts/bench_compare.py base.json new.json --threshold 0.10
+
+Prints per-benchmark time and throughput deltas and exits with status 1 if any
+benchmark got slower than the threshold (relative, on real_time) or reported an
+error in the candidate run (e.g. a failed equivalence check). Both runs should
+come from the same machine; warns when their host, CPU count or Google
+Benchmark library build type differ.
+"""
+import argparse
+import json
+import sys
+from pathlib import Path
+
+RATE_COUNTERS = ("frames/s", "speakers/s", "models/s", "utts/s", "queries/s", "trials/s", "bytes_per_second")
+
+
+def load(path: Path):
+    with path.open() as f:
+        data = json.load(f)
+    out = {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        out[b["name"]] = b
+    return data.get("context", {}), out
+
+
+def rate(b: dict):
+    for key in RATE_COUNTERS:
+        if key in b:
+            return key, float(b[key])
+    return None, None
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare libsv_bench JSON results")
+    ap.add_argument("baseline", type=Path)
+    ap.add_argument("candidate", type=Path)
+    ap.add_argument("--threshold", type=float, default=0.10,
+                    help="relative slowdown that counts as a regression (default 0.10)")
+    args = ap.parse_args()
+
+    base_ctx, base = load(args.baseline)
+    cand_ctx, cand = load(args.candidate)
+
+    for key, what in (("host_name", "hosts"), ("num_cpus", "CPU counts"),
+                      ("library_build_type", "benchmark library build types")):
+        bv, cv = base_ctx.get(key, "?"), cand_ctx.get(key, "?")
+        if bv != cv:
+            print(f"warning: {what} differ (baseline {bv}, candidate {cv})", file=sys.stderr)
+
+    regressions = []
+    errors = []
+    print(f"{'benchmark':<48} {'base':>12} {'new':>12} {'time':>8} {'rate':>8}")
+    for name in sorted(set(base) | set(cand)):
+        if name in cand and cand[name].get("error_occurred"):
+            print(f"{name:<48} {'ERROR: ' + cand[name].get('error_message', ''):>42}")
+            errors.append(name)
+            continue
+        if name not in base or name not in cand:
+            print(f"{name:<48} {'(only in ' + ('baseline' if name in base else 'candidate') + ')':>42}")
+            continue
+
+        b, c = base[name], cand[name]
+        if b.get("error_occurred"):
+            print(f"{name:<48} {'(error in baseline)':>42}")
+            continue
+
+        bt, ct = float(b["real_time"]), float(c["real_time"])
+        unit = b.get("time_unit", "ns")
+        dt = (ct - bt) / bt if bt > 0 else 0.0
+
+        key, br = rate(b)
+        _, cr = rate(c)
+        dr = f"{(cr - br) / br:+.1%}" if key and br else ""
+
+        print(f"{name:<48} {bt:>10.0f}{unit:>2} {ct:>10.0f}{unit:>2} {dt:>+8.1%} {dr:>8}")
+        if dt > args.threshold:
+            regressions.append((name, dt))
+
+    if errors:
+        print(f"\n{len(errors)} benchmark(s) reported an error:")
+        for name in errors:
+            print(f"  {name}")
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) above {args.threshold:.0%}:")
+        for name, dt in regressions:
+            print(f"  {name}: {dt:+.1%}")
+    if errors or regressions:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -7,100 +7,174 @@ CEPS_TYPES = {0: "MFCC", 1: "LFCC", 2: "GFCC", 3: "PNCC", 4: "PLP"}
 FILTERBANK_TYPES = {0: "Mel", 1: "Linear", 2: "Gammatone", 3: "Bark"}
 MEL_SCALES = {0: "HTK", 1: "Slaney"}
 COMPRESSION_TYPES = {0: "Log", 1: "PowerNormalized", 2: "CubeRoot"}
-
-def read_u32(f) -> int:
-    return struct.unpack("<I", f.read(4))[0]
-
-def read_i32(f) -> int:
-    return struct.unpack("<i", f.read(4))[0]
-
-def read_f64(f) -> float:
-    return struct.unpack("<d", f.read(8))[0]
-
-def read_u8(f) -> int:
-    return struct.unpack("<B", f.read(1))[0]
-
-def inspect_lvf(path: Path, max_rows_print: int = 5, max_cols_print: int = 10, full_matrix: bool = False):
-    with path.open("rb") as f:
-        magic = f.read(8)
-        version = read_u32(f)
-
-        print(f"File: {path}")
-        print(f"Magic: {magic!r}")
-        print(f"Version: {version}")
-
-        if magic != b"LVFEAT\x00\x00":
-            raise RuntimeError("Bad magic. This doesn't look like an .lvf written by FeatureSerdes.")
-        if version != 1:
-            raise RuntimeError(f"Unsupported version: {version}")
-
-        cep_u32 = read_u32(f)
-        print(f"CepstralType: {cep_u32} ({CEPS_TYPES.get(cep_u32, 'UNKNOWN')})")
-
-        sample_rate = read_i32(f)
-        num_filters = read_i32(f)
-        num_coeffs  = read_i32(f)
-        min_freq = read_f64(f)
-        max_freq = read_f64(f)
-        include_energy = read_u8(f)
-        filterbank = read_u32(f)
-        mel_scale = read_u32(f)
-        compression = read_u32(f)
-
-        print("\nFeatureOptions:")
-        print(f"  sampleRate: {sample_rate}")
-        print(f"  numFilters: {num_filters}")
-        print(f"  numCoeffs:  {num_coeffs}")
-        print(f"  minFreq:    {min_freq}")
-        print(f"  maxFreq:    {max_freq}")
-        print(f"  includeEnergy: {bool(include_energy)}")
-        print(f"  filterbank: {filterbank} ({FILTERBANK_TYPES.get(filterbank, 'UNKNOWN')})")
-        print(f"  melScale:   {mel_scale} ({MEL_SCALES.get(mel_scale, 'UNKNOWN')})")
-        print(f"  compressionType: {compression} ({COMPRESSION_TYPES.get(compression, 'UNKNOWN')})")
-
-        rows = read_u32(f)
-        cols = read_u32(f)
-        print(f"\nFeatureMatrix: {rows} x {cols} (float32)")
-
-        total = rows * cols
-        data_bytes = f.read(total * 4)
-        if len(data_bytes) != total * 4:
-            raise RuntimeError("Unexpected EOF while reading matrix")
-
-        floats = struct.unpack("<" + "f" * total, data_bytes)
-
-        if full_matrix:
-            print("\nMatrix (FULL):")
-            for r in range(rows):
-                row = floats[r*cols : (r+1)*cols]
-                print("  " + " ".join(f"{v: .6f}" for v in row))
-        else:
-            print("\nMatrix preview (first rows/cols):")
-            r_print = min(rows, max_rows_print)
-            c_print = min(cols, max_cols_print)
-            for r in range(r_print):
-                row = floats[r*cols : r*cols + c_print]
-                print(f"  row {r:>4}: " + " ".join(f"{v: .5f}" for v in row) + (" ..." if cols > c_print else ""))
-
-        vad_n = read_u32(f)
-        vad_bytes = f.read(vad_n)
-        if len(vad_bytes) != vad_n:
-            raise RuntimeError("Unexpected EOF while reading VAD flags")
-
-        n_speech = sum(1 for b in vad_bytes if b == 1)
-        n_nonspeech = vad_n - n_speech
-
-        print(f"\nVADFlags: {vad_n} entries")
-        print(f"  Speech:    {n_speech}")
-        print(f"  NonSpeech: {n_nonspeech}")
-        preview = " ".join(str(b) for b in vad_bytes[:50])
-        print(f"  first 50:  {preview}" + (" ..." if vad_n > 50 else ""))
-
-        extra = f.read(1)
-        if extra:
-            print("\n[WARN] File has extra bytes after expected end (format mismatch?)")
-        else:
-            print("\nOK: File structure matches expected .lvf format.")
+ENCODINGS = {0: "float32", 1: "float16", 2: "int16 (per-dim scaled)"}
+
+OPTIONS_BYTES = 41
+ALIGNMENT = 64
+
+def align_up(n: int, a: int = ALIGNMENT) -> int:
+    return (n + a - 1) // a * a
+
+class Cursor:
+    def __init__(self, data: bytes, pos: int = 0):
+        self.data = data
+        self.pos = pos
+
+    def take(self, fmt: str):
+        size = struct.calcsize(fmt)
+        if self.pos + size > len(self.data):
+            raise RuntimeError("Unexpected EOF")
+        v = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += size
+        return v[0] if len(v) == 1 else v
+
+def print_options(c: Cursor):
+    sample_rate = c.take("<i")
+    num_filters = c.take("<i")
+    num_coeffs  = c.take("<i")
+    min_freq = c.take("<d")
+    max_freq = c.take("<d")
+    include_energy = c.take("<B")
+    filterbank = c.take("<I")
+    mel_scale = c.take("<I")
+    compression = c.take("<I")
+
+    print("\nFeatureOptions:")
+    print(f"  sampleRate: {sample_rate}")
+    print(f"  numFilters: {num_filters}")
+    print(f"  numCoeffs:  {num_coeffs}")
+    print(f"  minFreq:    {min_freq}")
+    print(f"  maxFreq:    {max_freq}")
+    print(f"  includeEnergy: {bool(include_energy)}")
+    print(f"  filterbank: {filterbank} ({FILTERBANK_TYPES.get(filterbank, 'UNKNOWN')})")
+    print(f"  melScale:   {mel_scale} ({MEL_SCALES.get(mel_scale, 'UNKNOWN')})")
+    print(f"  compressionType: {compression} ({COMPRESSION_TYPES.get(compression, 'UNKNOWN')})")
+
+def print_matrix(values, rows: int, cols: int, max_rows_print: int, max_cols_print: int, full_matrix: bool):
+    if full_matrix:
+        print("\nMatrix (FULL):")
+        for r in range(rows):
+            row = values[r*cols : (r+1)*cols]
+            print("  " + " ".join(f"{v: .6f}" for v in row))
+    else:
+        print("\nMatrix preview (first rows/cols):")
+        r_print = min(rows, max_rows_print)
+        c_print = min(cols, max_cols_print)
+        for r in range(r_print):
+            row = values[r*cols : r*cols + c_print]
+            print(f"  row {r:>4}: " + " ".join(f"{v: .5f}" for v in row) + (" ..." if cols > c_print else ""))
+
+def print_vad(flags):
+    n_speech = sum(1 for b in flags if b == 1)
+    print(f"\nVADFlags: {len(flags)} entries")
+    print(f"  Speech:    {n_speech}")
+    print(f"  NonSpeech: {len(flags) - n_speech}")
+    preview = " ".join(str(b) for b in flags[:50])
+    print(f"  first 50:  {preview}" + (" ..." if len(flags) > 50 else ""))
+
+def inspect_v1(data: bytes, args):
+    c = Cursor(data, 12)
+    cep_u32 = c.take("<I")
+    print(f"CepstralType: {cep_u32} ({CEPS_TYPES.get(cep_u32, 'UNKNOWN')})")
+    print_options(c)
+
+    rows = c.take("<I")
+    cols = c.take("<I")
+    print(f"\nFeatureMatrix: {rows} x {cols} (float32)")
+
+    total = rows * cols
+    values = c.take("<" + "f" * total) if total else ()
+    if total == 1:
+        values = (values,)
+    print_matrix(values, rows, cols, args.rows, args.cols, args.full_matrix)
+
+    vad_n = c.take("<I")
+    if c.pos + vad_n > len(data):
+        raise RuntimeError("Unexpected EOF while reading VAD flags")
+    print_vad(list(data[c.pos : c.pos + vad_n]))
+    c.pos += vad_n
+
+    if c.pos != len(data):
+        print("\n[WARN] File has extra bytes after expected end (format mismatch?)")
+    else:
+        print("\nOK: File structure matches expected .lvf v1 format.")
+
+def inspect_v2(data: bytes, args):
+    if len(data) < 64:
+        raise RuntimeError("Truncated header")
+    encoding, cep_u32, rows, cols, vad_n = struct.unpack_from("<IIIII", data, 12)
+    checksum, payload_offset, payload_bytes = struct.unpack_from("<QQQ", data, 32)
+
+    print(f"CepstralType: {cep_u32} ({CEPS_TYPES.get(cep_u32, 'UNKNOWN')})")
+    print(f"Encoding: {encoding} ({ENCODINGS.get(encoding, 'UNKNOWN')})")
+    print(f"Payload: offset {payload_offset}, {payload_bytes} bytes, xxh64 {checksum:016x}")
+
+    if encoding not in ENCODINGS:
+        raise RuntimeError(f"Unknown encoding: {encoding}")
+    if payload_offset + payload_bytes > len(data):
+        raise RuntimeError("Unexpected EOF in payload")
+
+    payload = data[payload_offset : payload_offset + payload_bytes]
+    try:
+        import xxhash
+        ok = xxhash.xxh64_intdigest(payload) == checksum
+        print(f"Checksum: {'OK' if ok else 'MISMATCH'}")
+    except ImportError:
+        print("Checksum: not verified (pip install xxhash)")
+
+    print_options(Cursor(payload, 0))
+
+    scalar = 4 if encoding == 0 else 2
+    scales_offset = align_up(OPTIONS_BYTES)
+    matrix_offset = scales_offset + (align_up(2 * cols * 4) if encoding == 2 else 0)
+    vad_offset = matrix_offset + align_up(rows * cols * scalar)
+    if payload_bytes != vad_offset + align_up((vad_n + 7) // 8):
+        raise RuntimeError("Inconsistent payload size")
+
+    total = rows * cols
+    if encoding == 0:
+        values = struct.unpack_from("<" + "f" * total, payload, matrix_offset)
+    elif encoding == 1:
+        values = struct.unpack_from("<" + "e" * total, payload, matrix_offset)
+    else:
+        offsets = struct.unpack_from("<" + "f" * cols, payload, scales_offset)
+        steps = struct.unpack_from("<" + "f" * cols, payload, scales_offset + cols * 4)
+        codes = struct.unpack_from("<" + "h" * total, payload, matrix_offset)
+        values = [offsets[i % cols] + steps[i % cols] * q for i, q in enumerate(codes)]
+        print("\nInt16 scales (first dims):")
+        for d in range(min(cols, args.cols)):
+            print(f"  dim {d:>3}: offset {offsets[d]: .5f} step {steps[d]:.3e}")
+
+    print(f"\nFeatureMatrix: {rows} x {cols} ({ENCODINGS[encoding]})")
+    print_matrix(values, rows, cols, args.rows, args.cols, args.full_matrix)
+
+    bits = payload[vad_offset : vad_offset + (vad_n + 7) // 8]
+    print_vad([(bits[t // 8] >> (t % 8)) & 1 for t in range(vad_n)])
+
+    if payload_offset + payload_bytes != len(data):
+        print("\n[WARN] File has extra bytes after expected end (format mismatch?)")
+    else:
+        print("\nOK: File structure matches expected .lvf v2 format.")
+
+def inspect_lvf(path: Path, args):
+    data = path.read_bytes()
+    if len(data) < 12:
+        raise RuntimeError("File too short")
+    magic = data[:8]
+    version = struct.unpack_from("<I", data, 8)[0]
+
+    print(f"File: {path}")
+    print(f"Magic: {magic!r}")
+    print(f"Version: {version}")
+
+    if magic != b"LVFEAT\x00\x00":
+        raise RuntimeError("Bad magic. This doesn't look like an .lvf written by FeatureSerdes.")
+    if version == 1:
+        inspect_v1(data, args)
+    elif version == 2:
+        inspect_v2(data, args)
+    else:
+        raise RuntimeError(f"Unsupported version: {version}")
 
 def main():
     ap = argparse.ArgumentParser(description="Inspect .lvf files produced by sv::io::FeatureSerdes")
@@ -110,7 +184,7 @@ def main():
     ap.add_argument("--full-matrix", action="store_true", help="Print the full matrix (all rows and columns)")
     args = ap.parse_args()
 
-    inspect_lvf(args.lvf, args.rows, args.cols, args.full_matrix)
+    inspect_lvf(args.lvf, args)
 
 if __name__ == "__main__":
     main()